@@ -1315,6 +1315,120 @@ BOOL SetDutyAutoQst( int iLocCtrl )
 /****************************************************************************/
 /****************************************************************************/
 
+#if defined(__linux__)
+/****************************************************************************/
+/* GetAllConfigs() - Gets the configuration of every sensor and controller  */
+/* in the configuration profile given. The requests are sent together, as   */
+/* one pipelined batch, and each response is placed directly in its slot.   */
+/****************************************************************************/
+
+#define CONFIG_CLASSES  5
+#define CONFIG_MAX      (QST_ABS_TEMP_MONITORS + QST_ABS_FAN_MONITORS + QST_ABS_VOLT_MONITORS + QST_ABS_CURR_MONITORS + QST_ABS_FAN_CONTROLLERS)
+
+static BOOL GetAllConfigs( P_QST_GET_SUBSYSTEM_CONFIG_PROFILE_RSP pstProfile )
+{
+   static const UINT8 abyCommand[CONFIG_CLASSES] =
+   {
+      QST_GET_TEMP_MON_CONFIG,
+      QST_GET_FAN_MON_CONFIG,
+      QST_GET_VOLT_MON_CONFIG,
+      QST_GET_CURR_MON_CONFIG,
+      QST_GET_FAN_CTRL_CONFIG
+   };
+
+   static const size_t atRspSize[CONFIG_CLASSES] =
+   {
+      sizeof(QST_GET_TEMP_MON_CONFIG_RSP),
+      sizeof(QST_GET_FAN_MON_CONFIG_RSP),
+      sizeof(QST_GET_VOLT_MON_CONFIG_RSP),
+      sizeof(QST_GET_CURR_MON_CONFIG_RSP),
+      sizeof(QST_GET_FAN_CTRL_CONFIG_RSP)
+   };
+
+   static const int aiMax[CONFIG_CLASSES] =
+   {
+      QST_ABS_TEMP_MONITORS,
+      QST_ABS_FAN_MONITORS,
+      QST_ABS_VOLT_MONITORS,
+      QST_ABS_CURR_MONITORS,
+      QST_ABS_FAN_CONTROLLERS
+   };
+
+   UINT32            adwConfigured[CONFIG_CLASSES];
+   int               *apiCount[CONFIG_CLASSES];
+   int               *apiIndex[CONFIG_CLASSES];
+   UINT8             *apbyRsp[CONFIG_CLASSES];
+   QST_GENERIC_CMD   astCmd[CONFIG_MAX];
+   QST_BATCH_ENTRY   astEntry[CONFIG_MAX];
+   int               iClass, iBit, iCount, iIndex;
+
+   adwConfigured[0] = pstProfile->dwTempMonsConfigured;
+   adwConfigured[1] = pstProfile->dwFanMonsConfigured;
+   adwConfigured[2] = pstProfile->dwVoltMonsConfigured;
+   adwConfigured[3] = pstProfile->dwCurrMonsConfigured;
+   adwConfigured[4] = pstProfile->dwFanCtrlsConfigured;
+
+   apiCount[0]      = &iTempMons;
+   apiCount[1]      = &iFanMons;
+   apiCount[2]      = &iVoltMons;
+   apiCount[3]      = &iCurrMons;
+   apiCount[4]      = &iFanCtrls;
+
+   apiIndex[0]      = iTempMonIndex;
+   apiIndex[1]      = iFanMonIndex;
+   apiIndex[2]      = iVoltMonIndex;
+   apiIndex[3]      = iCurrMonIndex;
+   apiIndex[4]      = iFanCtrlIndex;
+
+   apbyRsp[0]       = (UINT8 *)stTempMonConfigRsp;
+   apbyRsp[1]       = (UINT8 *)stFanMonConfigRsp;
+   apbyRsp[2]       = (UINT8 *)stVoltMonConfigRsp;
+   apbyRsp[3]       = (UINT8 *)stCurrMonConfigRsp;
+   apbyRsp[4]       = (UINT8 *)stFanCtrlConfigRsp;
+
+   // Build a request for each sensor/controller that is configured
+
+   for( iClass = iCount = 0; iClass < CONFIG_CLASSES; iClass++ )
+   {
+      for( iBit = *apiCount[iClass] = 0; iBit < aiMax[iClass]; iBit++ )
+      {
+         if( BIT_SET( adwConfigured[iClass], iBit ) )
+         {
+            astCmd[iCount].stHeader.byCommand       = abyCommand[iClass];
+            astCmd[iCount].stHeader.byEntity        = (UINT8)iBit;
+            astCmd[iCount].stHeader.wCommandLength  = QST_CMD_DATA_SIZE(QST_GENERIC_CMD);
+            astCmd[iCount].stHeader.wResponseLength = (UINT16)atRspSize[iClass];
+
+            astEntry[iCount].pvCmdBuf = &astCmd[iCount];
+            astEntry[iCount].tCmdSize = sizeof(QST_GENERIC_CMD);
+            astEntry[iCount].pvRspBuf = apbyRsp[iClass] + *apiCount[iClass] * atRspSize[iClass];
+            astEntry[iCount].tRspSize = atRspSize[iClass];
+
+            apiIndex[iClass][(*apiCount[iClass])++] = iBit;
+            iCount++;
+         }
+      }
+   }
+
+   if( !QstCommandBatch( astEntry, iCount ) )
+      return( FALSE );
+
+   // Can't go any further if Subsystem rejected any of them
+
+   for( iIndex = 0; iIndex < iCount; iIndex++ )
+   {
+      if( ((UINT8 *)astEntry[iIndex].pvRspBuf)[0] )
+      {
+         SetQSTError( ((UINT8 *)astEntry[iIndex].pvRspBuf)[0] );
+         return( FALSE );
+      }
+   }
+
+   return( TRUE );
+}
+
+#endif // defined(__linux__)
+
 /****************************************************************************/
 /* EnumerateMonCtrl() - Enumerates the available temperature sensors, fan   */
 /* speed sensors and fan speed controllers, through query of active Monitor */
@@ -1373,6 +1487,14 @@ static BOOL EnumerateMonCtrl( void )
       return( FALSE );
    }
 
+#if defined(__linux__)
+
+   // Ascertain the configuration of every sensor and controller together
+
+   return( GetAllConfigs( &stProfileRsp ) );
+
+#else
+
    // Ascertain temperature sensor count and configuration
 
    for( iBit = iTempMons = 0; iBit < QST_ABS_TEMP_MONITORS; iBit++ )
@@ -1421,7 +1543,7 @@ static BOOL EnumerateMonCtrl( void )
          if( !GetCurrMonConfig( iBit, iCurrMons ) )
             return( FALSE );
 
-         iCurrMonIndex[iVoltMons++] = iBit;
+         iCurrMonIndex[iCurrMons++] = iBit;
       }
    }
 
@@ -1439,6 +1561,9 @@ static BOOL EnumerateMonCtrl( void )
    }
 
    return( TRUE );
+
+#endif
+
 }
 
 /****************************************************************************/
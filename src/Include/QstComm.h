@@ -86,6 +86,138 @@ BOOL QstInitialize( void );
 void QstCleanup( void );
 #endif
 
+#if defined(__linux__)
+/****************************************************************************/
+/* Concurrency modes. The mode may also be selected, before the library     */
+/* loads, through environment variable QST_CONCURRENCY ("exclusive",        */
+/* "process" or "system"). Every mode, exclusive included, still takes the  */
+/* library's per-process mutex around each command.                         */
+/****************************************************************************/
+
+#define QST_CONCURRENCY_EXCLUSIVE   0           // One thread of one process
+#define QST_CONCURRENCY_PROCESS     1           // Threads of one process
+#define QST_CONCURRENCY_SYSTEM      2           // Several processes (default)
+
+BOOL QstSetConcurrency( int iMode );
+int  QstGetConcurrency( void );
+
+/****************************************************************************/
+/* Command with a deadline (milliseconds)                                   */
+/****************************************************************************/
+
+BOOL QstCommandTimed( void *pvCmdBuf, size_t tCmdSize, void *pvRspBuf, size_t tRspSize, int iTimeout );
+
+/****************************************************************************/
+/* Response buffers that may be borrowed for copy-free polling              */
+/****************************************************************************/
+
+#define QST_BORROW_BUFFER_SIZE  4096
+
+void *QstBorrowBuffer( void );
+void  QstReturnBuffer( void *pvBuff );
+
+/****************************************************************************/
+/* Commands sent together                                                   */
+/****************************************************************************/
+
+typedef struct _QST_BATCH_ENTRY
+{
+   void     *pvCmdBuf;                          // Command packet
+   size_t   tCmdSize;                           // Size of command packet
+   void     *pvRspBuf;                          // Buffer for response packet
+   size_t   tRspSize;                           // Expected size of response packet
+   BOOL     bSucceeded;                         // Success indicator
+   int      iErrno;                             // errno value when failed
+
+} QST_BATCH_ENTRY, *P_QST_BATCH_ENTRY;
+
+BOOL QstCommandBatch( P_QST_BATCH_ENTRY pstEntries, int iCount );
+
+/****************************************************************************/
+/* Asynchronous commands, for event loops                                   */
+/****************************************************************************/
+
+#define QST_ASYNC_MAX_OUTSTANDING  64
+
+typedef struct _QST_ASYNC_CMD
+{
+   void     *pvCmdBuf;                          // Command packet
+   size_t   tCmdSize;                           // Size of command packet
+   void     *pvRspBuf;                          // Buffer for response packet
+   size_t   tRspSize;                           // Expected size of response packet
+   void     (*pfnDone)( struct _QST_ASYNC_CMD *pstCmd );
+                                                // Called on completion (may be NULL)
+   void     *pvContext;                         // For application's use
+   BOOL     bDone;                              // Set on completion
+   BOOL     bSucceeded;                         // Success indicator
+   int      iErrno;                             // errno value when failed
+
+} QST_ASYNC_CMD, *P_QST_ASYNC_CMD;
+
+BOOL QstCommandAsync( P_QST_ASYNC_CMD pstCmd );
+int  QstAsyncGetFD( void );
+int  QstAsyncProcess( void );
+
+/****************************************************************************/
+/* Counts of identical concurrent reads that shared a transaction           */
+/****************************************************************************/
+
+typedef struct _QST_COALESCE_STATS
+{
+   unsigned long ulIssued;                      // Reads sent to subsystem
+   unsigned long ulCoalesced;                   // Reads given another's response
+
+} QST_COALESCE_STATS, *P_QST_COALESCE_STATS;
+
+BOOL QstGetCoalesceStats( P_QST_COALESCE_STATS pstStats );
+
+/****************************************************************************/
+/* Configuration stamp. Changes whenever any process sets a sensor's        */
+/* thresholds (and when the system restarts), so that a copy of the         */
+/* sensors' configurations can be checked for staleness.                    */
+/****************************************************************************/
+
+unsigned long long QstGetConfigStamp( void );
+
+/****************************************************************************/
+/* Instrumentation. Latencies are in microseconds and are counted in        */
+/* histogram buckets that are linear below 8us and thereafter split each    */
+/* power of two into four; QST_STATS_BUCKET_FLOOR() gives the smallest      */
+/* latency counted in a bucket (the last bucket also counts all above it).  */
+/****************************************************************************/
+
+#define QST_STATS_COMMANDS          0x23        // QST_LAST_CMD_CODE + 1
+#define QST_STATS_BUCKETS           96
+
+#define QST_STATS_BUCKET_FLOOR(i)   (((i) < 8)? (unsigned long long)(i) : (4ULL + ((i) & 3)) << (((i) - 8) / 4 + 1))
+
+typedef struct _QST_COMMAND_STATS
+{
+   unsigned long long ullCount;                 // Commands completed
+   unsigned long long ullFailed;                // Commands that failed
+   unsigned long long ullTotalTime;             // Sum of latencies
+   unsigned long long ullMaxTime;               // Longest latency
+   unsigned long long aullHistogram[QST_STATS_BUCKETS];
+
+} QST_COMMAND_STATS, *P_QST_COMMAND_STATS;
+
+typedef struct _QST_COMM_STATS
+{
+   unsigned long long ullRetries;               // Transaction attempts repeated
+   unsigned long long ullAttaches;              // Connections formed with driver
+   unsigned long long ullDetaches;              // Connections dropped
+   unsigned long long ullTimeouts;              // Commands that ran out of time
+   unsigned long long ullTranslations;          // Commands translated between command sets
+   unsigned long long ullProbes;                // Subsystem information requests
+   QST_COMMAND_STATS  astCommand[QST_STATS_COMMANDS];
+                                                // Indexed by (QST 2.x) command code
+} QST_COMM_STATS, *P_QST_COMM_STATS;
+
+BOOL QstCommEnableStats( BOOL bEnable );
+BOOL QstCommGetStats( P_QST_COMM_STATS pstStats );
+
+#endif // defined(__linux__)
+
 #if defined(_WIN32) || defined(__WIN32__)
 /****************************************************************************/
 /* Definitions for explicit DLL loading in the Windows environment          */
@@ -221,6 +221,94 @@ typedef enum _QST_CONTROL_STATE
 
 } QST_CONTROL_STATE;
 
+#if defined(__linux__)
+/****************************************************************************/
+/* QST_SNAPSHOT - A structure that receives every sensor reading and health */
+/* state, and every controller duty cycle, health and control state, taken  */
+/* from a single update of the QST Subsystem. Sensors are grouped by        */
+/* QST_SENSOR_TYPE; within a group, and for controllers, entries appear in  */
+/* index order. The generation identifies the update; the timestamp gives   */
+/* the CLOCK_MONOTONIC time, in milliseconds, at which it was obtained.     */
+/****************************************************************************/
+
+#define QST_SENSOR_TYPES                        4
+#define QST_MAX_SNAPSHOT_ENTRIES                32
+
+typedef struct _QST_SNAPSHOT_SENSORS
+{
+    int                                         Count;
+    float                                       Reading[QST_MAX_SNAPSHOT_ENTRIES];
+    QST_HEALTH                                  Health[QST_MAX_SNAPSHOT_ENTRIES];
+
+} QST_SNAPSHOT_SENSORS;
+
+typedef struct _QST_SNAPSHOT
+{
+    unsigned long                               Generation;
+    unsigned long long                          Timestamp;
+    QST_SNAPSHOT_SENSORS                        Sensor[QST_SENSOR_TYPES];
+    int                                         ControllerCount;
+    float                                       ControllerDuty[QST_MAX_SNAPSHOT_ENTRIES];
+    QST_HEALTH                                  ControllerHealth[QST_MAX_SNAPSHOT_ENTRIES];
+    QST_CONTROL_STATE                           ControlState[QST_MAX_SNAPSHOT_ENTRIES];
+
+} QST_SNAPSHOT;
+
+/****************************************************************************/
+/* QST_SUBSCRIPTION - A structure that records the events a process wishes  */
+/* to wait for using QstWaitForEvents(), as set up by QstSubscribe(), and   */
+/* the last event it has seen. Health and threshold changes are only        */
+/* reported for sensors and controllers whose bits are set in the masks     */
+/* (bit n for index n); QstSubscribe() sets them all, and callers may clear */
+/* those they are not interested in.                                        */
+/****************************************************************************/
+
+#define QST_EVENT_NEW_READINGS                  0x00000001
+#define QST_EVENT_HEALTH_CHANGE                 0x00000002
+#define QST_EVENT_THRESHOLD_CHANGE              0x00000004
+#define QST_EVENT_POLLING_CHANGE                0x00000008
+
+typedef struct _QST_SUBSCRIPTION
+{
+    unsigned long                               Events;
+    unsigned long                               SensorMask[QST_SENSOR_TYPES];
+    unsigned long                               ControllerMask;
+    unsigned long                               LastEvent;
+
+} QST_SUBSCRIPTION;
+
+/****************************************************************************/
+/* QST_HISTORY_SAMPLE / QST_HISTORY_STATS - Structures that receive the     */
+/* recent readings of a sensor, as recorded by the library for the last     */
+/* QST_HISTORY_SAMPLES refreshes of its readings, and the count, the times  */
+/* of the oldest and newest, and the minimum, maximum and mean of those     */
+/* taken within a window. Timestamps are CLOCK_MONOTONIC times in           */
+/* milliseconds, as in QST_SNAPSHOT. Readings are only recorded when they   */
+/* are refreshed: either because a caller asked for them or by the          */
+/* background refresher.                                                    */
+/****************************************************************************/
+
+#define QST_HISTORY_SAMPLES                     128
+
+typedef struct _QST_HISTORY_SAMPLE
+{
+    unsigned long long                          Timestamp;
+    float                                       Reading;
+
+} QST_HISTORY_SAMPLE;
+
+typedef struct _QST_HISTORY_STATS
+{
+    int                                         Count;
+    unsigned long long                          Oldest;
+    unsigned long long                          Newest;
+    float                                       Minimum;
+    float                                       Maximum;
+    float                                       Mean;
+
+} QST_HISTORY_STATS;
+#endif
+
 /****************************************************************************/
 /* Function Prototypes for implicit DLL loading (static binding)            */
 /****************************************************************************/
@@ -272,6 +360,26 @@ BOOL APIENTRY QstGetSensorReading
     OUT float                                   *pSensorReading
 );
 
+#if defined(__linux__)
+BOOL APIENTRY QstGetSensorHistory
+(
+    IN  QST_SENSOR_TYPE                         SensorType,
+    IN  int                                     SensorIndex,
+    IN  unsigned long                           Window,
+    IN  int                                     MaxSamples,
+    OUT QST_HISTORY_SAMPLE                      *pSamples,
+    OUT int                                     *pSampleCount
+);
+
+BOOL APIENTRY QstGetSensorHistoryStats
+(
+    IN  QST_SENSOR_TYPE                         SensorType,
+    IN  int                                     SensorIndex,
+    IN  unsigned long                           Window,
+    OUT QST_HISTORY_STATS                       *pStats
+);
+#endif
+
 BOOL APIENTRY QstSetSensorThresholdsHigh
 (
     IN  QST_SENSOR_TYPE                         SensorType,
@@ -346,6 +454,33 @@ BOOL APIENTRY QstPollingIntervalChanged
     OUT BOOL                                    *pUpdated
 );
 
+#if defined(__linux__)
+BOOL APIENTRY QstGetAllReadings
+(
+    OUT QST_SNAPSHOT                            *pSnapshot
+);
+
+BOOL APIENTRY QstGetReadingsSince
+(
+    IN  unsigned long                           Generation,
+    OUT QST_SNAPSHOT                            *pSnapshot,
+    OUT BOOL                                    *pUpdated
+);
+
+BOOL APIENTRY QstSubscribe
+(
+    IN  unsigned long                           Events,
+    OUT QST_SUBSCRIPTION                        *pSubscription
+);
+
+BOOL APIENTRY QstWaitForEvents
+(
+    IN OUT QST_SUBSCRIPTION                     *pSubscription,
+    IN  int                                     Timeout,
+    OUT unsigned long                           *pEvents
+);
+#endif
+
 /****************************************************************************/
 /* Initialization functions                                                 */
 /****************************************************************************/
@@ -58,61 +58,907 @@
 #include <ctype.h>
 #include <errno.h>
 
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 #include "QstDll.h"
 #include "QstComm.h"
+#include "QstInst.h"
+
+/****************************************************************************/
+/* SetQSTError() - Places the appropriate error code for the QST error      */
+/* into the appropriate error variable for the environment.                 */
+/****************************************************************************/
+
+#ifdef __WIN32__
+
+static const DWORD dwWin32Map[] =
+{
+   ERROR_SUCCESS,               // QST_CMD_SUCCESSFUL
+   ERROR_NOT_SUPPORTED,         // QST_CMD_REJECTED_UNSUPPORTED
+   ERROR_ACCESS_DENIED,         // QST_CMD_REJECTED_LOCKED
+   ERROR_INVALID_PARAMETER,     // QST_CMD_REJECTED_PARAMETER
+   ERROR_REVISION_MISMATCH,     // QST_CMD_REJECTED_VERSION
+   ERROR_GEN_FAILURE,           // QST_CMD_FAILED_COMM_ERROR
+   ERROR_BAD_UNIT,              // QST_CMD_FAILED_SENSOR_ERROR
+   ERROR_NOT_ENOUGH_MEMORY,     // QST_CMD_FAILED_NO_MEMORY
+   ERROR_NO_SYSTEM_RESOURCES,   // QST_CMD_FAILED_NO_RESOURCES
+   ERROR_INVALID_FUNCTION,      // QST_CMD_REJECTED_INVALID
+   ERROR_BAD_COMMAND,           // QST_CMD_REJECTED_CMD_SIZE
+   ERROR_BAD_LENGTH             // QST_CMD_REJECTED_RSP_SIZE
+};
+
+#else
+
+static const int iErrnoMap[] =
+{
+   0,                           // QST_CMD_SUCCESSFUL
+   ENOEXEC,                     // QST_CMD_REJECTED_UNSUPPORTED
+   EACCES,                      // QST_CMD_REJECTED_LOCKED
+   EINVAL,                      // QST_CMD_REJECTED_PARAMETER
+   EDOM,                        // QST_CMD_REJECTED_VERSION
+   EIO,                         // QST_CMD_FAILED_COMM_ERROR
+   EFAULT,                      // QST_CMD_FAILED_SENSOR_ERROR
+   ENOMEM,                      // QST_CMD_FAILED_NO_MEMORY
+   ENOSPC,                      // QST_CMD_FAILED_NO_RESOURCES
+   EPERM,                       // QST_CMD_REJECTED_INVALID
+   ERANGE,                      // QST_CMD_REJECTED_CMD_SIZE
+   ERANGE                       // QST_CMD_REJECTED_RSP_SIZE
+};
+
+#endif
+
+static void SetQSTError( UINT8 byStatus )
+{
+
+#ifdef __WIN32__
+   SetLastError( (byStatus <= QST_CMD_REJECTED_RSP_SIZE)? dwWin32Map[byStatus] : ERROR_NONE_MAPPED );
+#else
+   errno = (byStatus <= QST_CMD_REJECTED_RSP_SIZE)? iErrnoMap[byStatus] : ENOENT;
+#endif
+
+}
+
+#if defined(__linux__)
+/****************************************************************************/
+/* MonitorHealth() - Gives the health of a monitor from its status, the     */
+/* monitor's own status taking precedence over the threshold status         */
+/****************************************************************************/
+
+static UINT8 MonitorHealth( QST_MON_HEALTH_STATUS *pstStatus )
+{
+   return( (UINT8)(pstStatus->uMonitorStatus? pstStatus->uMonitorStatus : pstStatus->uThresholdStatus) );
+}
+
+/****************************************************************************/
+/* ClassInterval() - Returns the polling interval configured for a class of */
+/* sensor or controller                                                     */
+/****************************************************************************/
+
+static DWORD ClassInterval( int iClass )
+{
+   DWORD dwInterval = pQstSeg->stPolling.dwClass[iClass];
+
+   return( dwInterval? dwInterval : pQstSeg->dwPollingInterval );
+}
+
+/****************************************************************************/
+/* ClassEntries() - Returns the number of sensors or controllers in a class */
+/****************************************************************************/
+
+static int ClassEntries( int iClass )
+{
+   switch( iClass )
+   {
+   case HOT_TEMP_MON:
+
+      return( pQstSeg->iTempMons );
+
+   case HOT_FAN_MON:
+
+      return( pQstSeg->iFanMons );
+
+   case HOT_VOLT_MON:
+
+      return( pQstSeg->iVoltMons );
+
+   case HOT_CURR_MON:
+
+      return( pQstSeg->iCurrMons );
+
+   default:
+
+      return( pQstSeg->iFanCtrls );
+   }
+}
+
+/****************************************************************************/
+/* NearThreshold() - Indicates whether a reading is within the specified    */
+/* fraction of an upper or lower threshold, or beyond it. The non-critical  */
+/* threshold is used, or the critical one if there is no non-critical one   */
+/* (a threshold of zero being absent).                                      */
+/****************************************************************************/
+
+#define ABS_FLOAT(f)    (((f) < 0.0f)? -(f) : (f))
+
+static BOOL NearThreshold( P_QST_THRESH pstThresh, BOOL bUpper, float fReading, float fMargin )
+{
+   float fLimit = (pstThresh->fNonCritical != 0.0f)? pstThresh->fNonCritical : pstThresh->fCritical;
+
+   if( fLimit == 0.0f )
+      return( FALSE );
+
+   fMargin *= ABS_FLOAT( fLimit );
+
+   return( bUpper? (fReading >= fLimit - fMargin) : (fReading <= fLimit + fMargin) );
+}
+
+/****************************************************************************/
+/* AdaptPolling() - Sets the interval at which a class is to poll (see      */
+/* QST_POLLING), from the readings just converted into its hot block and    */
+/* the previous readings given. Without adaptive polling, this is simply    */
+/* the interval configured for the class.                                   */
+/****************************************************************************/
+
+#define ADAPT_STEADY    1               // Largest change in a steady reading (% of reading)
+
+static void AdaptPolling( int iClass, float *pfLast )
+{
+   P_QST_POLLING     pstPolling = &pQstSeg->stPolling;
+   P_QST_HOT_BLOCK   pstHot     = &pQstSeg->stHot[iClass];
+   P_QST_THRESH      pstLower   = NULL, pstUpper = NULL;
+   DWORD             dwBase     = ClassInterval( iClass ), dwInterval = dwBase;
+   float             fMargin    = (float)pstPolling->dwMargin / 100.0f, fChange;
+   BOOL              bNear      = FALSE, bSteady = TRUE;
+   int               iIndex, iEntries = ClassEntries( iClass );
+
+   if( pstPolling->dwMargin )
+   {
+      switch( iClass )
+      {
+      case HOT_TEMP_MON:
+
+         pstUpper = pQstSeg->stTempMonThresh;
+         break;
+
+      case HOT_FAN_MON:
+
+         pstLower = pQstSeg->stFanMonThresh;
+         break;
+
+      case HOT_VOLT_MON:
+
+         pstLower = pQstSeg->stVoltMonThreshLow;
+         pstUpper = pQstSeg->stVoltMonThreshHigh;
+         break;
+
+      case HOT_CURR_MON:
+
+         pstLower = pQstSeg->stCurrMonThreshLow;
+         pstUpper = pQstSeg->stCurrMonThreshHigh;
+         break;
+
+      default:
+
+         break;                              // No thresholds; health only
+      }
+
+      for( iIndex = 0; iIndex < iEntries; iIndex++ )
+      {
+         if(    (pstHot->byHealth[iIndex] != HEALTH_NORMAL)
+             || (pstUpper && NearThreshold( &pstUpper[iIndex], TRUE, pstHot->fReading[iIndex], fMargin ))
+             || (pstLower && NearThreshold( &pstLower[iIndex], FALSE, pstHot->fReading[iIndex], fMargin )) )
+            bNear = TRUE;
+
+         fChange = pstHot->fReading[iIndex] - pfLast[iIndex];
+
+         if( ABS_FLOAT( fChange ) * 100.0f > ABS_FLOAT( pfLast[iIndex] ) * ADAPT_STEADY )
+            bSteady = FALSE;
+      }
+
+      // Speed up near a threshold, else back off while readings hold steady
+
+      if( bNear )
+         dwInterval = (pstPolling->dwFast < dwBase)? pstPolling->dwFast : dwBase;
+      else if( bSteady )
+      {
+         dwInterval = 2 * pstPolling->dwCurrent[iClass];
+
+         if( dwInterval < dwBase )
+            dwInterval = dwBase;
+         else if( dwInterval > dwBase * pstPolling->dwBackoff )
+            dwInterval = dwBase * pstPolling->dwBackoff;
+      }
+   }
+
+   pstPolling->dwCurrent[iClass] = dwInterval;
+}
+
+/****************************************************************************/
+/* SaveHotBlock() - Converts the readings and health of one class of sensor */
+/* or controller from its update response into its hot block, along with    */
+/* the time they are next due to be refreshed: the time of this refresh     */
+/* plus the interval the class is now to poll at (see AdaptPolling()).      */
+/* Entries whose health has changed are given the stamp of the event that   */
+/* will announce the update.                                                */
+/****************************************************************************/
+
+static void SaveHotBlock( int iClass, MILLITIME *pstRefreshTime )
+{
+   P_QST_HOT_BLOCK   pstHot = &pQstSeg->stHot[iClass];
+   UINT8             abyHealth[QST_HOT_ENTRIES];
+   float             afReading[QST_HOT_ENTRIES];
+   int               iIndex;
+
+   memcpy( abyHealth, pstHot->byHealth, sizeof(abyHealth) );
+   memcpy( afReading, pstHot->fReading, sizeof(afReading) );
+
+   BeginSeqWrite( &pstHot->uSequence );
+
+   switch( iClass )
+   {
+   case HOT_TEMP_MON:
+
+      for( iIndex = 0; iIndex < pQstSeg->iTempMons; iIndex++ )
+      {
+         QST_TEMP_MON_UPDATE *pstUpdate = &pQstSeg->stTempMonUpdateRsp.stMonitorUpdate[pQstSeg->iTempMonIndex[iIndex]];
+
+         pstHot->fReading[iIndex] = QST_TEMP_TO_FLOAT( pstUpdate->lfCurrentReading );
+         pstHot->byHealth[iIndex] = MonitorHealth( &pstUpdate->stMonitorStatus );
+      }
+
+      break;
+
+   case HOT_FAN_MON:
+
+      for( iIndex = 0; iIndex < pQstSeg->iFanMons; iIndex++ )
+      {
+         QST_FAN_MON_UPDATE *pstUpdate = &pQstSeg->stFanMonUpdateRsp.stMonitorUpdate[pQstSeg->iFanMonIndex[iIndex]];
+
+         pstHot->fReading[iIndex] = (float)pstUpdate->uCurrentSpeed;
+         pstHot->byHealth[iIndex] = MonitorHealth( &pstUpdate->stMonitorStatus );
+      }
+
+      break;
+
+   case HOT_VOLT_MON:
+
+      for( iIndex = 0; iIndex < pQstSeg->iVoltMons; iIndex++ )
+      {
+         QST_VOLT_MON_UPDATE *pstUpdate = &pQstSeg->stVoltMonUpdateRsp.stMonitorUpdate[pQstSeg->iVoltMonIndex[iIndex]];
+
+         pstHot->fReading[iIndex] = QST_VOLT_TO_FLOAT( pstUpdate->iCurrentVoltage );
+         pstHot->byHealth[iIndex] = MonitorHealth( &pstUpdate->stMonitorStatus );
+      }
+
+      break;
+
+   case HOT_CURR_MON:
+
+      for( iIndex = 0; iIndex < pQstSeg->iCurrMons; iIndex++ )
+      {
+         QST_CURR_MON_UPDATE *pstUpdate = &pQstSeg->stCurrMonUpdateRsp.stMonitorUpdate[pQstSeg->iCurrMonIndex[iIndex]];
+
+         pstHot->fReading[iIndex] = QST_CURR_TO_FLOAT( pstUpdate->iCurrentCurrent );
+         pstHot->byHealth[iIndex] = MonitorHealth( &pstUpdate->stMonitorStatus );
+      }
+
+      break;
+
+   case HOT_FAN_CTRL:
+
+      for( iIndex = 0; iIndex < pQstSeg->iFanCtrls; iIndex++ )
+      {
+         QST_FAN_CTRL_UPDATE *pstUpdate = &pQstSeg->stFanCtrlUpdateRsp.stControllerUpdate[pQstSeg->iFanCtrlIndex[iIndex]];
+
+         pstHot->fReading[iIndex] = QST_DUTY_TO_FLOAT( pstUpdate->uCurrentDutyCycle );
+         pstHot->byHealth[iIndex] = (UINT8)pstUpdate->stControllerStatus.uControllerStatus;
+
+         if( pstUpdate->stControllerStatus.bOverrideSoftware )
+            pstHot->byControl[iIndex] = CONTROL_OVERRIDE_SOFTWARE;
+         else if( pstUpdate->stControllerStatus.bOverrideFanController )
+            pstHot->byControl[iIndex] = CONTROL_OVERRIDE_CONTROLLER_ERROR;
+         else if( pstUpdate->stControllerStatus.bOverrideTemperatureSensor )
+            pstHot->byControl[iIndex] = CONTROL_OVERRIDE_SENSOR_ERROR;
+         else
+            pstHot->byControl[iIndex] = CONTROL_NORMAL;
+      }
+
+      break;
+   }
+
+   AdaptPolling( iClass, afReading );
+
+   CopyMTime( &pstHot->stUpdateTime, pstRefreshTime );
+   AddMTime( &pstHot->stUpdateTime, 0, pQstSeg->stPolling.dwCurrent[iClass] );
+   EndSeqWrite( &pstHot->uSequence );
+
+   for( iIndex = 0; iIndex < QST_HOT_ENTRIES; iIndex++ )
+   {
+      if( pstHot->byHealth[iIndex] != abyHealth[iIndex] )
+         pQstSeg->stEvents.uHealth[iClass][iIndex] = NextEventStamp( pQstSeg );
+   }
+}
+
+/****************************************************************************/
+/* AssignHistory() - Hands out series from the pool in the global memory    */
+/* segment to the sensors whose readings are to be recorded (see            */
+/* QST_HISTORY), class by class, once they have been enumerated             */
+/****************************************************************************/
+
+static void AssignHistory( void )
+{
+   int   iClass, iSeries = 0, iEntries;
+
+   for( iClass = 0; iClass < HISTORY_CLASSES; iClass++ )
+   {
+      if( (iEntries = ClassEntries( iClass )) > HISTORY_SERIES - iSeries )
+         iEntries = HISTORY_SERIES - iSeries;
+
+      pQstSeg->stHistory[iClass].iSeries  = iSeries;
+      pQstSeg->stHistory[iClass].iEntries = iEntries;
+      iSeries += iEntries;
+   }
+}
+
+/****************************************************************************/
+/* SaveHistory() - Adds the readings just converted into the hot block of a */
+/* sensor class to its history, as a sample taken at the time given (ms).   */
+/* Beside each reading go the running total and, level by level, the least  */
+/* and greatest of the 2, 4 .. HISTORY_SAMPLES readings ending with it:     */
+/* each level pairs the level below it, here, with the same level half its  */
+/* span back, so a sample costs one step per level.                         */
+/****************************************************************************/
+
+static void SaveHistory( int iClass, unsigned long long ullTime )
+{
+   P_QST_HISTORY        pstHist   = &pQstSeg->stHistory[iClass];
+   P_QST_HOT_BLOCK      pstHot    = &pQstSeg->stHot[iClass];
+   P_QST_HISTORY_SERIES pstSeries;
+   unsigned long long   ullSample = pstHist->ullSamples;
+   unsigned             uSlot     = (unsigned)(ullSample % HISTORY_SAMPLES), uBack, uBackSlot;
+   float                fMin, fMax, fBackMin, fBackMax;
+   int                  iIndex, iLevel;
+
+   BeginSeqWrite( &pstHist->uSequence );
+
+   pstHist->ullTime[uSlot] = ullTime;
+
+   for( iIndex = 0; iIndex < pstHist->iEntries; iIndex++ )
+   {
+      pstSeries = &pQstSeg->stSeries[pstHist->iSeries + iIndex];
+      fMin      = fMax = pstHot->fReading[iIndex];
+
+      pstSeries->fReading[uSlot] = fMin;
+      pstSeries->dTotal[uSlot]   = ullSample? pstSeries->dTotal[(ullSample - 1) % HISTORY_SAMPLES] + fMin : fMin;
+
+      for( iLevel = 0; iLevel < HISTORY_LEVELS; iLevel++ )
+      {
+         // Spans start short until there are enough samples to fill them
+
+         if( ullSample >= (uBack = 1U << iLevel) )
+         {
+            uBackSlot = (unsigned)((ullSample - uBack) % HISTORY_SAMPLES);
+            fBackMin  = iLevel? pstSeries->fMin[iLevel - 1][uBackSlot] : pstSeries->fReading[uBackSlot];
+            fBackMax  = iLevel? pstSeries->fMax[iLevel - 1][uBackSlot] : pstSeries->fReading[uBackSlot];
+
+            if( fBackMin < fMin )
+               fMin = fBackMin;
+
+            if( fBackMax > fMax )
+               fMax = fBackMax;
+         }
+
+         pstSeries->fMin[iLevel][uSlot] = fMin;
+         pstSeries->fMax[iLevel][uSlot] = fMax;
+      }
+   }
+
+   pstHist->ullSamples = ullSample + 1;
+   EndSeqWrite( &pstHist->uSequence );
+}
+
+/****************************************************************************/
+/* RefreshUpdates() - Requests updated readings/settings and health status  */
+/* for the class of sensor or controller specified (if any) and every other */
+/* class due to be refreshed by the horizon time given, in a single batch,  */
+/* so they are verified once, sent under one hold of the critical section   */
+/* and pipelined with each other. Each class whose request succeeds has its */
+/* polling interval restarted from the refresh time given. The outcome for  */
+/* the class specified is returned. Responses are gathered locally and then */
+/* copied into the global memory segment in one short write under the       */
+/* update sequence count, so readers that don't take the critical section   */
+/* never see a partial update. The hot block of each class refreshed is     */
+/* rewritten from its response within the same write, along with the time   */
+/* of the refresh, so that a reader checking the update sequence count gets */
+/* every block from one generation, and its readings are added to the       */
+/* class's history. Finally an event is posted to wake any processes        */
+/* waiting for readings. If no class was refreshed, the segment is left     */
+/* alone: neither the update sequence count nor the time of the last        */
+/* refresh moves, and no event is posted.                                   */
+/****************************************************************************/
+
+#define UPDATE_TEMP_MON HOT_TEMP_MON
+#define UPDATE_FAN_MON  HOT_FAN_MON
+#define UPDATE_VOLT_MON HOT_VOLT_MON
+#define UPDATE_CURR_MON HOT_CURR_MON
+#define UPDATE_FAN_CTRL HOT_FAN_CTRL
+#define UPDATE_CLASSES  HOT_CLASSES
+
+static BOOL RefreshUpdates( int iClass, MILLITIME *pstRefreshTime, MILLITIME *pstHorizon )
+{
+   static const UINT8 abyCommand[UPDATE_CLASSES] =
+   {
+      QST_GET_TEMP_MON_UPDATE,
+      QST_GET_FAN_MON_UPDATE,
+      QST_GET_VOLT_MON_UPDATE,
+      QST_GET_CURR_MON_UPDATE,
+      QST_GET_FAN_CTRL_UPDATE
+   };
+
+   static const size_t atRspSize[UPDATE_CLASSES] =
+   {
+      sizeof(QST_GET_TEMP_MON_UPDATE_RSP),
+      sizeof(QST_GET_FAN_MON_UPDATE_RSP),
+      sizeof(QST_GET_VOLT_MON_UPDATE_RSP),
+      sizeof(QST_GET_CURR_MON_UPDATE_RSP),
+      sizeof(QST_GET_FAN_CTRL_UPDATE_RSP)
+   };
+
+   UINT8             *apbyRsp[UPDATE_CLASSES];
+   MILLITIME         *apstTime[UPDATE_CLASSES];
+   QST_GENERIC_CMD   astCmd[UPDATE_CLASSES];
+   QST_BATCH_ENTRY   astEntry[UPDATE_CLASSES];
+   MILLITIME         stStamp;
+   unsigned long long ullStamp;
+   BOOL              bPosted = FALSE;
+   int               aiClass[UPDATE_CLASSES], iEntries = 0, iEntry, iWanted = -1, iIndex;
+
+   struct
+   {
+      QST_GET_TEMP_MON_UPDATE_RSP   stTempMon;
+      QST_GET_FAN_MON_UPDATE_RSP    stFanMon;
+      QST_GET_VOLT_MON_UPDATE_RSP   stVoltMon;
+      QST_GET_CURR_MON_UPDATE_RSP   stCurrMon;
+      QST_GET_FAN_CTRL_UPDATE_RSP   stFanCtrl;
+
+   }                 stStage;
+   UINT8             *apbyStage[UPDATE_CLASSES];
+
+   apbyRsp[UPDATE_TEMP_MON]  = (UINT8 *)&pQstSeg->stTempMonUpdateRsp;
+   apbyRsp[UPDATE_FAN_MON]   = (UINT8 *)&pQstSeg->stFanMonUpdateRsp;
+   apbyRsp[UPDATE_VOLT_MON]  = (UINT8 *)&pQstSeg->stVoltMonUpdateRsp;
+   apbyRsp[UPDATE_CURR_MON]  = (UINT8 *)&pQstSeg->stCurrMonUpdateRsp;
+   apbyRsp[UPDATE_FAN_CTRL]  = (UINT8 *)&pQstSeg->stFanCtrlUpdateRsp;
+
+   apstTime[UPDATE_TEMP_MON] = &pQstSeg->stTempMonUpdateTime;
+   apstTime[UPDATE_FAN_MON]  = &pQstSeg->stFanMonUpdateTime;
+   apstTime[UPDATE_VOLT_MON] = &pQstSeg->stVoltMonUpdateTime;
+   apstTime[UPDATE_CURR_MON] = &pQstSeg->stCurrMonUpdateTime;
+   apstTime[UPDATE_FAN_CTRL] = &pQstSeg->stFanCtrlUpdateTime;
+
+   apbyStage[UPDATE_TEMP_MON] = (UINT8 *)&stStage.stTempMon;
+   apbyStage[UPDATE_FAN_MON]  = (UINT8 *)&stStage.stFanMon;
+   apbyStage[UPDATE_VOLT_MON] = (UINT8 *)&stStage.stVoltMon;
+   apbyStage[UPDATE_CURR_MON] = (UINT8 *)&stStage.stCurrMon;
+   apbyStage[UPDATE_FAN_CTRL] = (UINT8 *)&stStage.stFanCtrl;
+
+   // Send the Update requests, for the class wanted and those due
+
+   for( iIndex = 0; iIndex < UPDATE_CLASSES; iIndex++ )
+   {
+      if( iIndex == iClass )
+         iWanted = iEntries;
+      else if( !PastMTime( apstTime[iIndex], pstHorizon ) )
+         continue;
+
+      aiClass[iEntries] = iIndex;
+
+      astCmd[iEntries].stHeader.byCommand       = abyCommand[iIndex];
+      astCmd[iEntries].stHeader.byEntity        = 0;
+      astCmd[iEntries].stHeader.wCommandLength  = QST_CMD_DATA_SIZE(QST_GENERIC_CMD);
+      astCmd[iEntries].stHeader.wResponseLength = (UINT16)atRspSize[iIndex];
+
+      astEntry[iEntries].pvCmdBuf = &astCmd[iEntries];
+      astEntry[iEntries].tCmdSize = sizeof(QST_GENERIC_CMD);
+      astEntry[iEntries].pvRspBuf = apbyStage[iIndex];
+      astEntry[iEntries].tRspSize = atRspSize[iIndex];
+      iEntries++;
+   }
+
+   if( !iEntries )
+      return( TRUE );
+
+   QstCommandBatch( astEntry, iEntries );
+
+   // Publish those that worked, along with the time of their next update.
+   // If none did, readers aren't disturbed (nor sent round again)
+
+   for( iEntry = 0; iEntry < iEntries; iEntry++ )
+   {
+      if( astEntry[iEntry].bSucceeded && !apbyStage[aiClass[iEntry]][0] )
+         bPosted = TRUE;
+   }
+
+   if( bPosted )
+   {
+      CurrMTime( &stStamp );
+      ullStamp = stStamp.uTimeNS / 1000000;
+
+      BeginUpdateWrite( pQstSeg );
+
+      for( iEntry = 0; iEntry < iEntries; iEntry++ )
+      {
+         iIndex = aiClass[iEntry];
+
+         if( astEntry[iEntry].bSucceeded && !apbyStage[iIndex][0] )
+         {
+            memcpy( apbyRsp[iIndex], apbyStage[iIndex], atRspSize[iIndex] );
+            SaveHotBlock( iIndex, pstRefreshTime );
+            CopyMTime( apstTime[iIndex], &pQstSeg->stHot[iIndex].stUpdateTime );
+
+            if( iIndex < HISTORY_CLASSES )
+               SaveHistory( iIndex, ullStamp );
+         }
+      }
+
+      pQstSeg->ullUpdateStamp = ullStamp;
+
+      EndUpdateWrite( pQstSeg );
+
+      pQstSeg->stEvents.uReadings = NextEventStamp( pQstSeg );
+      PostEvent( &pQstSeg->stEvents, pQstSeg->stEvents.uReadings );
+   }
+
+   // Can't go any further if the one we're after failed
+
+   if( iWanted < 0 )
+      return( TRUE );
+
+   if( !astEntry[iWanted].bSucceeded )
+   {
+      errno = astEntry[iWanted].iErrno;
+      return( FALSE );
+   }
+
+   if( apbyStage[iClass][0] )
+   {
+      SetQSTError( apbyStage[iClass][0] );
+      return( FALSE );
+   }
+
+   return( TRUE );
+}
+
+/****************************************************************************/
+/* RefreshAllQst() - Refreshes, for the background refresher, every class   */
+/* of sensor and controller that would otherwise fall due before the        */
+/* refresher's next cycle, iPeriod ms from now, has completed. They are     */
+/* refreshed ahead of time, being marked as refreshed half a period from    */
+/* now, so that callers find them current until then. Must be called from   */
+/* within the critical section.                                             */
+/****************************************************************************/
+
+BOOL RefreshAllQst( int iPeriod )
+{
+   MILLITIME stRefreshTime, stHorizon;
+
+   CurrMTime( &stRefreshTime );
+   AddMTime( &stRefreshTime, 0, (unsigned long)iPeriod / 2 );
+
+   CopyMTime( &stHorizon, &stRefreshTime );
+   AddMTime( &stHorizon, 0, (unsigned long)iPeriod );
+
+   return( RefreshUpdates( -1, &stRefreshTime, &stHorizon ) );
+}
+
+/****************************************************************************/
+/* RefreshPeriodQst() - Returns the shortest interval (ms) at which any     */
+/* class of sensor or controller is polling, which the background refresher */
+/* must keep up with                                                        */
+/****************************************************************************/
+
+DWORD RefreshPeriodQst( void )
+{
+   DWORD dwPeriod = 0, dwInterval;
+   int   iClass;
+
+   for( iClass = 0; iClass < HOT_CLASSES; iClass++ )
+   {
+      if( (dwInterval = pQstSeg->stPolling.dwCurrent[iClass]) == 0 )
+         dwInterval = ClassInterval( iClass );
+
+      if( !iClass || (dwInterval < dwPeriod) )
+         dwPeriod = dwInterval;
+   }
+
+   return( dwPeriod );
+}
+
+#endif // defined(__linux__)
+
+#if defined(__linux__)
+/****************************************************************************/
+/* Enumeration cache. The configurations and thresholds that                */
+/* EnumerateMonCtrl() gathers are saved in a file (ENUM_CACHE_FILE, or that */
+/* named by environment variable QST_ENUM_CACHE; an empty name disables     */
+/* the cache), keyed by the subsystem's information (firmware version) and  */
+/* configuration profile responses, the kernel's boot id and the            */
+/* configuration stamp from QstGetConfigStamp(). While the key still        */
+/* matches, the enumeration is loaded from the file instead of being        */
+/* requested one sensor at a time. Any process setting thresholds (whether  */
+/* through this library or with QstCommand()) changes the stamp, as does a  */
+/* restart, so that the next enumeration starts from what the subsystem     */
+/* reports.                                                                 */
+/****************************************************************************/
+
+#define ENUM_CACHE_FILE     "/var/cache/QstEnum.bin"
+#define ENUM_CACHE_MAGIC    'QSTE'
+#define ENUM_CACHE_VERSION  2
+#define ENUM_CACHE_BOOT_ID  "/proc/sys/kernel/random/boot_id"
+
+typedef struct _ENUM_CACHE
+{
+   UINT32                                uMagic;
+   UINT32                                uVersion;
+   UINT32                                uSize;              // Size of this structure
+
+   QST_GET_SUBSYSTEM_INFO_RSP            stInfoKey;
+   QST_GET_SUBSYSTEM_CONFIG_PROFILE_RSP  stProfileKey;
+   char                                  szBootIdKey[40];
+   unsigned long long                    ullStampKey;
+
+   int                                   iTempMons;
+   int                                   iTempMonIndex[QST_ABS_TEMP_MONITORS];
+   QST_GET_TEMP_MON_CONFIG_RSP           stTempMonConfigRsp[QST_ABS_TEMP_MONITORS];
+   QST_THRESH                            stTempMonThresh[QST_ABS_TEMP_MONITORS];
+
+   int                                   iFanMons;
+   int                                   iFanMonIndex[QST_ABS_FAN_MONITORS];
+   QST_GET_FAN_MON_CONFIG_RSP            stFanMonConfigRsp[QST_ABS_FAN_MONITORS];
+   QST_THRESH                            stFanMonThresh[QST_ABS_TEMP_MONITORS];
+
+   int                                   iVoltMons;
+   int                                   iVoltMonIndex[QST_ABS_VOLT_MONITORS];
+   QST_GET_VOLT_MON_CONFIG_RSP           stVoltMonConfigRsp[QST_ABS_VOLT_MONITORS];
+   QST_THRESH                            stVoltMonThreshLow[QST_ABS_TEMP_MONITORS];
+   QST_THRESH                            stVoltMonThreshHigh[QST_ABS_TEMP_MONITORS];
+
+   int                                   iCurrMons;
+   int                                   iCurrMonIndex[QST_ABS_CURR_MONITORS];
+   QST_GET_CURR_MON_CONFIG_RSP           stCurrMonConfigRsp[QST_ABS_CURR_MONITORS];
+   QST_THRESH                            stCurrMonThreshLow[QST_ABS_TEMP_MONITORS];
+   QST_THRESH                            stCurrMonThreshHigh[QST_ABS_TEMP_MONITORS];
+
+   int                                   iFanCtrls;
+   int                                   iFanCtrlIndex[QST_ABS_FAN_CONTROLLERS];
+   QST_GET_FAN_CTRL_CONFIG_RSP           stFanCtrlConfigRsp[QST_ABS_FAN_CONTROLLERS];
+
+   UINT32                                uChecksum;          // Of all that precedes it
+
+} ENUM_CACHE;
+
+// Fields held in both the cache and the global memory segment
+
+#define CACHE_FIELD(name)   { offsetof(ENUM_CACHE, name), offsetof(QST_DATA_SEGMENT, name), sizeof(((ENUM_CACHE *)0)->name) }
+
+static const struct
+{
+   size_t   tCacheOffset;
+   size_t   tSegOffset;
+   size_t   tSize;
+
+} astCacheField[] =
+{
+   CACHE_FIELD( iTempMons ),  CACHE_FIELD( iTempMonIndex ),  CACHE_FIELD( stTempMonConfigRsp ),  CACHE_FIELD( stTempMonThresh ),
+   CACHE_FIELD( iFanMons ),   CACHE_FIELD( iFanMonIndex ),   CACHE_FIELD( stFanMonConfigRsp ),   CACHE_FIELD( stFanMonThresh ),
+   CACHE_FIELD( iVoltMons ),  CACHE_FIELD( iVoltMonIndex ),  CACHE_FIELD( stVoltMonConfigRsp ),  CACHE_FIELD( stVoltMonThreshLow ),
+   CACHE_FIELD( stVoltMonThreshHigh ),
+   CACHE_FIELD( iCurrMons ),  CACHE_FIELD( iCurrMonIndex ),  CACHE_FIELD( stCurrMonConfigRsp ),  CACHE_FIELD( stCurrMonThreshLow ),
+   CACHE_FIELD( stCurrMonThreshHigh ),
+   CACHE_FIELD( iFanCtrls ),  CACHE_FIELD( iFanCtrlIndex ),  CACHE_FIELD( stFanCtrlConfigRsp )
+};
+
+#define CACHE_FIELDS        (sizeof(astCacheField) / sizeof(astCacheField[0]))
+
+/****************************************************************************/
+/* EnumCachePath() - Returns the name of the cache file, or NULL if the     */
+/* cache is disabled.                                                       */
+/****************************************************************************/
+
+static const char *EnumCachePath( void )
+{
+   const char *pszPath = getenv( "QST_ENUM_CACHE" );
+
+   if( !pszPath )
+      return( ENUM_CACHE_FILE );
+
+   return( *pszPath? pszPath : NULL );
+}
+
+/****************************************************************************/
+/* EnumCacheChecksum() - Calculates the checksum (FNV-1a) of a cache image  */
+/****************************************************************************/
+
+static UINT32 EnumCacheChecksum( const ENUM_CACHE *pstCache )
+{
+   const UINT8 *pbyData = (const UINT8 *)pstCache;
+   UINT32      uHash    = 2166136261U;
+   size_t      tIndex;
+
+   for( tIndex = 0; tIndex < offsetof(ENUM_CACHE, uChecksum); tIndex++ )
+      uHash = (uHash ^ pbyData[tIndex]) * 16777619U;
+
+   return( uHash );
+}
+
+/****************************************************************************/
+/* EnumCacheBootId() - Reads the kernel's boot id into the buffer given     */
+/* (zero-filled first), returning FALSE if this isn't available.            */
+/****************************************************************************/
+
+static BOOL EnumCacheBootId( char *pszId, size_t tSize )
+{
+   int         iFile;
+   ssize_t     tRead;
+
+   memset( pszId, 0, tSize );
+
+   if( (iFile = open( ENUM_CACHE_BOOT_ID, O_RDONLY | O_CLOEXEC )) == -1 )
+      return( FALSE );
+
+   tRead = read( iFile, pszId, tSize - 1 );
+   close( iFile );
+
+   if( tRead <= 0 )
+      return( FALSE );
+
+   pszId[strcspn( pszId, "\n" )] = '\0';
+   return( TRUE );
+}
+
+/****************************************************************************/
+/* LoadEnumCache() - Loads the enumeration into the global memory segment   */
+/* from the cache file, provided this was saved under the key given (with   */
+/* the current boot id). The function returns a boolean success indicator;  */
+/* errno is left unchanged.                                                 */
+/****************************************************************************/
+
+static BOOL LoadEnumCache( P_QST_GET_SUBSYSTEM_INFO_RSP pstInfo, P_QST_GET_SUBSYSTEM_CONFIG_PROFILE_RSP pstProfile, unsigned long long ullStamp )
+{
+   const char  *pszPath = EnumCachePath();
+   char        szBootId[sizeof(((ENUM_CACHE *)0)->szBootIdKey)];
+   ENUM_CACHE  stCache;
+   int         iFile, iErrno = errno;
+   ssize_t     tRead;
+   size_t      tIndex;
+
+   if(    !pszPath || !EnumCacheBootId( szBootId, sizeof(szBootId) )
+       || ((iFile = open( pszPath, O_RDONLY | O_CLOEXEC )) == -1) )
+   {
+      errno = iErrno;
+      return( FALSE );
+   }
+
+   tRead = read( iFile, &stCache, sizeof(ENUM_CACHE) );
+   close( iFile );
+   errno = iErrno;
+
+   if(    (tRead != sizeof(ENUM_CACHE))
+       || (stCache.uMagic != ENUM_CACHE_MAGIC)
+       || (stCache.uVersion != ENUM_CACHE_VERSION)
+       || (stCache.uSize != sizeof(ENUM_CACHE))
+       || (stCache.uChecksum != EnumCacheChecksum( &stCache ))
+       || memcmp( &stCache.stInfoKey, pstInfo, sizeof(QST_GET_SUBSYSTEM_INFO_RSP) )
+       || memcmp( &stCache.stProfileKey, pstProfile, sizeof(QST_GET_SUBSYSTEM_CONFIG_PROFILE_RSP) )
+       || memcmp( stCache.szBootIdKey, szBootId, sizeof(szBootId) )
+       || (stCache.ullStampKey != ullStamp) )
+   {
+      return( FALSE );
+   }
+
+   if(    (stCache.iTempMons < 0) || (stCache.iTempMons > QST_ABS_TEMP_MONITORS)
+       || (stCache.iFanMons  < 0) || (stCache.iFanMons  > QST_ABS_FAN_MONITORS)
+       || (stCache.iVoltMons < 0) || (stCache.iVoltMons > QST_ABS_VOLT_MONITORS)
+       || (stCache.iCurrMons < 0) || (stCache.iCurrMons > QST_ABS_CURR_MONITORS)
+       || (stCache.iFanCtrls < 0) || (stCache.iFanCtrls > QST_ABS_FAN_CONTROLLERS) )
+   {
+      return( FALSE );
+   }
+
+   for( tIndex = 0; tIndex < CACHE_FIELDS; tIndex++ )
+      memcpy( (UINT8 *)pQstSeg + astCacheField[tIndex].tSegOffset, (UINT8 *)&stCache + astCacheField[tIndex].tCacheOffset, astCacheField[tIndex].tSize );
+
+   return( TRUE );
+}
+
+/****************************************************************************/
+/* SaveEnumCache() - Saves the enumeration in the global memory segment to  */
+/* the cache file, under the key given (with the current boot id). Nothing  */
+/* is saved if the configuration stamp has moved on since the enumeration   */
+/* began. The file is written under a temporary name and renamed, so that   */
+/* readers see either the old or the new one. Failure is of no consequence  */
+/* (the cache may not be writable by this process), so errno is left        */
+/* unchanged.                                                               */
+/****************************************************************************/
+
+static void SaveEnumCache( P_QST_GET_SUBSYSTEM_INFO_RSP pstInfo, P_QST_GET_SUBSYSTEM_CONFIG_PROFILE_RSP pstProfile, unsigned long long ullStamp )
+{
+   const char  *pszPath = EnumCachePath();
+   char        szTemp[280];
+   ENUM_CACHE  stCache;
+   int         iFile, iErrno = errno;
+   size_t      tIndex;
+
+   if( !pszPath )
+      return;
+
+   memset( &stCache, 0, sizeof(ENUM_CACHE) );
+
+   if( !EnumCacheBootId( stCache.szBootIdKey, sizeof(stCache.szBootIdKey) ) || (QstGetConfigStamp() != ullStamp) )
+   {
+      errno = iErrno;
+      return;
+   }
+
+   stCache.uMagic   = ENUM_CACHE_MAGIC;
+   stCache.uVersion = ENUM_CACHE_VERSION;
+   stCache.uSize    = sizeof(ENUM_CACHE);
+
+   memcpy( &stCache.stInfoKey, pstInfo, sizeof(QST_GET_SUBSYSTEM_INFO_RSP) );
+   memcpy( &stCache.stProfileKey, pstProfile, sizeof(QST_GET_SUBSYSTEM_CONFIG_PROFILE_RSP) );
+   stCache.ullStampKey = ullStamp;
+
+   for( tIndex = 0; tIndex < CACHE_FIELDS; tIndex++ )
+      memcpy( (UINT8 *)&stCache + astCacheField[tIndex].tCacheOffset, (UINT8 *)pQstSeg + astCacheField[tIndex].tSegOffset, astCacheField[tIndex].tSize );
+
+   stCache.uChecksum = EnumCacheChecksum( &stCache );
+
+   snprintf( szTemp, sizeof(szTemp), "%s.%d", pszPath, (int)getpid() );
+
+   if( (iFile = open( szTemp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644 )) != -1 )
+   {
+      if( (write( iFile, &stCache, sizeof(ENUM_CACHE) ) != sizeof(ENUM_CACHE)) | close( iFile ) | rename( szTemp, pszPath ) )
+         unlink( szTemp );
+   }
+
+   errno = iErrno;
+}
 
 /****************************************************************************/
-/* SetQSTError() - Places the appropriate error code for the QST error      */
-/* into the appropriate error variable for the environment.                 */
+/* PostThreshEvent() - Posts a threshold change event for a sensor, waking  */
+/* any processes waiting for one.                                           */
 /****************************************************************************/
 
-#ifdef __WIN32__
-
-static const DWORD dwWin32Map[] =
+static void PostThreshEvent( int iClass, int iLocSensor )
 {
-   ERROR_SUCCESS,               // QST_CMD_SUCCESSFUL
-   ERROR_NOT_SUPPORTED,         // QST_CMD_REJECTED_UNSUPPORTED
-   ERROR_ACCESS_DENIED,         // QST_CMD_REJECTED_LOCKED
-   ERROR_INVALID_PARAMETER,     // QST_CMD_REJECTED_PARAMETER
-   ERROR_REVISION_MISMATCH,     // QST_CMD_REJECTED_VERSION
-   ERROR_GEN_FAILURE,           // QST_CMD_FAILED_COMM_ERROR
-   ERROR_BAD_UNIT,              // QST_CMD_FAILED_SENSOR_ERROR
-   ERROR_NOT_ENOUGH_MEMORY,     // QST_CMD_FAILED_NO_MEMORY
-   ERROR_NO_SYSTEM_RESOURCES,   // QST_CMD_FAILED_NO_RESOURCES
-   ERROR_INVALID_FUNCTION,      // QST_CMD_REJECTED_INVALID
-   ERROR_BAD_COMMAND,           // QST_CMD_REJECTED_CMD_SIZE
-   ERROR_BAD_LENGTH             // QST_CMD_REJECTED_RSP_SIZE
-};
+   UINT32      uStamp = NextEventStamp( pQstSeg );
+
+   pQstSeg->stEvents.uThresh[iClass][iLocSensor] = uStamp;
+   PostEvent( &pQstSeg->stEvents, uStamp );
+}
 
 #else
 
-static const int iErrnoMap[] =
-{
-   0,                           // QST_CMD_SUCCESSFUL
-   ENOEXEC,                     // QST_CMD_REJECTED_UNSUPPORTED
-   EACCES,                      // QST_CMD_REJECTED_LOCKED
-   EINVAL,                      // QST_CMD_REJECTED_PARAMETER
-   EDOM,                        // QST_CMD_REJECTED_VERSION
-   EIO,                         // QST_CMD_FAILED_COMM_ERROR
-   EFAULT,                      // QST_CMD_FAILED_SENSOR_ERROR
-   ENOMEM,                      // QST_CMD_FAILED_NO_MEMORY
-   ENOSPC,                      // QST_CMD_FAILED_NO_RESOURCES
-   EPERM,                       // QST_CMD_REJECTED_INVALID
-   ERANGE,                      // QST_CMD_REJECTED_CMD_SIZE
-   ERANGE                       // QST_CMD_REJECTED_RSP_SIZE
-};
+#define PostThreshEvent(iClass, iLocSensor) // No events
 
-#endif
+#endif // defined(__linux__)
 
-static void SetQSTError( UINT8 byStatus )
-{
+/****************************************************************************/
+/* SaveTempMonThresh() - Saves thresholds of temperature monitor from its   */
+/* configuration, in converted form                                         */
+/****************************************************************************/
 
-#ifdef __WIN32__
-   SetLastError( (byStatus <= QST_CMD_REJECTED_RSP_SIZE)? dwWin32Map[byStatus] : ERROR_NONE_MAPPED );
-#else
-   errno = (byStatus <= QST_CMD_REJECTED_RSP_SIZE)? iErrnoMap[byStatus] : ENOENT;
-#endif
+static void SaveTempMonThresh( int iLocSensor )
+{
+   P_QST_GET_TEMP_MON_CONFIG_RSP pstRsp    = &pQstSeg->stTempMonConfigRsp[iLocSensor];
+   P_QST_THRESH                  pstThresh = &pQstSeg->stTempMonThresh[iLocSensor];
 
+   pstThresh->fNonCritical    = QST_TEMP_TO_FLOAT( pstRsp->lfTempNonCritical    );
+   pstThresh->fCritical       = QST_TEMP_TO_FLOAT( pstRsp->lfTempCritical       );
+   pstThresh->fNonRecoverable = QST_TEMP_TO_FLOAT( pstRsp->lfTempNonRecoverable );
 }
 
 /****************************************************************************/
@@ -123,7 +969,6 @@ static BOOL GetTempMonConfig( int iRemSensor, int iLocSensor )
 {
    QST_GENERIC_CMD               stCmd;
    P_QST_GET_TEMP_MON_CONFIG_RSP pstRsp    = &pQstSeg->stTempMonConfigRsp[iLocSensor];
-   P_QST_THRESH                  pstThresh = &pQstSeg->stTempMonThresh[iLocSensor];
 
    // Send the Temperature Monitor Configuration request
 
@@ -145,10 +990,7 @@ static BOOL GetTempMonConfig( int iRemSensor, int iLocSensor )
 
    // Successful, Save off thresholds in converted form
 
-   pstThresh->fNonCritical    = QST_TEMP_TO_FLOAT( pstRsp->lfTempNonCritical    );
-   pstThresh->fCritical       = QST_TEMP_TO_FLOAT( pstRsp->lfTempCritical       );
-   pstThresh->fNonRecoverable = QST_TEMP_TO_FLOAT( pstRsp->lfTempNonRecoverable );
-
+   SaveTempMonThresh( iLocSensor );
    return( TRUE );
 }
 
@@ -167,6 +1009,15 @@ BOOL GetTempMonUpdateQst( void )
 
    if( PastMTime( &pQstSeg->stTempMonUpdateTime, &stCurrTime ) )
    {
+
+#if defined(__linux__)
+
+      // Refresh every class of sensor/controller together
+
+      return( RefreshUpdates( UPDATE_TEMP_MON, &stCurrTime, &stCurrTime ) );
+
+#else
+
       QST_GENERIC_CMD stCmd;
 
       // Send the Temperature Monitor Update request
@@ -191,6 +1042,9 @@ BOOL GetTempMonUpdateQst( void )
 
       CopyMTime( &pQstSeg->stTempMonUpdateTime, &stCurrTime );
       AddMTime( &pQstSeg->stTempMonUpdateTime, 0, pQstSeg->dwPollingInterval );
+
+#endif
+
    }
 
    return( TRUE );
@@ -257,10 +1111,26 @@ BOOL SetTempThreshQst( int iLocSensor, float fNonCritical, float fCritical, floa
       // Save current time as time of threshold change
 
       time( &pQstSeg->tTimeTempMonThreshChanged[iLocSensor] );
+      PostThreshEvent( HOT_TEMP_MON, iLocSensor );
       return( TRUE );
    }
 }
 
+/****************************************************************************/
+/* SaveFanMonThresh() - Saves thresholds of fan speed monitor from its      */
+/* configuration, in converted form                                         */
+/****************************************************************************/
+
+static void SaveFanMonThresh( int iLocSensor )
+{
+   P_QST_GET_FAN_MON_CONFIG_RSP  pstRsp    = &pQstSeg->stFanMonConfigRsp[iLocSensor];
+   P_QST_THRESH                  pstThresh = &pQstSeg->stFanMonThresh[iLocSensor];
+
+   pstThresh->fNonCritical    = (float)pstRsp->uSpeedNonCritical;
+   pstThresh->fCritical       = (float)pstRsp->uSpeedCritical;
+   pstThresh->fNonRecoverable = (float)pstRsp->uSpeedNonRecoverable;
+}
+
 /****************************************************************************/
 /* GetFanMonConfig() - Get configuration for fan speed monitor              */
 /****************************************************************************/
@@ -269,7 +1139,6 @@ static BOOL GetFanMonConfig( int iRemSensor, int iLocSensor )
 {
    QST_GENERIC_CMD               stCmd;
    P_QST_GET_FAN_MON_CONFIG_RSP  pstRsp    = &pQstSeg->stFanMonConfigRsp[iLocSensor];
-   P_QST_THRESH                  pstThresh = &pQstSeg->stFanMonThresh[iLocSensor];
 
    // Set Fan Speed Monitor Configuration command
 
@@ -291,10 +1160,7 @@ static BOOL GetFanMonConfig( int iRemSensor, int iLocSensor )
 
    // Successful, Save off thresholds in converted form
 
-   pstThresh->fNonCritical    = (float)pstRsp->uSpeedNonCritical;
-   pstThresh->fCritical       = (float)pstRsp->uSpeedCritical;
-   pstThresh->fNonRecoverable = (float)pstRsp->uSpeedNonRecoverable;
-
+   SaveFanMonThresh( iLocSensor );
    return( TRUE );
 }
 
@@ -313,6 +1179,15 @@ BOOL GetFanMonUpdateQst( void )
 
    if( PastMTime( &pQstSeg->stFanMonUpdateTime, &stCurrTime ) )
    {
+
+#if defined(__linux__)
+
+      // Refresh every class of sensor/controller together
+
+      return( RefreshUpdates( UPDATE_FAN_MON, &stCurrTime, &stCurrTime ) );
+
+#else
+
       QST_GENERIC_CMD stCmd;
 
       // Send the Fan Speed Monitor Update request
@@ -337,6 +1212,9 @@ BOOL GetFanMonUpdateQst( void )
 
       CopyMTime( &pQstSeg->stFanMonUpdateTime, &stCurrTime );
       AddMTime( &pQstSeg->stFanMonUpdateTime, 0, pQstSeg->dwPollingInterval );
+
+#endif
+
    }
 
    return( TRUE );
@@ -401,10 +1279,31 @@ BOOL SetFanThreshQst( int iLocSensor, float fNonCritical, float fCritical, float
       // Save current time as time of threshold change
 
       time( &pQstSeg->tTimeFanMonThreshChanged[iLocSensor] );
+      PostThreshEvent( HOT_FAN_MON, iLocSensor );
       return( TRUE );
    }
 }
 
+/****************************************************************************/
+/* SaveVoltMonThresh() - Saves thresholds of voltage monitor from its       */
+/* configuration, in converted form                                         */
+/****************************************************************************/
+
+static void SaveVoltMonThresh( int iLocSensor )
+{
+   P_QST_GET_VOLT_MON_CONFIG_RSP pstRsp        = &pQstSeg->stVoltMonConfigRsp[iLocSensor];
+   P_QST_THRESH                  pstThreshLow  = &pQstSeg->stVoltMonThreshLow[iLocSensor];
+   P_QST_THRESH                  pstThreshHigh = &pQstSeg->stVoltMonThreshHigh[iLocSensor];
+
+   pstThreshLow->fNonCritical     = QST_VOLT_TO_FLOAT( pstRsp->iUnderVoltageNonCritical    );
+   pstThreshLow->fCritical        = QST_VOLT_TO_FLOAT( pstRsp->iUnderVoltageCritical       );
+   pstThreshLow->fNonRecoverable  = QST_VOLT_TO_FLOAT( pstRsp->iUnderVoltageNonRecoverable );
+
+   pstThreshHigh->fNonCritical    = QST_VOLT_TO_FLOAT( pstRsp->iOverVoltageNonCritical     );
+   pstThreshHigh->fCritical       = QST_VOLT_TO_FLOAT( pstRsp->iOverVoltageCritical        );
+   pstThreshHigh->fNonRecoverable = QST_VOLT_TO_FLOAT( pstRsp->iOverVoltageNonRecoverable  );
+}
+
 /****************************************************************************/
 /* GetVoltMonConfig() - Get configuration for voltage monitor               */
 /****************************************************************************/
@@ -413,8 +1312,6 @@ static BOOL GetVoltMonConfig( int iRemSensor, int iLocSensor )
 {
    QST_GENERIC_CMD               stCmd;
    P_QST_GET_VOLT_MON_CONFIG_RSP pstRsp        = &pQstSeg->stVoltMonConfigRsp[iLocSensor];
-   P_QST_THRESH                  pstThreshLow  = &pQstSeg->stVoltMonThreshLow[iLocSensor];
-   P_QST_THRESH                  pstThreshHigh = &pQstSeg->stVoltMonThreshHigh[iLocSensor];
 
    stCmd.stHeader.byCommand       = QST_GET_VOLT_MON_CONFIG;
    stCmd.stHeader.byEntity        = (UINT8)iRemSensor;
@@ -432,14 +1329,7 @@ static BOOL GetVoltMonConfig( int iRemSensor, int iLocSensor )
 
    // Successful, Save off thresholds in converted form
 
-   pstThreshLow->fNonCritical     = QST_VOLT_TO_FLOAT( pstRsp->iUnderVoltageNonCritical    );
-   pstThreshLow->fCritical        = QST_VOLT_TO_FLOAT( pstRsp->iUnderVoltageCritical       );
-   pstThreshLow->fNonRecoverable  = QST_VOLT_TO_FLOAT( pstRsp->iUnderVoltageNonRecoverable );
-
-   pstThreshHigh->fNonCritical    = QST_VOLT_TO_FLOAT( pstRsp->iOverVoltageNonCritical     );
-   pstThreshHigh->fCritical       = QST_VOLT_TO_FLOAT( pstRsp->iOverVoltageCritical        );
-   pstThreshHigh->fNonRecoverable = QST_VOLT_TO_FLOAT( pstRsp->iOverVoltageNonRecoverable  );
-
+   SaveVoltMonThresh( iLocSensor );
    return( TRUE );
 }
 
@@ -458,6 +1348,15 @@ BOOL GetVoltMonUpdateQst( void )
 
    if( PastMTime( &pQstSeg->stVoltMonUpdateTime, &stCurrTime ) )
    {
+
+#if defined(__linux__)
+
+      // Refresh every class of sensor/controller together
+
+      return( RefreshUpdates( UPDATE_VOLT_MON, &stCurrTime, &stCurrTime ) );
+
+#else
+
       QST_GENERIC_CMD stCmd;
 
       // Send the Temperature Monitor Update request
@@ -482,6 +1381,9 @@ BOOL GetVoltMonUpdateQst( void )
 
       CopyMTime( &pQstSeg->stVoltMonUpdateTime, &stCurrTime );
       AddMTime( &pQstSeg->stVoltMonUpdateTime, 0, pQstSeg->dwPollingInterval );
+
+#endif
+
    }
 
    return( TRUE );
@@ -550,6 +1452,7 @@ BOOL SetVoltThreshLowQst( int iLocSensor, float fNonCritical, float fCritical, f
       // Save current time as time of threshold change
 
       time( &pQstSeg->tTimeVoltMonThreshLowChanged[iLocSensor] );
+      PostThreshEvent( HOT_VOLT_MON, iLocSensor );
       return( TRUE );
    }
 }
@@ -617,10 +1520,31 @@ BOOL SetVoltThreshHighQst( int iLocSensor, float fNonCritical, float fCritical,
       // Save current time as time of threshold change
 
       time( &pQstSeg->tTimeVoltMonThreshHighChanged[iLocSensor] );
+      PostThreshEvent( HOT_VOLT_MON, iLocSensor );
       return( TRUE );
    }
 }
 
+/****************************************************************************/
+/* SaveCurrMonThresh() - Saves thresholds of current monitor from its       */
+/* configuration, in converted form                                         */
+/****************************************************************************/
+
+static void SaveCurrMonThresh( int iLocSensor )
+{
+   P_QST_GET_CURR_MON_CONFIG_RSP pstRsp        = &pQstSeg->stCurrMonConfigRsp[iLocSensor];
+   P_QST_THRESH                  pstThreshLow  = &pQstSeg->stCurrMonThreshLow[iLocSensor];
+   P_QST_THRESH                  pstThreshHigh = &pQstSeg->stCurrMonThreshHigh[iLocSensor];
+
+   pstThreshLow->fNonCritical     = QST_CURR_TO_FLOAT( pstRsp->iUnderCurrentNonCritical    );
+   pstThreshLow->fCritical        = QST_CURR_TO_FLOAT( pstRsp->iUnderCurrentCritical       );
+   pstThreshLow->fNonRecoverable  = QST_CURR_TO_FLOAT( pstRsp->iUnderCurrentNonRecoverable );
+
+   pstThreshHigh->fNonCritical    = QST_CURR_TO_FLOAT( pstRsp->iOverCurrentNonCritical     );
+   pstThreshHigh->fCritical       = QST_CURR_TO_FLOAT( pstRsp->iOverCurrentCritical        );
+   pstThreshHigh->fNonRecoverable = QST_CURR_TO_FLOAT( pstRsp->iOverCurrentNonRecoverable  );
+}
+
 /****************************************************************************/
 /* GetCurrMonConfig() - Get configuration for voltage monitor               */
 /****************************************************************************/
@@ -629,8 +1553,6 @@ static BOOL GetCurrMonConfig( int iRemSensor, int iLocSensor )
 {
    QST_GENERIC_CMD               stCmd;
    P_QST_GET_CURR_MON_CONFIG_RSP pstRsp        = &pQstSeg->stCurrMonConfigRsp[iLocSensor];
-   P_QST_THRESH                  pstThreshLow  = &pQstSeg->stCurrMonThreshLow[iLocSensor];
-   P_QST_THRESH                  pstThreshHigh = &pQstSeg->stCurrMonThreshHigh[iLocSensor];
 
    stCmd.stHeader.byCommand       = QST_GET_CURR_MON_CONFIG;
    stCmd.stHeader.byEntity        = (UINT8)iRemSensor;
@@ -648,14 +1570,7 @@ static BOOL GetCurrMonConfig( int iRemSensor, int iLocSensor )
 
    // Successful, Save off thresholds in converted form
 
-   pstThreshLow->fNonCritical     = QST_CURR_TO_FLOAT( pstRsp->iUnderCurrentNonCritical    );
-   pstThreshLow->fCritical        = QST_CURR_TO_FLOAT( pstRsp->iUnderCurrentCritical       );
-   pstThreshLow->fNonRecoverable  = QST_CURR_TO_FLOAT( pstRsp->iUnderCurrentNonRecoverable );
-
-   pstThreshHigh->fNonCritical    = QST_CURR_TO_FLOAT( pstRsp->iOverCurrentNonCritical     );
-   pstThreshHigh->fCritical       = QST_CURR_TO_FLOAT( pstRsp->iOverCurrentCritical        );
-   pstThreshHigh->fNonRecoverable = QST_CURR_TO_FLOAT( pstRsp->iOverCurrentNonRecoverable  );
-
+   SaveCurrMonThresh( iLocSensor );
    return( TRUE );
 }
 
@@ -674,6 +1589,15 @@ BOOL GetCurrMonUpdateQst( void )
 
    if( PastMTime( &pQstSeg->stCurrMonUpdateTime, &stCurrTime ) )
    {
+
+#if defined(__linux__)
+
+      // Refresh every class of sensor/controller together
+
+      return( RefreshUpdates( UPDATE_CURR_MON, &stCurrTime, &stCurrTime ) );
+
+#else
+
       QST_GENERIC_CMD stCmd;
 
       // Send the Temperature Monitor Update request
@@ -698,6 +1622,9 @@ BOOL GetCurrMonUpdateQst( void )
 
       CopyMTime( &pQstSeg->stCurrMonUpdateTime, &stCurrTime );
       AddMTime( &pQstSeg->stCurrMonUpdateTime, 0, pQstSeg->dwPollingInterval );
+
+#endif
+
    }
 
    return( TRUE );
@@ -766,6 +1693,7 @@ BOOL SetCurrThreshLowQst( int iLocSensor, float fNonCritical, float fCritical, f
       // Save current time as time of threshold change
 
       time( &pQstSeg->tTimeCurrMonThreshLowChanged[iLocSensor] );
+      PostThreshEvent( HOT_CURR_MON, iLocSensor );
       return( TRUE );
    }
 }
@@ -833,6 +1761,7 @@ BOOL SetCurrThreshHighQst( int iLocSensor, float fNonCritical, float fCritical,
       // Save current time as time of threshold change
 
       time( &pQstSeg->tTimeCurrMonThreshHighChanged[iLocSensor] );
+      PostThreshEvent( HOT_CURR_MON, iLocSensor );
       return( TRUE );
    }
 }
@@ -877,6 +1806,15 @@ BOOL GetFanCtrlUpdateQst( void )
 
    if( PastMTime( &pQstSeg->stFanCtrlUpdateTime, &stCurrTime ) )
    {
+
+#if defined(__linux__)
+
+      // Refresh every class of sensor/controller together
+
+      return( RefreshUpdates( UPDATE_FAN_CTRL, &stCurrTime, &stCurrTime ) );
+
+#else
+
       QST_GENERIC_CMD stCmd;
 
       // Send the Fan Speed Monitor Update request
@@ -901,11 +1839,150 @@ BOOL GetFanCtrlUpdateQst( void )
 
       CopyMTime( &pQstSeg->stFanCtrlUpdateTime, &stCurrTime );
       AddMTime( &pQstSeg->stFanCtrlUpdateTime, 0, pQstSeg->dwPollingInterval );
+
+#endif
+
+   }
+
+   return( TRUE );
+}
+
+#if defined(__linux__)
+/****************************************************************************/
+/* GetAllConfigs() - Gets the configuration of every sensor and controller  */
+/* in the configuration profile given. The requests are sent together, as   */
+/* one pipelined batch, and each response is placed directly in its slot.   */
+/* The thresholds are then saved in converted form, as they would be by     */
+/* the individual Get*Config() functions.                                   */
+/****************************************************************************/
+
+#define CONFIG_CLASSES  5
+#define CONFIG_MAX      (QST_ABS_TEMP_MONITORS + QST_ABS_FAN_MONITORS + QST_ABS_VOLT_MONITORS + QST_ABS_CURR_MONITORS + QST_ABS_FAN_CONTROLLERS)
+
+static BOOL GetAllConfigs( P_QST_GET_SUBSYSTEM_CONFIG_PROFILE_RSP pstProfile )
+{
+   static const UINT8 abyCommand[CONFIG_CLASSES] =
+   {
+      QST_GET_TEMP_MON_CONFIG,
+      QST_GET_FAN_MON_CONFIG,
+      QST_GET_VOLT_MON_CONFIG,
+      QST_GET_CURR_MON_CONFIG,
+      QST_GET_FAN_CTRL_CONFIG
+   };
+
+   static const size_t atRspSize[CONFIG_CLASSES] =
+   {
+      sizeof(QST_GET_TEMP_MON_CONFIG_RSP),
+      sizeof(QST_GET_FAN_MON_CONFIG_RSP),
+      sizeof(QST_GET_VOLT_MON_CONFIG_RSP),
+      sizeof(QST_GET_CURR_MON_CONFIG_RSP),
+      sizeof(QST_GET_FAN_CTRL_CONFIG_RSP)
+   };
+
+   static const int aiMax[CONFIG_CLASSES] =
+   {
+      QST_ABS_TEMP_MONITORS,
+      QST_ABS_FAN_MONITORS,
+      QST_ABS_VOLT_MONITORS,
+      QST_ABS_CURR_MONITORS,
+      QST_ABS_FAN_CONTROLLERS
+   };
+
+   static void (* const apfnSaveThresh[CONFIG_CLASSES])( int ) =
+   {
+      SaveTempMonThresh,
+      SaveFanMonThresh,
+      SaveVoltMonThresh,
+      SaveCurrMonThresh,
+      NULL
+   };
+
+   UINT32            adwConfigured[CONFIG_CLASSES];
+   int               *apiCount[CONFIG_CLASSES];
+   int               *apiIndex[CONFIG_CLASSES];
+   UINT8             *apbyRsp[CONFIG_CLASSES];
+   QST_GENERIC_CMD   astCmd[CONFIG_MAX];
+   QST_BATCH_ENTRY   astEntry[CONFIG_MAX];
+   int               iClass, iBit, iCount, iIndex;
+
+   adwConfigured[0] = pstProfile->dwTempMonsConfigured;
+   adwConfigured[1] = pstProfile->dwFanMonsConfigured;
+   adwConfigured[2] = pstProfile->dwVoltMonsConfigured;
+   adwConfigured[3] = pstProfile->dwCurrMonsConfigured;
+   adwConfigured[4] = pstProfile->dwFanCtrlsConfigured;
+
+   apiCount[0]      = &pQstSeg->iTempMons;
+   apiCount[1]      = &pQstSeg->iFanMons;
+   apiCount[2]      = &pQstSeg->iVoltMons;
+   apiCount[3]      = &pQstSeg->iCurrMons;
+   apiCount[4]      = &pQstSeg->iFanCtrls;
+
+   apiIndex[0]      = pQstSeg->iTempMonIndex;
+   apiIndex[1]      = pQstSeg->iFanMonIndex;
+   apiIndex[2]      = pQstSeg->iVoltMonIndex;
+   apiIndex[3]      = pQstSeg->iCurrMonIndex;
+   apiIndex[4]      = pQstSeg->iFanCtrlIndex;
+
+   apbyRsp[0]       = (UINT8 *)pQstSeg->stTempMonConfigRsp;
+   apbyRsp[1]       = (UINT8 *)pQstSeg->stFanMonConfigRsp;
+   apbyRsp[2]       = (UINT8 *)pQstSeg->stVoltMonConfigRsp;
+   apbyRsp[3]       = (UINT8 *)pQstSeg->stCurrMonConfigRsp;
+   apbyRsp[4]       = (UINT8 *)pQstSeg->stFanCtrlConfigRsp;
+
+   // Build a request for each sensor/controller that is configured
+
+   for( iClass = iCount = 0; iClass < CONFIG_CLASSES; iClass++ )
+   {
+      for( iBit = *apiCount[iClass] = 0; iBit < aiMax[iClass]; iBit++ )
+      {
+         if( BIT_SET( adwConfigured[iClass], iBit ) )
+         {
+            astCmd[iCount].stHeader.byCommand       = abyCommand[iClass];
+            astCmd[iCount].stHeader.byEntity        = (UINT8)iBit;
+            astCmd[iCount].stHeader.wCommandLength  = QST_CMD_DATA_SIZE(QST_GENERIC_CMD);
+            astCmd[iCount].stHeader.wResponseLength = (UINT16)atRspSize[iClass];
+
+            astEntry[iCount].pvCmdBuf = &astCmd[iCount];
+            astEntry[iCount].tCmdSize = sizeof(QST_GENERIC_CMD);
+            astEntry[iCount].pvRspBuf = apbyRsp[iClass] + *apiCount[iClass] * atRspSize[iClass];
+            astEntry[iCount].tRspSize = atRspSize[iClass];
+
+            apiIndex[iClass][(*apiCount[iClass])++] = iBit;
+            iCount++;
+         }
+      }
+   }
+
+   if( !QstCommandBatch( astEntry, iCount ) )
+      return( FALSE );
+
+   // Can't go any further if Subsystem rejected any of them
+
+   for( iIndex = 0; iIndex < iCount; iIndex++ )
+   {
+      if( ((UINT8 *)astEntry[iIndex].pvRspBuf)[0] )
+      {
+         SetQSTError( ((UINT8 *)astEntry[iIndex].pvRspBuf)[0] );
+         return( FALSE );
+      }
+   }
+
+   // Successful, save off thresholds in converted form
+
+   for( iClass = 0; iClass < CONFIG_CLASSES; iClass++ )
+   {
+      if( apfnSaveThresh[iClass] )
+      {
+         for( iIndex = 0; iIndex < *apiCount[iClass]; iIndex++ )
+            apfnSaveThresh[iClass]( iIndex );
+      }
    }
 
    return( TRUE );
 }
 
+#endif // defined(__linux__)
+
 /****************************************************************************/
 /* EnumerateMonCtrl() - Enumerates the available temperature sensors, fan   */
 /* speed sensors and fan speed controllers, through query of active Monitor */
@@ -915,10 +1992,59 @@ BOOL GetFanCtrlUpdateQst( void )
 static BOOL EnumerateMonCtrl( void )
 {
    int                                   iBit;
-   QST_GENERIC_CMD                       stCmd;
    QST_GET_SUBSYSTEM_STATUS_RSP          stStatRsp;
    QST_GET_SUBSYSTEM_CONFIG_PROFILE_RSP  stProfRsp;
 
+#if defined(__linux__)
+
+   QST_GET_SUBSYSTEM_INFO_RSP            stInfoRsp;
+   QST_GENERIC_CMD                       astCmd[3];
+   QST_BATCH_ENTRY                       astEntry[3];
+   unsigned long long                    ullStamp;
+
+   static const UINT8                    abyCommand[3] = { QST_GET_SUBSYSTEM_STATUS, QST_GET_SUBSYSTEM_CONFIG_PROFILE, QST_GET_SUBSYSTEM_INFO };
+
+   // Thresholds set from here on must keep this enumeration out of the cache
+
+   ullStamp = QstGetConfigStamp();
+
+   // Get the QST Subsystem's Status, configuration profile and information
+   // together; the latter two are the key to the enumeration cache
+
+   astEntry[0].pvRspBuf = &stStatRsp;
+   astEntry[0].tRspSize = sizeof(QST_GET_SUBSYSTEM_STATUS_RSP);
+   astEntry[1].pvRspBuf = &stProfRsp;
+   astEntry[1].tRspSize = sizeof(QST_GET_SUBSYSTEM_CONFIG_PROFILE_RSP);
+   astEntry[2].pvRspBuf = &stInfoRsp;
+   astEntry[2].tRspSize = sizeof(QST_GET_SUBSYSTEM_INFO_RSP);
+
+   for( iBit = 0; iBit < 3; iBit++ )
+   {
+      astCmd[iBit].stHeader.byCommand       = abyCommand[iBit];
+      astCmd[iBit].stHeader.byEntity        = 0;
+      astCmd[iBit].stHeader.wCommandLength  = QST_CMD_DATA_SIZE(QST_GENERIC_CMD);
+      astCmd[iBit].stHeader.wResponseLength = (UINT16)astEntry[iBit].tRspSize;
+
+      astEntry[iBit].pvCmdBuf = &astCmd[iBit];
+      astEntry[iBit].tCmdSize = sizeof(QST_GENERIC_CMD);
+   }
+
+   if( !QstCommandBatch( astEntry, 3 ) )
+      return( FALSE );
+
+   for( iBit = 0; iBit < 3; iBit++ )
+   {
+      if( ((UINT8 *)astEntry[iBit].pvRspBuf)[0] )
+      {
+         SetQSTError( ((UINT8 *)astEntry[iBit].pvRspBuf)[0] );
+         return( FALSE );
+      }
+   }
+
+#else
+
+   QST_GENERIC_CMD                       stCmd;
+
    // Get the QST Subsystem's Status
 
    stCmd.stHeader.byCommand       = QST_GET_SUBSYSTEM_STATUS;
@@ -935,6 +2061,8 @@ static BOOL EnumerateMonCtrl( void )
       return( FALSE );
    }
 
+#endif
+
    // No point in going any further if the subsystem isn't configured
 
    if( !stStatRsp.stSubsystemStatus.bSubsystemConfigured )
@@ -949,6 +2077,34 @@ static BOOL EnumerateMonCtrl( void )
       return( FALSE );
    }
 
+#if defined(__linux__)
+
+   // If the configuration is as cached, only the readings need fetching
+
+   if( LoadEnumCache( &stInfoRsp, &stProfRsp, ullStamp ) )
+   {
+      AssignHistory();
+
+      return(    GetTempMonUpdateQst() && GetFanMonUpdateQst() && GetVoltMonUpdateQst()
+              && GetCurrMonUpdateQst() && GetFanCtrlUpdateQst() );
+   }
+
+   // Otherwise ascertain the configuration of every sensor and controller
+   // together, then their readings
+
+   if( !GetAllConfigs( &stProfRsp ) )
+      return( FALSE );
+
+   AssignHistory();
+
+   if(    !GetTempMonUpdateQst() || !GetFanMonUpdateQst() || !GetVoltMonUpdateQst()
+       || !GetCurrMonUpdateQst() || !GetFanCtrlUpdateQst() )
+      return( FALSE );
+
+   SaveEnumCache( &stInfoRsp, &stProfRsp, ullStamp );
+
+#else
+
    // Get the QST Subsystem's configuration profile
 
    stCmd.stHeader.byCommand       = QST_GET_SUBSYSTEM_CONFIG_PROFILE;
@@ -1045,6 +2201,8 @@ static BOOL EnumerateMonCtrl( void )
    if( !GetFanCtrlUpdateQst() )
       return( FALSE );
 
+#endif
+
    return( TRUE );
 }
 
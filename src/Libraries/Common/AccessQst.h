@@ -96,4 +96,13 @@ BOOL   SetCurrThreshHighQst( int iLocSensor, float fNonCritical, float fCritical
 
 BOOL   GetFanCtrlUpdateQst( void );
 
+#if defined(__linux__)
+/****************************************************************************/
+/* Background refresher support                                             */
+/****************************************************************************/
+
+BOOL   RefreshAllQst( int iPeriod );
+DWORD  RefreshPeriodQst( void );
+#endif
+
 #endif // ndef _ACCESSQST_H
@@ -100,6 +100,17 @@ BOOL CloseCritSect( HCRITSECT hCritSect );
 
 BOOL EnterCritSect( HCRITSECT hCritSect );
 
+#ifdef __linux__
+/****************************************************************************/
+/*  EnterCritSectTimed() -  Enters  critical  section  referenced  by  the  */
+/*  specified  handle,  like  EnterCritSect(),  but  waits  no  more  than  */
+/*  iTimeout milliseconds (forever if iTimeout is negative). Sets errno to  */
+/*  ETIMEDOUT if the time expires.                                          */
+/****************************************************************************/
+
+BOOL EnterCritSectTimed( HCRITSECT hCritSect, int iTimeout );
+#endif
+
 /****************************************************************************/
 /*  LeaveCritSect() - Leaves critical section referenced by the  specified  */
 /*  handle.  If  thread(s) are waiting to enter this critical section, the  */
@@ -8,6 +8,12 @@
 /*  Notes:      1.  We use segment id values to uniquely  identify  global  */
 /*                  memory segments.                                        */
 /*                                                                          */
+/*              2.  Segment ids with GLOBMEM_PERSISTENT set name  segments  */
+/*                  that are kept when their last  user  closes  them  (or  */
+/*                  dies), where the  environment  allows  it,  until  the  */
+/*                  system restarts. Whoever finds such a segment must  be  */
+/*                  prepared for the contents left in it by earlier users.  */
+/*                                                                          */
 /****************************************************************************/
 
 /****************************************************************************/
@@ -65,6 +71,8 @@ extern "C" {
 typedef void * HGLOBMEM;
 #endif
 
+#define GLOBMEM_PERSISTENT      0x80000000      // Segment id flag: keep segment (see note 2)
+
 /****************************************************************************/
 /*  LookupGlobMem() - Returns a handle for the global memory segment  with  */
 /*  the  specified  segment  id.  If  no segment exists with this id, NULL  */
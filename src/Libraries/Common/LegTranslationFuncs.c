@@ -45,7 +45,6 @@
 #pragma warning(disable: 4201 4701)
 
 #include <stdlib.h>
-#include <malloc.h>
 #include <memory.h>
 
 #include "QstCmd.h"
@@ -76,257 +75,338 @@ QST_GET_SUBSYSTEM_INFO_RSP   QstSubsystemInfo = {
 
 
 /****************************************************************************/
-/* Internal functions                                                       */
-/****************************************************************************/
-
-/****************************************************************************/
-/* ConvertToLegQstCommand () - Converts the QST 2.0 command and entity data */
-/* into a legacy command.  Also returns the maximum required buffer sizes.  */
+/* Command translation tables.  Each QST 2.x command that has a legacy      */
+/* equivalent is described once, in CmdMap[].  NewCmdIndex[] and            */
+/* LegCmdIndex[] locate that description given a command code from the      */
+/* 2.x or the 1.x command set respectively.                                 */
 /****************************************************************************/
 
-static BOOL ConvertToLegQstCommand(
+//
+// How a command and its response are translated
+//
+#define XLATE_FIXED              0        // One legacy command; entity ignored
+#define XLATE_ENTITY             1        // One legacy command per entity
+#define XLATE_PROFILE            2        // Fixed; profile fields resized
+#define XLATE_UPDATE             3        // Fixed; 2.x response is a slice of the legacy array
+#define XLATE_SST                4        // Packet sizes taken from command header
 
-   IN    QST_CMD_HEADER *QstCmd,             // 2.x command format
-   OUT   UINT8          *LegCommand,
-   OUT   size_t         *LegCmdSize,
-   OUT   size_t         *LegRspSize
-){
-   //
-   // Assume that the command translation failed by assigning a known bad
-   // legacy values.
-   //
-   *LegCommand = QST_LEG_LAST_CMD_CODE + 1;
-   *LegCmdSize = 0;
-   *LegRspSize = 0;
+typedef struct _CMD_MAP
+{
+   UINT8    byNewCommand;                 // QST 2.x command code
+   UINT8    byLegCommand;                 // Legacy command code (for entity 0)
+   UINT8    byType;                       // XLATE_xxx
+   UINT8    byEntities;                   // Legacy entities (XLATE_ENTITY/UPDATE)
+   UINT16   wNewCmdSize;                  // QST 2.x packet sizes
+   UINT16   wNewRspSize;
+   UINT16   wLegCmdSize;                  // Legacy packet sizes
+   UINT16   wLegRspSize;
+   UINT16   wNewEntrySize;                // Monitor entry sizes (XLATE_UPDATE)
+   UINT16   wLegEntrySize;
+
+} CMD_MAP;
+
+//
+// Indices into CmdMap[]
+//
+enum
+{
+   MAP_GET_SUBSYSTEM_STATUS = 0,
+   MAP_GET_SUBSYSTEM_CONFIG_PROFILE,
+   MAP_LOCK_SUBSYSTEM,
+   MAP_SST_PASS_THROUGH,
+   MAP_GET_TEMP_MON_UPDATE,
+   MAP_GET_TEMP_MON_CONFIG,
+   MAP_SET_TEMP_MON_THRESHOLDS,
+   MAP_SET_TEMP_MON_READING,
+   MAP_NO_TEMP_MON_READINGS,
+   MAP_GET_FAN_MON_UPDATE,
+   MAP_GET_FAN_MON_CONFIG,
+   MAP_SET_FAN_MON_THRESHOLDS,
+   MAP_ENABLE_FAN_MON,
+   MAP_DISABLE_FAN_MON,
+   MAP_REDETECT_FAN_PRESENCE,
+   MAP_GET_VOLT_MON_UPDATE,
+   MAP_GET_VOLT_MON_CONFIG,
+   MAP_SET_VOLT_MON_THRESHOLDS,
+   MAP_GET_FAN_CTRL_UPDATE,
+   MAP_GET_FAN_CTRL_CONFIG,
+   MAP_SET_FAN_CTRL_DUTY,
+   MAP_SET_FAN_CTRL_AUTO,
+   MAP_RESET_FAN_CTRL_MIN_DUTY,
+   MAP_ENTRIES,
+
+   MAP_NONE = 0xFF                        // Command has no equivalent
+};
 
-   //
-   // Begin to decode commands
-   //
-   switch (QstCmd->byCommand)
-   {
-   case QST_GET_SUBSYSTEM_INFO:
-   case QST_GET_SUBSYSTEM_CONFIG:
-   case QST_SET_SUBSYSTEM_CONFIG:
-   case QST_UPDATE_CPU_CONFIG:
-   case QST_GET_CPU_CONFIG_UPDATE:
-   case QST_UPDATE_FAN_CONFIG:
-   case QST_GET_FAN_CONFIG_UPDATE:
-   case QST_UPDATE_CPU_DTS_CONFIG:
-   case QST_GET_CPU_DTS_CONFIG_UPDATE:
-   case QST_GET_CURR_MON_UPDATE:
-   case QST_GET_CURR_MON_CONFIG:
-   case QST_SET_CURR_MON_THRESHOLDS:
-      //
-      // Handle commands that are not supported here.  This is the only place
-      // that unsupported commands will be checked!!!!
-      //
-      break;
-
-   case QST_GET_SUBSYSTEM_STATUS:
-      *LegCommand = QST_LEG_GET_SUBSYSTEM_STATUS;
-      *LegCmdSize = sizeof(QST_LEG_GENERIC_CMD);
-      *LegRspSize = sizeof(QST_LEG_GET_SUBSYSTEM_STATUS_RSP);
-      break;
-
-   case QST_GET_SUBSYSTEM_CONFIG_PROFILE:
-      *LegCommand = QST_LEG_GET_SUBSYSTEM_CONFIG_PROFILE;
-      *LegCmdSize = sizeof(QST_LEG_GENERIC_CMD);
-      *LegRspSize = sizeof(QST_LEG_GET_SUBSYSTEM_CONFIG_PROFILE_RSP);
-      break;
-
-   case QST_LOCK_SUBSYSTEM:
-      *LegCommand = QST_LEG_LOCK_SUBSYSTEM;
-      *LegCmdSize = sizeof(QST_LEG_LOCK_SUBSYSTEM_CMD);
-      *LegRspSize = sizeof(QST_LEG_GENERIC_RSP);
-      break;
-
-   case QST_SST_PASS_THROUGH:
-      //
-      // For SST PT buffer sizes will be handled in other places
-      //
-      *LegCommand = QST_LEG_SST_PASS_THROUGH;
-      break;
+static const CMD_MAP CmdMap[] =
+{
+   {  QST_GET_SUBSYSTEM_STATUS, QST_LEG_GET_SUBSYSTEM_STATUS, XLATE_FIXED, 0,
+      sizeof(QST_GENERIC_CMD), sizeof(QST_GET_SUBSYSTEM_STATUS_RSP),
+      sizeof(QST_LEG_GENERIC_CMD), sizeof(QST_LEG_GET_SUBSYSTEM_STATUS_RSP), 0, 0 },
+
+   {  QST_GET_SUBSYSTEM_CONFIG_PROFILE, QST_LEG_GET_SUBSYSTEM_CONFIG_PROFILE, XLATE_PROFILE, 0,
+      sizeof(QST_GENERIC_CMD), sizeof(QST_GET_SUBSYSTEM_CONFIG_PROFILE_RSP),
+      sizeof(QST_LEG_GENERIC_CMD), sizeof(QST_LEG_GET_SUBSYSTEM_CONFIG_PROFILE_RSP), 0, 0 },
+
+   {  QST_LOCK_SUBSYSTEM, QST_LEG_LOCK_SUBSYSTEM, XLATE_FIXED, 0,
+      sizeof(QST_LOCK_SUBSYSTEM_CMD), sizeof(QST_GENERIC_RSP),
+      sizeof(QST_LEG_LOCK_SUBSYSTEM_CMD), sizeof(QST_LEG_GENERIC_RSP), 0, 0 },
+
+   {  QST_SST_PASS_THROUGH, QST_LEG_SST_PASS_THROUGH, XLATE_SST, 0,
+      0, 0,
+      0, 0, 0, 0 },
+
+   {  QST_GET_TEMP_MON_UPDATE, QST_LEG_GET_TEMP_MON_UPDATE, XLATE_UPDATE, QST_LEG_MAX_TEMP_MONITORS,
+      sizeof(QST_GENERIC_CMD), sizeof(QST_GET_TEMP_MON_UPDATE_RSP),
+      sizeof(QST_LEG_GENERIC_CMD), sizeof(QST_LEG_GET_TEMP_MON_UPDATE_RSP),
+      sizeof(QST_TEMP_MON_UPDATE), sizeof(QST_LEG_TEMP_MON_UPDATE) },
+
+   {  QST_GET_TEMP_MON_CONFIG, QST_LEG_GET_TEMP_MON_1_CONFIG, XLATE_ENTITY, QST_LEG_MAX_TEMP_MONITORS,
+      sizeof(QST_GENERIC_CMD), sizeof(QST_GET_TEMP_MON_CONFIG_RSP),
+      sizeof(QST_LEG_GENERIC_CMD), sizeof(QST_LEG_GET_TEMP_MON_CONFIG_RSP), 0, 0 },
+
+   {  QST_SET_TEMP_MON_THRESHOLDS, QST_LEG_SET_TEMP_MON_1_THRESHOLDS, XLATE_ENTITY, QST_LEG_MAX_TEMP_MONITORS,
+      sizeof(QST_SET_TEMP_MON_THRESHOLDS_CMD), sizeof(QST_GENERIC_RSP),
+      sizeof(QST_LEG_SET_TEMP_MON_THRESHOLDS_CMD), sizeof(QST_LEG_GENERIC_RSP), 0, 0 },
+
+   {  QST_SET_TEMP_MON_READING, QST_LEG_SET_TEMP_MON_1_READING, XLATE_ENTITY, QST_LEG_MAX_TEMP_MONITORS,
+      sizeof(QST_SET_TEMP_MON_READING_CMD), sizeof(QST_GENERIC_RSP),
+      sizeof(QST_LEG_SET_TEMP_MON_READING_CMD), sizeof(QST_LEG_GENERIC_RSP), 0, 0 },
+
+   {  QST_NO_TEMP_MON_READINGS, QST_LEG_NO_TEMP_MON_1_READINGS, XLATE_ENTITY, QST_LEG_MAX_TEMP_MONITORS,
+      sizeof(QST_GENERIC_CMD), sizeof(QST_GENERIC_RSP),
+      sizeof(QST_LEG_GENERIC_CMD), sizeof(QST_LEG_GENERIC_RSP), 0, 0 },
+
+   {  QST_GET_FAN_MON_UPDATE, QST_LEG_GET_FAN_MON_UPDATE, XLATE_UPDATE, QST_LEG_MAX_FAN_MONITORS,
+      sizeof(QST_GENERIC_CMD), sizeof(QST_GET_FAN_MON_UPDATE_RSP),
+      sizeof(QST_LEG_GENERIC_CMD), sizeof(QST_LEG_GET_FAN_MON_UPDATE_RSP),
+      sizeof(QST_FAN_MON_UPDATE), sizeof(QST_LEG_FAN_MON_UPDATE) },
+
+   {  QST_GET_FAN_MON_CONFIG, QST_LEG_GET_FAN_MON_1_CONFIG, XLATE_ENTITY, QST_LEG_MAX_FAN_MONITORS,
+      sizeof(QST_GENERIC_CMD), sizeof(QST_GET_FAN_MON_CONFIG_RSP),
+      sizeof(QST_LEG_GENERIC_CMD), sizeof(QST_LEG_GET_FAN_MON_CONFIG_RSP), 0, 0 },
+
+   {  QST_SET_FAN_MON_THRESHOLDS, QST_LEG_SET_FAN_MON_1_THRESHOLDS, XLATE_ENTITY, QST_LEG_MAX_FAN_MONITORS,
+      sizeof(QST_SET_FAN_MON_THRESHOLDS_CMD), sizeof(QST_GENERIC_RSP),
+      sizeof(QST_LEG_SET_FAN_MON_THRESHOLDS_CMD), sizeof(QST_LEG_GENERIC_RSP), 0, 0 },
+
+   {  QST_ENABLE_FAN_MON, QST_LEG_ENABLE_FAN_MON_1, XLATE_ENTITY, QST_LEG_MAX_FAN_MONITORS,
+      sizeof(QST_GENERIC_CMD), sizeof(QST_GENERIC_RSP),
+      sizeof(QST_LEG_GENERIC_CMD), sizeof(QST_LEG_GENERIC_RSP), 0, 0 },
+
+   {  QST_DISABLE_FAN_MON, QST_LEG_DISABLE_FAN_MON_1, XLATE_ENTITY, QST_LEG_MAX_FAN_MONITORS,
+      sizeof(QST_GENERIC_CMD), sizeof(QST_GENERIC_RSP),
+      sizeof(QST_LEG_GENERIC_CMD), sizeof(QST_LEG_GENERIC_RSP), 0, 0 },
+
+   {  QST_REDETECT_FAN_PRESENCE, QST_LEG_REDETECT_FAN_PRESENCE, XLATE_FIXED, 0,
+      sizeof(QST_GENERIC_CMD), sizeof(QST_GENERIC_RSP),
+      sizeof(QST_LEG_GENERIC_CMD), sizeof(QST_LEG_GENERIC_RSP), 0, 0 },
+
+   {  QST_GET_VOLT_MON_UPDATE, QST_LEG_GET_VOLT_MON_UPDATE, XLATE_UPDATE, QST_LEG_MAX_VOLT_MONITORS,
+      sizeof(QST_GENERIC_CMD), sizeof(QST_GET_VOLT_MON_UPDATE_RSP),
+      sizeof(QST_LEG_GENERIC_CMD), sizeof(QST_LEG_GET_VOLT_MON_UPDATE_RSP),
+      sizeof(QST_VOLT_MON_UPDATE), sizeof(QST_LEG_VOLT_MON_UPDATE) },
+
+   {  QST_GET_VOLT_MON_CONFIG, QST_LEG_GET_VOLT_MON_1_CONFIG, XLATE_ENTITY, QST_LEG_MAX_VOLT_MONITORS,
+      sizeof(QST_GENERIC_CMD), sizeof(QST_GET_VOLT_MON_CONFIG_RSP),
+      sizeof(QST_LEG_GENERIC_CMD), sizeof(QST_LEG_GET_VOLT_MON_CONFIG_RSP), 0, 0 },
+
+   {  QST_SET_VOLT_MON_THRESHOLDS, QST_LEG_SET_VOLT_MON_1_THRESHOLDS, XLATE_ENTITY, QST_LEG_MAX_VOLT_MONITORS,
+      sizeof(QST_SET_VOLT_MON_THRESHOLDS_CMD), sizeof(QST_GENERIC_RSP),
+      sizeof(QST_LEG_SET_VOLT_MON_THRESHOLDS_CMD), sizeof(QST_LEG_GENERIC_RSP), 0, 0 },
+
+   {  QST_GET_FAN_CTRL_UPDATE, QST_LEG_GET_FAN_CTRL_UPDATE, XLATE_UPDATE, QST_LEG_MAX_FAN_CONTROLLERS,
+      sizeof(QST_GENERIC_CMD), sizeof(QST_GET_FAN_CTRL_UPDATE_RSP),
+      sizeof(QST_LEG_GENERIC_CMD), sizeof(QST_LEG_GET_FAN_CTRL_UPDATE_RSP),
+      sizeof(QST_FAN_CTRL_UPDATE), sizeof(QST_LEG_FAN_CTRL_UPDATE) },
+
+   {  QST_GET_FAN_CTRL_CONFIG, QST_LEG_GET_FAN_CTRL_1_CONFIG, XLATE_ENTITY, QST_LEG_MAX_FAN_CONTROLLERS,
+      sizeof(QST_GENERIC_CMD), sizeof(QST_GET_FAN_CTRL_CONFIG_RSP),
+      sizeof(QST_LEG_GENERIC_CMD), sizeof(QST_LEG_GET_FAN_CTRL_CONFIG_RSP), 0, 0 },
+
+   {  QST_SET_FAN_CTRL_DUTY, QST_LEG_SET_FAN_CTRL_1_DUTY, XLATE_ENTITY, QST_LEG_MAX_FAN_CONTROLLERS,
+      sizeof(QST_SET_FAN_CTRL_DUTY_CMD), sizeof(QST_GENERIC_RSP),
+      sizeof(QST_LEG_SET_FAN_CTRL_DUTY_CMD), sizeof(QST_LEG_GENERIC_RSP), 0, 0 },
+
+   {  QST_SET_FAN_CTRL_AUTO, QST_LEG_SET_FAN_CTRL_1_AUTO, XLATE_ENTITY, QST_LEG_MAX_FAN_CONTROLLERS,
+      sizeof(QST_GENERIC_CMD), sizeof(QST_GENERIC_RSP),
+      sizeof(QST_LEG_GENERIC_CMD), sizeof(QST_LEG_GENERIC_RSP), 0, 0 },
+
+   {  QST_RESET_FAN_CTRL_MIN_DUTY, QST_LEG_RESET_FAN_CTRL_1_MIN_DUTY, XLATE_ENTITY, QST_LEG_MAX_FAN_CONTROLLERS,
+      sizeof(QST_GENERIC_CMD), sizeof(QST_GENERIC_RSP),
+      sizeof(QST_LEG_GENERIC_CMD), sizeof(QST_LEG_GENERIC_RSP), 0, 0 }
+};
 
-   case QST_GET_TEMP_MON_UPDATE:
-      *LegCommand = QST_LEG_GET_TEMP_MON_UPDATE;
-      *LegCmdSize = sizeof(QST_LEG_GENERIC_CMD);
-      *LegRspSize = sizeof(QST_LEG_GET_TEMP_MON_UPDATE_RSP);
-      break;
+//
+// QST 2.x command code to CmdMap[] index.  Commands marked MAP_NONE are not
+// supported by QST 1.x firmware; this is the only place they are listed.
+//
+static const UINT8 NewCmdIndex[] =
+{
+   MAP_NONE,                              // QST_GET_SUBSYSTEM_INFO
+   MAP_GET_SUBSYSTEM_STATUS,              // QST_GET_SUBSYSTEM_STATUS
+   MAP_NONE,                              // QST_GET_SUBSYSTEM_CONFIG
+   MAP_GET_SUBSYSTEM_CONFIG_PROFILE,      // QST_GET_SUBSYSTEM_CONFIG_PROFILE
+   MAP_NONE,                              // QST_SET_SUBSYSTEM_CONFIG
+   MAP_LOCK_SUBSYSTEM,                    // QST_LOCK_SUBSYSTEM
+   MAP_NONE,                              // QST_UPDATE_CPU_CONFIG
+   MAP_NONE,                              // QST_GET_CPU_CONFIG_UPDATE
+   MAP_NONE,                              // QST_UPDATE_CPU_DTS_CONFIG
+   MAP_NONE,                              // QST_GET_CPU_DTS_CONFIG_UPDATE
+   MAP_NONE,                              // QST_UPDATE_FAN_CONFIG
+   MAP_NONE,                              // QST_GET_FAN_CONFIG_UPDATE
+   MAP_SST_PASS_THROUGH,                  // QST_SST_PASS_THROUGH
+   MAP_GET_TEMP_MON_UPDATE,               // QST_GET_TEMP_MON_UPDATE
+   MAP_GET_TEMP_MON_CONFIG,               // QST_GET_TEMP_MON_CONFIG
+   MAP_SET_TEMP_MON_THRESHOLDS,           // QST_SET_TEMP_MON_THRESHOLDS
+   MAP_SET_TEMP_MON_READING,              // QST_SET_TEMP_MON_READING
+   MAP_NO_TEMP_MON_READINGS,              // QST_NO_TEMP_MON_READINGS
+   MAP_GET_FAN_MON_UPDATE,                // QST_GET_FAN_MON_UPDATE
+   MAP_GET_FAN_MON_CONFIG,                // QST_GET_FAN_MON_CONFIG
+   MAP_SET_FAN_MON_THRESHOLDS,            // QST_SET_FAN_MON_THRESHOLDS
+   MAP_ENABLE_FAN_MON,                    // QST_ENABLE_FAN_MON
+   MAP_DISABLE_FAN_MON,                   // QST_DISABLE_FAN_MON
+   MAP_REDETECT_FAN_PRESENCE,             // QST_REDETECT_FAN_PRESENCE
+   MAP_GET_VOLT_MON_UPDATE,               // QST_GET_VOLT_MON_UPDATE
+   MAP_GET_VOLT_MON_CONFIG,               // QST_GET_VOLT_MON_CONFIG
+   MAP_SET_VOLT_MON_THRESHOLDS,           // QST_SET_VOLT_MON_THRESHOLDS
+   MAP_NONE,                              // QST_GET_CURR_MON_UPDATE
+   MAP_NONE,                              // QST_GET_CURR_MON_CONFIG
+   MAP_NONE,                              // QST_SET_CURR_MON_THRESHOLDS
+   MAP_GET_FAN_CTRL_UPDATE,               // QST_GET_FAN_CTRL_UPDATE
+   MAP_GET_FAN_CTRL_CONFIG,               // QST_GET_FAN_CTRL_CONFIG
+   MAP_SET_FAN_CTRL_DUTY,                 // QST_SET_FAN_CTRL_DUTY
+   MAP_SET_FAN_CTRL_AUTO,                 // QST_SET_FAN_CTRL_AUTO
+   MAP_RESET_FAN_CTRL_MIN_DUTY            // QST_RESET_FAN_CTRL_MIN_DUTY
+};
 
-   case QST_GET_TEMP_MON_CONFIG:
-      if (QstCmd->byEntity < QST_LEG_MAX_TEMP_MONITORS)
-      {
-         *LegCommand = (UINT8) (QST_LEG_GET_TEMP_MON_1_CONFIG + QstCmd->byEntity);
-         *LegCmdSize = sizeof(QST_LEG_GENERIC_CMD);
-         *LegRspSize = sizeof(QST_LEG_GET_TEMP_MON_CONFIG_RSP);
-      }
-      break;
+//
+// Legacy command code to CmdMap[] index.  Legacy commands addressing an
+// entity have one code per entity, allocated consecutively.
+//
+#define MAP_X4(Index)      Index, Index, Index, Index
+#define MAP_X8(Index)      MAP_X4(Index), MAP_X4(Index)
+#define MAP_X12(Index)     MAP_X8(Index), MAP_X4(Index)
 
-   case QST_SET_TEMP_MON_THRESHOLDS:
-      if (QstCmd->byEntity < QST_LEG_MAX_TEMP_MONITORS)
-      {
-         *LegCommand = (UINT8) (QST_LEG_SET_TEMP_MON_1_THRESHOLDS + QstCmd->byEntity);
-         *LegCmdSize = sizeof(QST_LEG_SET_TEMP_MON_THRESHOLDS_CMD);
-         *LegRspSize = sizeof(QST_LEG_GENERIC_RSP);
-      }
-      break;
+static const UINT8 LegCmdIndex[] =
+{
+   MAP_GET_SUBSYSTEM_STATUS,              // QST_LEG_GET_SUBSYSTEM_STATUS
+   MAP_NONE,                              // QST_LEG_GET_SUBSYSTEM_CONFIG
+   MAP_GET_SUBSYSTEM_CONFIG_PROFILE,      // QST_LEG_GET_SUBSYSTEM_CONFIG_PROFILE
+   MAP_NONE,                              // QST_LEG_SET_SUBSYSTEM_CONFIG
+   MAP_LOCK_SUBSYSTEM,                    // QST_LEG_LOCK_SUBSYSTEM
+   MAP_X4(MAP_NONE),                      // QST_LEG_UPDATE_CPU_1_CONFIG...
+   MAP_X8(MAP_NONE),                      // QST_LEG_UPDATE_FAN_1_CONFIG...
+   MAP_SST_PASS_THROUGH,                  // QST_LEG_SST_PASS_THROUGH
+   MAP_GET_TEMP_MON_UPDATE,               // QST_LEG_GET_TEMP_MON_UPDATE
+   MAP_X12(MAP_GET_TEMP_MON_CONFIG),      // QST_LEG_GET_TEMP_MON_1_CONFIG...
+   MAP_X12(MAP_SET_TEMP_MON_THRESHOLDS),  // QST_LEG_SET_TEMP_MON_1_THRESHOLDS...
+   MAP_X12(MAP_SET_TEMP_MON_READING),     // QST_LEG_SET_TEMP_MON_1_READING...
+   MAP_GET_FAN_MON_UPDATE,                // QST_LEG_GET_FAN_MON_UPDATE
+   MAP_X8(MAP_GET_FAN_MON_CONFIG),        // QST_LEG_GET_FAN_MON_1_CONFIG...
+   MAP_X8(MAP_SET_FAN_MON_THRESHOLDS),    // QST_LEG_SET_FAN_MON_1_THRESHOLDS...
+   MAP_X8(MAP_ENABLE_FAN_MON),            // QST_LEG_ENABLE_FAN_MON_1...
+   MAP_X8(MAP_DISABLE_FAN_MON),           // QST_LEG_DISABLE_FAN_MON_1...
+   MAP_GET_VOLT_MON_UPDATE,               // QST_LEG_GET_VOLT_MON_UPDATE
+   MAP_X8(MAP_GET_VOLT_MON_CONFIG),       // QST_LEG_GET_VOLT_MON_1_CONFIG...
+   MAP_X8(MAP_SET_VOLT_MON_THRESHOLDS),   // QST_LEG_SET_VOLT_MON_1_THRESHOLDS...
+   MAP_GET_FAN_CTRL_UPDATE,               // QST_LEG_GET_FAN_CTRL_UPDATE
+   MAP_X8(MAP_GET_FAN_CTRL_CONFIG),       // QST_LEG_GET_FAN_CTRL_1_CONFIG...
+   MAP_X8(MAP_SET_FAN_CTRL_DUTY),         // QST_LEG_SET_FAN_CTRL_1_DUTY...
+   MAP_X8(MAP_SET_FAN_CTRL_AUTO),         // QST_LEG_SET_FAN_CTRL_1_AUTO...
+   MAP_X4(MAP_NONE),                      // QST_LEG_GET_CPU_1_CONFIG_UPDATE...
+   MAP_X8(MAP_NONE),                      // QST_LEG_GET_FAN_1_CONFIG_UPDATE...
+   MAP_X8(MAP_RESET_FAN_CTRL_MIN_DUTY),   // QST_LEG_RESET_FAN_CTRL_1_MIN_DUTY...
+   MAP_REDETECT_FAN_PRESENCE,             // QST_LEG_REDETECT_FAN_PRESENCE
+   MAP_X12(MAP_NO_TEMP_MON_READINGS)      // QST_LEG_NO_TEMP_MON_1_READINGS...
+};
 
-   case QST_SET_TEMP_MON_READING:
-      if (QstCmd->byEntity < QST_LEG_MAX_TEMP_MONITORS)
-      {
-         *LegCommand = (UINT8) (QST_LEG_SET_TEMP_MON_1_READING + QstCmd->byEntity);
-         *LegCmdSize = sizeof(QST_LEG_SET_TEMP_MON_READING_CMD);
-         *LegRspSize = sizeof(QST_LEG_GENERIC_RSP);
-      }
-      break;
+//
+// Catch tables that have fallen out of step with the command sets
+//
+#define TABLE_CHECK(Name, Cond)  typedef char Name[(Cond) ? 1 : -1]
 
-   case QST_NO_TEMP_MON_READINGS:
-      if (QstCmd->byEntity < QST_LEG_MAX_TEMP_MONITORS)
-      {
-         *LegCommand = (UINT8) (QST_LEG_NO_TEMP_MON_1_READINGS + QstCmd->byEntity);
-         *LegCmdSize = sizeof(QST_LEG_GENERIC_CMD);
-         *LegRspSize = sizeof(QST_LEG_GENERIC_RSP);
-      }
-      break;
+TABLE_CHECK(CmdMapSizeCheck, sizeof(CmdMap) / sizeof(CmdMap[0]) == MAP_ENTRIES);
+TABLE_CHECK(NewCmdIndexSizeCheck, sizeof(NewCmdIndex) == QST_LAST_CMD_CODE + 1);
+TABLE_CHECK(LegCmdIndexSizeCheck, sizeof(LegCmdIndex) == QST_LEG_LAST_CMD_CODE + 1);
 
-   case QST_GET_FAN_MON_UPDATE:
-      *LegCommand = QST_LEG_GET_FAN_MON_UPDATE;
-      *LegCmdSize = sizeof(QST_LEG_GENERIC_CMD);
-      *LegRspSize = sizeof(QST_LEG_GET_FAN_MON_UPDATE_RSP);
-      break;
+/****************************************************************************/
+/* Translated packets are built in bounded buffers on the stack.  Only SST  */
+/* Pass-Through packets vary in size; those that do not fit are rejected.   */
+/****************************************************************************/
 
-   case QST_GET_FAN_MON_CONFIG:
-      if (QstCmd->byEntity < QST_LEG_MAX_FAN_MONITORS)
-      {
-         *LegCommand = (UINT8) (QST_LEG_GET_FAN_MON_1_CONFIG + QstCmd->byEntity);
-         *LegCmdSize = sizeof(QST_LEG_GENERIC_CMD);
-         *LegRspSize = sizeof(QST_LEG_GET_FAN_MON_CONFIG_RSP);
-      }
-      break;
+#define TRANSLATE_BUFFER_SIZE    512
 
-   case QST_SET_FAN_MON_THRESHOLDS:
-      if (QstCmd->byEntity < QST_LEG_MAX_FAN_MONITORS)
-      {
-         *LegCommand = (UINT8) (QST_LEG_SET_FAN_MON_1_THRESHOLDS + QstCmd->byEntity);
-         *LegCmdSize = sizeof(QST_LEG_SET_FAN_MON_THRESHOLDS_CMD);
-         *LegRspSize = sizeof(QST_LEG_GENERIC_RSP);
-      }
-      break;
-
-   case QST_ENABLE_FAN_MON:
-      if (QstCmd->byEntity < QST_LEG_MAX_FAN_MONITORS)
-      {
-         *LegCommand = (UINT8) (QST_LEG_ENABLE_FAN_MON_1 + QstCmd->byEntity);
-         *LegCmdSize = sizeof(QST_LEG_GENERIC_CMD);
-         *LegRspSize = sizeof(QST_LEG_GENERIC_RSP);
-      }
-      break;
+typedef union _TRANSLATE_BUFFER
+{
+   UINT32   dwAlign;
+   UINT8    abyData[TRANSLATE_BUFFER_SIZE];
 
-   case QST_DISABLE_FAN_MON:
-      if (QstCmd->byEntity < QST_LEG_MAX_FAN_MONITORS)
-      {
-         *LegCommand = (UINT8) (QST_LEG_DISABLE_FAN_MON_1 + QstCmd->byEntity);
-         *LegCmdSize = sizeof(QST_LEG_GENERIC_CMD);
-         *LegRspSize = sizeof(QST_LEG_GENERIC_RSP);
-      }
-      break;
-
-   case QST_REDETECT_FAN_PRESENCE:
-      *LegCommand = QST_LEG_REDETECT_FAN_PRESENCE;
-      *LegCmdSize = sizeof(QST_LEG_GENERIC_CMD);
-      *LegRspSize = sizeof(QST_LEG_GENERIC_RSP);
-      break;
-
-   case QST_GET_VOLT_MON_UPDATE:
-      *LegCommand = QST_LEG_GET_VOLT_MON_UPDATE;
-      *LegCmdSize = sizeof(QST_LEG_GENERIC_CMD);
-      *LegRspSize = sizeof(QST_LEG_GET_VOLT_MON_UPDATE_RSP);
-      break;
-
-   case QST_GET_VOLT_MON_CONFIG:
-      if (QstCmd->byEntity < QST_LEG_MAX_VOLT_MONITORS)
-      {
-         *LegCommand = (UINT8) (QST_LEG_GET_VOLT_MON_1_CONFIG + QstCmd->byEntity);
-         *LegCmdSize = sizeof(QST_LEG_GENERIC_CMD);
-         *LegRspSize = sizeof(QST_LEG_GET_VOLT_MON_CONFIG_RSP);
-      }
-      break;
+} TRANSLATE_BUFFER;
 
-   case QST_SET_VOLT_MON_THRESHOLDS:
-      if (QstCmd->byEntity < QST_LEG_MAX_VOLT_MONITORS)
-      {
-         *LegCommand = (UINT8) (QST_LEG_SET_VOLT_MON_1_THRESHOLDS + QstCmd->byEntity);
-         *LegCmdSize = sizeof(QST_LEG_SET_VOLT_MON_THRESHOLDS_CMD);
-         *LegRspSize = sizeof(QST_LEG_GENERIC_RSP);
-      }
-      break;
+TABLE_CHECK(TranslateBufferSizeCheck, sizeof(QST_GET_TEMP_MON_UPDATE_RSP) <= TRANSLATE_BUFFER_SIZE);
 
-   case QST_GET_FAN_CTRL_UPDATE:
-      *LegCommand = QST_LEG_GET_FAN_CTRL_UPDATE;
-      *LegCmdSize = sizeof(QST_LEG_GENERIC_CMD);
-      *LegRspSize = sizeof(QST_LEG_GET_FAN_CTRL_UPDATE_RSP);
-      break;
 
-   case QST_GET_FAN_CTRL_CONFIG:
-      if (QstCmd->byEntity < QST_LEG_MAX_FAN_CONTROLLERS)
-      {
-         *LegCommand = (UINT8) (QST_LEG_GET_FAN_CTRL_1_CONFIG + QstCmd->byEntity);
-         *LegCmdSize = sizeof(QST_LEG_GENERIC_CMD);
-         *LegRspSize = sizeof(QST_LEG_GET_FAN_CTRL_CONFIG_RSP);
-      }
-      break;
+/****************************************************************************/
+/* Internal functions                                                       */
+/****************************************************************************/
 
-   case QST_SET_FAN_CTRL_DUTY:
-      if (QstCmd->byEntity < QST_LEG_MAX_FAN_CONTROLLERS)
-      {
-         *LegCommand = (UINT8) (QST_LEG_SET_FAN_CTRL_1_DUTY + QstCmd->byEntity);
-         *LegCmdSize = sizeof(QST_LEG_SET_FAN_CTRL_DUTY_CMD);
-         *LegRspSize = sizeof(QST_LEG_GENERIC_RSP);
-      }
-      break;
+/****************************************************************************/
+/* ConvertToLegQstCommand () - Converts the QST 2.0 command and entity data */
+/* into a legacy command.  Also returns the maximum required buffer sizes.  */
+/* Returns the command's description, or NULL if it cannot be translated.   */
+/****************************************************************************/
 
-   case QST_SET_FAN_CTRL_AUTO:
-      if (QstCmd->byEntity < QST_LEG_MAX_FAN_CONTROLLERS)
-      {
-         *LegCommand = (UINT8) (QST_LEG_SET_FAN_CTRL_1_AUTO + QstCmd->byEntity);
-         *LegCmdSize = sizeof(QST_LEG_GENERIC_CMD);
-         *LegRspSize = sizeof(QST_LEG_GENERIC_RSP);
-      }
-      break;
+static const CMD_MAP *ConvertToLegQstCommand(
 
-   case QST_RESET_FAN_CTRL_MIN_DUTY:
-      if (QstCmd->byEntity < QST_LEG_MAX_FAN_CONTROLLERS)
-      {
-         *LegCommand = (UINT8) (QST_LEG_RESET_FAN_CTRL_1_MIN_DUTY + QstCmd->byEntity);
-         *LegCmdSize = sizeof(QST_LEG_GENERIC_CMD);
-         *LegRspSize = sizeof(QST_LEG_GENERIC_RSP);
-      }
-      break;
+   IN    QST_CMD_HEADER *QstCmd,             // 2.x command format
+   OUT   UINT8          *LegCommand,
+   OUT   size_t         *LegCmdSize,
+   OUT   size_t         *LegRspSize
+){
+   const CMD_MAP  *Map;
 
-   default:
-      break;
+   //
+   // Locate the command's description
+   //
+   if (QstCmd->byCommand > QST_LAST_CMD_CODE || NewCmdIndex[QstCmd->byCommand] == MAP_NONE)
+   {
+      return NULL;
    }
 
+   Map = &CmdMap[NewCmdIndex[QstCmd->byCommand]];
+
    //
-   // Check to see if the command was not decoded
+   // Select the legacy command for the entity, if it addresses one
    //
-   if (*LegCommand == (QST_LEG_LAST_CMD_CODE + 1))
+   *LegCommand = Map->byLegCommand;
+
+   if (Map->byType == XLATE_ENTITY)
    {
-      return FALSE;
+      if (QstCmd->byEntity >= Map->byEntities)
+      {
+         return NULL;
+      }
+
+      *LegCommand = (UINT8) (Map->byLegCommand + QstCmd->byEntity);
    }
 
    //
-   // Command decoded
+   // For SST PT buffer sizes will be handled in other places
    //
-   return TRUE;
+   *LegCmdSize = Map->wLegCmdSize;
+   *LegRspSize = Map->wLegRspSize;
+
+   return Map;
 }
 
 /****************************************************************************/
 /* ConvertToNewQstCommand() - Converts the QST 1.x command into a 2.x       */
 /* command and also returns the required buffer sizes for the new command.  */
+/* Returns the command's description, or NULL if it cannot be translated.   */
 /****************************************************************************/
 
-static BOOL ConvertToNewQstCommand(
+static const CMD_MAP *ConvertToNewQstCommand(
 
    IN    QST_LEG_CMD_HEADER   *QstCmd,       // 1.x command format
    OUT   UINT8                *NewCommand,
@@ -334,344 +414,36 @@ static BOOL ConvertToNewQstCommand(
    OUT   size_t               *NewCmdSize,
    OUT   size_t               *NewRspSize
 ){
-   //
-   // Assume that the command translation failed by assigning known bad values.
-   //
-   *NewCommand = QST_LAST_CMD_CODE + 1;
-   *NewEntity  = 0;
-   *NewCmdSize = 0;
-   *NewRspSize = 0;
+   const CMD_MAP  *Map;
 
    //
-   // Convert the command to the 2.x command set and update buffer sizes
+   // Locate the command's description
    //
-   switch (QstCmd->byCommand)
+   if (QstCmd->byCommand > QST_LEG_LAST_CMD_CODE || LegCmdIndex[QstCmd->byCommand] == MAP_NONE)
    {
-   case QST_LEG_GET_SUBSYSTEM_CONFIG:
-   case QST_LEG_SET_SUBSYSTEM_CONFIG:
-   case QST_LEG_UPDATE_CPU_1_CONFIG:
-   case QST_LEG_UPDATE_CPU_2_CONFIG:
-   case QST_LEG_UPDATE_CPU_3_CONFIG:
-   case QST_LEG_UPDATE_CPU_4_CONFIG:
-   case QST_LEG_GET_CPU_1_CONFIG_UPDATE:
-   case QST_LEG_GET_CPU_2_CONFIG_UPDATE:
-   case QST_LEG_GET_CPU_3_CONFIG_UPDATE:
-   case QST_LEG_GET_CPU_4_CONFIG_UPDATE:
-   case QST_LEG_UPDATE_FAN_1_CONFIG:
-   case QST_LEG_UPDATE_FAN_2_CONFIG:
-   case QST_LEG_UPDATE_FAN_3_CONFIG:
-   case QST_LEG_UPDATE_FAN_4_CONFIG:
-   case QST_LEG_UPDATE_FAN_5_CONFIG:
-   case QST_LEG_UPDATE_FAN_6_CONFIG:
-   case QST_LEG_UPDATE_FAN_7_CONFIG:
-   case QST_LEG_UPDATE_FAN_8_CONFIG:
-   case QST_LEG_GET_FAN_1_CONFIG_UPDATE:
-   case QST_LEG_GET_FAN_2_CONFIG_UPDATE:
-   case QST_LEG_GET_FAN_3_CONFIG_UPDATE:
-   case QST_LEG_GET_FAN_4_CONFIG_UPDATE:
-   case QST_LEG_GET_FAN_5_CONFIG_UPDATE:
-   case QST_LEG_GET_FAN_6_CONFIG_UPDATE:
-   case QST_LEG_GET_FAN_7_CONFIG_UPDATE:
-   case QST_LEG_GET_FAN_8_CONFIG_UPDATE:
-      //
-      // Handle unsupported commands here...  This will be the only location
-      // that these commands will be checked!!!
-      //
-      break;
-
-   case QST_LEG_GET_SUBSYSTEM_STATUS:
-      *NewCommand = QST_GET_SUBSYSTEM_STATUS;
-      *NewEntity  = 0;
-      *NewCmdSize = sizeof(QST_GENERIC_CMD);
-      *NewRspSize = sizeof(QST_GET_SUBSYSTEM_STATUS_RSP);
-      break;
-
-   case QST_LEG_GET_SUBSYSTEM_CONFIG_PROFILE:
-      *NewCommand = QST_GET_SUBSYSTEM_CONFIG_PROFILE;
-      *NewEntity  = 0;
-      *NewCmdSize = sizeof(QST_GENERIC_CMD);
-      *NewRspSize = sizeof(QST_GET_SUBSYSTEM_CONFIG_PROFILE_RSP);
-      break;
-
-   case QST_LEG_LOCK_SUBSYSTEM:
-      *NewCommand = QST_LOCK_SUBSYSTEM;
-      *NewEntity  = 0;
-      *NewCmdSize = sizeof(QST_LOCK_SUBSYSTEM_CMD);
-      *NewRspSize = sizeof(QST_GENERIC_RSP);
-      break;
-
-   case QST_LEG_SST_PASS_THROUGH:
-      //
-      // Assign command code but buffer sizes need to be handles outside this
-      // function.
-      //
-      *NewCommand = QST_SST_PASS_THROUGH;
-      break;
-
-   case QST_LEG_GET_TEMP_MON_UPDATE:
-      *NewCommand = QST_GET_TEMP_MON_UPDATE;
-      *NewEntity  = 0;
-      *NewCmdSize = sizeof(QST_GENERIC_CMD);
-      *NewRspSize = sizeof(QST_GET_TEMP_MON_UPDATE_RSP);
-      break;
-
-   case QST_LEG_GET_TEMP_MON_1_CONFIG:
-   case QST_LEG_GET_TEMP_MON_2_CONFIG:
-   case QST_LEG_GET_TEMP_MON_3_CONFIG:
-   case QST_LEG_GET_TEMP_MON_4_CONFIG:
-   case QST_LEG_GET_TEMP_MON_5_CONFIG:
-   case QST_LEG_GET_TEMP_MON_6_CONFIG:
-   case QST_LEG_GET_TEMP_MON_7_CONFIG:
-   case QST_LEG_GET_TEMP_MON_8_CONFIG:
-   case QST_LEG_GET_TEMP_MON_9_CONFIG:
-   case QST_LEG_GET_TEMP_MON_10_CONFIG:
-   case QST_LEG_GET_TEMP_MON_11_CONFIG:
-   case QST_LEG_GET_TEMP_MON_12_CONFIG:
-      *NewCommand = QST_GET_TEMP_MON_CONFIG;
-      *NewEntity  = (UINT8) (QstCmd->byCommand - QST_LEG_GET_TEMP_MON_1_CONFIG);
-      *NewCmdSize = sizeof(QST_GENERIC_CMD);
-      *NewRspSize = sizeof(QST_GET_TEMP_MON_CONFIG_RSP);
-      break;
-
-   case QST_LEG_SET_TEMP_MON_1_THRESHOLDS:
-   case QST_LEG_SET_TEMP_MON_2_THRESHOLDS:
-   case QST_LEG_SET_TEMP_MON_3_THRESHOLDS:
-   case QST_LEG_SET_TEMP_MON_4_THRESHOLDS:
-   case QST_LEG_SET_TEMP_MON_5_THRESHOLDS:
-   case QST_LEG_SET_TEMP_MON_6_THRESHOLDS:
-   case QST_LEG_SET_TEMP_MON_7_THRESHOLDS:
-   case QST_LEG_SET_TEMP_MON_8_THRESHOLDS:
-   case QST_LEG_SET_TEMP_MON_9_THRESHOLDS:
-   case QST_LEG_SET_TEMP_MON_10_THRESHOLDS:
-   case QST_LEG_SET_TEMP_MON_11_THRESHOLDS:
-   case QST_LEG_SET_TEMP_MON_12_THRESHOLDS:
-      *NewCommand = QST_SET_TEMP_MON_THRESHOLDS;
-      *NewEntity  = (UINT8) (QstCmd->byCommand - QST_LEG_SET_TEMP_MON_1_THRESHOLDS);
-      *NewCmdSize = sizeof(QST_SET_TEMP_MON_THRESHOLDS_CMD);
-      *NewRspSize = sizeof(QST_GENERIC_RSP);
-      break;
-
-   case QST_LEG_SET_TEMP_MON_1_READING:
-   case QST_LEG_SET_TEMP_MON_2_READING:
-   case QST_LEG_SET_TEMP_MON_3_READING:
-   case QST_LEG_SET_TEMP_MON_4_READING:
-   case QST_LEG_SET_TEMP_MON_5_READING:
-   case QST_LEG_SET_TEMP_MON_6_READING:
-   case QST_LEG_SET_TEMP_MON_7_READING:
-   case QST_LEG_SET_TEMP_MON_8_READING:
-   case QST_LEG_SET_TEMP_MON_9_READING:
-   case QST_LEG_SET_TEMP_MON_10_READING:
-   case QST_LEG_SET_TEMP_MON_11_READING:
-   case QST_LEG_SET_TEMP_MON_12_READING:
-      *NewCommand = QST_SET_TEMP_MON_READING;
-      *NewEntity  = (UINT8) (QstCmd->byCommand - QST_LEG_SET_TEMP_MON_1_READING);
-      *NewCmdSize = sizeof(QST_SET_TEMP_MON_READING_CMD);
-      *NewRspSize = sizeof(QST_GENERIC_RSP);
-      break;
-
-   case QST_LEG_NO_TEMP_MON_1_READINGS:
-   case QST_LEG_NO_TEMP_MON_2_READINGS:
-   case QST_LEG_NO_TEMP_MON_3_READINGS:
-   case QST_LEG_NO_TEMP_MON_4_READINGS:
-   case QST_LEG_NO_TEMP_MON_5_READINGS:
-   case QST_LEG_NO_TEMP_MON_6_READINGS:
-   case QST_LEG_NO_TEMP_MON_7_READINGS:
-   case QST_LEG_NO_TEMP_MON_8_READINGS:
-   case QST_LEG_NO_TEMP_MON_9_READINGS:
-   case QST_LEG_NO_TEMP_MON_10_READINGS:
-   case QST_LEG_NO_TEMP_MON_11_READINGS:
-   case QST_LEG_NO_TEMP_MON_12_READINGS:
-      *NewCommand = QST_NO_TEMP_MON_READINGS;
-      *NewEntity  = (UINT8) (QstCmd->byCommand - QST_LEG_NO_TEMP_MON_1_READINGS);
-      *NewCmdSize = sizeof(QST_GENERIC_CMD);
-      *NewRspSize = sizeof(QST_GENERIC_RSP);
-      break;
-
-   case QST_LEG_GET_FAN_MON_UPDATE:
-      *NewCommand = QST_GET_FAN_MON_UPDATE;
-      *NewEntity  = 0;
-      *NewCmdSize = sizeof(QST_GENERIC_CMD);
-      *NewRspSize = sizeof(QST_GET_FAN_MON_UPDATE_RSP);
-      break;
-
-   case QST_LEG_GET_FAN_MON_1_CONFIG:
-   case QST_LEG_GET_FAN_MON_2_CONFIG:
-   case QST_LEG_GET_FAN_MON_3_CONFIG:
-   case QST_LEG_GET_FAN_MON_4_CONFIG:
-   case QST_LEG_GET_FAN_MON_5_CONFIG:
-   case QST_LEG_GET_FAN_MON_6_CONFIG:
-   case QST_LEG_GET_FAN_MON_7_CONFIG:
-   case QST_LEG_GET_FAN_MON_8_CONFIG:
-      *NewCommand = QST_GET_FAN_MON_CONFIG;
-      *NewEntity  = (UINT8) (QstCmd->byCommand - QST_LEG_GET_FAN_MON_1_CONFIG);
-      *NewCmdSize = sizeof(QST_GENERIC_CMD);
-      *NewRspSize = sizeof(QST_GET_FAN_MON_CONFIG_RSP);
-      break;
-
-   case QST_LEG_SET_FAN_MON_1_THRESHOLDS:
-   case QST_LEG_SET_FAN_MON_2_THRESHOLDS:
-   case QST_LEG_SET_FAN_MON_3_THRESHOLDS:
-   case QST_LEG_SET_FAN_MON_4_THRESHOLDS:
-   case QST_LEG_SET_FAN_MON_5_THRESHOLDS:
-   case QST_LEG_SET_FAN_MON_6_THRESHOLDS:
-   case QST_LEG_SET_FAN_MON_7_THRESHOLDS:
-   case QST_LEG_SET_FAN_MON_8_THRESHOLDS:
-      *NewCommand = QST_SET_FAN_MON_THRESHOLDS;
-      *NewEntity  = (UINT8) (QstCmd->byCommand - QST_LEG_SET_FAN_MON_1_THRESHOLDS);
-      *NewCmdSize = sizeof(QST_SET_FAN_MON_THRESHOLDS_CMD);
-      *NewRspSize = sizeof(QST_GENERIC_RSP);
-      break;
-
-   case QST_LEG_ENABLE_FAN_MON_1:
-   case QST_LEG_ENABLE_FAN_MON_2:
-   case QST_LEG_ENABLE_FAN_MON_3:
-   case QST_LEG_ENABLE_FAN_MON_4:
-   case QST_LEG_ENABLE_FAN_MON_5:
-   case QST_LEG_ENABLE_FAN_MON_6:
-   case QST_LEG_ENABLE_FAN_MON_7:
-   case QST_LEG_ENABLE_FAN_MON_8:
-      *NewCommand = QST_ENABLE_FAN_MON;
-      *NewEntity  = (UINT8) (QstCmd->byCommand - QST_LEG_ENABLE_FAN_MON_1);
-      *NewCmdSize = sizeof(QST_GENERIC_CMD);
-      *NewRspSize = sizeof(QST_GENERIC_RSP);
-      break;
-
-   case QST_LEG_DISABLE_FAN_MON_1:
-   case QST_LEG_DISABLE_FAN_MON_2:
-   case QST_LEG_DISABLE_FAN_MON_3:
-   case QST_LEG_DISABLE_FAN_MON_4:
-   case QST_LEG_DISABLE_FAN_MON_5:
-   case QST_LEG_DISABLE_FAN_MON_6:
-   case QST_LEG_DISABLE_FAN_MON_7:
-   case QST_LEG_DISABLE_FAN_MON_8:
-      *NewCommand = QST_DISABLE_FAN_MON;
-      *NewEntity  = (UINT8) (QstCmd->byCommand - QST_LEG_DISABLE_FAN_MON_1);
-      *NewCmdSize = sizeof(QST_GENERIC_CMD);
-      *NewRspSize = sizeof(QST_GENERIC_RSP);
-      break;
-
-   case QST_LEG_REDETECT_FAN_PRESENCE:
-      *NewCommand = QST_REDETECT_FAN_PRESENCE;
-      *NewEntity  = 0;
-      *NewCmdSize = sizeof(QST_GENERIC_CMD);
-      *NewRspSize = sizeof(QST_GENERIC_RSP);
-      break;
-
-   case QST_LEG_GET_VOLT_MON_UPDATE:
-      *NewCommand = QST_GET_VOLT_MON_UPDATE;
-      *NewEntity  = 0;
-      *NewCmdSize = sizeof(QST_GENERIC_CMD);
-      *NewRspSize = sizeof(QST_GET_VOLT_MON_UPDATE_RSP);
-      break;
-
-   case QST_LEG_GET_VOLT_MON_1_CONFIG:
-   case QST_LEG_GET_VOLT_MON_2_CONFIG:
-   case QST_LEG_GET_VOLT_MON_3_CONFIG:
-   case QST_LEG_GET_VOLT_MON_4_CONFIG:
-   case QST_LEG_GET_VOLT_MON_5_CONFIG:
-   case QST_LEG_GET_VOLT_MON_6_CONFIG:
-   case QST_LEG_GET_VOLT_MON_7_CONFIG:
-   case QST_LEG_GET_VOLT_MON_8_CONFIG:
-      *NewCommand = QST_GET_VOLT_MON_CONFIG;
-      *NewEntity  = (UINT8) (QstCmd->byCommand - QST_LEG_GET_VOLT_MON_1_CONFIG);
-      *NewCmdSize = sizeof(QST_GENERIC_CMD);
-      *NewRspSize = sizeof(QST_GET_VOLT_MON_CONFIG_RSP);
-      break;
-
-   case QST_LEG_SET_VOLT_MON_1_THRESHOLDS:
-   case QST_LEG_SET_VOLT_MON_2_THRESHOLDS:
-   case QST_LEG_SET_VOLT_MON_3_THRESHOLDS:
-   case QST_LEG_SET_VOLT_MON_4_THRESHOLDS:
-   case QST_LEG_SET_VOLT_MON_5_THRESHOLDS:
-   case QST_LEG_SET_VOLT_MON_6_THRESHOLDS:
-   case QST_LEG_SET_VOLT_MON_7_THRESHOLDS:
-   case QST_LEG_SET_VOLT_MON_8_THRESHOLDS:
-      *NewCommand = QST_SET_VOLT_MON_THRESHOLDS;
-      *NewEntity  = (UINT8) (QstCmd->byCommand - QST_LEG_SET_VOLT_MON_1_THRESHOLDS);
-      *NewCmdSize = sizeof(QST_SET_VOLT_MON_THRESHOLDS_CMD);
-      *NewRspSize = sizeof(QST_GENERIC_RSP);
-      break;
-
-   case QST_LEG_GET_FAN_CTRL_UPDATE:
-      *NewCommand = QST_GET_FAN_CTRL_UPDATE;
-      *NewEntity  = 0;
-      *NewCmdSize = sizeof(QST_GENERIC_CMD);
-      *NewRspSize = sizeof(QST_GET_FAN_CTRL_UPDATE_RSP);
-      break;
-
-   case QST_LEG_GET_FAN_CTRL_1_CONFIG:
-   case QST_LEG_GET_FAN_CTRL_2_CONFIG:
-   case QST_LEG_GET_FAN_CTRL_3_CONFIG:
-   case QST_LEG_GET_FAN_CTRL_4_CONFIG:
-   case QST_LEG_GET_FAN_CTRL_5_CONFIG:
-   case QST_LEG_GET_FAN_CTRL_6_CONFIG:
-   case QST_LEG_GET_FAN_CTRL_7_CONFIG:
-   case QST_LEG_GET_FAN_CTRL_8_CONFIG:
-      *NewCommand = QST_GET_FAN_CTRL_CONFIG;
-      *NewEntity  = (UINT8) (QstCmd->byCommand - QST_LEG_GET_FAN_CTRL_1_CONFIG);
-      *NewCmdSize = sizeof(QST_GENERIC_CMD);
-      *NewRspSize = sizeof(QST_GET_FAN_CTRL_CONFIG_RSP);
-      break;
-
-   case QST_LEG_SET_FAN_CTRL_1_DUTY:
-   case QST_LEG_SET_FAN_CTRL_2_DUTY:
-   case QST_LEG_SET_FAN_CTRL_3_DUTY:
-   case QST_LEG_SET_FAN_CTRL_4_DUTY:
-   case QST_LEG_SET_FAN_CTRL_5_DUTY:
-   case QST_LEG_SET_FAN_CTRL_6_DUTY:
-   case QST_LEG_SET_FAN_CTRL_7_DUTY:
-   case QST_LEG_SET_FAN_CTRL_8_DUTY:
-      *NewCommand = QST_SET_FAN_CTRL_DUTY;
-      *NewEntity  = (UINT8) (QstCmd->byCommand - QST_LEG_SET_FAN_CTRL_1_DUTY);
-      *NewCmdSize = sizeof(QST_SET_FAN_CTRL_DUTY_CMD);
-      *NewRspSize = sizeof(QST_GENERIC_RSP);
-      break;
-
-   case QST_LEG_SET_FAN_CTRL_1_AUTO:
-   case QST_LEG_SET_FAN_CTRL_2_AUTO:
-   case QST_LEG_SET_FAN_CTRL_3_AUTO:
-   case QST_LEG_SET_FAN_CTRL_4_AUTO:
-   case QST_LEG_SET_FAN_CTRL_5_AUTO:
-   case QST_LEG_SET_FAN_CTRL_6_AUTO:
-   case QST_LEG_SET_FAN_CTRL_7_AUTO:
-   case QST_LEG_SET_FAN_CTRL_8_AUTO:
-      *NewCommand = QST_SET_FAN_CTRL_AUTO;
-      *NewEntity  = (UINT8) (QstCmd->byCommand - QST_LEG_SET_FAN_CTRL_1_AUTO);
-      *NewCmdSize = sizeof(QST_GENERIC_CMD);
-      *NewRspSize = sizeof(QST_GENERIC_RSP);
-      break;
-
-   case QST_LEG_RESET_FAN_CTRL_1_MIN_DUTY:
-   case QST_LEG_RESET_FAN_CTRL_2_MIN_DUTY:
-   case QST_LEG_RESET_FAN_CTRL_3_MIN_DUTY:
-   case QST_LEG_RESET_FAN_CTRL_4_MIN_DUTY:
-   case QST_LEG_RESET_FAN_CTRL_5_MIN_DUTY:
-   case QST_LEG_RESET_FAN_CTRL_6_MIN_DUTY:
-   case QST_LEG_RESET_FAN_CTRL_7_MIN_DUTY:
-   case QST_LEG_RESET_FAN_CTRL_8_MIN_DUTY:
-      *NewCommand = QST_RESET_FAN_CTRL_MIN_DUTY;
-      *NewEntity  = (UINT8) (QstCmd->byCommand - QST_LEG_RESET_FAN_CTRL_1_MIN_DUTY);
-      *NewCmdSize = sizeof(QST_GENERIC_CMD);
-      *NewRspSize = sizeof(QST_GENERIC_RSP);
-      break;
-
-   default:
-      //
-      // Unknown command passed in so error out
-      //
-      return FALSE;
+      return NULL;
    }
 
+   Map = &CmdMap[LegCmdIndex[QstCmd->byCommand]];
+
    //
-   // Check to see if the command was not decoded
+   // Legacy commands addressing an entity carry it in their command code
    //
-   if (*NewCommand == (QST_LAST_CMD_CODE + 1))
+   *NewCommand = Map->byNewCommand;
+   *NewEntity  = 0;
+
+   if (Map->byType == XLATE_ENTITY)
    {
-      return FALSE;
+      *NewEntity = (UINT8) (QstCmd->byCommand - Map->byLegCommand);
    }
 
+   //
+   // For SST PT buffer sizes will be handled in other places
+   //
+   *NewCmdSize = Map->wNewCmdSize;
+   *NewRspSize = Map->wNewRspSize;
 
-   return TRUE;
+   return Map;
 }
 
 /****************************************************************************/
@@ -782,6 +554,7 @@ static BOOL ConvertToNewCommandData(
 static BOOL ConvertToNewResponseData(
 
    IN    void           *CmdBuf,             // 2.x command format
+   IN    const CMD_MAP  *Map,
    IN    void           *LegRspBuf,
    IN    size_t         LegRspSize,
    OUT   void           *RspBuf,
@@ -791,8 +564,7 @@ static BOOL ConvertToNewResponseData(
    QST_LEG_GET_SUBSYSTEM_CONFIG_PROFILE_RSP  *LegConfigProfileRsp = LegRspBuf;
    size_t                                    MaxCopySize;
    size_t                                    CopySize;
-   UINT8                                     MaxEntityCount = 0;
-   UINT8                                     CopyCount = 0;
+   size_t                                    CopyCount = 0;
    QST_CMD_HEADER                            QstCmd = {0};
    void                                      *CopyStartAddr = NULL;
 
@@ -831,7 +603,7 @@ static BOOL ConvertToNewResponseData(
    //
    // Copy data based on command
    //
-   if (QstCmd.byCommand == QST_GET_SUBSYSTEM_CONFIG_PROFILE)
+   if (Map->byType == XLATE_PROFILE)
    {
       //
       // Profile data structure changed so copy individual settings across
@@ -844,41 +616,12 @@ static BOOL ConvertToNewResponseData(
       ConfigProfileRsp->dwTempRespConfigured = LegConfigProfileRsp->byTempRespConfigured;
       ConfigProfileRsp->dwFanCtrlsConfigured = LegConfigProfileRsp->byFanCtrlConfigured;
    }
-   else if (QstCmd.byCommand == QST_GET_TEMP_MON_UPDATE ||
-            QstCmd.byCommand == QST_GET_FAN_MON_UPDATE ||
-            QstCmd.byCommand == QST_GET_VOLT_MON_UPDATE ||
-            QstCmd.byCommand == QST_GET_FAN_CTRL_UPDATE)
+   else if (Map->byType == XLATE_UPDATE)
    {
-      //
-      // Determine bounds for legacy entities
-      //
-      switch (QstCmd.byCommand)
-      {
-      case QST_GET_TEMP_MON_UPDATE:
-         MaxEntityCount = QST_LEG_MAX_TEMP_MONITORS;
-         CopyCount = (UINT8) QST_TEMP_MON_UPDATE_SENSOR_COUNT(QstCmd.wResponseLength);
-         break;
-
-      case QST_GET_FAN_MON_UPDATE:
-         MaxEntityCount = QST_LEG_MAX_FAN_MONITORS;
-         CopyCount = (UINT8) QST_FAN_MON_UPDATE_SENSOR_COUNT(QstCmd.wResponseLength);
-         break;
-
-      case QST_GET_VOLT_MON_UPDATE:
-         MaxEntityCount = QST_LEG_MAX_VOLT_MONITORS;
-         CopyCount = (UINT8) QST_VOLT_MON_UPDATE_SENSOR_COUNT(QstCmd.wResponseLength);
-         break;
-
-      case QST_GET_FAN_CTRL_UPDATE:
-         MaxEntityCount = QST_LEG_MAX_FAN_CONTROLLERS;
-         CopyCount = (UINT8) QST_FAN_CTRL_UPDATE_SENSOR_COUNT(QstCmd.wResponseLength);
-         break;
-      }
-
       //
       // Check to see if any data needs to be copied
       //
-      if (QstCmd.byEntity >= MaxEntityCount)
+      if (QstCmd.byEntity >= Map->byEntities)
       {
          return TRUE;
       }
@@ -886,35 +629,25 @@ static BOOL ConvertToNewResponseData(
       //
       // Determine the number of entries to copy
       //
-      if ((QstCmd.byEntity + CopyCount) >= MaxEntityCount)
+      if (QstCmd.wResponseLength > sizeof(QST_GENERIC_RSP))
       {
-         CopyCount = (UINT8) (MaxEntityCount - QstCmd.byEntity);
+         CopyCount = (QstCmd.wResponseLength - sizeof(QST_GENERIC_RSP)) / Map->wNewEntrySize;
+      }
+
+      if ((QstCmd.byEntity + CopyCount) >= Map->byEntities)
+      {
+         CopyCount = Map->byEntities - QstCmd.byEntity;
       }
 
       //
       // Get start address for copy
       //
-      switch (QstCmd.byCommand)
+      CopyStartAddr = ((UINT8*) LegRspBuf) + sizeof(QST_LEG_GENERIC_RSP) + (QstCmd.byEntity * Map->wLegEntrySize);
+      CopySize = Map->wLegEntrySize * CopyCount;
+
+      if (CopySize > RspSize - sizeof(QST_GENERIC_RSP))
       {
-      case QST_GET_TEMP_MON_UPDATE:
-         CopyStartAddr = &((QST_LEG_GET_TEMP_MON_UPDATE_RSP*) LegRspBuf)->stMonitorUpdate[QstCmd.byEntity];
-         CopySize = sizeof(QST_LEG_TEMP_MON_UPDATE) * CopyCount;
-         break;
-
-      case QST_GET_FAN_MON_UPDATE:
-         CopyStartAddr = &((QST_LEG_GET_FAN_MON_UPDATE_RSP*) LegRspBuf)->stMonitorUpdate[QstCmd.byEntity];
-         CopySize = sizeof(QST_LEG_FAN_MON_UPDATE) * CopyCount;
-         break;
-
-      case QST_GET_VOLT_MON_UPDATE:
-         CopyStartAddr = &((QST_LEG_GET_VOLT_MON_UPDATE_RSP*) LegRspBuf)->stMonitorUpdate[QstCmd.byEntity];
-         CopySize = sizeof(QST_LEG_VOLT_MON_UPDATE) * CopyCount;
-         break;
-
-      case QST_GET_FAN_CTRL_UPDATE:
-         CopyStartAddr = &((QST_LEG_GET_TEMP_MON_UPDATE_RSP*) LegRspBuf)->stMonitorUpdate[QstCmd.byEntity];
-         CopySize = sizeof(QST_LEG_TEMP_MON_UPDATE) * CopyCount;
-         break;
+         CopySize = RspSize - sizeof(QST_GENERIC_RSP);
       }
 
       //
@@ -946,7 +679,7 @@ static BOOL ConvertToNewResponseData(
 
 static BOOL ConvertToLegResponseData(
 
-   IN    void                 *CmdBuf,       // 1.x command format
+   IN    const CMD_MAP        *Map,          // 1.x command's description
    IN    void                 *NewRspBuf,
    IN    size_t               NewRspSize,
    OUT   void                 *RspBuf,
@@ -955,7 +688,6 @@ static BOOL ConvertToLegResponseData(
    QST_GET_SUBSYSTEM_CONFIG_PROFILE_RSP      *ConfigProfileRsp = NewRspBuf;
    QST_LEG_GET_SUBSYSTEM_CONFIG_PROFILE_RSP  *LegConfigProfileRsp = RspBuf;
    size_t                                    MaxCopySize;
-   QST_LEG_CMD_HEADER                        QstCmd = {0};
 
    //
    // Check to see if we have any work to do.
@@ -965,12 +697,6 @@ static BOOL ConvertToLegResponseData(
       return TRUE;
    }
 
-   //
-   // Create a local copy of the command buffer just in case the command and
-   // response buffers are shared.
-   //
-   memcpy (&QstCmd, CmdBuf, sizeof(QST_LEG_CMD_HEADER));
-
    //
    // Determine the maximum data that can be copied between the two response
    // buffers.
@@ -985,14 +711,15 @@ static BOOL ConvertToLegResponseData(
    // Zero fill the buffer as many commands need this to be the case.
    //
    // NOTE: Clearing the response buffer may cause the command buffer to be
-   //       cleared if the buffers are shared.  Use the cached copy to be safe.
+   //       cleared if the buffers are shared.  The command's description was
+   //       obtained before this point, so the command is not needed again.
    //
    memset (RspBuf, 0, RspSize);
 
    //
    // Begin to process commands here
    //
-   if (QstCmd.byCommand == QST_LEG_GET_SUBSYSTEM_CONFIG_PROFILE)
+   if (Map->byType == XLATE_PROFILE)
    {
       LegConfigProfileRsp->byStatus = ConfigProfileRsp->byStatus;
       LegConfigProfileRsp->wTempMonsConfigured = (UINT16) ConfigProfileRsp->dwTempMonsConfigured;
@@ -1134,11 +861,12 @@ CMD_TRANSLATION_STATUS TranslateToLegacyCommand(
    IN  size_t     tRspSize            // Expected size of response packet
 ){
    BOOL              bSucceeded = FALSE;
-   void              *LegCmdBuf = NULL;
+   TRANSLATE_BUFFER  LegCmdBuf;
    size_t            LegCmdSize = 0;
-   void              *LegRspBuf = NULL;
+   TRANSLATE_BUFFER  LegRspBuf;
    size_t            LegRspSize = 0;
    QST_CMD_HEADER    *QstCmd    = pvCmdBuf;
+   const CMD_MAP     *Map       = NULL;
    UINT8             LegCmdCode = 0;
    size_t            MinRspSize = 0;
    size_t            MaxRspSize = 0;
@@ -1146,7 +874,8 @@ CMD_TRANSLATION_STATUS TranslateToLegacyCommand(
    //
    // Convert the command and entity information into a legacy command
    //
-   if (!ConvertToLegQstCommand (QstCmd, &LegCmdCode, &LegCmdSize, &LegRspSize))
+   Map = ConvertToLegQstCommand (QstCmd, &LegCmdCode, &LegCmdSize, &LegRspSize);
+   if (Map == NULL)
    {
       //
       // Special handling for commands not supported for QST 1.x but that can
@@ -1232,31 +961,17 @@ CMD_TRANSLATION_STATUS TranslateToLegacyCommand(
    //
    // Handle buffer sizes for SST PT commands here
    //
-   if (QstCmd->byCommand == QST_SST_PASS_THROUGH)
+   if (Map->byType == XLATE_SST)
    {
       LegCmdSize = QstCmd->wCommandLength + sizeof(QST_LEG_CMD_HEADER);
       LegRspSize = QstCmd->wResponseLength;
    }
 
    //
-   // Allocate buffers for commands
+   // Check that the packets fit the translation buffers
    //
-   LegCmdBuf = malloc (LegCmdSize);
-   LegRspBuf = malloc (LegRspSize);
-   if (LegCmdBuf == NULL || LegRspBuf == NULL)
+   if (LegCmdSize > sizeof(LegCmdBuf) || LegRspSize > sizeof(LegRspBuf))
    {
-      //
-      // Free any allocated buffers
-      //
-      if (LegCmdBuf != NULL)
-      {
-         free (LegCmdBuf);
-      }
-      if (LegRspBuf != NULL)
-      {
-         free (LegRspBuf);
-      }
-
       //
       // Set error and return
       //
@@ -1270,14 +985,8 @@ CMD_TRANSLATION_STATUS TranslateToLegacyCommand(
    //
    // Copy command data into legacy command format (May need some additional translation)
    //
-   if (!ConvertToLegCommandData (pvCmdBuf, tCmdSize, LegCmdCode, LegCmdBuf, LegCmdSize, LegRspSize))
+   if (!ConvertToLegCommandData (pvCmdBuf, tCmdSize, LegCmdCode, &LegCmdBuf, LegCmdSize, LegRspSize))
    {
-      //
-      // Error so free buffers
-      //
-      free (LegCmdBuf);
-      free (LegRspBuf);
-
       //
       // Sett error codes
       //
@@ -1291,19 +1000,13 @@ CMD_TRANSLATION_STATUS TranslateToLegacyCommand(
    //
    // Call common command handler (Calls SetLastError before exit if failed)
    //
-   bSucceeded = CommonCmdHandler (LegCmdBuf, LegCmdSize, LegRspBuf, LegRspSize);
+   bSucceeded = CommonCmdHandler (&LegCmdBuf, LegCmdSize, &LegRspBuf, LegRspSize);
 
    //
    // Convert legacy response data to the current response format
    //
-   if (!ConvertToNewResponseData (QstCmd, LegRspBuf, LegRspSize, pvRspBuf, tRspSize))
+   if (!ConvertToNewResponseData (QstCmd, Map, &LegRspBuf, LegRspSize, pvRspBuf, tRspSize))
    {
-      //
-      // Error so free the buffers
-      //
-      free (LegCmdBuf);
-      free (LegRspBuf);
-
       //
       // Sett error codes
       //
@@ -1314,12 +1017,6 @@ CMD_TRANSLATION_STATUS TranslateToLegacyCommand(
       return TRANSLATE_CMD_INVALID_PARAMETER;
    }
 
-   //
-   // Free buffers
-   //
-   free (LegCmdBuf);
-   free (LegRspBuf);
-
    //
    // Check to see if the command being sent had issues
    //
@@ -1345,18 +1042,20 @@ CMD_TRANSLATION_STATUS TranslateToNewCommand(
    IN  size_t     tRspSize            // Expected size of response packet
 ){
    BOOL                 bSucceeded     = FALSE;
-   void                 *NewCmdBuf     = NULL;
+   TRANSLATE_BUFFER     NewCmdBuf;
    size_t               NewCmdSize     = 0;
-   void                 *NewRspBuf     = NULL;
+   TRANSLATE_BUFFER     NewRspBuf;
    size_t               NewRspSize     = 0;
    QST_LEG_CMD_HEADER   *QstCmd        = pvCmdBuf;
+   const CMD_MAP        *Map           = NULL;
    UINT8                NewCmdCode     = 0;
    UINT8                NewCmdEntity   = 0;
 
    //
    // Convert the command to the new command set
    //
-   if (!ConvertToNewQstCommand (QstCmd, &NewCmdCode, &NewCmdEntity, &NewCmdSize, &NewRspSize))
+   Map = ConvertToNewQstCommand (QstCmd, &NewCmdCode, &NewCmdEntity, &NewCmdSize, &NewRspSize);
+   if (Map == NULL)
    {
       //
       // Unable to decode the command so bail...
@@ -1371,31 +1070,17 @@ CMD_TRANSLATION_STATUS TranslateToNewCommand(
    //
    // Handle SST PT command sizes here
    //
-   if (QstCmd->byCommand == QST_LEG_SST_PASS_THROUGH)
+   if (Map->byType == XLATE_SST)
    {
       NewCmdSize = QstCmd->wCommandLength + sizeof(QST_GENERIC_CMD);
       NewRspSize = QstCmd->wResponseLength;
    }
 
    //
-   // Allocate buffers for commands
+   // Check that the packets fit the translation buffers
    //
-   NewCmdBuf = malloc (NewCmdSize);
-   NewRspBuf = malloc (NewRspSize);
-   if (NewCmdBuf == NULL || NewRspBuf == NULL)
+   if (NewCmdSize > sizeof(NewCmdBuf) || NewRspSize > sizeof(NewRspBuf))
    {
-      //
-      // Free any allocated buffers
-      //
-      if (NewCmdBuf != NULL)
-      {
-         free (NewCmdBuf);
-      }
-      if (NewRspBuf != NULL)
-      {
-         free (NewCmdBuf);
-      }
-
       //
       // Return memory error
       //
@@ -1409,14 +1094,8 @@ CMD_TRANSLATION_STATUS TranslateToNewCommand(
    //
    // Copy legacy command data into new command format
    //
-   if (!ConvertToNewCommandData (pvCmdBuf, tCmdSize, NewCmdCode, NewCmdEntity, NewCmdBuf, NewCmdSize, NewRspSize))
+   if (!ConvertToNewCommandData (pvCmdBuf, tCmdSize, NewCmdCode, NewCmdEntity, &NewCmdBuf, NewCmdSize, NewRspSize))
    {
-      //
-      // Error converting so free buffers
-      //
-      free (NewCmdBuf);
-      free (NewRspBuf);
-
       //
       // Sett error codes
       //
@@ -1430,19 +1109,13 @@ CMD_TRANSLATION_STATUS TranslateToNewCommand(
    //
    // Call common command handler (Calls SetLastError before exit if failed)
    //
-   bSucceeded = CommonCmdHandler (NewCmdBuf, NewCmdSize, NewRspBuf, NewRspSize);
+   bSucceeded = CommonCmdHandler (&NewCmdBuf, NewCmdSize, &NewRspBuf, NewRspSize);
 
    //
    // Convert new response data to the legacy response format
    //
-   if (!ConvertToLegResponseData (QstCmd, NewRspBuf, NewRspSize, pvRspBuf, tRspSize))
+   if (!ConvertToLegResponseData (Map, &NewRspBuf, NewRspSize, pvRspBuf, tRspSize))
    {
-      //
-      // Error so free the buffers and set error
-      //
-      free (NewCmdBuf);
-      free (NewRspBuf);
-
       //
       // Sett error codes
       //
@@ -1453,12 +1126,6 @@ CMD_TRANSLATION_STATUS TranslateToNewCommand(
       return TRANSLATE_CMD_INVALID_PARAMETER;
    }
 
-   //
-   // Free buffers
-   //
-   free (NewCmdBuf);
-   free (NewRspBuf);
-
    //
    // Check to see if the command being sent had issues
    //
@@ -57,6 +57,11 @@ typedef enum
 
 } CMD_TRANSLATION_STATUS;
 
+// Subsystem information (QST 1.x values until determined)
+
+extern BOOL                         QstSubsystemInfoFound;
+extern QST_GET_SUBSYSTEM_INFO_RSP   QstSubsystemInfo;
+
 // Function prototypes
 
 BOOL GetSubsystemInformation( void );
@@ -3,7 +3,9 @@
 /*  Module:         MilliTime.c                                             */
 /*                                                                          */
 /*  Description:    Implements a  set  of  portable  time  functions  with  */
-/*                  millisecond resolution.                                 */
+/*                  millisecond resolution. Under Linux, times are kept as  */
+/*                  nanosecond counts of the monotonic clock, so that they  */
+/*                  are unaffected by changes to the time of day.           */
 /*                                                                          */
 /*  Functions:      CurrMTime()   - Places  current  time  into  specified  */
 /*                                  MILLITIME buffer.                       */
@@ -25,6 +27,22 @@
 /*                  WaitMTime()   - Delays execution until  the  specified  */
 /*                                  MILLITIME time occurs.                  */
 /*                                                                          */
+/*                  DiffMTime()   - Returns the number of milliseconds  by  */
+/*                                  which the  first  MILLITIME  value  is  */
+/*                                  later than the second.                  */
+/*                                                                          */
+/*                  OpenMTimer()  - Creates   a   timer   for   scheduling  */
+/*                                  periodic work (Linux only).             */
+/*                                                                          */
+/*                  StartMTimer() - Arms a timer to tick  at  a  specified  */
+/*                                  MILLITIME time and then periodically.   */
+/*                                                                          */
+/*                  WaitMTimer()  - Waits for the next tick of a timer and  */
+/*                                  returns the number of ticks since  the  */
+/*                                  last wait.                              */
+/*                                                                          */
+/*                  CloseMTimer() - Destroys a timer.                       */
+/*                                                                          */
 /****************************************************************************/
 
 /****************************************************************************/
@@ -68,11 +86,19 @@
 #include <time.h>
 #include <errno.h>
 
+#if !defined(__LINUX__) && defined(__linux__)
+#define __LINUX__
+#endif
+
 #if defined(__WIN32__) || defined(_WIN32) || defined(_WIN64) || defined(__WINDOWS__)
 #include <windows.h>
 #include <tchar.h>
 #include "sys/timeb.h"
-#elif defined(__SOLARIS__) || defined(__sun__) || defined(__LINUX__) || defined(__linux__)
+#elif defined(__LINUX__)
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+#elif defined(__SOLARIS__) || defined(__sun__)
 #include <sys/time.h>
 #elif defined(__MSDOS__) || defined(MSDOS) || defined(_MSDOS) || defined(__DOS__)
 #if (CLOCKS_PER_SEC != 1000)
@@ -82,6 +108,11 @@
 
 #include "MilliTime.h"
 
+#define NS_PER_MS       1000000ULL
+#define NS_PER_SEC      1000000000ULL
+
+#if !defined(__LINUX__)
+
 /****************************************************************************/
 /* Delay() - Implements an 'n' millisecond delay.                           */
 /****************************************************************************/
@@ -91,7 +122,7 @@ static void Delay( unsigned long uMilliseconds )
    if( uMilliseconds )
    {
 
-#if defined(__LINUX__) || defined(__SOLARIS__)
+#if defined(__SOLARIS__)
 
       struct timespec stTS;
 
@@ -129,6 +160,8 @@ static void Delay( unsigned long uMilliseconds )
    }
 }
 
+#endif // !defined(__LINUX__)
+
 /****************************************************************************/
 /* CurrMTime() - Stores current time into specified MILLITIME buffer.       */
 /****************************************************************************/
@@ -136,7 +169,15 @@ static void Delay( unsigned long uMilliseconds )
 void CurrMTime( P_MILLITIME pMTime )
 {
 
-#if defined(__LINUX__) || defined(__SOLARIS__)
+#if defined(__LINUX__)
+
+   struct timespec stTS;
+
+   clock_gettime( CLOCK_MONOTONIC, &stTS );
+
+   pMTime->uTimeNS = (unsigned long long)stTS.tv_sec * NS_PER_SEC + stTS.tv_nsec;
+
+#elif defined(__SOLARIS__)
 
    struct timeval stTV;
    gettimeofday( &stTV, NULL );
@@ -168,8 +209,18 @@ void CurrMTime( P_MILLITIME pMTime )
 
 void SetMTime( P_MILLITIME pMTime, time_t tSecs, unsigned long wMillisecs )
 {
+
+#if defined(__LINUX__)
+
+   pMTime->uTimeNS = (unsigned long long)tSecs * NS_PER_SEC + wMillisecs * NS_PER_MS;
+
+#else
+
    pMTime->tTimeS  = tSecs;
    pMTime->uTimeMS = wMillisecs;
+
+#endif
+
 }
 
 /****************************************************************************/
@@ -178,8 +229,18 @@ void SetMTime( P_MILLITIME pMTime, time_t tSecs, unsigned long wMillisecs )
 
 void CopyMTime( P_MILLITIME pMTimeOut, P_MILLITIME pMTimeIn )
 {
+
+#if defined(__LINUX__)
+
+   pMTimeOut->uTimeNS = pMTimeIn->uTimeNS;
+
+#else
+
    pMTimeOut->tTimeS  = pMTimeIn->tTimeS;
    pMTimeOut->uTimeMS = pMTimeIn->uTimeMS;
+
+#endif
+
 }
 
 /****************************************************************************/
@@ -189,10 +250,20 @@ void CopyMTime( P_MILLITIME pMTimeOut, P_MILLITIME pMTimeIn )
 
 void AddMTime( P_MILLITIME pMTime, time_t tSecs, unsigned long uMillisecs )
 {
+
+#if defined(__LINUX__)
+
+   pMTime->uTimeNS += (unsigned long long)tSecs * NS_PER_SEC + uMillisecs * NS_PER_MS;
+
+#else
+
    DWORD dwMS = pMTime->uTimeMS + uMillisecs;
 
    pMTime->tTimeS  += (dwMS / 1000) + tSecs;
    pMTime->uTimeMS  = dwMS % 1000;
+
+#endif
+
 }
 
 /****************************************************************************/
@@ -202,6 +273,13 @@ void AddMTime( P_MILLITIME pMTime, time_t tSecs, unsigned long uMillisecs )
 
 BOOL PastMTime( P_MILLITIME pMTime1, P_MILLITIME pMTime2 )
 {
+
+#if defined(__LINUX__)
+
+   return( pMTime1->uTimeNS < pMTime2->uTimeNS );
+
+#else
+
    if( pMTime1->tTimeS > pMTime2->tTimeS )
       return( FALSE );
 
@@ -214,6 +292,9 @@ BOOL PastMTime( P_MILLITIME pMTime1, P_MILLITIME pMTime2 )
       return( TRUE );
 
    return( FALSE );
+
+#endif
+
 }
 
 /****************************************************************************/
@@ -222,6 +303,20 @@ BOOL PastMTime( P_MILLITIME pMTime1, P_MILLITIME pMTime2 )
 
 void WaitMTime( P_MILLITIME pMTime )
 {
+
+#if defined(__LINUX__)
+
+   struct timespec stTS;
+
+   // Sleep until the time itself, rather than for a computed interval
+
+   stTS.tv_sec  = (time_t)(pMTime->uTimeNS / NS_PER_SEC);
+   stTS.tv_nsec = (long)(pMTime->uTimeNS % NS_PER_SEC);
+
+   while( clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &stTS, NULL ) == EINTR );
+
+#else
+
    MILLITIME stNow;
    long      iMS;
 
@@ -231,5 +326,97 @@ void WaitMTime( P_MILLITIME pMTime )
 
    if( iMS > 0 )
       Delay( (unsigned long)iMS );
+
+#endif
+
+}
+
+/****************************************************************************/
+/* DiffMTime() - Returns the number of milliseconds by which the first      */
+/* MILLITIME value is later than the second (negative if it is earlier).    */
+/****************************************************************************/
+
+long DiffMTime( P_MILLITIME pMTime1, P_MILLITIME pMTime2 )
+{
+
+#if defined(__LINUX__)
+
+   return( (long)((long long)(pMTime1->uTimeNS - pMTime2->uTimeNS) / (long long)NS_PER_MS) );
+
+#else
+
+   return( (long)(pMTime1->tTimeS - pMTime2->tTimeS) * 1000 + (long)pMTime1->uTimeMS - (long)pMTime2->uTimeMS );
+
+#endif
+
+}
+
+#if defined(__LINUX__)
+
+/****************************************************************************/
+/* OpenMTimer() - Creates a timer for scheduling periodic work. Returns     */
+/* FALSE, with errno set, if the timer can't be created.                    */
+/****************************************************************************/
+
+BOOL OpenMTimer( P_MILLITIMER pTimer )
+{
+   pTimer->iHandle = timerfd_create( CLOCK_MONOTONIC, TFD_CLOEXEC );
+
+   return( pTimer->iHandle != -1 );
+}
+
+/****************************************************************************/
+/* StartMTimer() - Arms a timer to tick at the specified time and every     */
+/* dwPeriod milliseconds after that (or just the once, if dwPeriod is 0).   */
+/* The kernel keeps to the schedule, so the ticks don't drift by the time   */
+/* taken to service them. A time already past ticks immediately.            */
+/****************************************************************************/
+
+BOOL StartMTimer( P_MILLITIMER pTimer, P_MILLITIME pMTime, unsigned long dwPeriod )
+{
+   struct itimerspec stSpec;
+
+   stSpec.it_value.tv_sec     = (time_t)(pMTime->uTimeNS / NS_PER_SEC);
+   stSpec.it_value.tv_nsec    = (long)(pMTime->uTimeNS % NS_PER_SEC);
+   stSpec.it_interval.tv_sec  = (time_t)(dwPeriod / 1000);
+   stSpec.it_interval.tv_nsec = (long)((dwPeriod % 1000) * NS_PER_MS);
+
+   // A zero time would disarm the timer instead
+
+   if( !pMTime->uTimeNS )
+      stSpec.it_value.tv_nsec = 1;
+
+   return( timerfd_settime( pTimer->iHandle, TFD_TIMER_ABSTIME, &stSpec, NULL ) == 0 );
 }
 
+/****************************************************************************/
+/* WaitMTimer() - Waits for the next tick of a timer. Returns the number of */
+/* ticks since the last wait (more than one if the caller has fallen        */
+/* behind), or 0, with errno set, if the wait failed.                       */
+/****************************************************************************/
+
+unsigned long WaitMTimer( P_MILLITIMER pTimer )
+{
+   uint64_t uTicks;
+   ssize_t  iRead;
+
+   while( ((iRead = read( pTimer->iHandle, &uTicks, sizeof(uTicks) )) == -1) && (errno == EINTR) );
+
+   return( (iRead == (ssize_t)sizeof(uTicks))? (unsigned long)uTicks : 0 );
+}
+
+/****************************************************************************/
+/* CloseMTimer() - Destroys a timer.                                        */
+/****************************************************************************/
+
+void CloseMTimer( P_MILLITIMER pTimer )
+{
+   if( pTimer->iHandle != -1 )
+   {
+      close( pTimer->iHandle );
+      pTimer->iHandle = -1;
+   }
+}
+
+#endif // defined(__LINUX__)
+
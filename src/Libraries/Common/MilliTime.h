@@ -3,8 +3,9 @@
 /*  Module:         MilliTime.h                                             */
 /*                                                                          */
 /*  Description:    Provides prototypes and supporting definitions  for  a  */
-/*                  set   of  portable  time  functions  with  millisecond  */
-/*                  resolution.                                             */
+/*                  set  of  portable  time  functions  with   millisecond  */
+/*                  resolution. Under Linux, times are kept as  nanosecond  */
+/*                  counts of the monotonic clock.                          */
 /*                                                                          */
 /*  Functions:      CurrMTime()   - Places  current  time  into  specified  */
 /*                                  MILLITIME buffer.                       */
@@ -26,6 +27,22 @@
 /*                  WaitMTime()   - Delays execution until  the  specified  */
 /*                                  MILLITIME time occurs.                  */
 /*                                                                          */
+/*                  DiffMTime()   - Returns the number of milliseconds  by  */
+/*                                  which the  first  MILLITIME  value  is  */
+/*                                  later than the second.                  */
+/*                                                                          */
+/*                  OpenMTimer()  - Creates   a   timer   for   scheduling  */
+/*                                  periodic work (Linux only).             */
+/*                                                                          */
+/*                  StartMTimer() - Arms a timer to tick  at  a  specified  */
+/*                                  MILLITIME time and then periodically.   */
+/*                                                                          */
+/*                  WaitMTimer()  - Waits for the next tick of a timer and  */
+/*                                  returns the number of ticks since  the  */
+/*                                  last wait.                              */
+/*                                                                          */
+/*                  CloseMTimer() - Destroys a timer.                       */
+/*                                                                          */
 /****************************************************************************/
 
 /****************************************************************************/
@@ -79,6 +96,28 @@ extern "C" {
 /* Definitions                                                              */
 /****************************************************************************/
 
+#if defined(__linux__)
+
+/****************************************************************************/
+/* Under Linux, a time is a nanosecond count of CLOCK_MONOTONIC, which the  */
+/* time of day being stepped (by NTP or by hand) can't disturb. The clock   */
+/* is common to all processes, so times may be shared between them.         */
+/****************************************************************************/
+
+typedef struct _MILLITIME
+{
+   unsigned long long   uTimeNS;
+
+}  MILLITIME, *P_MILLITIME;
+
+typedef struct _MILLITIMER
+{
+   int                  iHandle;        // timerfd
+
+}  MILLITIMER, *P_MILLITIMER;
+
+#else
+
 typedef struct _MILLITIME
 {
    time_t         tTimeS;
@@ -86,6 +125,8 @@ typedef struct _MILLITIME
 
 }  MILLITIME, *P_MILLITIME;
 
+#endif
+
 /****************************************************************************/
 /* Function Prototypes                                                      */
 /****************************************************************************/
@@ -96,6 +137,16 @@ void SetMTime(  P_MILLITIME pMTime, time_t tSecs, unsigned long dwMillisecs );
 void AddMTime(  P_MILLITIME pMTime, time_t tSecs, unsigned long dwMillisecs );
 BOOL PastMTime( P_MILLITIME pMTime1, P_MILLITIME pMTime2 );
 void WaitMTime( P_MILLITIME pMTime );
+long DiffMTime( P_MILLITIME pMTime1, P_MILLITIME pMTime2 );
+
+#if defined(__linux__)
+
+BOOL OpenMTimer(  P_MILLITIMER pTimer );
+BOOL StartMTimer( P_MILLITIMER pTimer, P_MILLITIME pMTime, unsigned long dwPeriod );
+unsigned long WaitMTimer( P_MILLITIMER pTimer );
+void CloseMTimer( P_MILLITIMER pTimer );
+
+#endif
 
 #pragma pack()
 
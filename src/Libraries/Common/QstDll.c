@@ -65,6 +65,14 @@
 #include "INIFile.h"
 #endif
 
+#if defined(__linux__)
+#include <limits.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "Futex.h"
+#endif
+
 #include "QstDll.h"
 #include "CritSect.h"
 #include "GlobMem.h"
@@ -93,6 +101,17 @@ HGLOBMEM                        hGlobMem;
 
 #define QST_DEF_POLLING         1000                // Default = 1000ms (1 second)
 
+#define INIT_PENDING            0x00000000          // Segment not yet initialized
+#define INIT_COMPLETE           0xFFFFFFFF          // Segment initialized
+#define INIT_TIMEOUT            60000               // Default wait for initialization (ms)
+
+#define LOCKS_NONE              0                   // Segment's locks not yet set up
+#define LOCKS_BUSY              1                   // Segment's locks being set up
+#define LOCKS_READY             2                   // Segment's locks set up
+
+#define REFRESH_CHECK           500                 // Interval for checking on refresher (ms)
+#define REFRESH_MIN             10                  // Shortest refresh interval (ms)
+
 #if defined(__WIN32__)
 
 #define QST_REG_KEY             "Software\\Intel\\QST"
@@ -103,8 +122,14 @@ HGLOBMEM                        hGlobMem;
 #define INI_FILE_NAME           "QST.ini"           // INI file name
 #define INI_FILE_PARAG          "Instrumentation"   // Paragraph name
 #define INI_FILE_PARAM          "PollingInterval"   // Parameter name
+#define INI_ADAPT_MARGIN        "AdaptiveMargin"    // Adaptive polling parameters
+#define INI_ADAPT_INTERVAL      "AdaptiveInterval"
+#define INI_ADAPT_BACKOFF       "AdaptiveBackoff"
 #define BUFF_SIZE               131                 // Buffer size
 
+#define ADAPT_INTERVAL          250                 // Default adaptive interval (ms)
+#define ADAPT_BACKOFF           4                   // Default backoff limit (intervals)
+
 /****************************************************************************/
 /* strupr() - Converts string to uppercase. Provided here for Linux, which  */
 /* doesn't provide one.                                                     */
@@ -149,6 +174,66 @@ static void CleanupString( char *szString )
    strupr( szString );
 }
 
+#if defined(__linux__)
+
+/****************************************************************************/
+/* ReadINIValue() - Returns the value of an optional numeric entry in the   */
+/* INI file, or the default specified if the entry is missing or bad        */
+/****************************************************************************/
+
+static DWORD ReadINIValue( const char *pszParam, DWORD dwDefault )
+{
+   char szBuff[BUFF_SIZE+1], *pszBuff;
+   long lValue;
+
+   if( GetINIEntry( INI_FILE_NAME, INI_FILE_PARAG, pszParam, szBuff, BUFF_SIZE ) )
+   {
+      CleanupString( szBuff );
+      lValue = strtol( szBuff, &pszBuff, 10 );
+
+      if( szBuff[0] && (*pszBuff == '\0') && (lValue >= 0) )
+         return( (DWORD)lValue );
+   }
+
+   return( dwDefault );
+}
+
+/****************************************************************************/
+/* InitPolling() - Reads the per-class and adaptive polling settings (see   */
+/* QST_POLLING) from the INI file. Unlike the polling interval, these are   */
+/* optional and aren't written back when missing.                           */
+/****************************************************************************/
+
+static void InitPolling( void )
+{
+   static const char * const apszClassParam[HOT_CLASSES] =
+   {
+      "TempPollingInterval",                       // HOT_TEMP_MON
+      "FanPollingInterval",                        // HOT_FAN_MON
+      "VoltPollingInterval",                       // HOT_VOLT_MON
+      "CurrPollingInterval",                       // HOT_CURR_MON
+      "DutyPollingInterval"                        // HOT_FAN_CTRL
+   };
+
+   P_QST_POLLING pstPolling = &pQstSeg->stPolling;
+   int           iClass;
+
+   for( iClass = 0; iClass < HOT_CLASSES; iClass++ )
+      pstPolling->dwClass[iClass] = ReadINIValue( apszClassParam[iClass], 0 );
+
+   pstPolling->dwMargin  = ReadINIValue( INI_ADAPT_MARGIN, 0 );
+   pstPolling->dwFast    = ReadINIValue( INI_ADAPT_INTERVAL, ADAPT_INTERVAL );
+   pstPolling->dwBackoff = ReadINIValue( INI_ADAPT_BACKOFF, ADAPT_BACKOFF );
+
+   if( !pstPolling->dwFast )
+      pstPolling->dwFast = ADAPT_INTERVAL;
+
+   if( !pstPolling->dwBackoff )
+      pstPolling->dwBackoff = 1;
+}
+
+#endif // defined(__linux__)
+
 #endif  // defined(__LINUX__)
 
 /****************************************************************************/
@@ -235,6 +320,10 @@ static BOOL InitRegistryAccess( BOOL bInitQstSeg )
 
       char szBuff[BUFF_SIZE+1], *pszBuff;
 
+#if defined(__linux__)
+      InitPolling();
+#endif
+
       // Get and process entry from INI file
 
       if( GetINIEntry( INI_FILE_NAME, INI_FILE_PARAG, INI_FILE_PARAM, szBuff, BUFF_SIZE ) )
@@ -302,6 +391,16 @@ BOOL UpdatePollingInterval( DWORD dwInterval )
 
    pQstSeg->dwPollingInterval = dwInterval;
    time( &pQstSeg->tTimePollingIntervalChanged );
+
+#if defined(__linux__)
+
+   // Wake any processes waiting for the change
+
+   pQstSeg->stEvents.uPolling = NextEventStamp( pQstSeg );
+   PostEvent( &pQstSeg->stEvents, pQstSeg->stEvents.uPolling );
+
+#endif
+
    return( TRUE );
 }
 
@@ -323,18 +422,316 @@ void EndCriticalSection( void )
    LeaveCritSect( hCritSect );
 }
 
+#if defined(__linux__)
 /****************************************************************************/
-/* InitSharedMemoryPrimary() - Performs initialization for primary user     */
-/* (creator) of the shared memory segment.                                  */
+/* SetupLocks() - Sets up the segment's locks, which are robust mutexes     */
+/* shared between processes, if nobody has yet. A new segment is            */
+/* zero-filled; the first process to see it claims the job through          */
+/* uLockState, and any others wait (on the word) until it is done, or until */
+/* the realtime clock reaches *pstUntil (failing with ETIMEDOUT).           */
+/****************************************************************************/
+
+static BOOL SetupLocks( const struct timespec *pstUntil )
+{
+   pthread_mutexattr_t  stAttr;
+   struct timespec      stNow;
+   UINT32               uState = LOCKS_NONE;
+   long                 lRemaining;
+
+   if( __atomic_compare_exchange_n( &pQstSeg->uLockState, &uState, LOCKS_BUSY, FALSE, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE ) )
+   {
+      pthread_mutexattr_init( &stAttr );
+      pthread_mutexattr_setpshared( &stAttr, PTHREAD_PROCESS_SHARED );
+      pthread_mutexattr_setrobust( &stAttr, PTHREAD_MUTEX_ROBUST );
+      pthread_mutex_init( &pQstSeg->stInitLock, &stAttr );
+      pthread_mutex_init( &pQstSeg->stRefreshLock, &stAttr );
+      pthread_mutexattr_destroy( &stAttr );
+
+      __atomic_store_n( &pQstSeg->uLockState, LOCKS_READY, __ATOMIC_RELEASE );
+      FutexWake( &pQstSeg->uLockState, INT_MAX );
+      return( TRUE );
+   }
+
+   while( uState != LOCKS_READY )
+   {
+      clock_gettime( CLOCK_REALTIME, &stNow );
+      lRemaining = (pstUntil->tv_sec - stNow.tv_sec) * 1000L + (pstUntil->tv_nsec - stNow.tv_nsec) / 1000000L;
+
+      if( lRemaining <= 0 )
+      {
+         errno = ETIMEDOUT;
+         return( FALSE );
+      }
+
+      FutexWait( &pQstSeg->uLockState, uState, (int)lRemaining );
+      uState = __atomic_load_n( &pQstSeg->uLockState, __ATOMIC_ACQUIRE );
+   }
+
+   return( TRUE );
+}
+
+/****************************************************************************/
+/* AwaitInit() - Waits for the shared memory segment to be initialized. The */
+/* segment's uInitState holds INIT_PENDING until it has been initialized,   */
+/* and then INIT_COMPLETE. The job of initializing it goes to whoever holds */
+/* stInitLock, a robust mutex, so waiters sleep in the mutex and, should    */
+/* the initializer die, the next of them to get it takes the job over.      */
+/* Ownership goes with the initializing thread itself, so a recycled        */
+/* process id (or one in another namespace) can't be taken for it. Returns  */
+/* TRUE when the segment is initialized, or when this process has claimed   */
+/* the job (*pbInitializer set TRUE). Returns FALSE, with errno set to      */
+/* ETIMEDOUT, if neither happens within INIT_TIMEOUT ms (or the time set by */
+/* environment variable QST_INIT_TIMEOUT).                                  */
+/****************************************************************************/
+
+static BOOL AwaitInit( BOOL *pbInitializer )
+{
+   const char       *pszTimeout = getenv( "QST_INIT_TIMEOUT" );
+   int              iTimeout    = (pszTimeout && *pszTimeout)? atoi( pszTimeout ) : INIT_TIMEOUT;
+   struct timespec  stUntil;
+   int              iError;
+
+   if( iTimeout < 0 )
+      iTimeout = 0;
+
+   clock_gettime( CLOCK_REALTIME, &stUntil );
+
+   stUntil.tv_sec  += iTimeout / 1000;
+   stUntil.tv_nsec += (iTimeout % 1000) * 1000000L;
+
+   if( stUntil.tv_nsec >= 1000000000L )
+   {
+      stUntil.tv_sec++;
+      stUntil.tv_nsec -= 1000000000L;
+   }
+
+   if( !SetupLocks( &stUntil ) )
+      return( FALSE );
+
+   if( __atomic_load_n( &pQstSeg->uInitState, __ATOMIC_ACQUIRE ) == INIT_COMPLETE )
+   {
+      *pbInitializer = FALSE;
+      return( TRUE );
+   }
+
+   // Claim the job; if whoever had it died, the mutex is ours, but must be
+   // marked consistent again before it can be released
+
+   iError = pthread_mutex_timedlock( &pQstSeg->stInitLock, &stUntil );
+
+   if( iError == EOWNERDEAD )
+      iError = pthread_mutex_consistent( &pQstSeg->stInitLock );
+
+   if( iError )
+   {
+      errno = iError;
+      return( FALSE );
+   }
+
+   // Done by whoever had it, if it is no longer pending
+
+   if( __atomic_load_n( &pQstSeg->uInitState, __ATOMIC_ACQUIRE ) == INIT_COMPLETE )
+   {
+      pthread_mutex_unlock( &pQstSeg->stInitLock );
+      *pbInitializer = FALSE;
+      return( TRUE );
+   }
+
+   *pbInitializer = TRUE;
+   return( TRUE );
+}
+
+/****************************************************************************/
+/* EndInit() - Records the outcome of this process' initialization of the   */
+/* shared memory segment and gives up the job. If it failed, the job is     */
+/* left for one of the processes waiting for it to claim.                   */
+/****************************************************************************/
+
+static void EndInit( BOOL bSuccess )
+{
+   __atomic_store_n( &pQstSeg->uInitState, bSuccess? INIT_COMPLETE : INIT_PENDING, __ATOMIC_RELEASE );
+   pthread_mutex_unlock( &pQstSeg->stInitLock );
+}
+
+/****************************************************************************/
+/* Background refresher. A process that sets environment variable           */
+/* QST_REFRESHER to a non-zero value runs a thread that offers to keep the  */
+/* readings current on behalf of every process using the library. One of    */
+/* these threads is elected, by taking the segment's stRefreshLock (a       */
+/* robust mutex) and holding it for as long as it runs; it wakes at the     */
+/* shortest polling interval of any class and refreshes each class whose    */
+/* interval comes round, ahead of time (see RefreshAllQst()), so that       */
+/* callers always find the readings current and never have to wait for a    */
+/* command to the subsystem. The other threads stand by, trying for the     */
+/* mutex every REFRESH_CHECK ms, and one of them gets it once the refresher */
+/* gives up the job or dies (whatever became of its process id). Both are   */
+/* paced by a periodic timer (see StartMTimer()), so the refreshes keep to  */
+/* the interval however long each one takes. Should the refresher stall,    */
+/* callers find the readings due and refresh them themselves, as they would */
+/* without one.                                                             */
+/****************************************************************************/
+
+static pthread_t                hRefresher;
+static BOOL                     bRefresher;
+static U32                      uRefresherStop;     // Set when thread is to finish
+static MILLITIMER               stRefreshTimer;     // Paces the thread
+
+static void *Refresher( void *pvArg )
+{
+   BOOL             bLeader = FALSE;
+   unsigned long    dwPeriod = 0, dwWanted;
+   MILLITIME        stFirst;
+   int              iError;
+
+   for( ;; )
+   {
+      // Take over if there is no refresher, or it has died (leaving the
+      // mutex to be marked consistent again)
+
+      if( !bLeader )
+      {
+         iError = pthread_mutex_trylock( &pQstSeg->stRefreshLock );
+
+         if( iError == EOWNERDEAD )
+            iError = pthread_mutex_consistent( &pQstSeg->stRefreshLock );
+
+         if( !iError )
+         {
+            bLeader  = TRUE;
+            dwPeriod = 0;                             // Rearm, to refresh straight away
+         }
+      }
+
+      // Tick at the shortest interval any class polls at as the refresher,
+      // every REFRESH_CHECK ms on standby; a new refresher starts with an
+      // immediate tick
+
+      if( bLeader )
+         dwWanted = (RefreshPeriodQst() < REFRESH_MIN)? REFRESH_MIN : RefreshPeriodQst();
+      else
+         dwWanted = REFRESH_CHECK;
+
+      if( dwWanted != dwPeriod )
+      {
+         CurrMTime( &stFirst );
+
+         if( !bLeader )
+            AddMTime( &stFirst, 0, dwWanted );
+
+         dwPeriod = dwWanted;
+         StartMTimer( &stRefreshTimer, &stFirst, dwPeriod );
+      }
+
+      // Look for a stop only after arming the timer, so that the tick
+      // StopRefresher() forces can't be lost
+
+      if( __atomic_load_n( &uRefresherStop, __ATOMIC_SEQ_CST ) )
+         break;
+
+      if( !WaitMTimer( &stRefreshTimer ) || __atomic_load_n( &uRefresherStop, __ATOMIC_SEQ_CST ) )
+         break;
+
+      if( bLeader && BeginCriticalSection() )
+      {
+         RefreshAllQst( (int)dwPeriod );
+         EndCriticalSection();
+      }
+   }
+
+   // Give up the job; only this thread can, since it holds the mutex
+
+   if( bLeader )
+      pthread_mutex_unlock( &pQstSeg->stRefreshLock );
+
+   return( NULL );
+}
+
+/****************************************************************************/
+/* ForgetRefresher() - Forgets, in the child of a fork(), the refresher     */
+/* thread that wasn't copied into it                                        */
+/****************************************************************************/
+
+static void ForgetRefresher( void )
+{
+   CloseMTimer( &stRefreshTimer );
+   bRefresher = FALSE;
+}
+
+/****************************************************************************/
+/* StartRefresher() - Starts this process' refresher thread, if selected    */
+/****************************************************************************/
+
+static void StartRefresher( void )
+{
+   const char       *pszRefresher = getenv( "QST_REFRESHER" );
+
+   if( pszRefresher && atoi( pszRefresher ) && OpenMTimer( &stRefreshTimer ) )
+   {
+      uRefresherStop = FALSE;
+      bRefresher     = !pthread_create( &hRefresher, NULL, Refresher, NULL );
+
+      if( bRefresher )
+         pthread_atfork( NULL, NULL, ForgetRefresher );
+      else
+         CloseMTimer( &stRefreshTimer );
+   }
+}
+
+/****************************************************************************/
+/* StopRefresher() - Stops this process' refresher thread, giving up the    */
+/* job of refreshing if it had it                                           */
+/****************************************************************************/
+
+static void StopRefresher( void )
+{
+   MILLITIME        stNow;
+
+   if( bRefresher )
+   {
+      // Force a tick, to end the thread's wait
+
+      __atomic_store_n( &uRefresherStop, TRUE, __ATOMIC_SEQ_CST );
+      CurrMTime( &stNow );
+      StartMTimer( &stRefreshTimer, &stNow, 0 );
+      pthread_join( hRefresher, NULL );
+      CloseMTimer( &stRefreshTimer );
+
+      bRefresher = FALSE;
+   }
+}
+
+#endif  // defined(__linux__)
+
+/****************************************************************************/
+/* InitSharedMemory() - Performs initialization for a user of the shared    */
+/* memory segment. The primary user (creator) initializes its contents as   */
+/* well; on Linux, this is whichever user claims the job (see AwaitInit()). */
 /****************************************************************************/
 
 static BOOL InitSharedMemory( BOOL bCreator )
 {
-   // Clear its contents (sets bInitComplete to FALSE)
+
+#if defined(__linux__)
+
+   if( !AwaitInit( &bCreator ) )
+      return( FALSE );
+
+   // A new segment is zero-filled; clear anything a previous initializer
+   // left behind (all but the update sequence count, uInitState and the
+   // locks)
+
+   if( bCreator )
+      memset( &pQstSeg->dwPollingInterval, 0, sizeof(QST_DATA_SEGMENT) - offsetof( QST_DATA_SEGMENT, dwPollingInterval ) );
+
+#else
+
+   // Clear its contents (sets uInitState to INIT_PENDING)
 
    if( bCreator )
        memset( pQstSeg, 0, sizeof(QST_DATA_SEGMENT) );
 
+#endif
+
    // Do full initializaton for QST Subsystem access
 
    if( InitializeQst( bCreator ) )
@@ -351,12 +748,21 @@ static BOOL InitSharedMemory( BOOL bCreator )
          {
             // We're successfully initialized!
 
+#if defined(__linux__)
+
             if( bCreator )
-               pQstSeg->bInitComplete = TRUE;
+               EndInit( TRUE );
+
+#else
+
+            if( bCreator )
+               pQstSeg->uInitState = INIT_COMPLETE;
             else
-               while( !pQstSeg->bInitComplete )
+               while( pQstSeg->uInitState != INIT_COMPLETE )
                   Delay( 5 );
 
+#endif
+
             return( TRUE );
          }
 
@@ -369,6 +775,14 @@ static BOOL InitSharedMemory( BOOL bCreator )
    }
 
    CleanupQst();
+
+#if defined(__linux__)
+
+   if( bCreator )
+      EndInit( FALSE );
+
+#endif
+
    return( FALSE );
 }
 
@@ -440,6 +854,11 @@ BOOL QstInstInitialize( void )
 
 void QstInstCleanup( void )
 {
+
+#if defined(__linux__)
+   StopRefresher();
+#endif
+
    CloseCritSect( hCritSect );
    CleanupRegistryAccess();
    CleanupQst();
@@ -481,7 +900,11 @@ BOOL WINAPI DllMain( HANDLE hModule, DWORD dwReason, LPVOID pvReserved )
 /* Bind main init/cleanup functions for load-/unload-time execution         */
 /****************************************************************************/
 
+#if defined(__linux__)
+static void ModuleInit( void ) { if( QstInstInitialize() ) StartRefresher(); }
+#else
 static void ModuleInit( void ) { QstInstInitialize(); }
+#endif
 
 #ifdef USE_CTORS
    static void (*const init_array [])( void ) __attribute__ ((section (".ctors")))      = { ModuleInit,     };
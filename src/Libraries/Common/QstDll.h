@@ -60,6 +60,13 @@
 #include "AccessQst.h"
 #include "MilliTime.h"
 
+#if defined(__linux__)
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include "Futex.h"
+#endif
+
 /****************************************************************************/
 /* Structures                                                               */
 /****************************************************************************/
@@ -72,9 +79,127 @@ typedef struct _QST_THRESH
 
 }  QST_THRESH, *P_QST_THRESH;
 
+#if defined(__linux__)
+
+/****************************************************************************/
+/* QST_HOT_BLOCK - Current readings and health of one class of sensor or    */
+/* controller, indexed as the library's callers index them and converted    */
+/* once by the process that refreshes them. Readers that want nothing else  */
+/* touch only this block: it has its own sequence count and is aligned to,  */
+/* and padded out to, whole cache lines, apart from the configuration data  */
+/* and from the blocks of the other classes.                                */
+/****************************************************************************/
+
+#define QST_CACHE_LINE  64
+
+#define QST_HOT_ENTRIES 32              // Largest of the QST_ABS_* limits
+
+#define HOT_TEMP_MON    0
+#define HOT_FAN_MON     1
+#define HOT_VOLT_MON    2
+#define HOT_CURR_MON    3
+#define HOT_FAN_CTRL    4
+#define HOT_CLASSES     5
+
+typedef struct _QST_HOT_BLOCK
+{
+   UINT32                           uSequence;          // Odd while block being written
+   MILLITIME                        stUpdateTime;       // Time readings are due to be refreshed
+   float                            fReading[QST_HOT_ENTRIES];  // Readings (duty cycles for controllers)
+   UINT8                            byHealth[QST_HOT_ENTRIES];  // QST_HEALTH values
+   UINT8                            byControl[QST_HOT_ENTRIES]; // QST_CONTROL_STATE values (controllers only)
+
+}  __attribute__((aligned(QST_CACHE_LINE))) QST_HOT_BLOCK, *P_QST_HOT_BLOCK;
+
+/****************************************************************************/
+/* QST_EVENT_STAMPS - Records when things that processes may wish to wait   */
+/* for last happened. Each event posted is given the next stamp, which is   */
+/* written into the entries it concerns and then published in uCount, the   */
+/* word that waiting processes sleep upon; an entry holding a stamp later   */
+/* than the last one a process saw has changed since.                       */
+/****************************************************************************/
+
+typedef struct _QST_EVENT_STAMPS
+{
+   UINT32                           uCount;             // Stamp of latest event posted
+   UINT32                           uWaiters;           // Processes waiting upon uCount
+   UINT32                           uReadings;          // Latest update
+   UINT32                           uPolling;           // Latest polling interval change
+   UINT32                           uHealth[HOT_CLASSES][QST_HOT_ENTRIES];  // Latest health changes
+   UINT32                           uThresh[HOT_CLASSES][QST_HOT_ENTRIES];  // Latest threshold changes
+
+}  __attribute__((aligned(QST_CACHE_LINE))) QST_EVENT_STAMPS, *P_QST_EVENT_STAMPS;
+
+/****************************************************************************/
+/* QST_POLLING - How often each class of sensor or controller is refreshed. */
+/* A class polls at its own configured interval, or at dwPollingInterval if */
+/* it has none. With adaptive polling enabled (a non-zero margin), a class  */
+/* whose readings come within the margin of a threshold, or whose health    */
+/* isn't normal, is polled at the faster adaptive interval instead, while a */
+/* class whose readings are holding steady backs off, doubling its interval */
+/* each refresh up to the backoff limit. dwCurrent holds the interval each  */
+/* class was last set to poll at (see AdaptPolling() in AccessQst.c).       */
+/****************************************************************************/
+
+typedef struct _QST_POLLING
+{
+   DWORD                            dwClass[HOT_CLASSES];   // Configured interval of each class (ms), or 0
+   DWORD                            dwCurrent[HOT_CLASSES]; // Interval each class is polling at (ms)
+   DWORD                            dwMargin;           // Adaptive margin (% of threshold), or 0 if disabled
+   DWORD                            dwFast;             // Adaptive interval near thresholds (ms)
+   DWORD                            dwBackoff;          // Most times a class interval steady classes back off to
+
+}  QST_POLLING, *P_QST_POLLING;
+
+/****************************************************************************/
+/* QST_HISTORY - The latest readings of each class of sensor, kept for the  */
+/* last HISTORY_SAMPLES refreshes of the class in a ring, along with the    */
+/* time of each. Each sensor's readings go into a series of their own,      */
+/* handed out from a pool in the segment once the sensors have been         */
+/* enumerated; any beyond the end of the pool go unrecorded. Beside each    */
+/* reading, a series keeps the total of all the readings up to it and the   */
+/* least and greatest of the 2, 4 .. HISTORY_SAMPLES readings ending with   */
+/* it, so that the mean, minimum and maximum of any run of samples can be   */
+/* had from two entries each, however long the run (see SaveHistory() in    */
+/* AccessQst.c). A class's uSequence is odd while a sample is being added.  */
+/****************************************************************************/
+
+#define HISTORY_SAMPLES 128             // Samples kept (a power of 2)
+#define HISTORY_LEVELS  7               // log2(HISTORY_SAMPLES)
+#define HISTORY_CLASSES 4               // Classes recorded (HOT_TEMP_MON to HOT_CURR_MON)
+#define HISTORY_SERIES  64              // Sensors that can be recorded
+
+typedef struct _QST_HISTORY_SERIES
+{
+   double                           dTotal[HISTORY_SAMPLES];    // Total of readings up to each sample
+   float                            fReading[HISTORY_SAMPLES];
+   float                            fMin[HISTORY_LEVELS][HISTORY_SAMPLES]; // Least of 2^(level+1) readings ending at each
+   float                            fMax[HISTORY_LEVELS][HISTORY_SAMPLES]; // Greatest of them
+
+}  QST_HISTORY_SERIES, *P_QST_HISTORY_SERIES;
+
+typedef struct _QST_HISTORY
+{
+   UINT32                           uSequence;          // Odd while sample being added
+   int                              iSeries;            // First series of the class
+   int                              iEntries;           // Sensors of the class recorded
+   unsigned long long               ullSamples;         // Samples added (ring slot is this modulo HISTORY_SAMPLES)
+   unsigned long long               ullTime[HISTORY_SAMPLES];   // CLOCK_MONOTONIC time of each sample (ms)
+
+}  __attribute__((aligned(QST_CACHE_LINE))) QST_HISTORY, *P_QST_HISTORY;
+
+#endif // defined(__linux__)
+
 typedef struct _QST_DATA_SEGMENT
 {
-   BOOL                             bInitComplete;
+   UINT32                           uUpdateSequence;    // Odd while updates being written
+   UINT32                           uInitState;         // INIT_PENDING or INIT_COMPLETE
+
+#if defined(__linux__)
+   UINT32                           uLockState;         // Whether locks below set up (LOCKS_XXX)
+   pthread_mutex_t                  stInitLock;         // Held by process initializing segment
+   pthread_mutex_t                  stRefreshLock;      // Held by background refresher
+#endif
 
    DWORD                            dwPollingInterval;
    time_t                           tTimePollingIntervalChanged;
@@ -121,9 +246,112 @@ typedef struct _QST_DATA_SEGMENT
    QST_GET_FAN_CTRL_UPDATE_RSP      stFanCtrlUpdateRsp;
    MILLITIME                        stFanCtrlUpdateTime;
 
+#if defined(__linux__)
+   QST_HOT_BLOCK                    stHot[HOT_CLASSES]; // Converted readings, by class (HOT_*)
+   unsigned long long               ullUpdateStamp;     // CLOCK_MONOTONIC time of last refresh (ms)
+   QST_EVENT_STAMPS                 stEvents;           // Stamps of latest events
+   QST_POLLING                      stPolling;          // Per-class and adaptive polling intervals
+   QST_HISTORY                      stHistory[HISTORY_CLASSES]; // Recent samples of each sensor class
+   QST_HISTORY_SERIES               stSeries[HISTORY_SERIES];   // Readings of the sensors recorded
+#endif
 
 }  QST_DATA_SEGMENT, *P_QST_DATA_SEGMENT;
 
+#if defined(__linux__)
+
+/****************************************************************************/
+/* Sequence counts. The update responses, and the times they are due to be  */
+/* refreshed, are only written by a process holding the critical section,   */
+/* which keeps uUpdateSequence odd while it does so; each hot block is      */
+/* written likewise under its own uSequence. Readers don't need the         */
+/* critical section: they copy what they want between BeginSeqRead() and    */
+/* EndSeqRead(), and try again if the latter reports that the copy may be   */
+/* torn.                                                                    */
+/****************************************************************************/
+
+static __inline__ UINT32 BeginSeqRead( UINT32 *puSequence )
+{
+   return( __atomic_load_n( puSequence, __ATOMIC_ACQUIRE ) );
+}
+
+static __inline__ BOOL EndSeqRead( UINT32 *puSequence, UINT32 uSequence )
+{
+   __atomic_thread_fence( __ATOMIC_ACQUIRE );
+
+   return( !(uSequence & 1) && (__atomic_load_n( puSequence, __ATOMIC_RELAXED ) == uSequence) );
+}
+
+static __inline__ void BeginSeqWrite( UINT32 *puSequence )
+{
+   UINT32 uSequence = __atomic_load_n( puSequence, __ATOMIC_RELAXED );
+
+   // Still odd if a writer died part way through; stay odd
+
+   __atomic_store_n( puSequence, (uSequence & 1)? uSequence + 2 : uSequence + 1, __ATOMIC_RELAXED );
+   __atomic_thread_fence( __ATOMIC_RELEASE );
+}
+
+static __inline__ void EndSeqWrite( UINT32 *puSequence )
+{
+   __atomic_store_n( puSequence, *puSequence + 1, __ATOMIC_RELEASE );
+}
+
+#define BeginUpdateRead(pstSeg)             BeginSeqRead( &(pstSeg)->uUpdateSequence )
+#define EndUpdateRead(pstSeg, uSequence)    EndSeqRead( &(pstSeg)->uUpdateSequence, uSequence )
+#define BeginUpdateWrite(pstSeg)            BeginSeqWrite( &(pstSeg)->uUpdateSequence )
+#define EndUpdateWrite(pstSeg)              EndSeqWrite( &(pstSeg)->uUpdateSequence )
+
+/****************************************************************************/
+/* Events. Only a process holding the critical section posts them: it takes */
+/* the stamp from NextEventStamp(), writes it into the entries concerned    */
+/* and then calls PostEvent(), which wakes any processes in WaitEvent().    */
+/* The waiters count saves the wake call when there is nobody to wake; it   */
+/* is raised before the stamp is rechecked, so either the waiter sees the   */
+/* new stamp or the poster sees the waiter.                                 */
+/****************************************************************************/
+
+#define NextEventStamp(pstSeg)              ((pstSeg)->stEvents.uCount + 1)
+
+#define EventStampNew(uStamp, uLast, uCount) ((UINT32)((uStamp) - (uLast) - 1) < (UINT32)((uCount) - (uLast)))
+
+static __inline__ void PostEvent( P_QST_EVENT_STAMPS pstEvents, UINT32 uStamp )
+{
+   __atomic_store_n( &pstEvents->uCount, uStamp, __ATOMIC_SEQ_CST );
+
+   if( __atomic_load_n( &pstEvents->uWaiters, __ATOMIC_SEQ_CST ) )
+      FutexWake( &pstEvents->uCount, INT_MAX );
+}
+
+/****************************************************************************/
+/* WaitEvent() - Waits no more than iTimeout milliseconds (forever if it's  */
+/* negative) for an event to be posted after the one stamped uLast. Returns */
+/* the stamp of the latest event. This is still uLast if the time expired,  */
+/* a signal interrupted the wait or the wakeup was spurious; errno is then  */
+/* ETIMEDOUT, EINTR or zero respectively.                                   */
+/****************************************************************************/
+
+static __inline__ UINT32 WaitEvent( P_QST_EVENT_STAMPS pstEvents, UINT32 uLast, int iTimeout )
+{
+   UINT32   uCount;
+
+   __atomic_fetch_add( &pstEvents->uWaiters, 1, __ATOMIC_SEQ_CST );
+
+   if( (uCount = __atomic_load_n( &pstEvents->uCount, __ATOMIC_SEQ_CST )) == uLast )
+   {
+      errno = iTimeout? 0 : ETIMEDOUT;
+
+      if( iTimeout )
+         FutexWait( &pstEvents->uCount, uLast, iTimeout );
+
+      uCount = __atomic_load_n( &pstEvents->uCount, __ATOMIC_ACQUIRE );
+   }
+
+   __atomic_fetch_sub( &pstEvents->uWaiters, 1, __ATOMIC_RELAXED );
+   return( uCount );
+}
+
+#endif // defined(__linux__)
+
 /****************************************************************************/
 /* Global Variables                                                         */
 /****************************************************************************/
@@ -61,6 +61,435 @@
 #include "QstDll.h"
 #include "QstInst.h"
 
+#if defined(__linux__)
+
+/****************************************************************************/
+/* PeekHot() - Copies the reading, health and control state of an entry in  */
+/* one of the hot blocks in the global memory segment without entering the  */
+/* critical section. Returns FALSE if the readings are due to be refreshed, */
+/* or no consistent copy could be had while they were being written,        */
+/* leaving the caller to take the critical section and refresh them (or     */
+/* wait for the refresh in progress).                                       */
+/****************************************************************************/
+
+#define PEEK_TRIES      16              // Attempts at a consistent copy
+
+static const int  aiHotClass[QST_SENSOR_TYPES] =
+{
+   HOT_TEMP_MON,                       // TEMPERATURE_SENSOR
+   HOT_VOLT_MON,                       // VOLTAGE_SENSOR
+   HOT_FAN_MON,                        // FAN_SPEED_SENSOR
+   HOT_CURR_MON                        // CURRENT_SENSOR
+};
+
+static BOOL PeekHot( int iClass, int iIndex, float *pfReading, UINT8 *pbyHealth, UINT8 *pbyControl )
+{
+   P_QST_HOT_BLOCK   pstHot = &pQstSeg->stHot[iClass];
+   MILLITIME         stCurrTime, stUpdateTime;
+   UINT32            uSequence;
+   int               iTries;
+
+   CurrMTime( &stCurrTime );
+
+   for( iTries = 0; iTries < PEEK_TRIES; iTries++ )
+   {
+      uSequence = BeginSeqRead( &pstHot->uSequence );
+
+      *pfReading  = pstHot->fReading[iIndex];
+      *pbyHealth  = pstHot->byHealth[iIndex];
+      *pbyControl = pstHot->byControl[iIndex];
+
+      memcpy( &stUpdateTime, &pstHot->stUpdateTime, sizeof(MILLITIME) );
+
+      if( EndSeqRead( &pstHot->uSequence, uSequence ) )
+         return( !PastMTime( &stUpdateTime, &stCurrTime ) );
+   }
+
+   return( FALSE );
+}
+
+/****************************************************************************/
+/* PeekSensor() - Gets the health and reading for the specified sensor      */
+/* using PeekHot()                                                          */
+/****************************************************************************/
+
+static BOOL PeekSensor( QST_SENSOR_TYPE eType, int iIndex, float *pfReading, UINT8 *pbyHealth )
+{
+   UINT8    byControl;
+
+   switch( eType )
+   {
+   case TEMPERATURE_SENSOR:
+
+      return( (iIndex < pQstSeg->iTempMons) && PeekHot( HOT_TEMP_MON, iIndex, pfReading, pbyHealth, &byControl ) );
+
+   case VOLTAGE_SENSOR:
+
+      return( (iIndex < pQstSeg->iVoltMons) && PeekHot( HOT_VOLT_MON, iIndex, pfReading, pbyHealth, &byControl ) );
+
+   case CURRENT_SENSOR:
+
+      return( (iIndex < pQstSeg->iCurrMons) && PeekHot( HOT_CURR_MON, iIndex, pfReading, pbyHealth, &byControl ) );
+
+   case FAN_SPEED_SENSOR:
+
+      return( (iIndex < pQstSeg->iFanMons) && PeekHot( HOT_FAN_MON, iIndex, pfReading, pbyHealth, &byControl ) );
+
+   default:
+
+      return( FALSE );
+   }
+}
+
+/****************************************************************************/
+/* HotCurrent() - Returns TRUE if none of the hot blocks is due to be       */
+/* refreshed. Must be called between BeginUpdateRead() and EndUpdateRead(), */
+/* whose outcome decides whether the answer can be believed.                */
+/****************************************************************************/
+
+static BOOL HotCurrent( MILLITIME *pstCurrTime )
+{
+   int               iClass;
+
+   for( iClass = 0; iClass < HOT_CLASSES; iClass++ )
+   {
+      if( PastMTime( &pQstSeg->stHot[iClass].stUpdateTime, pstCurrTime ) )
+         return( FALSE );
+   }
+
+   return( TRUE );
+}
+
+/****************************************************************************/
+/* CopySnapshot() - Copies every entry of every hot block into a snapshot,  */
+/* under the update sequence count so that all come from one generation.    */
+/* Unless called from within the critical section (bLocked), returns FALSE  */
+/* if any of the blocks is due to be refreshed, or if no consistent copy    */
+/* could be had while an update was being written.                          */
+/****************************************************************************/
+
+static BOOL CopySnapshot( QST_SNAPSHOT *pstSnap, BOOL bLocked )
+{
+   QST_SNAPSHOT_SENSORS *pstSensors;
+   P_QST_HOT_BLOCK   pstHot;
+   MILLITIME         stCurrTime;
+   UINT32            uSequence;
+   int               iTries, iType, iIndex;
+
+   // Counts don't change once the segment has been initialized
+
+   pstSnap->Sensor[TEMPERATURE_SENSOR].Count = pQstSeg->iTempMons;
+   pstSnap->Sensor[VOLTAGE_SENSOR].Count     = pQstSeg->iVoltMons;
+   pstSnap->Sensor[FAN_SPEED_SENSOR].Count   = pQstSeg->iFanMons;
+   pstSnap->Sensor[CURRENT_SENSOR].Count     = pQstSeg->iCurrMons;
+   pstSnap->ControllerCount                  = pQstSeg->iFanCtrls;
+
+   CurrMTime( &stCurrTime );
+
+   for( iTries = 0; iTries < PEEK_TRIES; iTries++ )
+   {
+      uSequence = BeginUpdateRead( pQstSeg );
+
+      if( !bLocked && !HotCurrent( &stCurrTime ) )
+      {
+         if( EndUpdateRead( pQstSeg, uSequence ) )
+            return( FALSE );
+
+         continue;
+      }
+
+      for( iType = 0; iType < QST_SENSOR_TYPES; iType++ )
+      {
+         pstSensors = &pstSnap->Sensor[iType];
+         pstHot     = &pQstSeg->stHot[aiHotClass[iType]];
+
+         memcpy( pstSensors->Reading, pstHot->fReading, pstSensors->Count * sizeof(float) );
+
+         for( iIndex = 0; iIndex < pstSensors->Count; iIndex++ )
+            pstSensors->Health[iIndex] = (QST_HEALTH)pstHot->byHealth[iIndex];
+      }
+
+      pstHot = &pQstSeg->stHot[HOT_FAN_CTRL];
+
+      memcpy( pstSnap->ControllerDuty, pstHot->fReading, pstSnap->ControllerCount * sizeof(float) );
+
+      for( iIndex = 0; iIndex < pstSnap->ControllerCount; iIndex++ )
+      {
+         pstSnap->ControllerHealth[iIndex] = (QST_HEALTH)pstHot->byHealth[iIndex];
+         pstSnap->ControlState[iIndex]     = (QST_CONTROL_STATE)pstHot->byControl[iIndex];
+      }
+
+      pstSnap->Generation = uSequence >> 1;
+      pstSnap->Timestamp  = pQstSeg->ullUpdateStamp;
+
+      if( EndUpdateRead( pQstSeg, uSequence ) )
+         return( TRUE );
+   }
+
+   return( FALSE );
+}
+
+/****************************************************************************/
+/* TakeSnapshot() - Fills a snapshot from the latest update without locking */
+/* if it's still current; otherwise enters the critical section, refreshes  */
+/* whatever is due and copies the result from there.                        */
+/****************************************************************************/
+
+static BOOL TakeSnapshot( QST_SNAPSHOT *pstSnap )
+{
+   BOOL              bSuccess = FALSE;
+
+   if( CopySnapshot( pstSnap, FALSE ) )
+      return( TRUE );
+
+   if( BeginCriticalSection() )
+   {
+      // One batch refreshes every class; the rest find themselves current
+
+      if( GetTempMonUpdateQst() && GetFanMonUpdateQst() && GetVoltMonUpdateQst() && GetCurrMonUpdateQst() && GetFanCtrlUpdateQst() )
+         bSuccess = CopySnapshot( pstSnap, TRUE );
+
+      EndCriticalSection();
+   }
+
+   return( bSuccess );
+}
+
+/****************************************************************************/
+/* PendingEvents() - Returns those events of a subscription that have been  */
+/* posted since the last one it saw, up to the one stamped uCount           */
+/****************************************************************************/
+
+#define QST_EVENTS      (QST_EVENT_NEW_READINGS | QST_EVENT_HEALTH_CHANGE | QST_EVENT_THRESHOLD_CHANGE | QST_EVENT_POLLING_CHANGE)
+
+static unsigned long PendingEvents( QST_SUBSCRIPTION *pstSub, UINT32 uCount )
+{
+   P_QST_EVENT_STAMPS   pstEvents = &pQstSeg->stEvents;
+   UINT32               uLast     = (UINT32)pstSub->LastEvent;
+   unsigned long        ulEvents  = 0;
+   int                  iType, iIndex, iClass;
+
+   if( uCount == uLast )
+      return( 0 );
+
+   if( EventStampNew( pstEvents->uReadings, uLast, uCount ) )
+      ulEvents |= QST_EVENT_NEW_READINGS;
+
+   if( EventStampNew( pstEvents->uPolling, uLast, uCount ) )
+      ulEvents |= QST_EVENT_POLLING_CHANGE;
+
+   // Health and threshold changes of the sensors and controllers selected
+
+   for( iType = 0; iType <= QST_SENSOR_TYPES; iType++ )
+   {
+      unsigned long ulMask = (iType < QST_SENSOR_TYPES)? pstSub->SensorMask[iType] : pstSub->ControllerMask;
+
+      iClass = (iType < QST_SENSOR_TYPES)? aiHotClass[iType] : HOT_FAN_CTRL;
+
+      for( iIndex = 0; (iIndex < QST_HOT_ENTRIES) && (ulMask >> iIndex); iIndex++ )
+      {
+         if( !(ulMask & (1UL << iIndex)) )
+            continue;
+
+         if( EventStampNew( pstEvents->uHealth[iClass][iIndex], uLast, uCount ) )
+            ulEvents |= QST_EVENT_HEALTH_CHANGE;
+
+         if( EventStampNew( pstEvents->uThresh[iClass][iIndex], uLast, uCount ) )
+            ulEvents |= QST_EVENT_THRESHOLD_CHANGE;
+      }
+   }
+
+   return( ulEvents & pstSub->Events );
+}
+
+/****************************************************************************/
+/* HistoryStats() - Fills in the statistics of a run of samples of a        */
+/* sensor's history, from the first sample given onwards. The minimum and   */
+/* maximum come from the two overlapping spans of the largest power-of-2    */
+/* length that together cover the run, and the mean from the running totals */
+/* at either end, so the cost doesn't grow with the length of the run.      */
+/****************************************************************************/
+
+static void HistoryStats( P_QST_HISTORY pstHist, P_QST_HISTORY_SERIES pstSeries, unsigned long long ullFirst, int iCount, QST_HISTORY_STATS *pstStats )
+{
+   unsigned          uFirst = (unsigned)(ullFirst % HISTORY_SAMPLES);
+   unsigned          uLast  = (unsigned)((ullFirst + iCount - 1) % HISTORY_SAMPLES), uMid;
+   float             fLow, fHigh;
+   int               iLevel;
+
+   memset( pstStats, 0, sizeof(QST_HISTORY_STATS) );
+
+   if( (pstStats->Count = iCount) == 0 )
+      return;
+
+   pstStats->Oldest = pstHist->ullTime[uFirst];
+   pstStats->Newest = pstHist->ullTime[uLast];
+   pstStats->Mean   = (float)((pstSeries->dTotal[uLast] - pstSeries->dTotal[uFirst] + pstSeries->fReading[uFirst]) / iCount);
+
+   if( iCount == 1 )
+   {
+      pstStats->Minimum = pstStats->Maximum = pstSeries->fReading[uLast];
+      return;
+   }
+
+   // Level whose span is the largest power of 2 no longer than the run
+
+   iLevel = 30 - __builtin_clz( (unsigned)iCount );
+   uMid   = (unsigned)((ullFirst + (2U << iLevel) - 1) % HISTORY_SAMPLES);
+
+   fLow  = pstSeries->fMin[iLevel][uMid];
+   fHigh = pstSeries->fMax[iLevel][uMid];
+
+   pstStats->Minimum = (pstSeries->fMin[iLevel][uLast] < fLow)? pstSeries->fMin[iLevel][uLast] : fLow;
+   pstStats->Maximum = (pstSeries->fMax[iLevel][uLast] > fHigh)? pstSeries->fMax[iLevel][uLast] : fHigh;
+}
+
+/****************************************************************************/
+/* CopyHistory() - Copies, from the history of a sensor, the samples taken  */
+/* within the window given (ms before ullNow, or all of those kept if it is */
+/* zero) into pstSamples, oldest first and up to the newest iMax of them,   */
+/* or their statistics into pstStats. The start of the window is found by a */
+/* binary search of the sample times. Unless called from within the         */
+/* critical section (bLocked), returns FALSE if no consistent copy could be */
+/* had while a sample was being added.                                      */
+/****************************************************************************/
+
+static BOOL CopyHistory( int iClass, int iIndex, unsigned long long ullNow, unsigned long ulWindow, int iMax, QST_HISTORY_SAMPLE *pstSamples, int *piCount, QST_HISTORY_STATS *pstStats, BOOL bLocked )
+{
+   P_QST_HISTORY        pstHist   = &pQstSeg->stHistory[iClass];
+   P_QST_HISTORY_SERIES pstSeries = &pQstSeg->stSeries[pstHist->iSeries + iIndex];
+   unsigned long long   ullSince  = (ullNow > ulWindow)? ullNow - ulWindow : 0;
+   unsigned long long   ullFirst, ullEnd, ullHigh, ullMid;
+   UINT32               uSequence;
+   unsigned             uSlot;
+   int                  iTries, iCount, iSample;
+
+   for( iTries = 0; iTries < PEEK_TRIES; iTries++ )
+   {
+      uSequence = BeginSeqRead( &pstHist->uSequence );
+      ullEnd    = pstHist->ullSamples;
+      ullFirst  = (ullEnd > HISTORY_SAMPLES)? ullEnd - HISTORY_SAMPLES : 0;
+
+      // Find the first sample within the window
+
+      for( ullHigh = ullEnd; ulWindow && (ullFirst < ullHigh); )
+      {
+         ullMid = ullFirst + (ullHigh - ullFirst) / 2;
+
+         if( pstHist->ullTime[ullMid % HISTORY_SAMPLES] < ullSince )
+            ullFirst = ullMid + 1;
+         else
+            ullHigh  = ullMid;
+      }
+
+      iCount = (int)(ullEnd - ullFirst);
+
+      if( pstSamples )
+      {
+         if( iCount > iMax )
+         {
+            ullFirst = ullEnd - iMax;
+            iCount   = iMax;
+         }
+
+         for( iSample = 0; iSample < iCount; iSample++ )
+         {
+            uSlot = (unsigned)((ullFirst + iSample) % HISTORY_SAMPLES);
+
+            pstSamples[iSample].Timestamp = pstHist->ullTime[uSlot];
+            pstSamples[iSample].Reading   = pstSeries->fReading[uSlot];
+         }
+
+         *piCount = iCount;
+      }
+      else
+         HistoryStats( pstHist, pstSeries, ullFirst, iCount, pstStats );
+
+      if( bLocked || EndSeqRead( &pstHist->uSequence, uSequence ) )
+         return( TRUE );
+   }
+
+   return( FALSE );
+}
+
+/****************************************************************************/
+/* TakeHistory() - Checks that a sensor exists and has its readings         */
+/* recorded, brings its class up to date if the readings are due to be      */
+/* refreshed, so that the newest sample is current, and copies its history  */
+/* as CopyHistory() would, without locking if possible, else from within    */
+/* the critical section                                                     */
+/****************************************************************************/
+
+static BOOL TakeHistory( QST_SENSOR_TYPE eType, int iIndex, unsigned long ulWindow, int iMax, QST_HISTORY_SAMPLE *pstSamples, int *piCount, QST_HISTORY_STATS *pstStats )
+{
+   static BOOL (* const apfnUpdate[HISTORY_CLASSES])( void ) =
+   {
+      GetTempMonUpdateQst,             // HOT_TEMP_MON
+      GetFanMonUpdateQst,              // HOT_FAN_MON
+      GetVoltMonUpdateQst,             // HOT_VOLT_MON
+      GetCurrMonUpdateQst              // HOT_CURR_MON
+   };
+
+   int               aiCount[QST_SENSOR_TYPES];
+   MILLITIME         stCurrTime;
+   unsigned long long ullNow;
+   float             fReading;
+   UINT8             byHealth;
+   BOOL              bSuccess;
+   int               iClass;
+
+   aiCount[TEMPERATURE_SENSOR] = pQstSeg->iTempMons;
+   aiCount[VOLTAGE_SENSOR]     = pQstSeg->iVoltMons;
+   aiCount[FAN_SPEED_SENSOR]   = pQstSeg->iFanMons;
+   aiCount[CURRENT_SENSOR]     = pQstSeg->iCurrMons;
+
+   if( ((int)eType < 0) || ((int)eType >= QST_SENSOR_TYPES) || (iIndex >= aiCount[eType]) )
+   {
+      errno = EINVAL;
+      return( FALSE );
+   }
+
+   // Sensors beyond the end of the pool aren't recorded
+
+   if( iIndex >= pQstSeg->stHistory[iClass = aiHotClass[eType]].iEntries )
+   {
+      errno = ENOSPC;
+      return( FALSE );
+   }
+
+   // Refresh the class first if it's due, so the newest sample is current
+
+   if( !PeekSensor( eType, iIndex, &fReading, &byHealth ) )
+   {
+      if( !BeginCriticalSection() )
+         return( FALSE );
+
+      bSuccess = apfnUpdate[iClass]();
+      EndCriticalSection();
+
+      if( !bSuccess )
+         return( FALSE );
+   }
+
+   CurrMTime( &stCurrTime );
+   ullNow = stCurrTime.uTimeNS / 1000000;
+
+   if( CopyHistory( iClass, iIndex, ullNow, ulWindow, iMax, pstSamples, piCount, pstStats, FALSE ) )
+      return( TRUE );
+
+   bSuccess = FALSE;
+
+   if( BeginCriticalSection() )
+   {
+      bSuccess = CopyHistory( iClass, iIndex, ullNow, ulWindow, iMax, pstSamples, piCount, pstStats, TRUE );
+      EndCriticalSection();
+   }
+
+   return( bSuccess );
+}
+
+#endif // defined(__linux__)
+
 /****************************************************************************/
 /* QstGetSensorCount() - Returns a count of the number of sensors of the    */
 /* specified type that are being managed by the QST Subsystem               */
@@ -560,6 +989,11 @@ BOOL APIENTRY QstGetSensorHealth
    BOOL                             bSuccess = FALSE;
    QST_MON_HEALTH_STATUS            *pstStatus;
 
+#if defined(__linux__)
+   float                            fReading;
+   UINT8                            byHealth;
+#endif
+
    // Handle obvious parameters issues
 
    if( !peHealth || (iIndex < 0) )
@@ -588,6 +1022,18 @@ BOOL APIENTRY QstGetSensorHealth
       return( FALSE );
    }
 
+#if defined(__linux__)
+
+   // Use the latest update without locking if it's still current
+
+   if( PeekSensor( eType, iIndex, &fReading, &byHealth ) )
+   {
+      *peHealth = (QST_HEALTH)byHealth;
+      return( TRUE );
+   }
+
+#endif
+
    // Process request
 
    if( BeginCriticalSection() )
@@ -719,6 +1165,10 @@ BOOL APIENTRY QstGetSensorReading
 ){
    BOOL                             bSuccess = FALSE;
 
+#if defined(__linux__)
+   UINT8                            byHealth;
+#endif
+
    // Handle obvious parameters issues
 
    if( !pfReading || (iIndex < 0) )
@@ -747,6 +1197,15 @@ BOOL APIENTRY QstGetSensorReading
       return( FALSE );
    }
 
+#if defined(__linux__)
+
+   // Use the latest update without locking if it's still current
+
+   if( PeekSensor( eType, iIndex, pfReading, &byHealth ) )
+      return( TRUE );
+
+#endif
+
    // Process request
 
    if( BeginCriticalSection() )
@@ -857,6 +1316,82 @@ BOOL APIENTRY QstGetSensorReading
    return( bSuccess );
 }
 
+#if defined(__linux__)
+
+/****************************************************************************/
+/* QstGetSensorHistory() - Returns the readings of the specified sensor     */
+/* recorded within the specified number of milliseconds (all of those kept  */
+/* if zero), oldest first and each with its timestamp, up to the newest     */
+/* MaxSamples of them                                                       */
+/****************************************************************************/
+
+BOOL APIENTRY QstGetSensorHistory
+(
+   IN   QST_SENSOR_TYPE             eType,
+   IN   int                         iIndex,
+   IN   unsigned long               ulWindow,
+   IN   int                         iMaxSamples,
+   OUT  QST_HISTORY_SAMPLE          *pstSamples,
+   OUT  int                         *piSamples
+){
+   // Handle obvious parameters issues
+
+   if( !pstSamples || !piSamples || (iIndex < 0) || (iMaxSamples <= 0) )
+   {
+      errno = EINVAL;
+      return( FALSE );
+   }
+
+   // Handle errors during library initialization
+
+   if( !pQstSeg )
+   {
+      errno = iInitErrno;
+      return( FALSE );
+   }
+
+   // Process request
+
+   return( TakeHistory( eType, iIndex, ulWindow, iMaxSamples, pstSamples, piSamples, NULL ) );
+}
+
+/****************************************************************************/
+/* QstGetSensorHistoryStats() - Returns the count, the times of the oldest  */
+/* and newest, and the minimum, maximum and mean of the readings of the     */
+/* specified sensor recorded within the specified number of milliseconds    */
+/* (all of those kept if zero). The count is zero if there are none.        */
+/****************************************************************************/
+
+BOOL APIENTRY QstGetSensorHistoryStats
+(
+   IN   QST_SENSOR_TYPE             eType,
+   IN   int                         iIndex,
+   IN   unsigned long               ulWindow,
+   OUT  QST_HISTORY_STATS           *pstStats
+){
+   // Handle obvious parameters issues
+
+   if( !pstStats || (iIndex < 0) )
+   {
+      errno = EINVAL;
+      return( FALSE );
+   }
+
+   // Handle errors during library initialization
+
+   if( !pQstSeg )
+   {
+      errno = iInitErrno;
+      return( FALSE );
+   }
+
+   // Process request
+
+   return( TakeHistory( eType, iIndex, ulWindow, 0, NULL, NULL, pstStats ) );
+}
+
+#endif // defined(__linux__)
+
 /****************************************************************************/
 /* QstSetSensorThresholdsHigh() - Sets the high health thresholds for the   */
 /* specified sensor                                                         */
@@ -1470,7 +2005,12 @@ BOOL APIENTRY QstGetControllerState
    OUT  QST_CONTROL_STATE           *peControl
 ){
    BOOL                             bSuccess = FALSE;
-   QST_FAN_CTRL_STATUS              *pstStatus;
+   QST_FAN_CTRL_STATUS              stStatus;
+
+#if defined(__linux__)
+   float                            fDuty;
+   UINT8                            byHealth, byControl;
+#endif
 
    // Handle obvious parameters issues
 
@@ -1502,28 +2042,44 @@ BOOL APIENTRY QstGetControllerState
 
    // Process request
 
+#if defined(__linux__)
+
+   // Use the latest update without locking if it's still current
+
+   if( PeekHot( HOT_FAN_CTRL, iIndex, &fDuty, &byHealth, &byControl ) )
+   {
+      *peHealth  = (QST_HEALTH)byHealth;
+      *peControl = (QST_CONTROL_STATE)byControl;
+      return( TRUE );
+   }
+
+#endif
+
    if( BeginCriticalSection() )
    {
       if( GetFanCtrlUpdateQst() )
       {
-         pstStatus = &pQstSeg->stFanCtrlUpdateRsp.stControllerUpdate[pQstSeg->iFanCtrlIndex[iIndex]].stControllerStatus;
-         *peHealth = pstStatus->uControllerStatus;
-
-         if( pstStatus->bOverrideSoftware )
-            *peControl = CONTROL_OVERRIDE_SOFTWARE;
-         else if( pstStatus->bOverrideFanController )
-            *peControl = CONTROL_OVERRIDE_CONTROLLER_ERROR;
-         else if( pstStatus->bOverrideTemperatureSensor)
-            *peControl = CONTROL_OVERRIDE_SENSOR_ERROR;
-         else
-            *peControl = CONTROL_NORMAL;
-
+         stStatus = pQstSeg->stFanCtrlUpdateRsp.stControllerUpdate[pQstSeg->iFanCtrlIndex[iIndex]].stControllerStatus;
          bSuccess = TRUE;
       }
 
       EndCriticalSection();
    }
 
+   if( bSuccess )
+   {
+      *peHealth = stStatus.uControllerStatus;
+
+      if( stStatus.bOverrideSoftware )
+         *peControl = CONTROL_OVERRIDE_SOFTWARE;
+      else if( stStatus.bOverrideFanController )
+         *peControl = CONTROL_OVERRIDE_CONTROLLER_ERROR;
+      else if( stStatus.bOverrideTemperatureSensor)
+         *peControl = CONTROL_OVERRIDE_SENSOR_ERROR;
+      else
+         *peControl = CONTROL_NORMAL;
+   }
+
    return( bSuccess );
 }
 
@@ -1539,6 +2095,10 @@ BOOL APIENTRY QstGetControllerDutyCycle
 ){
    BOOL                             bSuccess = FALSE;
 
+#if defined(__linux__)
+   UINT8                            byHealth, byControl;
+#endif
+
    // Handle obvious parameters issues
 
    if( !pfDuty || (iIndex < 0) || (iIndex >= pQstSeg->iFanCtrls) )
@@ -1567,6 +2127,15 @@ BOOL APIENTRY QstGetControllerDutyCycle
       return( FALSE );
    }
 
+#if defined(__linux__)
+
+   // Use the latest update without locking if it's still current
+
+   if( PeekHot( HOT_FAN_CTRL, iIndex, pfDuty, &byHealth, &byControl ) )
+      return( TRUE );
+
+#endif
+
    // Process request
 
    if( BeginCriticalSection() )
@@ -1740,3 +2309,196 @@ BOOL APIENTRY QstPollingIntervalChanged
 
    return( bSuccess );
 }
+
+#if defined(__linux__)
+
+/****************************************************************************/
+/* QstGetAllReadings() - Returns the reading and health of every sensor and */
+/* the duty cycle, health and control state of every controller, all taken  */
+/* from the same update, in a single call                                   */
+/****************************************************************************/
+
+BOOL APIENTRY QstGetAllReadings
+(
+   OUT  QST_SNAPSHOT                *pstSnap
+){
+   // Handle obvious parameters issues
+
+   if( !pstSnap )
+   {
+      errno = EINVAL;
+      return( FALSE );
+   }
+
+   // Handle errors during library initialization
+
+   if( !pQstSeg )
+   {
+      errno = iInitErrno;
+      return( FALSE );
+   }
+
+   // Process request
+
+   return( TakeSnapshot( pstSnap ) );
+}
+
+/****************************************************************************/
+/* QstGetReadingsSince() - Returns an indication of whether or not there    */
+/* has been an update since the one with the specified generation and, if   */
+/* there has, fills in a snapshot from it as QstGetAllReadings() would. The */
+/* snapshot is left untouched when there is nothing new.                    */
+/****************************************************************************/
+
+BOOL APIENTRY QstGetReadingsSince
+(
+   IN   unsigned long               ulGeneration,
+   OUT  QST_SNAPSHOT                *pstSnap,
+   OUT  BOOL                        *pbUpdated
+){
+   MILLITIME                        stCurrTime;
+   UINT32                           uSequence;
+   BOOL                             bCurrent;
+
+   // Handle obvious parameters issues
+
+   if( !pstSnap || !pbUpdated )
+   {
+      errno = EINVAL;
+      return( FALSE );
+   }
+
+   // Handle errors during library initialization
+
+   if( !pQstSeg )
+   {
+      errno = iInitErrno;
+      return( FALSE );
+   }
+
+   // Process request; nothing to copy if the same update is still current
+
+   CurrMTime( &stCurrTime );
+
+   uSequence = BeginUpdateRead( pQstSeg );
+   bCurrent  = HotCurrent( &stCurrTime );
+
+   if( EndUpdateRead( pQstSeg, uSequence ) && bCurrent && ((uSequence >> 1) == ulGeneration) )
+   {
+      *pbUpdated = FALSE;
+      return( TRUE );
+   }
+
+   if( !TakeSnapshot( pstSnap ) )
+      return( FALSE );
+
+   *pbUpdated = (pstSnap->Generation != ulGeneration);
+   return( TRUE );
+}
+
+/****************************************************************************/
+/* QstSubscribe() - Sets up a subscription to the specified events, for all */
+/* sensors and controllers, starting from the latest event posted           */
+/****************************************************************************/
+
+BOOL APIENTRY QstSubscribe
+(
+   IN   unsigned long               ulEvents,
+   OUT  QST_SUBSCRIPTION            *pstSub
+){
+   int                              iType;
+
+   // Handle obvious parameters issues
+
+   if( !pstSub || !ulEvents || (ulEvents & ~QST_EVENTS) )
+   {
+      errno = EINVAL;
+      return( FALSE );
+   }
+
+   // Handle errors during library initialization
+
+   if( !pQstSeg )
+   {
+      errno = iInitErrno;
+      return( FALSE );
+   }
+
+   // Process request
+
+   pstSub->Events = ulEvents;
+
+   for( iType = 0; iType < QST_SENSOR_TYPES; iType++ )
+      pstSub->SensorMask[iType] = ~0UL;
+
+   pstSub->ControllerMask = ~0UL;
+   pstSub->LastEvent      = __atomic_load_n( &pQstSeg->stEvents.uCount, __ATOMIC_ACQUIRE );
+
+   return( TRUE );
+}
+
+/****************************************************************************/
+/* QstWaitForEvents() - Waits no more than the specified number of          */
+/* milliseconds (forever if negative, not at all if zero) for any of the    */
+/* events of a subscription to be posted after the last one it saw, and     */
+/* returns those that were (none if the time expired). The subscription is  */
+/* moved on to the latest event, so each is only reported once.             */
+/****************************************************************************/
+
+BOOL APIENTRY QstWaitForEvents
+(
+   IN OUT QST_SUBSCRIPTION          *pstSub,
+   IN   int                         iTimeout,
+   OUT  unsigned long               *pulEvents
+){
+   MILLITIME                        stStart, stNow;
+   unsigned long                    ulEvents;
+   UINT32                           uCount;
+   int                              iRemaining = -1;
+
+   // Handle obvious parameters issues
+
+   if( !pstSub || !pulEvents )
+   {
+      errno = EINVAL;
+      return( FALSE );
+   }
+
+   // Handle errors during library initialization
+
+   if( !pQstSeg )
+   {
+      errno = iInitErrno;
+      return( FALSE );
+   }
+
+   // Process request
+
+   CurrMTime( &stStart );
+   uCount   = __atomic_load_n( &pQstSeg->stEvents.uCount, __ATOMIC_ACQUIRE );
+
+   for( ; ; )
+   {
+      ulEvents          = PendingEvents( pstSub, uCount );
+      pstSub->LastEvent = uCount;
+
+      if( ulEvents )
+         break;
+
+      if( iTimeout >= 0 )
+      {
+         CurrMTime( &stNow );
+
+         if( (iRemaining = iTimeout - (int)DiffMTime( &stNow, &stStart )) <= 0 )
+            break;
+      }
+
+      if( ((uCount = WaitEvent( &pQstSeg->stEvents, uCount, iRemaining )) == (UINT32)pstSub->LastEvent) && (errno == EINTR) )
+         return( FALSE );
+   }
+
+   *pulEvents = ulEvents;
+   return( TRUE );
+}
+
+#endif // defined(__linux__)
@@ -5,11 +5,35 @@
 /*  Description:    Implements support for the use of critical sections in  */
 /*                  the Linux environment.                                  */
 /*                                                                          */
-/*  Notes:      1.  In the Linux  environment,  we  use  a  global  binary  */
-/*                  semaphore (implemented using a counting semaphore with  */
-/*                  a single unit) to implement the critical section.  The  */
-/*                  critical  section type value is used as the identifier  */
-/*                  for the semaphore (so make it unique!!).                */
+/*  Notes:      1.  In the Linux environment, we  implement  the  critical  */
+/*                  section with a  lock  word  held  in  a  small  global  */
+/*                  (System V) shared memory segment. The critical section  */
+/*                  type value is used as the key for the segment (so make  */
+/*                  it unique,  both  among  critical  section  types  and  */
+/*                  global memory segment ids!!).                           */
+/*                                                                          */
+/*              2.  Entering an unowned critical section  takes  a  single  */
+/*                  atomic operation on the  lock  word,  with  no  system  */
+/*                  call. Only when there is contention do  threads  wait,  */
+/*                  using a futex on the lock word (see Futex.c).  Leaving  */
+/*                  makes a system call only if some thread is waiting.     */
+/*                                                                          */
+/*              3.  The lock word holds a  token  identifying  the  owning  */
+/*                  process. Each process using critical sections holds  a  */
+/*                  lock  (by  fcntl())  on   its   own   byte   of   file  */
+/*                  CRIT_SECT_OWNERS, which  the  kernel  drops  when  the  */
+/*                  process  ends,  however  it  ends.  A  waiting  thread  */
+/*                  periodically checks that the  owner's  byte  is  still  */
+/*                  locked; if not, it takes the  critical  section  over.  */
+/*                  Tokens are never reused (short of 2^31 processes), so,  */
+/*                  unlike a process id, a token can't come to  belong  to  */
+/*                  some other process, and it means the same in every pid  */
+/*                  namespace that shares  the  file.  This  provides  the  */
+/*                  protection SEM_UNDO  gave  the  semaphores  previously  */
+/*                  used. Ownership is by process (rather than thread), so  */
+/*                  a critical section entered by one thread may  be  left  */
+/*                  by another thread in the same process, which a  robust  */
+/*                  mutex (owned by a thread) would not allow.              */
 /*                                                                          */
 /****************************************************************************/
 
@@ -53,63 +77,209 @@
 #endif
 
 #include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
 
 #include <sys/ipc.h>
 #include <sys/types.h>
-#include <sys/sem.h>
+#include <sys/shm.h>
+#include <sys/stat.h>
 #include <sys/time.h>
 
 #include "CritSect.h"
+#include "Futex.h"
+
+/****************************************************************************/
+/*  CRIT_SECT_LOCK - Contents of the shared  memory  segment  holding  the  */
+/*  lock. The lock word is zero when the  critical  section  is  free  and  */
+/*  otherwise holds the owner's token (see below).  Bit  CRIT_SECT_WAITERS  */
+/*  is set when threads may be waiting for the critical section...          */
+/****************************************************************************/
+
+#define CRIT_SECT_WAITERS   0x80000000  // Lock word: threads may be waiting
+#define CRIT_SECT_TOKENS    0x7FFFFFFF  // Lock word: owner's token
+#define CRIT_SECT_POLL      100         // Owner check interval (milliseconds)
+#define CRIT_SECT_OWNERS    "/dev/shm/qst-owners"
+                                        // File in which owners hold locks
+
+typedef struct _CRIT_SECT_LOCK
+{
+    volatile U32            uLock;          // Lock word
+    U32                     uReserved;
+
+} CRIT_SECT_LOCK;
+
+/****************************************************************************/
+/*  Owner tokens. A process using critical sections holds a write lock (by  */
+/*  fcntl()) on one byte of file CRIT_SECT_OWNERS, at an offset  given  by  */
+/*  its token. The file starts with a count of the tokens handed out, so a  */
+/*  token is only ever given to one process. The  kernel  drops  the  lock  */
+/*  when the process ends, however it ends, so  an  owner  whose  byte  is  */
+/*  unlocked has gone. A child of fork() doesn't inherit the lock,  so  it  */
+/*  is given a token of its own...                                          */
+/****************************************************************************/
+
+#define TOKEN_OFFSET(uToken)    ((off_t)sizeof(U32) + (uToken))
+
+static int              iOwnerFile = -1;                // CRIT_SECT_OWNERS
+static U32              uSelfToken;                     // Our token (0 until given)
+static pthread_mutex_t  stOwnerLock = PTHREAD_MUTEX_INITIALIZER;
+
+static void ForkCritSect( void )
+{
+    pthread_mutex_init( &stOwnerLock, NULL );
+    uSelfToken = 0;
+}
+
+static void RegisterFork( void )
+{
+    pthread_atfork( NULL, NULL, ForkCritSect );
+}
 
 /****************************************************************************/
-/*  semun - Union used to manipulate Linux Semaphores. We have to  declare  */
-/*  this ourselves if the Linux include files don't do so. It's silly that  */
-/*  they so carefully document how to declare this union yet won't add the  */
-/*  declaration to the include files...                                     */
+/*  LockBytes() - Applies a lock operation (F_SETLK, F_SETLKW or  F_GETLK)  */
+/*  to bytes of the owners file. Returns the lock type found  by  F_GETLK,  */
+/*  or F_UNLCK for the others, or -1 (with errno set) on failure.           */
 /****************************************************************************/
 
-#if defined(__GNU_LIBRARY__) && !defined(_SEM_SEMUN_UNDEFINED)
-// union semun Was defined by including <sys/sem.h>
-#else
+static int LockBytes( int iCommand, short sType, off_t tStart, off_t tLength )
+{
+    struct flock stLock;
+
+    memset( &stLock, 0, sizeof(stLock) );
+
+    stLock.l_type   = sType;
+    stLock.l_whence = SEEK_SET;
+    stLock.l_start  = tStart;
+    stLock.l_len    = tLength;
 
-union semun
+    if( fcntl( iOwnerFile, iCommand, &stLock ) == -1 )
+        return( -1 );
+
+    return( (iCommand == F_GETLK)? stLock.l_type : F_UNLCK );
+}
+
+/****************************************************************************/
+/*  ClaimToken() - Gives this process a token, if it doesn't yet have one.  */
+/*  The count is read and advanced under a lock on its own bytes, and  the  */
+/*  token it gives is locked straight away; should the count have  wrapped  */
+/*  onto a token still held, the next is tried. Returns FALSE (with  errno  */
+/*  set) if the owners file can't be used.                                  */
+/****************************************************************************/
+
+static BOOL ClaimToken( void )
 {
-    int                     val;            // value for SETVAL
-    struct semid_ds         *buf;           // buffer for IPC_STAT, IPC_SET
-    unsigned short int      *array;         // array for GETALL, SETALL
-    struct seminfo          *__buf;         // buffer for IPC_INFO
-};
+    U32  uCount;
+    BOOL bClaimed = FALSE;
+
+    pthread_mutex_lock( &stOwnerLock );
 
-#endif // def _SEM_SEMUN_UNDEFINED
+    if( uSelfToken )
+    {
+        pthread_mutex_unlock( &stOwnerLock );
+        return( TRUE );
+    }
+
+    if( iOwnerFile == -1 )
+    {
+        // Set permissions exactly (umask applies to open()); only the
+        // file's creator can, and only needs to
+
+        if( (iOwnerFile = open( CRIT_SECT_OWNERS, O_RDWR | O_CREAT | O_CLOEXEC, 0666 )) != -1 )
+            fchmod( iOwnerFile, 0666 );
+    }
+
+    if( (iOwnerFile != -1) && (LockBytes( F_SETLKW, F_WRLCK, 0, sizeof(U32) ) != -1) )
+    {
+        if( pread( iOwnerFile, &uCount, sizeof(uCount), 0 ) != sizeof(uCount) )
+            uCount = 0;
+
+        for( ;; )
+        {
+            uCount = (uCount % CRIT_SECT_TOKENS) + 1;
+
+            if( LockBytes( F_SETLK, F_WRLCK, TOKEN_OFFSET( uCount ), 1 ) != -1 )
+            {
+                bClaimed = TRUE;
+                break;
+            }
+
+            if( (errno != EACCES) && (errno != EAGAIN) )
+                break;
+        }
+
+        if( bClaimed && (pwrite( iOwnerFile, &uCount, sizeof(uCount), 0 ) != sizeof(uCount)) )
+        {
+            LockBytes( F_SETLK, F_UNLCK, TOKEN_OFFSET( uCount ), 1 );
+            bClaimed = FALSE;
+        }
+
+        LockBytes( F_SETLK, F_UNLCK, 0, sizeof(U32) );
+    }
+
+    if( bClaimed )
+        uSelfToken = uCount;
+
+    pthread_mutex_unlock( &stOwnerLock );
+    return( bClaimed );
+}
 
 /****************************************************************************/
-/*  Declarations for our  semaphore  operation  specification  structures.  */
-/*  Structure  stSemAdd requests the addition of a unit to a semaphore and  */
-/*  structure stSemRem requests the removal of a unit  from  a  semaphore.  */
-/*  Both  specify  SEM_UNDO  so  that  the semaphore is protected should a  */
-/*  thread in ownership of the semaphore be deleted...                      */
+/*  OwnerGone() - Indicates if the process given a token has ended, as  no  */
+/*  lock is held on the token's byte.                                       */
 /****************************************************************************/
 
-static const struct sembuf stSemAdd = { 0,  1, SEM_UNDO };
-static const struct sembuf stSemRem = { 0, -1, SEM_UNDO };
+static BOOL OwnerGone( U32 uToken )
+{
+    return( (uToken != uSelfToken) && (LockBytes( F_GETLK, F_WRLCK, TOKEN_OFFSET( uToken ), 1 ) == F_UNLCK) );
+}
+
+/****************************************************************************/
+/*  AttachCritSect() - Maps the segment holding the lock and returns it as  */
+/*  the handle for the critical  section.  Returns  NULL  if  the  mapping  */
+/*  fails.                                                                  */
+/****************************************************************************/
+
+static HCRITSECT AttachCritSect( int iShmId )
+{
+    void *pvLock;
+
+    static pthread_once_t stOnce = PTHREAD_ONCE_INIT;
+
+    if( iShmId == -1 )
+        return( NULL );
+
+    if( !uSelfToken )
+    {
+        pthread_once( &stOnce, RegisterFork );
+
+        if( !ClaimToken() )
+            return( NULL );
+    }
+
+    pvLock = shmat( iShmId, NULL, 0 );
+
+    return( (pvLock == (void *)-1)? NULL : (HCRITSECT)pvLock );
+}
 
 /****************************************************************************/
 /*  LookupCritSect() - Returns a handle for the operator that is  used  to  */
 /*  implement  the  specified critical section type. If this operator does  */
 /*  not exist, the function will return NULL.                               */
 /*                                                                          */
-/*  On Linux, we attempt to look up the identifier for the semaphore using  */
-/*  the specified critical section type.  We  add  1  to  this  identifier  */
-/*  (since  0 is a valid identifier) and return this as the handle for our  */
-/*  critical section. If the lookup fails, semget() returns -1.  Adding  1  */
-/*  to  this  value  yields  0 (the NULL handle), which is perfect for our  */
-/*  external needs...                                                       */
+/*  On Linux, we attempt to look up the shared memory segment holding  the  */
+/*  lock, using the specified critical section type, and map it  into  our  */
+/*  address space. The address of the lock is the handle for our  critical  */
+/*  section. If either operation fails, errno is set by the shared  memory  */
+/*  primitives and NULL is returned...                                      */
 /****************************************************************************/
 
 HCRITSECT LookupCritSect( U32 uSectionType )
 {
-    int iSemId = semget( (int)uSectionType, 1, 0 );
-    return( (HCRITSECT)((long)(iSemId + 1)) );
+    return( AttachCritSect( shmget( (key_t)uSectionType, sizeof(CRIT_SECT_LOCK), 0 ) ) );
 }
 
 /****************************************************************************/
@@ -120,45 +290,26 @@ HCRITSECT LookupCritSect( U32 uSectionType )
 /*  exists.  If  set  to  FALSE, the function will return a handle for the  */
 /*  existing operator.                                                      */
 /*                                                                          */
-/*  On Linux we create or lookup the appropriate semaphore using  function  */
-/*  semget(),  depending upon the creation type requested. We add 1 to the  */
-/*  semaphore's identifier (since 0 is a valid identifier) and return this  */
-/*  as the handle for our critical section. If the lookup fails,  semget()  */
-/*  returns  -1.  Adding 1 to this value yields 0 (the NULL Handle), which  */
-/*  is perfect for our external (Handle) needs. We set errno to EEXIST  if  */
-/*  the  semaphore  already existed and creation was requested. Otherwise,  */
-/*  errno is set by the semaphore primities.                                */
+/*  On Linux we create or lookup the shared  memory  segment  holding  the  */
+/*  lock, depending upon the creation type requested, and map it into  our  */
+/*  address space. A newly created segment is zero-filled by  the  kernel,  */
+/*  so the lock starts out free without any  further  initialization  (and  */
+/*  thus  without  a  window  in  which  another  process  could  see   it  */
+/*  uninitialized). We set errno to EEXIST if the segment already  existed  */
+/*  and creation was requested. Otherwise, errno  is  set  by  the  shared  */
+/*  memory primitives.                                                      */
 /****************************************************************************/
 
 HCRITSECT CreateCritSect( U32 uSectionType, BOOL bMustCreate )
 {
-    int iSemId = semget( (int)uSectionType, 1, IPC_CREAT | IPC_EXCL | 0666 );
+    int iShmId = shmget( (key_t)uSectionType, sizeof(CRIT_SECT_LOCK), IPC_CREAT | IPC_EXCL | 0666 );
 
-    if( iSemId == -1 )
-    {
-        // if they didn't say must create, try looking up semaphore
+    // if they didn't say must create, try looking up segment
 
-        if( !bMustCreate )
-            iSemId = semget( (int)uSectionType, 1, 0 );
-    }
-    else
-    {
-        // We created; initialize to have one unit (indicating available)
-
-        union semun uSemun;
-        uSemun.val = 1;
-
-        if( semctl( iSemId, 0, SETVAL, uSemun ) == -1 )
-        {
-            int iSave = errno;
-            semctl( iSemId, 0, IPC_RMID, 0 );
-            errno = iSave;
-
-            iSemId = -1;
-        }
-    }
+    if( (iShmId == -1) && !bMustCreate )
+        iShmId = shmget( (key_t)uSectionType, sizeof(CRIT_SECT_LOCK), 0 );
 
-    return( (HCRITSECT)((long)(iSemId + 1)) );
+    return( AttachCritSect( iShmId ) );
 }
 
 /****************************************************************************/
@@ -167,14 +318,15 @@ HCRITSECT CreateCritSect( U32 uSectionType, BOOL bMustCreate )
 /*  last handle that was referencing the operator, the  operator  will  be  */
 /*  deleted.                                                                */
 /*                                                                          */
-/*  On Linux, we have nothing to do.  When  all  applications  referencing  */
-/*  the  semaphore  are  deleted,  the  semaphore  will  be  automatically  */
-/*  deleted...                                                              */
+/*  On Linux, we unmap the segment holding the lock.  We  don't  mark  the  */
+/*  segment  for deletion; a process looking up the critical section after  */
+/*  that would be given a new (different) lock. Like the semaphores before  */
+/*  it, the segment persists for the next user...                           */
 /****************************************************************************/
 
 BOOL CloseCritSect( HCRITSECT hCritSect )
 {
-    return( TRUE );
+    return( shmdt( hCritSect ) != -1 );
 }
 
 /****************************************************************************/
@@ -185,15 +337,112 @@ BOOL CloseCritSect( HCRITSECT hCritSect )
 /*  of waiting threads ("back of the line, buddy"). The  function  returns  */
 /*  TRUE if successful; FALSE otherwise.                                    */
 /*                                                                          */
-/*  On Linux, we use function semop() to remove a unit from the semaphore.  */
-/*  This  will  cause  a  wait  if no units are available. On failure, the  */
-/*  errno setting comes from function semop().                              */
+/*  On Linux, we first try to swap our token into a  free  lock  word.  If  */
+/*  that fails, we wait on the lock word's futex, retrying each time we're  */
+/*  woken; just before the first  wait  (never  if  the  time  allowed  is  */
+/*  already up), we mark the lock word as having  waiters.  Once  we  have  */
+/*  waited, we always enter with the waiters bit  set,  since  others  may  */
+/*  still be  queued  behind  us.  Waits  are  limited  to  CRIT_SECT_POLL  */
+/*  milliseconds; after each, we check the owner is  alive  and  take  the  */
+/*  critical section over if it is not. Note: the futex does not guarantee  */
+/*  the order in which waiters are woken.                                   */
 /****************************************************************************/
 
 BOOL EnterCritSect( HCRITSECT hCritSect )
 {
-    int iSemId = (int)(*((long*)&hCritSect)) - 1;
-    return( semop( iSemId, (struct sembuf *)&stSemRem, 1 ) != -1 );
+    return( EnterCritSectTimed( hCritSect, -1 ) );
+}
+
+/****************************************************************************/
+/*  EnterCritSectTimed() -  Enters  critical  section  referenced  by  the  */
+/*  specified  handle,  like  EnterCritSect(),  but  waits  no  more  than  */
+/*  iTimeout milliseconds (forever if iTimeout is negative). If  the  time  */
+/*  expires, the function returns FALSE with errno set to ETIMEDOUT.        */
+/****************************************************************************/
+
+BOOL EnterCritSectTimed( HCRITSECT hCritSect, int iTimeout )
+{
+    volatile U32    *puLock = &((CRIT_SECT_LOCK *)hCritSect)->uLock;
+    U32             uSelf, uValue = 0;
+    struct timespec stTime;
+    long long       llNow, llUntil = 0;
+    int             iWait;
+    BOOL            bWaited = FALSE;
+
+    // A child of fork() needs a token of its own
+
+    if( !uSelfToken && !ClaimToken() )
+        return( FALSE );
+
+    uSelf = uSelfToken;
+
+    // Fast path: critical section is free
+
+    if( __atomic_compare_exchange_n( puLock, &uValue, uSelf, FALSE, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED ) )
+        return( TRUE );
+
+    if( iTimeout >= 0 )
+    {
+        clock_gettime( CLOCK_MONOTONIC, &stTime );
+        llUntil = (long long)stTime.tv_sec * 1000 + stTime.tv_nsec / 1000000 + iTimeout;
+    }
+
+    for( ;; )
+    {
+        // uValue holds current lock word
+
+        if( uValue == 0 )
+        {
+            if( __atomic_compare_exchange_n( puLock, &uValue, bWaited? uSelf | CRIT_SECT_WAITERS : uSelf, FALSE, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED ) )
+                return( TRUE );
+
+            continue;
+        }
+
+        iWait = CRIT_SECT_POLL;
+
+        if( iTimeout >= 0 )
+        {
+            clock_gettime( CLOCK_MONOTONIC, &stTime );
+            llNow = (long long)stTime.tv_sec * 1000 + stTime.tv_nsec / 1000000;
+
+            if( llNow >= llUntil )
+            {
+                errno = ETIMEDOUT;
+                return( FALSE );
+            }
+
+            if( llUntil - llNow < iWait )
+                iWait = (int)(llUntil - llNow);
+        }
+
+        // Only once we are going to wait is the lock word marked
+
+        if( !(uValue & CRIT_SECT_WAITERS) )
+        {
+            if( !__atomic_compare_exchange_n( puLock, &uValue, uValue | CRIT_SECT_WAITERS, FALSE, __ATOMIC_RELAXED, __ATOMIC_RELAXED ) )
+                continue;
+
+            uValue |= CRIT_SECT_WAITERS;
+        }
+
+        bWaited = TRUE;
+
+        if( !FutexWait( puLock, uValue, iWait ) )
+        {
+            if( (errno != EAGAIN) && (errno != EINTR) && (errno != ETIMEDOUT) )
+                return( FALSE );
+
+            // If owner has died, take over
+
+            if(    (errno == ETIMEDOUT)
+                && OwnerGone( uValue & CRIT_SECT_TOKENS )
+                && __atomic_compare_exchange_n( puLock, &uValue, uSelf | CRIT_SECT_WAITERS, FALSE, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED ) )
+                return( TRUE );
+        }
+
+        uValue = __atomic_load_n( puLock, __ATOMIC_RELAXED );
+    }
 }
 
 /****************************************************************************/
@@ -202,15 +451,17 @@ BOOL EnterCritSect( HCRITSECT hCritSect )
 /*  one that has been waiting the longest  gets  to  enter.  The  function  */
 /*  returns TRUE if successful; FALSE otherwise.                            */
 /*                                                                          */
-/*  On Linux, we use function semop() to add a unit to the  semaphore  for  */
-/*  the  specified  critical section. This wakes up longest waiting thread  */
-/*  (if any are, in fact, waiting for  a  unit).  On  failure,  the  errno  */
-/*  setting comes from function semop().                                    */
+/*  On Linux, we free the lock word  and,  if  it  was  marked  as  having  */
+/*  waiters, wake one of them using  the  futex.  On  failure,  the  errno  */
+/*  setting comes from function FutexWake().                                */
 /****************************************************************************/
 
 BOOL LeaveCritSect( HCRITSECT hCritSect )
 {
-    int iSemId = (int)(*((long*)&hCritSect)) - 1;
-    return( semop( iSemId, (struct sembuf *)&stSemAdd, 1 ) != -1 );
-}
+    volatile U32 *puLock = &((CRIT_SECT_LOCK *)hCritSect)->uLock;
 
+    if( __atomic_exchange_n( puLock, 0, __ATOMIC_RELEASE ) & CRIT_SECT_WAITERS )
+        return( FutexWake( puLock, 1 ) != -1 );
+
+    return( TRUE );
+}
@@ -0,0 +1,94 @@
+/****************************************************************************/
+/*                                                                          */
+/*  Module:         Futex.c                                                 */
+/*                                                                          */
+/*  Description:    Wraps the Linux futex (fast user-space  mutex)  system  */
+/*                  call for use on words placed in memory shared  between  */
+/*                  processes.                                              */
+/*                                                                          */
+/*  Notes:      1.  The futexes are not private to  the  process,  so  the  */
+/*                  kernel keys them by  the  physical  page  backing  the  */
+/*                  word. Any process mapping the same memory can wait  or  */
+/*                  wake upon them.                                         */
+/*                                                                          */
+/****************************************************************************/
+
+/****************************************************************************/
+/*                                                                          */
+/*     Copyright (c) 2005-2009, Intel Corporation. All Rights Reserved.     */
+/*                                                                          */
+/*  Redistribution and use in source and binary  forms,  with  or  without  */
+/*  modification, are permitted provided that the following conditions are  */
+/*  met:                                                                    */
+/*                                                                          */
+/*    - Redistributions of source code must  retain  the  above  copyright  */
+/*      notice, this list of conditions and the following disclaimer.       */
+/*                                                                          */
+/*    - Redistributions  in binary form must reproduce the above copyright  */
+/*      notice, this list of conditions and the  following  disclaimer  in  */
+/*      the   documentation  and/or  other  materials  provided  with  the  */
+/*      distribution.                                                       */
+/*                                                                          */
+/*    - Neither the name  of  Intel  Corporation  nor  the  names  of  its  */
+/*      contributors  may  be  used to endorse or promote products derived  */
+/*      from this software without specific prior written permission.       */
+/*                                                                          */
+/*  DISCLAIMER: THIS SOFTWARE IS PROVIDED BY  THE  COPYRIGHT  HOLDERS  AND  */
+/*  CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  */
+/*  BUT  NOT  LIMITED  TO,  THE  IMPLIED WARRANTIES OF MERCHANTABILITY AND  */
+/*  FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN  NO  EVENT  SHALL  */
+/*  INTEL  CORPORATION  OR  THE  CONTRIBUTORS  BE  LIABLE  FOR ANY DIRECT,  */
+/*  INDIRECT, INCIDENTAL, SPECIAL,  EXEMPLARY,  OR  CONSEQUENTIAL  DAMAGES  */
+/*  (INCLUDING,  BUT  NOT  LIMITED  TO, PROCUREMENT OF SUBSTITUTE GOODS OR  */
+/*  SERVICES; LOSS OF USE, DATA, OR  PROFITS;  OR  BUSINESS  INTERRUPTION)  */
+/*  HOWEVER  CAUSED  AND  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,  */
+/*  STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)  ARISING  */
+/*  IN  ANY  WAY  OUT  OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE  */
+/*  POSSIBILITY OF SUCH DAMAGE.                                             */
+/*                                                                          */
+/****************************************************************************/
+
+#ifndef __linux__
+#error This source module intended for use in Linux environments only
+#endif
+
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "Futex.h"
+
+/****************************************************************************/
+/* FutexWait() - Waits for the word to be woken, provided it (still) holds  */
+/* the expected value. Waits no more than iTimeout milliseconds (forever if */
+/* iTimeout is negative). Returns TRUE if woken; FALSE otherwise, with      */
+/* errno set to EAGAIN if the value differed, ETIMEDOUT if the time expired */
+/* or EINTR if a signal interrupted the wait. Callers must be prepared for  */
+/* spurious wakeups; the word should always be rechecked.                   */
+/****************************************************************************/
+
+BOOL FutexWait( volatile U32 *puWord, U32 uExpected, int iTimeout )
+{
+    struct timespec stTime, *pstTime = NULL;
+
+    if( iTimeout >= 0 )
+    {
+        stTime.tv_sec  = iTimeout / 1000;
+        stTime.tv_nsec = (long)(iTimeout % 1000) * 1000000L;
+        pstTime        = &stTime;
+    }
+
+    return( syscall( SYS_futex, puWord, FUTEX_WAIT, uExpected, pstTime, NULL, 0 ) == 0 );
+}
+
+/****************************************************************************/
+/* FutexWake() - Wakes up to iCount threads waiting upon the word. Returns  */
+/* the number woken, or -1 (with errno set) on failure.                     */
+/****************************************************************************/
+
+int FutexWake( volatile U32 *puWord, int iCount )
+{
+    return( (int)syscall( SYS_futex, puWord, FUTEX_WAKE, iCount, NULL, NULL, 0 ) );
+}
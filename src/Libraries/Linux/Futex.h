@@ -0,0 +1,59 @@
+/****************************************************************************/
+/*                                                                          */
+/*  Module:         Futex.h                                                 */
+/*                                                                          */
+/*  Description:    Provides function prototypes for the module that wraps  */
+/*                  the Linux futex (fast user-space  mutex)  system  call  */
+/*                  for use on  words  placed  in  memory  shared  between  */
+/*                  processes.                                              */
+/*                                                                          */
+/****************************************************************************/
+
+/****************************************************************************/
+/*                                                                          */
+/*     Copyright (c) 2005-2009, Intel Corporation. All Rights Reserved.     */
+/*                                                                          */
+/*  Redistribution and use in source and binary  forms,  with  or  without  */
+/*  modification, are permitted provided that the following conditions are  */
+/*  met:                                                                    */
+/*                                                                          */
+/*    - Redistributions of source code must  retain  the  above  copyright  */
+/*      notice, this list of conditions and the following disclaimer.       */
+/*                                                                          */
+/*    - Redistributions  in binary form must reproduce the above copyright  */
+/*      notice, this list of conditions and the  following  disclaimer  in  */
+/*      the   documentation  and/or  other  materials  provided  with  the  */
+/*      distribution.                                                       */
+/*                                                                          */
+/*    - Neither the name  of  Intel  Corporation  nor  the  names  of  its  */
+/*      contributors  may  be  used to endorse or promote products derived  */
+/*      from this software without specific prior written permission.       */
+/*                                                                          */
+/*  DISCLAIMER: THIS SOFTWARE IS PROVIDED BY  THE  COPYRIGHT  HOLDERS  AND  */
+/*  CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  */
+/*  BUT  NOT  LIMITED  TO,  THE  IMPLIED WARRANTIES OF MERCHANTABILITY AND  */
+/*  FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN  NO  EVENT  SHALL  */
+/*  INTEL  CORPORATION  OR  THE  CONTRIBUTORS  BE  LIABLE  FOR ANY DIRECT,  */
+/*  INDIRECT, INCIDENTAL, SPECIAL,  EXEMPLARY,  OR  CONSEQUENTIAL  DAMAGES  */
+/*  (INCLUDING,  BUT  NOT  LIMITED  TO, PROCUREMENT OF SUBSTITUTE GOODS OR  */
+/*  SERVICES; LOSS OF USE, DATA, OR  PROFITS;  OR  BUSINESS  INTERRUPTION)  */
+/*  HOWEVER  CAUSED  AND  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,  */
+/*  STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)  ARISING  */
+/*  IN  ANY  WAY  OUT  OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE  */
+/*  POSSIBILITY OF SUCH DAMAGE.                                             */
+/*                                                                          */
+/****************************************************************************/
+
+#ifndef _FUTEX_H
+#define _FUTEX_H
+
+#include <typedef.h>
+
+/****************************************************************************/
+/* Functions                                                                */
+/****************************************************************************/
+
+BOOL   FutexWait( volatile U32 *puWord, U32 uExpected, int iTimeout );
+int    FutexWake( volatile U32 *puWord, int iCount );
+
+#endif // ndef _FUTEX_H
@@ -5,10 +5,48 @@
 /*  Description:    Implements  support  for  the  use  of  global  memory  */
 /*                  segments in the Linux environment.                      */
 /*                                                                          */
-/*  Notes:      1.  For Linux, we utilize the shm (shared memory) facility  */
-/*                  to manage our global memory segments. The segment type  */
-/*                  is  used  as  the  identifier  for  the  shared memory  */
-/*                  segments (so make them unique!!).                       */
+/*  Notes:      1.  Segments are files in a  memory-backed  directory:  by  */
+/*                  default /dev/shm, where shm_open() puts  its  objects.  */
+/*                  The segment id gives the file name (qst-<id>), so make  */
+/*                  them  unique!!  Environment  variable  QST_GLOBMEM_DIR  */
+/*                  places them elsewhere; on a hugetlbfs mount, they  are  */
+/*                  backed by huge pages.                                   */
+/*                                                                          */
+/*              2.  A segment is built as an unnamed file (O_TMPFILE),  or  */
+/*                  under a temporary name, and only linked under its  own  */
+/*                  name once it has been sized, so  nobody  can  find  it  */
+/*                  half-made. Every  process  using  a  segment  holds  a  */
+/*                  shared flock() on it; the one that closes it and finds  */
+/*                  it can take the  lock  exclusively  is  the  last  and  */
+/*                  removes it. Locks go with the  process,  so  when  the  */
+/*                  last user crashes, nobody holds a lock on the file  it  */
+/*                  leaves behind: the next process to look the segment up  */
+/*                  or create it finds it can take  the  lock  exclusively  */
+/*                  and removes it, so a fresh  segment  is  built  rather  */
+/*                  than the stale contents attached to.                    */
+/*                                                                          */
+/*              3.  Mappings are prefaulted (MAP_POPULATE),  so  a  client  */
+/*                  doesn't take its page faults one at a  time  on  first  */
+/*                  touch. Setting QST_GLOBMEM_HUGEPAGES (to other than 0)  */
+/*                  asks for transparent huge pages as  well,  which  take  */
+/*                  effect where the kernel's shmem policy allows them.     */
+/*                                                                          */
+/*              4.  Segments are created  with  permissions  GLOBMEM_MODE,  */
+/*                  unless QST_GLOBMEM_MODE  supplies  others  (in  octal,  */
+/*                  e.g. "0666" for the former world-writable segments).    */
+/*                                                                          */
+/*              5.  Setting QST_GLOBMEM_TYPE to "sysv"  selects  System  V  */
+/*                  shared memory instead, with the segment id used as the  */
+/*                  key. Such segments outlive the processes that use them  */
+/*                  until removed (ipcrm) or the system restarts.           */
+/*                                                                          */
+/*              6.  Segments whose ids have  GLOBMEM_PERSISTENT  set  (see  */
+/*                  GlobMem.h) are kept when their last user  closes  them  */
+/*                  and aren't taken for orphans  when  their  users  have  */
+/*                  died, so what they hold survives times when no process  */
+/*                  is using them. Only one too small for the  size  asked  */
+/*                  for is replaced.  System  V  ones  aren't  marked  for  */
+/*                  deletion on closing either.                             */
 /*                                                                          */
 /****************************************************************************/
 
@@ -47,17 +85,257 @@
 /*                                                                          */
 /****************************************************************************/
 
+
 #ifndef __linux__
 #error This source module intended for use in Linux environments only
 #endif
 
+#define _GNU_SOURCE                     // For O_TMPFILE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
 #include <sys/ipc.h>
 #include <sys/types.h>
 #include <sys/shm.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/vfs.h>
 #include <sys/time.h>
 
 #include "GlobMem.h"
 
+/****************************************************************************/
+/* Definitions                                                              */
+/****************************************************************************/
+
+#define GLOBMEM_DIR             "/dev/shm"              // Default directory for segments
+#define GLOBMEM_MODE            0660                    // Default permissions for segments
+#define GLOBMEM_SIGNATURE       'GLOB'                  // Signature for validating descriptors
+#define GLOBMEM_RETRIES         8                       // Attempts to find (or replace) a segment
+
+#ifndef HUGETLBFS_MAGIC
+#define HUGETLBFS_MAGIC         0x958458f6
+#endif
+
+/****************************************************************************/
+/* Descriptors that we use to record the segments this process has handles  */
+/* for. The handle is the address of the descriptor; a list of them allows  */
+/* UnmapGlobMem() to find the segment a mapping belongs to.                 */
+/****************************************************************************/
+
+typedef struct _GLOBMEM_DESCR
+{
+    U32                         uSignature;
+    int                         iShmId;                 // System V segment (-1 if file)
+    int                         iFd;                    // File (-1 if System V segment)
+    size_t                      tMapSize;               // Size rounded up to page size
+    BOOL                        bPersistent;            // Kept after last user (see note 6)
+    void                        *pvMapping;             // Address mapped at (NULL if not mapped)
+    U32                         uReferences;
+    U32                         uMappings;
+    char                        szPath[256];
+    struct _GLOBMEM_DESCR *     pstNextDescr;
+
+} GLOBMEM_DESCR;
+
+static  GLOBMEM_DESCR *         pstFirstDescr = NULL;   // Head of our linked list
+static  pthread_mutex_t         stDescrLock = PTHREAD_MUTEX_INITIALIZER;
+
+/****************************************************************************/
+/* Configuration, taken from the environment on first use                   */
+/****************************************************************************/
+
+static  BOOL                    bConfigured;
+static  BOOL                    bSysV;                  // System V segments in use
+static  BOOL                    bHugePages;             // Transparent huge pages wanted
+static  mode_t                  tMode;                  // Permissions for new segments
+static  char                    szDir[200];             // Directory holding segments
+static  size_t                  tPageSize;              // Page size for segments
+
+static void Configure( void )
+{
+    const char                  *pszEnv;
+    struct statfs               stFS;
+
+    if( bConfigured )
+        return;
+
+    pszEnv = getenv( "QST_GLOBMEM_TYPE" );
+    bSysV  = pszEnv && !strcmp( pszEnv, "sysv" );
+
+    pszEnv     = getenv( "QST_GLOBMEM_HUGEPAGES" );
+    bHugePages = pszEnv && *pszEnv && strcmp( pszEnv, "0" );
+
+    pszEnv = getenv( "QST_GLOBMEM_MODE" );
+    tMode  = (pszEnv && *pszEnv)? (mode_t)(strtoul( pszEnv, NULL, 8 ) & 0777) : GLOBMEM_MODE;
+
+    pszEnv = getenv( "QST_GLOBMEM_DIR" );
+    snprintf( szDir, sizeof(szDir), "%s", (pszEnv && *pszEnv)? pszEnv : GLOBMEM_DIR );
+
+    // Files on hugetlbfs have to be sized (and mapped) in huge pages
+
+    tPageSize = (size_t)sysconf( _SC_PAGESIZE );
+
+    if( !bSysV && !statfs( szDir, &stFS ) && (stFS.f_type == HUGETLBFS_MAGIC) )
+        tPageSize = (size_t)stFS.f_bsize;
+
+    bConfigured = TRUE;
+}
+
+/****************************************************************************/
+/* NewDescr() - Creates a descriptor for a segment and lists it             */
+/****************************************************************************/
+
+static GLOBMEM_DESCR *NewDescr( int iShmId, int iFd, size_t tSegmentSize, U32 uSegmentId, const char *pszPath )
+{
+    GLOBMEM_DESCR *pstDescr = (GLOBMEM_DESCR *)calloc( 1, sizeof(GLOBMEM_DESCR) );
+
+    if( !pstDescr )
+    {
+        errno = ENOMEM;
+        return( NULL );
+    }
+
+    pstDescr->uSignature  = GLOBMEM_SIGNATURE;
+    pstDescr->iShmId      = iShmId;
+    pstDescr->iFd         = iFd;
+    pstDescr->tMapSize    = (tSegmentSize + tPageSize - 1) / tPageSize * tPageSize;
+    pstDescr->bPersistent = (uSegmentId & GLOBMEM_PERSISTENT) != 0;
+    pstDescr->uReferences = 1;
+
+    if( pszPath )
+        snprintf( pstDescr->szPath, sizeof(pstDescr->szPath), "%s", pszPath );
+
+    pthread_mutex_lock( &stDescrLock );
+    pstDescr->pstNextDescr = pstFirstDescr;
+    pstFirstDescr          = pstDescr;
+    pthread_mutex_unlock( &stDescrLock );
+
+    return( pstDescr );
+}
+
+/****************************************************************************/
+/* FreeDescr() - Releases a descriptor once it has no references and no     */
+/* mappings. For a file, the shared lock goes with the descriptor.          */
+/****************************************************************************/
+
+static void FreeDescr( GLOBMEM_DESCR *pstDescr )
+{
+    GLOBMEM_DESCR **ppstDescr;
+
+    if( pstDescr->uReferences || pstDescr->uMappings )
+        return;
+
+    pthread_mutex_lock( &stDescrLock );
+
+    for( ppstDescr = &pstFirstDescr; *ppstDescr; ppstDescr = &(*ppstDescr)->pstNextDescr )
+    {
+        if( *ppstDescr == pstDescr )
+        {
+            *ppstDescr = pstDescr->pstNextDescr;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock( &stDescrLock );
+
+    if( pstDescr->iFd != -1 )
+        close( pstDescr->iFd );
+
+    pstDescr->uSignature = 0;
+    free( pstDescr );
+}
+
+/****************************************************************************/
+/* SegmentPath() - Builds the name of the file for a segment                */
+/****************************************************************************/
+
+static void SegmentPath( U32 uSegmentId, char *pszPath, size_t tPathMax )
+{
+    snprintf( pszPath, tPathMax, "%s/qst-%08X", szDir, (unsigned int)uSegmentId );
+}
+
+/****************************************************************************/
+/* SameFile() - Indicates if a path still names the file open on a          */
+/* descriptor                                                               */
+/****************************************************************************/
+
+static BOOL SameFile( int iFd, const char *pszPath )
+{
+    struct stat stOpen, stNamed;
+
+    return( !fstat( iFd, &stOpen ) && !stat( pszPath, &stNamed ) &&
+            (stOpen.st_dev == stNamed.st_dev) && (stOpen.st_ino == stNamed.st_ino) );
+}
+
+/****************************************************************************/
+/* Orphaned() - Indicates if the segment file open on a descriptor has been */
+/* left behind by users that died without closing it (nobody holds a lock   */
+/* on it), in which case its name is removed                                */
+/****************************************************************************/
+
+static BOOL Orphaned( int iFd, const char *pszPath )
+{
+    if( flock( iFd, LOCK_EX | LOCK_NB ) )
+        return( FALSE );
+
+    if( SameFile( iFd, pszPath ) )
+        unlink( pszPath );
+
+    return( TRUE );
+}
+
+/****************************************************************************/
+/* RemoveOrphan() - Removes the segment file with the given name if it has  */
+/* been left behind (see Orphaned()). Returns TRUE if the name may now be   */
+/* free. Doesn't disturb errno.                                             */
+/****************************************************************************/
+
+static BOOL RemoveOrphan( const char *pszPath )
+{
+    int  iErrno = errno;
+    int  iFd;
+    BOOL bRemoved;
+
+    if( (iFd = open( pszPath, O_RDWR | O_CLOEXEC )) == -1 )
+        bRemoved = (errno == ENOENT);
+    else
+    {
+        bRemoved = Orphaned( iFd, pszPath );
+        close( iFd );
+    }
+
+    errno = iErrno;
+    return( bRemoved );
+}
+
+/****************************************************************************/
+/* RemoveUndersized() - Removes the persistent segment file with the given  */
+/* name if it is smaller than tSegmentSize (left by users that wanted less  */
+/* of it). Returns TRUE if the name may now be free. Doesn't disturb errno. */
+/****************************************************************************/
+
+static BOOL RemoveUndersized( const char *pszPath, size_t tSegmentSize )
+{
+    int         iErrno = errno;
+    struct stat stFile;
+    BOOL        bRemoved;
+
+    if( stat( pszPath, &stFile ) )
+        bRemoved = (errno == ENOENT);
+    else if( (bRemoved = ((size_t)stFile.st_size < tSegmentSize)) != FALSE )
+        unlink( pszPath );
+
+    errno = iErrno;
+    return( bRemoved );
+}
+
 /****************************************************************************/
 /*  LookupGlobMem() - Returns a handle for the global memory segment  with  */
 /*  the  specified  segment  id.  If  no segment exists with this id, NULL  */
@@ -65,18 +343,61 @@
 /*  are  used  in  the search; thus, the operation may fail if the size is  */
 /*  incorrect.                                                              */
 /*                                                                          */
-/*  On Linux, we use shmget() to determine whether a global memory segment  */
-/*  exists with the specified segment id. We add 1 to the  identifier  for  */
-/*  this  segment  (since  0 is a valid identifier) and return this as the  */
-/*  handle for our critical section. If shmget() fails, -1 is returned  as  */
-/*  the  identifier.  Adding  1  to this value yields 0 (the NULL handle),  */
-/*  which is perfect for our external needs...                              */
+/*  On Linux, we open the segment's file and take a shared lock on it (see  */
+/*  note 2). If the file was removed between the  two,  by  the  segment's  */
+/*  last user closing it, we try again. A file that nobody holds a lock on  */
+/*  has been left behind by users that died; we remove it and report  that  */
+/*  there is no segment, unless it is persistent (see note 6). As with      */
+/*  System V shared memory, a segment that is smaller than the size  given  */
+/*  isn't a match.                                                          */
 /****************************************************************************/
 
 HGLOBMEM LookupGlobMem( U32 uSegmentId, size_t tSegmentSize )
 {
-    int iShmId = shmget( (key_t)uSegmentId, tSegmentSize, 0 );
-    return( (HGLOBMEM)((long)(iShmId + 1)) );
+    char        szPath[256];
+    struct stat stFile;
+    int         iShmId, iFd, iTries;
+
+    Configure();
+
+    if( bSysV )
+    {
+        if( (iShmId = shmget( (key_t)uSegmentId, tSegmentSize, 0 )) == -1 )
+            return( NULL );
+
+        return( (HGLOBMEM)NewDescr( iShmId, -1, tSegmentSize, uSegmentId, NULL ) );
+    }
+
+    SegmentPath( uSegmentId, szPath, sizeof(szPath) );
+
+    for( iTries = 0; iTries < GLOBMEM_RETRIES; iTries++ )
+    {
+        if( (iFd = open( szPath, O_RDWR | O_CLOEXEC )) == -1 )
+            return( NULL );
+
+        if( !(uSegmentId & GLOBMEM_PERSISTENT) && Orphaned( iFd, szPath ) )
+        {
+            close( iFd );
+            continue;
+        }
+
+        if( !flock( iFd, LOCK_SH ) && SameFile( iFd, szPath ) )
+        {
+            if( fstat( iFd, &stFile ) || ((size_t)stFile.st_size < tSegmentSize) )
+            {
+                close( iFd );
+                errno = EINVAL;
+                return( NULL );
+            }
+
+            return( (HGLOBMEM)NewDescr( -1, iFd, tSegmentSize, uSegmentId, szPath ) );
+        }
+
+        close( iFd );
+    }
+
+    errno = ENOENT;
+    return( NULL );
 }
 
 /****************************************************************************/
@@ -87,25 +408,102 @@ HGLOBMEM LookupGlobMem( U32 uSegmentId, size_t tSegmentSize )
 /*  return a handle for the existing segment. If no segment exists, one is  */
 /*  created. If the creation attempt fails, the function returns NULL.      */
 /*                                                                          */
-/*  On Linux, we use shmget() to attempt the creation of the global memory  */
-/*  segment.  The  IPC_EXCL  flag  says  fail  the  request if the segment  */
-/*  already exists. If the operation  is  successful,  we  add  1  to  the  */
-/*  identifier for this segment (since 0 is a valid identifier) and return  */
-/*  this as the handle for our critical section. If the creation operation  */
-/*  fails  and  the  caller  has  not  said  we  must  create,  we  invoke  */
-/*  LookupGlobMem() to attempt the lookup of an existing segment. In  this  */
-/*  case,  we  let it establish the handle and exception code to return to  */
-/*  the caller...                                                           */
+/*  On Linux, we build the file for the segment without a name (or under a  */
+/*  temporary one, where the directory doesn't  support  O_TMPFILE),  take  */
+/*  the shared lock and size it, then link it under the segment's name. If  */
+/*  a segment left behind by users that died has the name,  we  remove  it  */
+/*  and link again (a persistent segment is only  removed  if  it  is  too  */
+/*  small for us). If another process got there first, the link fails  and  */
+/*  we either report EEXIST or, if the caller hasn't said we must  create,  */
+/*  we invoke LookupGlobMem() to establish the handle and  error  code  to  */
+/*  return.                                                                 */
 /****************************************************************************/
 
 HGLOBMEM CreateGlobMem( U32 uSegmentId, size_t tSegmentSize, BOOL bMustCreate )
 {
-    int  iShmId = shmget( (key_t)uSegmentId, tSegmentSize, IPC_CREAT | IPC_EXCL | 0666 );
+    GLOBMEM_DESCR   *pstDescr;
+    char            szPath[256], szTemp[280], szProc[40];
+    int             iShmId, iFd, iErrno, iTries;
+    BOOL            bLinked;
+
+    Configure();
+
+    if( bSysV )
+    {
+        iShmId = shmget( (key_t)uSegmentId, tSegmentSize, IPC_CREAT | IPC_EXCL | (bHugePages? SHM_HUGETLB : 0) | tMode );
+
+        if( (iShmId == -1) && bHugePages && (errno != EEXIST) )
+            iShmId = shmget( (key_t)uSegmentId, tSegmentSize, IPC_CREAT | IPC_EXCL | tMode );
+
+        if( iShmId != -1 )
+            return( (HGLOBMEM)NewDescr( iShmId, -1, tSegmentSize, uSegmentId, NULL ) );
 
-    if( iShmId != -1 )
-        return( (HGLOBMEM)((long)(iShmId + 1)) );
-    else
         return( (bMustCreate)? NULL : LookupGlobMem( uSegmentId, tSegmentSize ) );
+    }
+
+    SegmentPath( uSegmentId, szPath, sizeof(szPath) );
+    szTemp[0] = '\0';
+
+    if( (iFd = open( szDir, O_TMPFILE | O_RDWR | O_CLOEXEC, tMode )) == -1 )
+    {
+        snprintf( szTemp, sizeof(szTemp), "%s.%d", szPath, (int)getpid() );
+
+        if( (iFd = open( szTemp, O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, tMode )) == -1 )
+            return( NULL );
+    }
+
+    // Set permissions exactly (umask applies to open()), lock and size it,
+    // then give it its name, replacing a segment left behind by users that
+    // died
+
+    if(    fchmod( iFd, tMode )
+        || flock( iFd, LOCK_SH )
+        || ftruncate( iFd, (off_t)((tSegmentSize + tPageSize - 1) / tPageSize * tPageSize) ) )
+    {
+        bLinked = FALSE;
+    }
+    else
+    {
+        snprintf( szProc, sizeof(szProc), "/proc/self/fd/%d", iFd );
+
+        for( iTries = 0; ; iTries++ )
+        {
+            if( szTemp[0] )
+                bLinked = !link( szTemp, szPath );
+            else
+                bLinked = !linkat( AT_FDCWD, szProc, AT_FDCWD, szPath, AT_SYMLINK_FOLLOW );
+
+            if( bLinked || (errno != EEXIST) || (iTries == GLOBMEM_RETRIES) )
+                break;
+
+            if( !((uSegmentId & GLOBMEM_PERSISTENT)? RemoveUndersized( szPath, tSegmentSize ) : RemoveOrphan( szPath )) )
+                break;
+        }
+    }
+
+    iErrno = errno;
+
+    if( szTemp[0] )
+        unlink( szTemp );
+
+    if( bLinked )
+    {
+        if( (pstDescr = NewDescr( -1, iFd, tSegmentSize, uSegmentId, szPath )) == NULL )
+        {
+            unlink( szPath );
+            close( iFd );
+        }
+
+        return( (HGLOBMEM)pstDescr );
+    }
+
+    close( iFd );
+    errno = iErrno;
+
+    if( (iErrno != EEXIST) || bMustCreate )
+        return( NULL );
+
+    return( LookupGlobMem( uSegmentId, tSegmentSize ) );
 }
 
 /****************************************************************************/
@@ -113,17 +511,43 @@ HGLOBMEM CreateGlobMem( U32 uSegmentId, size_t tSegmentSize, BOOL bMustCreate )
 /*  this is the last handle to the global memory segment, the segment will  */
 /*  be deleted. The function returns a boolean success indicator.           */
 /*                                                                          */
-/*  On Linux, we use shmctl() to validate the handle and to indicate  that  */
-/*  the  segment  can  be  deleted  when  its  last  attachment is removed  */
-/*  (unmapped). We do not remove the attachment for this process, however;  */
-/*  we don't have the pointer with which to do so and  the  caller  should  */
-/*  have already done this before calling us anyway.                        */
+/*  On Linux, for a file, we try to trade our shared lock for an exclusive  */
+/*  one. Only the last user can have it, and it removes the segment's name  */
+/*  (if that still refers to this segment); the memory goes once the  last  */
+/*  mapping is removed. For a System V segment, we use  shmctl()  to  mark  */
+/*  the  segment  for  deletion  once  its  last  attachment  is   removed  */
+/*  (unmapped), as this module always has. Persistent segments  (see  note  */
+/*  6) are left as they are.                                                */
 /****************************************************************************/
 
 BOOL CloseGlobMem( HGLOBMEM hSegment )
 {
-    int iShmId = (int)(*((long*)&hSegment)) - 1;
-    return( shmctl( iShmId, IPC_RMID, NULL ) != -1 );
+    GLOBMEM_DESCR *pstDescr = (GLOBMEM_DESCR *)hSegment;
+    BOOL          bSuccess  = TRUE;
+
+    if( !pstDescr || (pstDescr->uSignature != GLOBMEM_SIGNATURE) || !pstDescr->uReferences )
+    {
+        errno = EINVAL;
+        return( FALSE );
+    }
+
+    if( pstDescr->iFd == -1 )
+    {
+        if( !pstDescr->bPersistent )
+            bSuccess = (shmctl( pstDescr->iShmId, IPC_RMID, NULL ) != -1);
+    }
+    else if( !pstDescr->bPersistent && !flock( pstDescr->iFd, LOCK_EX | LOCK_NB ) )
+    {
+        if( SameFile( pstDescr->iFd, pstDescr->szPath ) )
+            unlink( pstDescr->szPath );
+
+        flock( pstDescr->iFd, LOCK_SH );
+    }
+
+    pstDescr->uReferences--;
+    FreeDescr( pstDescr );
+
+    return( bSuccess );
 }
 
 /****************************************************************************/
@@ -132,13 +556,60 @@ BOOL CloseGlobMem( HGLOBMEM hSegment )
 /*  base of the area assigned to the segment is returned. If anything goes  */
 /*  wrong during the attempt, NULL is returned.                             */
 /*                                                                          */
-/*  On Linux, we use shmat() to map the segment...                          */
+/*  On Linux, we map a file with mmap(), prefaulted (see note  3),  and  a  */
+/*  System V segment with shmat(). A handle is  mapped  once;  mapping  it  */
+/*  again returns the same address.                                         */
 /****************************************************************************/
 
 void *MapGlobMem( HGLOBMEM hSegment )
 {
-    int iShmId = (int)(*((long*)&hSegment)) - 1;
-    return( (void *)shmat( iShmId, NULL, 0 ) );
+    GLOBMEM_DESCR *pstDescr = (GLOBMEM_DESCR *)hSegment;
+    void          *pvSegment;
+    size_t        tOffset;
+
+    if( !pstDescr || (pstDescr->uSignature != GLOBMEM_SIGNATURE) )
+    {
+        errno = EINVAL;
+        return( NULL );
+    }
+
+    if( pstDescr->uMappings )
+    {
+        pstDescr->uMappings++;
+        return( pstDescr->pvMapping );
+    }
+
+    if( pstDescr->iFd == -1 )
+    {
+        if( (pvSegment = shmat( pstDescr->iShmId, NULL, 0 )) == (void *)-1 )
+            return( NULL );
+    }
+    else if( !bHugePages )
+    {
+        pvSegment = mmap( NULL, pstDescr->tMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, pstDescr->iFd, 0 );
+
+        if( pvSegment == MAP_FAILED )
+            return( NULL );
+    }
+    else
+    {
+        // Huge pages have to be asked for before the mapping is populated
+
+        pvSegment = mmap( NULL, pstDescr->tMapSize, PROT_READ | PROT_WRITE, MAP_SHARED, pstDescr->iFd, 0 );
+
+        if( pvSegment == MAP_FAILED )
+            return( NULL );
+
+        madvise( pvSegment, pstDescr->tMapSize, MADV_HUGEPAGE );
+
+        for( tOffset = 0; tOffset < pstDescr->tMapSize; tOffset += (size_t)sysconf( _SC_PAGESIZE ) )
+            ((volatile char *)pvSegment)[tOffset];
+    }
+
+    pstDescr->pvMapping = pvSegment;
+    pstDescr->uMappings = 1;
+
+    return( pvSegment );
 }
 
 /****************************************************************************/
@@ -147,11 +618,40 @@ void *MapGlobMem( HGLOBMEM hSegment )
 /*  process,  the  segment  will  be  unmapped  from  the calling process'  */
 /*  address space. The function returns a boolean success indicator.        */
 /*                                                                          */
-/*  On Linux, we use shmdt() to unmap the segment...                        */
+/*  On Linux, we find the descriptor for the mapping and, once it  has  no  */
+/*  more mappings, unmap it with munmap() or shmdt() as appropriate.        */
 /****************************************************************************/
 
 BOOL UnmapGlobMem( void *pvSegment )
 {
-    return( shmdt( pvSegment ) != -1 );
+    GLOBMEM_DESCR *pstDescr;
+    BOOL          bSuccess;
+
+    pthread_mutex_lock( &stDescrLock );
+
+    for( pstDescr = pstFirstDescr; pstDescr; pstDescr = pstDescr->pstNextDescr )
+        if( pstDescr->uMappings && (pstDescr->pvMapping == pvSegment) )
+            break;
+
+    pthread_mutex_unlock( &stDescrLock );
+
+    if( !pstDescr )
+    {
+        errno = EINVAL;
+        return( FALSE );
+    }
+
+    if( --pstDescr->uMappings )
+        return( TRUE );
+
+    if( pstDescr->iFd == -1 )
+        bSuccess = (shmdt( pvSegment ) != -1);
+    else
+        bSuccess = (munmap( pvSegment, pstDescr->tMapSize ) != -1);
+
+    pstDescr->pvMapping = NULL;
+    FreeDescr( pstDescr );
+
+    return( bSuccess );
 }
 
@@ -0,0 +1,1446 @@
+/****************************************************************************/
+/*                                                                          */
+/*  Module:         HeciPipe.c                                              */
+/*                                                                          */
+/*  Description:    Implements the Linux HECI transaction engine.  Threads  */
+/*                  submit command packets into a queue. The  thread  that  */
+/*                  finds nobody driving the transport becomes the  "pump"  */
+/*                  and posts queued commands to the  ME  Subsystem  while  */
+/*                  earlier responses are still on their way  back.  Since  */
+/*                  the QST Subsystem handles commands strictly in  order,  */
+/*                  responses are matched  to  their  submitters  in  FIFO  */
+/*                  order.                                                  */
+/*                                                                          */
+/*  Notes:      1.  The cross-process access operation (pfnEnter) is  held  */
+/*                  for a batch of transactions rather than for each  one.  */
+/*                  It is never  released  while  transactions  are  still  */
+/*                  outstanding, since another process would otherwise  be  */
+/*                  able to read our responses.                             */
+/*                                                                          */
+/*              2.  When the pump's own transaction  completes,  it  hands  */
+/*                  the pump role to the owner of the  oldest  transaction  */
+/*                  that is still outstanding (or queued). All threads  of  */
+/*                  the process  therefore  share  a  single  use  of  the  */
+/*                  transport.                                              */
+/*                                                                          */
+/*              3.  An outstanding depth of one reproduces  the  previous,  */
+/*                  strictly serialized, behavior.                          */
+/*                                                                          */
+/*              4.  A  transaction  may  be  given  a  deadline.  A  timed  */
+/*                  transaction's  response  is  received  into  a  buffer  */
+/*                  belonging to the engine and copied  to  the  submitter  */
+/*                  only on completion, so the submitter can  abandon  the  */
+/*                  transaction when its deadline passes,  whether  it  is  */
+/*                  still queued or already posted.  The  engine  discards  */
+/*                  the responses of abandoned transactions. If  a  pump's  */
+/*                  own deadline passes, it hands the pump role to another  */
+/*                  waiting thread; if there is  none,  the  transport  is  */
+/*                  detached (discarding any responses still to  come)  so  */
+/*                  that it is clean for the next transaction.              */
+/*                                                                          */
+/*              5.  A  set  of  transactions  may  be  submitted  together  */
+/*                  (HeciPipeTransactBatch()). They  are  queued  back  to  */
+/*                  back, so they  share  the  pump  and  a  cross-process  */
+/*                  access and are kept in flight together.                 */
+/*                                                                          */
+/*              6.  Transactions may also be submitted  asynchronously  by  */
+/*                  an event loop. These are pumped without blocking, from  */
+/*                  HeciPipeSubmit() and HeciPipeProcess(), and never hold  */
+/*                  the pump while a response is awaited; the engine's own  */
+/*                  epoll  descriptor  (which  contains  the  transport's)  */
+/*                  tells the loop when to call HeciPipeProcess() again. A  */
+/*                  thread  that  is  pumping  for  its  own   transaction  */
+/*                  completes asynchronous  transactions  along  the  way.  */
+/*                  Responses are awaited with  the  cross-process  access  */
+/*                  held, so the loop must call HeciPipeProcess() promptly  */
+/*                  whenever the descriptor is readable. If it hasn't done  */
+/*                  so PIPE_HOLD milliseconds after  the  oldest  response  */
+/*                  was  due,  a  watchdog   thread   fails   the   posted  */
+/*                  transactions (with ETIMEDOUT) and releases the access,  */
+/*                  so that a stalled loop can't shut other processes out.  */
+/*                                                                          */
+/****************************************************************************/
+
+/****************************************************************************/
+/*                                                                          */
+/*     Copyright (c) 2005-2009, Intel Corporation. All Rights Reserved.     */
+/*                                                                          */
+/*  Redistribution and use in source and binary  forms,  with  or  without  */
+/*  modification, are permitted provided that the following conditions are  */
+/*  met:                                                                    */
+/*                                                                          */
+/*    - Redistributions of source code must  retain  the  above  copyright  */
+/*      notice, this list of conditions and the following disclaimer.       */
+/*                                                                          */
+/*    - Redistributions  in binary form must reproduce the above copyright  */
+/*      notice, this list of conditions and the  following  disclaimer  in  */
+/*      the   documentation  and/or  other  materials  provided  with  the  */
+/*      distribution.                                                       */
+/*                                                                          */
+/*    - Neither the name  of  Intel  Corporation  nor  the  names  of  its  */
+/*      contributors  may  be  used to endorse or promote products derived  */
+/*      from this software without specific prior written permission.       */
+/*                                                                          */
+/*  DISCLAIMER: THIS SOFTWARE IS PROVIDED BY  THE  COPYRIGHT  HOLDERS  AND  */
+/*  CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  */
+/*  BUT  NOT  LIMITED  TO,  THE  IMPLIED WARRANTIES OF MERCHANTABILITY AND  */
+/*  FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN  NO  EVENT  SHALL  */
+/*  INTEL  CORPORATION  OR  THE  CONTRIBUTORS  BE  LIABLE  FOR ANY DIRECT,  */
+/*  INDIRECT, INCIDENTAL, SPECIAL,  EXEMPLARY,  OR  CONSEQUENTIAL  DAMAGES  */
+/*  (INCLUDING,  BUT  NOT  LIMITED  TO, PROCUREMENT OF SUBSTITUTE GOODS OR  */
+/*  SERVICES; LOSS OF USE, DATA, OR  PROFITS;  OR  BUSINESS  INTERRUPTION)  */
+/*  HOWEVER  CAUSED  AND  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,  */
+/*  STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)  ARISING  */
+/*  IN  ANY  WAY  OUT  OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE  */
+/*  POSSIBILITY OF SUCH DAMAGE.                                             */
+/*                                                                          */
+/****************************************************************************/
+
+#ifndef __linux__
+#error This source module intended for use in Linux environments only
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+#include "HeciPipe.h"
+
+/****************************************************************************/
+/* Configuration                                                            */
+/****************************************************************************/
+
+#define PIPE_BATCH      64              // Transactions posted per cross-process access
+#define PIPE_RETRY      2               // Asynchronous access/poll retry delay (milliseconds)
+#define PIPE_HOLD       1000            // Grace given an event loop holding access (milliseconds)
+
+/****************************************************************************/
+/* HECI_TXN - Describes a single transaction. These live on the stack of    */
+/* the submitting thread, which waits until the transaction completes, or   */
+/* (if submitted asynchronously) in the engine's pool.                      */
+/****************************************************************************/
+
+typedef struct _HECI_TXN
+{
+    struct _HECI_TXN    *pstNext;       // Next queued (or completed asynchronous) transaction
+    pthread_cond_t      stDone;         // Signalled on completion or pump handoff
+    void                *pvCmdBuf;      // Command packet
+    size_t              tCmdSize;       // Size of command packet
+    void                *pvRspBuf;      // Buffer for response packet
+    size_t              tRspSize;       // Expected size of response packet
+    uint64_t            uDeadline;      // Time by which to complete (0 if none)
+    int                 iSlot;          // Index in flight ring (-1 if not posted)
+    int                 iResult;        // Bytes received or -1
+    int                 iErrno;         // errno value when failed
+    BOOL                bGiveUp;        // Retrying won't help
+    BOOL                bDone;          // Transaction has completed
+    BOOL                bAsync;         // Submitted asynchronously
+    HECI_PIPE_DONE      pfnDone;        // Completion function (asynchronous only)
+    void                *pvTag;         // Passed to completion function
+
+} HECI_TXN;
+
+/****************************************************************************/
+/* HECI_REPORT - Completion of an asynchronous transaction, to be reported  */
+/****************************************************************************/
+
+typedef struct _HECI_REPORT
+{
+    HECI_PIPE_DONE      pfnDone;        // Completion function
+    void                *pvTag;         // Passed to completion function
+    int                 iResult;        // Bytes received or -1
+    int                 iErrno;         // errno value when failed
+
+} HECI_REPORT;
+
+/****************************************************************************/
+/* Process-Specific Variables                                               */
+/****************************************************************************/
+
+static pthread_mutex_t  stPipeLock = PTHREAD_MUTEX_INITIALIZER;
+
+static HECI_PIPE_OPS    stOps;          // Transport operations
+static int              iPipeDepth;     // Maximum outstanding transactions
+static int              iWaitTimeout;   // Response timeout (milliseconds)
+
+static HECI_TXN *       pstQueueHead;   // Submitted transactions, not yet posted
+static HECI_TXN *       pstQueueTail;
+
+static HECI_TXN *       apstFlight[HECI_PIPE_MAX_DEPTH];
+                                        // Posted transactions, awaiting response
+static int              iFlightHead;    // Index of oldest posted transaction
+static int              iFlightCount;   // Number of posted transactions
+
+static BOOL             bPumping;       // A thread is driving the transport
+static BOOL             bEntered;       // Cross-process access held
+static BOOL             bAttached;      // Transport attached
+static int              iMaxPacket;     // Maximum packet size for transport
+static int              iBatch;         // Posted during current access
+
+static UINT8 *          pbySlotBuff;    // Response buffers for timed transactions
+static int              iSlotSize;      // Size of each response buffer
+static uint64_t         uHeadSince;     // When oldest posted transaction became oldest
+
+static HECI_TXN         astAsync[HECI_PIPE_MAX_ASYNC];
+                                        // Pool of asynchronous transactions
+static HECI_TXN *       pstAsyncFree;   // Unused asynchronous transactions
+static int              iAsyncCount;    // Asynchronous transactions not yet completed
+static HECI_TXN *       pstDoneHead;    // Completed asynchronous transactions, not
+static HECI_TXN *       pstDoneTail;    // yet reported
+
+static int              iPollFD = -1;   // epoll set for asynchronous operation
+static int              iKickFD = -1;   // eventfd signalled when there's work
+static int              iTimerFD = -1;  // timerfd for retries and response timeouts
+static int              iWatchFD = -1;  // Transport descriptor in epoll set (or -1)
+
+static pthread_t        stWatchdog;     // Thread bounding access left held for event loop
+static pthread_cond_t   stWatchdogWake; // Signalled when uHoldUntil is set
+static pid_t            iWatchdogPid;   // Process that started watchdog (0 if none)
+static BOOL             bWatchdogStop;  // Watchdog is to exit
+static uint64_t         uHoldUntil;     // When access left held is taken back (0 if not)
+
+/****************************************************************************/
+/* HeciPipeNow() - Returns the (monotonic) time, in milliseconds, against   */
+/* which deadlines are measured.                                            */
+/****************************************************************************/
+
+uint64_t HeciPipeNow( void )
+{
+    struct timespec stTime;
+
+    clock_gettime( CLOCK_MONOTONIC, &stTime );
+    return( (uint64_t)stTime.tv_sec * 1000 + stTime.tv_nsec / 1000000 );
+}
+
+/****************************************************************************/
+/* Remaining() - Returns the time (milliseconds) remaining before a         */
+/* transaction's deadline, or -1 if it has none.                            */
+/****************************************************************************/
+
+static int Remaining( HECI_TXN *pstTxn )
+{
+    uint64_t uNow;
+
+    if( !pstTxn->uDeadline )
+        return( -1 );
+
+    uNow = HeciPipeNow();
+
+    return( (uNow >= pstTxn->uDeadline)? 0 : (int)(pstTxn->uDeadline - uNow) );
+}
+
+/****************************************************************************/
+/* Kick() - Makes the engine's descriptor readable, so the event loop calls */
+/* HeciPipeProcess().                                                       */
+/****************************************************************************/
+
+static void Kick( void )
+{
+    uint64_t uOne = 1;
+
+    if( iKickFD != -1 )
+        while( (write( iKickFD, &uOne, sizeof(uOne) ) < 0) && (errno == EINTR) );
+}
+
+/****************************************************************************/
+/* ArmTimer() - Makes the engine's descriptor readable at the specified     */
+/* time (see HeciPipeNow()), or never if it is 0.                           */
+/****************************************************************************/
+
+static void ArmTimer( uint64_t uWhen )
+{
+    struct itimerspec stTimer;
+
+    memset( &stTimer, 0, sizeof(stTimer) );
+
+    stTimer.it_value.tv_sec  = (time_t)(uWhen / 1000);
+    stTimer.it_value.tv_nsec = (long)(uWhen % 1000) * 1000000L;
+
+    if( iTimerFD != -1 )
+        timerfd_settime( iTimerFD, TFD_TIMER_ABSTIME, &stTimer, NULL );
+}
+
+/****************************************************************************/
+/* Watch() - Adds the transport's descriptor to (or removes it from) the    */
+/* engine's epoll set, so that the arrival of a response makes the engine's */
+/* descriptor readable. Called with engine lock held.                       */
+/****************************************************************************/
+
+static void Watch( BOOL bWatch )
+{
+    struct epoll_event stEvent;
+    int                iFD;
+
+    if( iPollFD == -1 )
+        return;
+
+    iFD = (bWatch && bAttached && stOps.pfnGetFD)? stOps.pfnGetFD() : -1;
+
+    if( iFD == iWatchFD )
+        return;
+
+    if( iWatchFD != -1 )
+        epoll_ctl( iPollFD, EPOLL_CTL_DEL, iWatchFD, NULL );
+
+    iWatchFD = -1;
+
+    if( iFD != -1 )
+    {
+        memset( &stEvent, 0, sizeof(stEvent) );
+        stEvent.events  = EPOLLIN;
+        stEvent.data.fd = iFD;
+
+        if( !epoll_ctl( iPollFD, EPOLL_CTL_ADD, iFD, &stEvent ) )
+            iWatchFD = iFD;
+    }
+}
+
+/****************************************************************************/
+/* Detach() - Detaches from the transport. Called with engine lock held.    */
+/****************************************************************************/
+
+static void Detach( void )
+{
+    Watch( FALSE );
+    stOps.pfnDetach();
+    bAttached = FALSE;
+}
+
+/****************************************************************************/
+/* Complete() - Completes a transaction and wakes its submitter. Completed  */
+/* asynchronous transactions are kept for HeciPipeProcess() to report.      */
+/* Called with the engine lock held.                                        */
+/****************************************************************************/
+
+static void Complete( HECI_TXN *pstTxn, int iResult, int iErrno, BOOL bGiveUp )
+{
+    pstTxn->iResult = iResult;
+    pstTxn->iErrno  = iErrno;
+    pstTxn->bGiveUp = bGiveUp;
+    pstTxn->bDone   = TRUE;
+
+    if( !pstTxn->bAsync )
+    {
+        pthread_cond_signal( &pstTxn->stDone );
+        return;
+    }
+
+    pstTxn->pstNext = NULL;
+
+    if( pstDoneTail )
+        pstDoneTail->pstNext = pstTxn;
+    else
+        pstDoneHead = pstTxn;
+
+    pstDoneTail = pstTxn;
+    iAsyncCount--;
+
+    Kick();
+}
+
+/****************************************************************************/
+/* FailQueued() - Fails all transactions that haven't been posted yet.      */
+/****************************************************************************/
+
+static void FailQueued( int iErrno, BOOL bGiveUp )
+{
+    HECI_TXN *pstTxn;
+
+    while( pstQueueHead )
+    {
+        pstTxn       = pstQueueHead;
+        pstQueueHead = pstTxn->pstNext;
+
+        Complete( pstTxn, -1, iErrno, bGiveUp );
+    }
+
+    pstQueueTail = NULL;
+}
+
+/****************************************************************************/
+/* FailFlight() - Fails all posted transactions. Since we can no longer say */
+/* which response belongs to whom, the transport is detached so it will be  */
+/* reattached (in a clean state) for the next transaction.                  */
+/****************************************************************************/
+
+static void FailFlight( int iErrno )
+{
+    while( iFlightCount )
+    {
+        if( apstFlight[iFlightHead] )
+            Complete( apstFlight[iFlightHead], -1, iErrno, FALSE );
+
+        iFlightHead = (iFlightHead + 1) % HECI_PIPE_MAX_DEPTH;
+        iFlightCount--;
+    }
+
+    if( bAttached )
+        Detach();
+}
+
+/****************************************************************************/
+/* Leave() - Releases cross-process access. Called with engine lock held.   */
+/****************************************************************************/
+
+static void Leave( void )
+{
+    bEntered = FALSE;
+
+    if( stOps.pfnLeave )
+    {
+        pthread_mutex_unlock( &stPipeLock );
+        stOps.pfnLeave();
+        pthread_mutex_lock( &stPipeLock );
+    }
+}
+
+/****************************************************************************/
+/* Abandon() - Withdraws a timed transaction whose deadline has passed. If  */
+/* it has been posted, its slot in the flight ring is emptied so that its   */
+/* response will be discarded.                                              */
+/****************************************************************************/
+
+static void Abandon( HECI_TXN *pstTxn )
+{
+    HECI_TXN *pstScan, *pstPrev = NULL;
+
+    if( pstTxn->iSlot >= 0 )
+        apstFlight[pstTxn->iSlot] = NULL;
+    else
+    {
+        for( pstScan = pstQueueHead; pstScan && (pstScan != pstTxn); pstScan = pstScan->pstNext )
+            pstPrev = pstScan;
+
+        if( pstScan )
+        {
+            if( pstPrev )
+                pstPrev->pstNext = pstTxn->pstNext;
+            else
+                pstQueueHead = pstTxn->pstNext;
+
+            if( pstQueueTail == pstTxn )
+                pstQueueTail = pstPrev;
+        }
+    }
+
+    Complete( pstTxn, -1, ETIMEDOUT, FALSE );
+}
+
+/****************************************************************************/
+/* WakeWaiter() - Wakes the thread waiting for the oldest transaction that  */
+/* is still outstanding (or queued) to take over the pump. Returns FALSE if */
+/* there is no such thread. Called with engine lock held.                   */
+/****************************************************************************/
+
+static BOOL WakeWaiter( void )
+{
+    HECI_TXN *pstTxn;
+    int      iIndex;
+
+    for( iIndex = 0; iIndex < iFlightCount; iIndex++ )
+    {
+        pstTxn = apstFlight[(iFlightHead + iIndex) % HECI_PIPE_MAX_DEPTH];
+
+        if( pstTxn && !pstTxn->bAsync )
+        {
+            pthread_cond_signal( &pstTxn->stDone );
+            return( TRUE );
+        }
+    }
+
+    for( pstTxn = pstQueueHead; pstTxn; pstTxn = pstTxn->pstNext )
+    {
+        if( !pstTxn->bAsync )
+        {
+            pthread_cond_signal( &pstTxn->stDone );
+            return( TRUE );
+        }
+    }
+
+    return( FALSE );
+}
+
+/****************************************************************************/
+/* Watchdog() - Takes back cross-process access that the event loop has     */
+/* left held for too long (see HoldForLoop()), failing the transactions     */
+/* posted under it, so that a stalled loop can't shut other processes out.  */
+/****************************************************************************/
+
+static void *Watchdog( void *pvArg )
+{
+    struct timespec         stUntil;
+
+    pthread_mutex_lock( &stPipeLock );
+
+    while( !bWatchdogStop )
+    {
+        if( !uHoldUntil )
+            pthread_cond_wait( &stWatchdogWake, &stPipeLock );
+        else if( HeciPipeNow() < uHoldUntil )
+        {
+            stUntil.tv_sec  = (time_t)(uHoldUntil / 1000);
+            stUntil.tv_nsec = (long)(uHoldUntil % 1000) * 1000000L;
+
+            pthread_cond_timedwait( &stWatchdogWake, &stPipeLock, &stUntil );
+        }
+        else
+        {
+            uHoldUntil = 0;
+
+            // Nothing to do if a thread is driving the transport again.
+            // Otherwise, once posted transactions have failed, a waiting
+            // thread may carry on with access; if there is none, leave
+
+            if( !bPumping && bEntered && iFlightCount )
+            {
+                bPumping = TRUE;
+                FailFlight( ETIMEDOUT );
+
+                if( !WakeWaiter() )
+                {
+                    Leave();
+
+                    if( iAsyncCount )
+                        Kick();
+                }
+
+                bPumping = FALSE;
+            }
+        }
+    }
+
+    pthread_mutex_unlock( &stPipeLock );
+    return( pvArg );
+}
+
+/****************************************************************************/
+/* HoldForLoop() - Called when the engine stops being driven while it holds */
+/* cross-process access, awaiting responses that the event loop is to       */
+/* collect. The loop is expected back by the time the oldest response is    */
+/* due (when the engine's descriptor becomes readable regardless); if it    */
+/* hasn't called HeciPipeProcess() PIPE_HOLD milliseconds after that, the   */
+/* watchdog takes access back. Called with engine lock held.                */
+/****************************************************************************/
+
+static void HoldForLoop( void )
+{
+    pthread_condattr_t      stAttr;
+    uint64_t                uNow = HeciPipeNow();
+    uint64_t                uDue = (iWaitTimeout >= 0)? uHeadSince + iWaitTimeout : 0;
+
+    // Start the watchdog on first use (in this process, if we've forked)
+
+    if( iWatchdogPid != getpid() )
+    {
+        pthread_condattr_init( &stAttr );
+        pthread_condattr_setclock( &stAttr, CLOCK_MONOTONIC );
+        pthread_cond_init( &stWatchdogWake, &stAttr );
+        pthread_condattr_destroy( &stAttr );
+
+        if( pthread_create( &stWatchdog, NULL, Watchdog, NULL ) )
+        {
+            pthread_cond_destroy( &stWatchdogWake );
+            return;
+        }
+
+        iWatchdogPid = getpid();
+    }
+
+    uHoldUntil = ((uDue > uNow)? uDue : uNow) + PIPE_HOLD;
+    pthread_cond_signal( &stWatchdogWake );
+}
+
+/****************************************************************************/
+/* HandOff() - Called when the pump stops. If any thread is waiting, the    */
+/* pump role is handed to it. If only asynchronous transactions remain, the */
+/* event loop is kicked to continue with them. Otherwise, the transport is  */
+/* detached if abandoned transactions are still outstanding and other       */
+/* processes are given access. Called with engine lock held.                */
+/****************************************************************************/
+
+static void HandOff( void )
+{
+    if( WakeWaiter() )
+        return;
+
+    if( iAsyncCount )
+    {
+        if( !iFlightCount && bEntered )
+            Leave();
+
+        if( bEntered )
+            HoldForLoop();
+
+        Kick();
+        return;
+    }
+
+    if( iFlightCount )
+        FailFlight( ETIMEDOUT );
+
+    if( bEntered )
+        Leave();
+}
+
+/****************************************************************************/
+/* Attach() - Attaches to the transport and makes sure the response buffers */
+/* for timed transactions are big enough for its packets. Returns FALSE     */
+/* (with errno set) on failure. Called with the engine lock held.           */
+/****************************************************************************/
+
+static BOOL Attach( int iTimeout )
+{
+    int iLen, iErrno;
+
+    pthread_mutex_unlock( &stPipeLock );
+    iLen   = stOps.pfnAttach( iTimeout );
+    iErrno = errno;
+    pthread_mutex_lock( &stPipeLock );
+
+    if( iLen <= 0 )
+    {
+        errno = iErrno;
+        return( FALSE );
+    }
+
+    bAttached  = TRUE;
+    iMaxPacket = iLen;
+
+    if( iSlotSize < iMaxPacket )
+    {
+        free( pbySlotBuff );
+
+        pbySlotBuff = (UINT8 *)malloc( (size_t)iMaxPacket * HECI_PIPE_MAX_DEPTH );
+        iSlotSize   = pbySlotBuff? iMaxPacket : 0;
+
+        if( !pbySlotBuff )
+        {
+            Detach();
+            errno = ENOMEM;
+            return( FALSE );
+        }
+    }
+
+    return( TRUE );
+}
+
+/****************************************************************************/
+/* PostQueued() - Posts queued commands while there's room in the window    */
+/* and the current batch isn't used up. Called with engine lock held.       */
+/****************************************************************************/
+
+static void PostQueued( void )
+{
+    HECI_TXN                *pstTxn;
+    int                     iErrno;
+    BOOL                    bOK;
+
+    while( pstQueueHead && (iFlightCount < iPipeDepth) && (iBatch < PIPE_BATCH) )
+    {
+        pstTxn       = pstQueueHead;
+        pstQueueHead = pstTxn->pstNext;
+
+        if( !pstQueueHead )
+            pstQueueTail = NULL;
+
+        if( (pstTxn->tCmdSize > iMaxPacket) || (pstTxn->tRspSize > iMaxPacket) )
+        {
+            // wants to send/receive more than can be supported...
+
+            Complete( pstTxn, -1, ERANGE, TRUE );
+            continue;
+        }
+
+        iBatch++;
+
+        pthread_mutex_unlock( &stPipeLock );
+        bOK    = stOps.pfnPost( pstTxn->pvCmdBuf, pstTxn->tCmdSize );
+        iErrno = errno;
+        pthread_mutex_lock( &stPipeLock );
+
+        if( !bOK )
+        {
+            Complete( pstTxn, -1, iErrno, FALSE );
+            FailFlight( iErrno );
+            break;
+        }
+
+        // If no response is expected, transaction is already done
+
+        if( pstTxn->tRspSize == 0 )
+            Complete( pstTxn, 0, 0, FALSE );
+        else
+        {
+            if( !iFlightCount )
+                uHeadSince = HeciPipeNow();
+
+            pstTxn->iSlot = (iFlightHead + iFlightCount) % HECI_PIPE_MAX_DEPTH;
+            apstFlight[pstTxn->iSlot] = pstTxn;
+            iFlightCount++;
+        }
+    }
+}
+
+/****************************************************************************/
+/* ReceiveNext() - Waits up to iWait milliseconds for the oldest response   */
+/* and completes its transaction. An untimed transaction's response goes    */
+/* directly into its submitter's buffer; others (including those abandoned) */
+/* go into the slot's own buffer. Returns 1 if a response was received, 0   */
+/* if the wait failed (with errno set) and -1 if receiving failed (in which */
+/* case posted transactions have been failed). Called with engine lock      */
+/* held.                                                                    */
+/****************************************************************************/
+
+static int ReceiveNext( int iWait )
+{
+    HECI_TXN                *pstTxn;
+    UINT8                   *pbyInto;
+    size_t                  tInto;
+    int                     iLen = -1, iErrno, iSlot;
+    BOOL                    bWaited;
+
+    iSlot  = iFlightHead;
+    pstTxn = apstFlight[iSlot];
+
+    if( pstTxn && !pstTxn->uDeadline )
+    {
+        pbyInto = (UINT8 *)pstTxn->pvRspBuf;
+        tInto   = pstTxn->tRspSize;
+    }
+    else
+    {
+        pbyInto = pbySlotBuff + (size_t)iSlot * iSlotSize;
+        tInto   = (size_t)iSlotSize;
+    }
+
+    pthread_mutex_unlock( &stPipeLock );
+
+    bWaited = (!stOps.pfnWait || stOps.pfnWait( iWait ));
+
+    if( bWaited )
+        iLen = stOps.pfnReceive( pbyInto, tInto );
+
+    iErrno = errno;
+    pthread_mutex_lock( &stPipeLock );
+
+    if( !bWaited )
+    {
+        errno = iErrno;
+        return( 0 );
+    }
+
+    if( iLen < 0 )
+    {
+        FailFlight( iErrno );
+        return( -1 );
+    }
+
+    // Submitter may have abandoned the transaction while we received
+
+    pstTxn = apstFlight[iSlot];
+
+    iFlightHead = (iFlightHead + 1) % HECI_PIPE_MAX_DEPTH;
+    iFlightCount--;
+    uHeadSince  = HeciPipeNow();
+
+    if( !pstTxn )
+        return( 1 );
+
+    if( pbyInto != (UINT8 *)pstTxn->pvRspBuf )
+    {
+        if( iLen > pstTxn->tRspSize )
+        {
+            Complete( pstTxn, -1, ENOSPC, FALSE );
+            return( 1 );
+        }
+
+        memcpy( pstTxn->pvRspBuf, pbyInto, iLen );
+    }
+
+    Complete( pstTxn, iLen, 0, FALSE );
+    return( 1 );
+}
+
+/****************************************************************************/
+/* Pump() - Drives the transport until the specified transaction completes. */
+/* Called (and returns) with the engine lock held.                          */
+/****************************************************************************/
+
+static void Pump( HECI_TXN *pstMe )
+{
+    int                     iErrno, iWait;
+    BOOL                    bOK;
+
+    uHoldUntil = 0;
+
+    while( !pstMe->bDone )
+    {
+        // Withdraw our own transaction once its deadline has passed
+
+        if( Remaining( pstMe ) == 0 )
+        {
+            Abandon( pstMe );
+            break;
+        }
+
+        // Obtain cross-process access for this batch of transactions
+
+        if( !bEntered )
+        {
+            if( stOps.pfnEnter )
+            {
+                pthread_mutex_unlock( &stPipeLock );
+                bOK    = stOps.pfnEnter( Remaining( pstMe ) );
+                iErrno = errno;
+                pthread_mutex_lock( &stPipeLock );
+
+                if( !bOK && (Remaining( pstMe ) == 0) )
+                    continue;
+
+                if( !bOK )
+                {
+                    FailQueued( iErrno, TRUE );
+                    break;
+                }
+            }
+
+            bEntered = TRUE;
+            iBatch   = 0;
+        }
+
+        // Attach to the transport if we aren't already
+
+        if( !bAttached && !Attach( Remaining( pstMe ) ) )
+        {
+            iErrno = errno;
+
+            if( Remaining( pstMe ) == 0 )
+                continue;
+
+            FailQueued( iErrno, TRUE );
+            break;
+        }
+
+        PostQueued();
+
+        if( pstMe->bDone )
+            break;
+
+        // If nothing is outstanding, we've used up our batch; give other
+        // processes a turn before continuing
+
+        if( !iFlightCount )
+        {
+            if( bEntered )
+                Leave();
+
+            continue;
+        }
+
+        // Receive the oldest response, not waiting beyond our own deadline
+        // if our transaction is posted. A wait cut short by our deadline
+        // isn't a transport failure
+
+        iWait = iWaitTimeout;
+
+        if( (pstMe->iSlot >= 0) && pstMe->uDeadline && (Remaining( pstMe ) < iWait) )
+            iWait = Remaining( pstMe );
+
+        if( !ReceiveNext( iWait ) && ((iWait == iWaitTimeout) || pstMe->bDone) )
+            FailFlight( errno );
+    }
+
+    // Nothing left for us to do; let somebody else take over
+
+    HandOff();
+}
+
+/****************************************************************************/
+/* PumpAsync() - Drives the transport for as long as it can do so without   */
+/* blocking, then arranges for the engine's descriptor to become readable   */
+/* when it's worth trying again. Called (and returns) with the engine lock  */
+/* held.                                                                    */
+/****************************************************************************/
+
+static void PumpAsync( void )
+{
+    uint64_t                uDue;
+    int                     iErrno;
+    BOOL                    bOK;
+
+    uHoldUntil = 0;
+
+    for( ;; )
+    {
+        // Nothing to do; give other processes access
+
+        if( !pstQueueHead && !iFlightCount )
+        {
+            if( bEntered )
+                Leave();
+
+            break;
+        }
+
+        // Obtain cross-process access, trying again shortly if another
+        // process has it
+
+        if( !bEntered )
+        {
+            if( stOps.pfnEnter )
+            {
+                pthread_mutex_unlock( &stPipeLock );
+                bOK    = stOps.pfnEnter( 0 );
+                iErrno = errno;
+                pthread_mutex_lock( &stPipeLock );
+
+                if( !bOK && (iErrno == ETIMEDOUT) )
+                {
+                    ArmTimer( HeciPipeNow() + PIPE_RETRY );
+                    break;
+                }
+
+                if( !bOK )
+                {
+                    FailQueued( iErrno, TRUE );
+                    continue;
+                }
+            }
+
+            bEntered = TRUE;
+            iBatch   = 0;
+        }
+
+        // Make a single attempt at attaching to the transport
+
+        if( !bAttached && !Attach( 0 ) )
+        {
+            FailQueued( errno, TRUE );
+            continue;
+        }
+
+        PostQueued();
+
+        if( !iFlightCount )
+        {
+            if( bEntered )
+                Leave();
+
+            continue;
+        }
+
+        // Take the oldest response if it's there
+
+        if( ReceiveNext( 0 ) )
+            continue;
+
+        if( errno != ETIMEDOUT )
+        {
+            FailFlight( errno );
+            continue;
+        }
+
+        // It isn't. Fail posted transactions if it's overdue; otherwise
+        // watch the transport (or poll it, if it can't be watched) and
+        // arrange to be woken if it becomes overdue
+
+        uDue = (iWaitTimeout >= 0)? uHeadSince + iWaitTimeout : 0;
+
+        if( uDue && (HeciPipeNow() >= uDue) )
+        {
+            FailFlight( ETIMEDOUT );
+            continue;
+        }
+
+        Watch( TRUE );
+
+        if( (iWatchFD == -1) && (!uDue || (HeciPipeNow() + PIPE_RETRY < uDue)) )
+            uDue = HeciPipeNow() + PIPE_RETRY;
+
+        ArmTimer( uDue );
+        break;
+    }
+
+    if( !iFlightCount )
+        Watch( FALSE );
+
+    // Responses are awaited with access held, so bound how long the event
+    // loop can leave it that way
+
+    if( bEntered )
+        HoldForLoop();
+
+    // Threads waiting for their own transactions get the pump back
+
+    WakeWaiter();
+}
+
+/****************************************************************************/
+/* InitTxn() - Prepares a transaction for submission by a waiting thread.   */
+/****************************************************************************/
+
+static void InitTxn( HECI_TXN *pstTxn, void *pvCmdBuf, size_t tCmdSize, void *pvRspBuf, size_t tRspSize, uint64_t uDeadline )
+{
+    pthread_condattr_t      stAttr;
+
+    memset( pstTxn, 0, sizeof(*pstTxn) );
+
+    pthread_condattr_init( &stAttr );
+    pthread_condattr_setclock( &stAttr, CLOCK_MONOTONIC );
+    pthread_cond_init( &pstTxn->stDone, &stAttr );
+    pthread_condattr_destroy( &stAttr );
+
+    pstTxn->pvCmdBuf  = pvCmdBuf;
+    pstTxn->tCmdSize  = tCmdSize;
+    pstTxn->pvRspBuf  = pvRspBuf;
+    pstTxn->tRspSize  = tRspSize;
+    pstTxn->uDeadline = uDeadline;
+    pstTxn->iSlot     = -1;
+}
+
+/****************************************************************************/
+/* Enqueue() - Adds a transaction to the end of the submission queue.       */
+/* Called with engine lock held.                                            */
+/****************************************************************************/
+
+static void Enqueue( HECI_TXN *pstTxn )
+{
+    if( pstQueueTail )
+        pstQueueTail->pstNext = pstTxn;
+    else
+        pstQueueHead = pstTxn;
+
+    pstQueueTail = pstTxn;
+}
+
+/****************************************************************************/
+/* HeciPipeTransactTimed() - Submits a command packet and waits for its     */
+/* response packet. Returns the size of the response received (0 if no      */
+/* response was expected) or -1 (with errno set) on failure. On failure,    */
+/* *pbGiveUp is set TRUE if retrying the transaction would not help. If     */
+/* uDeadline is non-zero, the transaction fails with errno ETIMEDOUT once   */
+/* HeciPipeNow() reaches it.                                                */
+/****************************************************************************/
+
+int HeciPipeTransactTimed( void *pvCmdBuf, size_t tCmdSize, void *pvRspBuf, size_t tRspSize, BOOL *pbGiveUp, uint64_t uDeadline )
+{
+    HECI_TXN                stTxn;
+    struct timespec         stUntil;
+
+    InitTxn( &stTxn, pvCmdBuf, tCmdSize, pvRspBuf, tRspSize, uDeadline );
+
+    stUntil.tv_sec  = (time_t)(uDeadline / 1000);
+    stUntil.tv_nsec = (long)(uDeadline % 1000) * 1000000L;
+
+    pthread_mutex_lock( &stPipeLock );
+
+    Enqueue( &stTxn );
+
+    // Wait for completion, driving the transport ourselves if nobody else is
+
+    while( !stTxn.bDone )
+    {
+        if( !bPumping )
+        {
+            bPumping = TRUE;
+            Pump( &stTxn );
+            bPumping = FALSE;
+        }
+        else if( !uDeadline )
+            pthread_cond_wait( &stTxn.stDone, &stPipeLock );
+        else if( (pthread_cond_timedwait( &stTxn.stDone, &stPipeLock, &stUntil ) == ETIMEDOUT) && !stTxn.bDone )
+        {
+            // Give up; if we were about to be handed the pump, pass it on
+
+            Abandon( &stTxn );
+
+            if( !bPumping )
+            {
+                bPumping = TRUE;
+                HandOff();
+                bPumping = FALSE;
+            }
+        }
+    }
+
+    pthread_mutex_unlock( &stPipeLock );
+    pthread_cond_destroy( &stTxn.stDone );
+
+    if( pbGiveUp )
+        *pbGiveUp = stTxn.bGiveUp;
+
+    if( stTxn.iResult < 0 )
+        errno = stTxn.iErrno;
+
+    return( stTxn.iResult );
+}
+
+/****************************************************************************/
+/* HeciPipeTransact() - Submits a command packet and waits for its response */
+/* packet, without a deadline. See HeciPipeTransactTimed().                 */
+/****************************************************************************/
+
+int HeciPipeTransact( void *pvCmdBuf, size_t tCmdSize, void *pvRspBuf, size_t tRspSize, BOOL *pbGiveUp )
+{
+    return( HeciPipeTransactTimed( pvCmdBuf, tCmdSize, pvRspBuf, tRspSize, pbGiveUp, 0 ) );
+}
+
+/****************************************************************************/
+/* HeciPipeTransactBatch() - Submits a set of command packets together and  */
+/* waits for all of their responses. Since they are queued back-to-back,    */
+/* they are posted under a single cross-process access (unless there are    */
+/* more than PIPE_BATCH) and kept in flight together. Each entry's iResult, */
+/* iErrno and bGiveUp are set as HeciPipeTransact() would return them.      */
+/* Returns FALSE, with errno set from the first entry that failed, if any   */
+/* did (or, with errno EINVAL, if iCount isn't between 1 and                */
+/* HECI_PIPE_MAX_BATCH).                                                    */
+/****************************************************************************/
+
+BOOL HeciPipeTransactBatch( HECI_PIPE_ENTRY *pstEntries, int iCount )
+{
+    HECI_TXN                astTxn[HECI_PIPE_MAX_BATCH];
+    int                     iIndex, iWait, iErrno = 0;
+
+    if( !pstEntries || (iCount < 1) || (iCount > HECI_PIPE_MAX_BATCH) )
+    {
+        errno = EINVAL;
+        return( FALSE );
+    }
+
+    for( iIndex = 0; iIndex < iCount; iIndex++ )
+        InitTxn( &astTxn[iIndex], pstEntries[iIndex].pvCmdBuf, pstEntries[iIndex].tCmdSize,
+                 pstEntries[iIndex].pvRspBuf, pstEntries[iIndex].tRspSize, 0 );
+
+    pthread_mutex_lock( &stPipeLock );
+
+    for( iIndex = 0; iIndex < iCount; iIndex++ )
+        Enqueue( &astTxn[iIndex] );
+
+    // Transactions complete in order, so wait for each in turn, driving
+    // the transport ourselves whenever nobody else is
+
+    for( iWait = 0; iWait < iCount; )
+    {
+        if( astTxn[iWait].bDone )
+            iWait++;
+        else if( !bPumping )
+        {
+            bPumping = TRUE;
+            Pump( &astTxn[iWait] );
+            bPumping = FALSE;
+        }
+        else
+            pthread_cond_wait( &astTxn[iWait].stDone, &stPipeLock );
+    }
+
+    pthread_mutex_unlock( &stPipeLock );
+
+    for( iIndex = 0; iIndex < iCount; iIndex++ )
+    {
+        pthread_cond_destroy( &astTxn[iIndex].stDone );
+
+        pstEntries[iIndex].iResult = astTxn[iIndex].iResult;
+        pstEntries[iIndex].iErrno  = astTxn[iIndex].iErrno;
+        pstEntries[iIndex].bGiveUp = astTxn[iIndex].bGiveUp;
+
+        if( (astTxn[iIndex].iResult < 0) && !iErrno )
+            iErrno = astTxn[iIndex].iErrno;
+    }
+
+    if( iErrno )
+        errno = iErrno;
+
+    return( !iErrno );
+}
+
+/****************************************************************************/
+/* AsyncSetup() - Creates the descriptors used for asynchronous operation   */
+/* and the pool of asynchronous transactions, on first use. Returns FALSE   */
+/* (with errno set) on failure. Called with engine lock held.               */
+/****************************************************************************/
+
+static BOOL AsyncSetup( void )
+{
+    struct epoll_event      stEvent;
+    int                     iIndex, iErrno;
+
+    if( iPollFD != -1 )
+        return( TRUE );
+
+    iKickFD  = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+    iTimerFD = timerfd_create( CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC );
+    iPollFD  = epoll_create1( EPOLL_CLOEXEC );
+
+    if( (iKickFD != -1) && (iTimerFD != -1) && (iPollFD != -1) )
+    {
+        memset( &stEvent, 0, sizeof(stEvent) );
+        stEvent.events  = EPOLLIN;
+        stEvent.data.fd = iKickFD;
+
+        if( !epoll_ctl( iPollFD, EPOLL_CTL_ADD, iKickFD, &stEvent ) )
+        {
+            stEvent.data.fd = iTimerFD;
+
+            if( !epoll_ctl( iPollFD, EPOLL_CTL_ADD, iTimerFD, &stEvent ) )
+            {
+                for( iIndex = 0; iIndex < HECI_PIPE_MAX_ASYNC; iIndex++ )
+                    astAsync[iIndex].pstNext = (iIndex + 1 < HECI_PIPE_MAX_ASYNC)? &astAsync[iIndex + 1] : NULL;
+
+                pstAsyncFree = &astAsync[0];
+                iWatchFD     = -1;
+
+                return( TRUE );
+            }
+        }
+    }
+
+    iErrno = errno;
+
+    if( iPollFD != -1 )
+        close( iPollFD );
+
+    if( iTimerFD != -1 )
+        close( iTimerFD );
+
+    if( iKickFD != -1 )
+        close( iKickFD );
+
+    iPollFD = iTimerFD = iKickFD = -1;
+
+    errno = iErrno;
+    return( FALSE );
+}
+
+/****************************************************************************/
+/* HeciPipeSubmit() - Submits a command packet without waiting for its      */
+/* response. The transaction completes by pfnDone() being called, from      */
+/* HeciPipeProcess(), with the same result and errno value that             */
+/* HeciPipeTransact() would have returned; the buffers must remain valid    */
+/* until then. Up to HECI_PIPE_MAX_ASYNC transactions may be incomplete at  */
+/* any time; beyond that, the function fails with errno EAGAIN.             */
+/****************************************************************************/
+
+BOOL HeciPipeSubmit( void *pvCmdBuf, size_t tCmdSize, void *pvRspBuf, size_t tRspSize, HECI_PIPE_DONE pfnDone, void *pvTag )
+{
+    HECI_TXN                *pstTxn;
+
+    if( !pfnDone )
+    {
+        errno = EINVAL;
+        return( FALSE );
+    }
+
+    pthread_mutex_lock( &stPipeLock );
+
+    if( !AsyncSetup() )
+    {
+        pthread_mutex_unlock( &stPipeLock );
+        return( FALSE );
+    }
+
+    if( !pstAsyncFree )
+    {
+        pthread_mutex_unlock( &stPipeLock );
+        errno = EAGAIN;
+        return( FALSE );
+    }
+
+    pstTxn       = pstAsyncFree;
+    pstAsyncFree = pstTxn->pstNext;
+
+    memset( pstTxn, 0, sizeof(*pstTxn) );
+
+    pstTxn->pvCmdBuf = pvCmdBuf;
+    pstTxn->tCmdSize = tCmdSize;
+    pstTxn->pvRspBuf = pvRspBuf;
+    pstTxn->tRspSize = tRspSize;
+    pstTxn->iSlot    = -1;
+    pstTxn->bAsync   = TRUE;
+    pstTxn->pfnDone  = pfnDone;
+    pstTxn->pvTag    = pvTag;
+
+    Enqueue( pstTxn );
+    iAsyncCount++;
+
+    // Get it posted straight away if nobody else is driving the transport
+
+    if( !bPumping )
+    {
+        bPumping = TRUE;
+        PumpAsync();
+        bPumping = FALSE;
+    }
+
+    pthread_mutex_unlock( &stPipeLock );
+    return( TRUE );
+}
+
+/****************************************************************************/
+/* HeciPipeGetFD() - Returns a descriptor that becomes readable whenever    */
+/* HeciPipeProcess() has work to do, for adding to the caller's poll/epoll  */
+/* set. Returns -1 (with errno set) on failure.                             */
+/****************************************************************************/
+
+int HeciPipeGetFD( void )
+{
+    int                     iFD;
+
+    pthread_mutex_lock( &stPipeLock );
+    iFD = AsyncSetup()? iPollFD : -1;
+    pthread_mutex_unlock( &stPipeLock );
+
+    return( iFD );
+}
+
+/****************************************************************************/
+/* HeciPipeProcess() - Drives the transport for asynchronous transactions,  */
+/* without blocking, and calls the completion functions of those that have  */
+/* completed. Returns the number of transactions completed. Must be called  */
+/* promptly whenever the descriptor from HeciPipeGetFD() is readable;       */
+/* otherwise posted transactions fail (see note 6).                         */
+/****************************************************************************/
+
+int HeciPipeProcess( void )
+{
+    HECI_REPORT             astReport[HECI_PIPE_MAX_ASYNC];
+    HECI_TXN                *pstTxn;
+    uint64_t                uCount;
+    int                     iCount, iIndex;
+
+    pthread_mutex_lock( &stPipeLock );
+
+    if( iPollFD == -1 )
+    {
+        pthread_mutex_unlock( &stPipeLock );
+        return( 0 );
+    }
+
+    // Clear expiry of timer; the pump rearms it if still required
+
+    if( read( iTimerFD, &uCount, sizeof(uCount) ) < 0 )
+        uCount = 0;
+
+    // If a thread is pumping for its own transaction, it'll kick us when
+    // it hands off; stop watching the transport meanwhile
+
+    if( !bPumping )
+    {
+        bPumping = TRUE;
+        PumpAsync();
+        bPumping = FALSE;
+    }
+    else
+        Watch( FALSE );
+
+    // Collect completed transactions. Kicks made before this point are
+    // for the completions being collected here
+
+    if( read( iKickFD, &uCount, sizeof(uCount) ) < 0 )
+        uCount = 0;
+
+    for( iCount = 0; pstDoneHead; iCount++ )
+    {
+        pstTxn      = pstDoneHead;
+        pstDoneHead = pstTxn->pstNext;
+
+        astReport[iCount].pfnDone = pstTxn->pfnDone;
+        astReport[iCount].pvTag   = pstTxn->pvTag;
+        astReport[iCount].iResult = pstTxn->iResult;
+        astReport[iCount].iErrno  = pstTxn->iErrno;
+
+        pstTxn->pstNext = pstAsyncFree;
+        pstAsyncFree    = pstTxn;
+    }
+
+    pstDoneTail = NULL;
+
+    pthread_mutex_unlock( &stPipeLock );
+
+    // Report completions (which may submit further transactions)
+
+    for( iIndex = 0; iIndex < iCount; iIndex++ )
+        astReport[iIndex].pfnDone( astReport[iIndex].pvTag, astReport[iIndex].iResult, astReport[iIndex].iErrno );
+
+    return( iCount );
+}
+
+/****************************************************************************/
+/* HeciPipeInitialize() - Initializes the engine.                           */
+/****************************************************************************/
+
+BOOL HeciPipeInitialize( const HECI_PIPE_OPS *pstOps, int iDepth, int iTimeout )
+{
+    if( !pstOps || (iDepth < 1) || (iDepth > HECI_PIPE_MAX_DEPTH) )
+    {
+        errno = EINVAL;
+        return( FALSE );
+    }
+
+    pthread_mutex_lock( &stPipeLock );
+
+    stOps        = *pstOps;
+    iPipeDepth   = iDepth;
+    iWaitTimeout = iTimeout;
+
+    pstQueueHead = pstQueueTail = NULL;
+    iFlightHead  = iFlightCount = 0;
+    bPumping     = bEntered = bAttached = FALSE;
+    iMaxPacket   = 0;
+    iAsyncCount  = 0;
+    pstDoneHead  = pstDoneTail = NULL;
+
+    pthread_mutex_unlock( &stPipeLock );
+    return( TRUE );
+}
+
+/****************************************************************************/
+/* HeciPipeCleanup() - Cleans up after the engine.                          */
+/****************************************************************************/
+
+void HeciPipeCleanup( void )
+{
+    pthread_mutex_lock( &stPipeLock );
+
+    uHoldUntil = 0;
+
+    if( iWatchdogPid == getpid() )
+    {
+        bWatchdogStop = TRUE;
+        pthread_cond_signal( &stWatchdogWake );
+
+        pthread_mutex_unlock( &stPipeLock );
+        pthread_join( stWatchdog, NULL );
+        pthread_mutex_lock( &stPipeLock );
+
+        pthread_cond_destroy( &stWatchdogWake );
+        iWatchdogPid  = 0;
+        bWatchdogStop = FALSE;
+    }
+
+    if( bAttached )
+        Detach();
+
+    if( bEntered )
+        Leave();
+
+    free( pbySlotBuff );
+    pbySlotBuff = NULL;
+    iSlotSize   = 0;
+
+    if( iPollFD != -1 )
+    {
+        close( iPollFD );
+        close( iTimerFD );
+        close( iKickFD );
+
+        iPollFD = iTimerFD = iKickFD = iWatchFD = -1;
+    }
+
+    pthread_mutex_unlock( &stPipeLock );
+}
@@ -0,0 +1,124 @@
+/****************************************************************************/
+/*                                                                          */
+/*  Module:         HeciPipe.h                                              */
+/*                                                                          */
+/*  Description:    Prototypes the functions that implement the Linux HECI  */
+/*                  transaction engine. The engine maintains  a  queue  of  */
+/*                  command  packets  submitted  by  the  threads  of  the  */
+/*                  process and keeps a number of  them  outstanding  with  */
+/*                  the ME Subsystem at the same time.                      */
+/*                                                                          */
+/****************************************************************************/
+
+/****************************************************************************/
+/*                                                                          */
+/*     Copyright (c) 2005-2009, Intel Corporation. All Rights Reserved.     */
+/*                                                                          */
+/*  Redistribution and use in source and binary  forms,  with  or  without  */
+/*  modification, are permitted provided that the following conditions are  */
+/*  met:                                                                    */
+/*                                                                          */
+/*    - Redistributions of source code must  retain  the  above  copyright  */
+/*      notice, this list of conditions and the following disclaimer.       */
+/*                                                                          */
+/*    - Redistributions  in binary form must reproduce the above copyright  */
+/*      notice, this list of conditions and the  following  disclaimer  in  */
+/*      the   documentation  and/or  other  materials  provided  with  the  */
+/*      distribution.                                                       */
+/*                                                                          */
+/*    - Neither the name  of  Intel  Corporation  nor  the  names  of  its  */
+/*      contributors  may  be  used to endorse or promote products derived  */
+/*      from this software without specific prior written permission.       */
+/*                                                                          */
+/*  DISCLAIMER: THIS SOFTWARE IS PROVIDED BY  THE  COPYRIGHT  HOLDERS  AND  */
+/*  CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  */
+/*  BUT  NOT  LIMITED  TO,  THE  IMPLIED WARRANTIES OF MERCHANTABILITY AND  */
+/*  FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN  NO  EVENT  SHALL  */
+/*  INTEL  CORPORATION  OR  THE  CONTRIBUTORS  BE  LIABLE  FOR ANY DIRECT,  */
+/*  INDIRECT, INCIDENTAL, SPECIAL,  EXEMPLARY,  OR  CONSEQUENTIAL  DAMAGES  */
+/*  (INCLUDING,  BUT  NOT  LIMITED  TO, PROCUREMENT OF SUBSTITUTE GOODS OR  */
+/*  SERVICES; LOSS OF USE, DATA, OR  PROFITS;  OR  BUSINESS  INTERRUPTION)  */
+/*  HOWEVER  CAUSED  AND  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,  */
+/*  STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)  ARISING  */
+/*  IN  ANY  WAY  OUT  OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE  */
+/*  POSSIBILITY OF SUCH DAMAGE.                                             */
+/*                                                                          */
+/****************************************************************************/
+
+#ifndef _HECIPIPE_H
+#define _HECIPIPE_H
+
+#include <stdint.h>
+#include <typedef.h>
+
+/****************************************************************************/
+/* Definitions                                                              */
+/****************************************************************************/
+
+#define HECI_PIPE_MAX_DEPTH     16      // Maximum outstanding transactions
+#define HECI_PIPE_MAX_ASYNC     64      // Maximum incomplete asynchronous transactions
+#define HECI_PIPE_MAX_BATCH     64      // Maximum transactions submitted together
+
+/****************************************************************************/
+/* HECI_PIPE_OPS - Operations the engine uses to reach the transport and to */
+/* serialize its use with other processes. Operations pfnWait, pfnEnter,    */
+/* pfnLeave and pfnGetFD are optional (may be NULL). Operations pfnAttach   */
+/* and pfnEnter are given the time (milliseconds) they may take, or -1 for  */
+/* no limit. Operation pfnGetFD returns a descriptor that is readable when  */
+/* a response packet is available; without it, asynchronous transactions    */
+/* are polled for.                                                          */
+/****************************************************************************/
+
+typedef struct _HECI_PIPE_OPS
+{
+    int     (*pfnAttach)( int iTimeout );                   // Attach; returns max packet size or -1
+    void    (*pfnDetach)( void );                           // Detach
+    BOOL    (*pfnPost)( void *pvBuff, size_t tBuffLen );    // Send command packet (no waiting)
+    BOOL    (*pfnWait)( int iTimeout );                     // Wait for next response packet
+    int     (*pfnReceive)( void *pvBuff, size_t tBuffMax ); // Receive next response packet
+    BOOL    (*pfnEnter)( int iTimeout );                    // Obtain cross-process access
+    void    (*pfnLeave)( void );                            // Release cross-process access
+    int     (*pfnGetFD)( void );                            // Descriptor to poll for responses
+
+} HECI_PIPE_OPS;
+
+/****************************************************************************/
+/* HECI_PIPE_ENTRY - One of a set of transactions submitted together        */
+/****************************************************************************/
+
+typedef struct _HECI_PIPE_ENTRY
+{
+    void    *pvCmdBuf;                                      // Command packet
+    size_t  tCmdSize;                                       // Size of command packet
+    void    *pvRspBuf;                                      // Buffer for response packet
+    size_t  tRspSize;                                       // Expected size of response packet
+    int     iResult;                                        // Bytes received or -1
+    int     iErrno;                                         // errno value when failed
+    BOOL    bGiveUp;                                        // Retrying won't help
+
+} HECI_PIPE_ENTRY;
+
+/****************************************************************************/
+/* HECI_PIPE_DONE - Called on completion of an asynchronous transaction     */
+/****************************************************************************/
+
+typedef void (*HECI_PIPE_DONE)( void *pvTag, int iResult, int iErrno );
+
+/****************************************************************************/
+/* Functions                                                                */
+/****************************************************************************/
+
+BOOL   HeciPipeInitialize( const HECI_PIPE_OPS *pstOps, int iDepth, int iTimeout );
+void   HeciPipeCleanup( void );
+
+int    HeciPipeTransact( void *pvCmdBuf, size_t tCmdSize, void *pvRspBuf, size_t tRspSize, BOOL *pbGiveUp );
+int    HeciPipeTransactTimed( void *pvCmdBuf, size_t tCmdSize, void *pvRspBuf, size_t tRspSize, BOOL *pbGiveUp, uint64_t uDeadline );
+BOOL   HeciPipeTransactBatch( HECI_PIPE_ENTRY *pstEntries, int iCount );
+
+BOOL   HeciPipeSubmit( void *pvCmdBuf, size_t tCmdSize, void *pvRspBuf, size_t tRspSize, HECI_PIPE_DONE pfnDone, void *pvTag );
+int    HeciPipeGetFD( void );
+int    HeciPipeProcess( void );
+
+uint64_t HeciPipeNow( void );
+
+#endif // ndef _HECIPIPE_H
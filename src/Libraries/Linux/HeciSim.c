@@ -0,0 +1,1052 @@
+/****************************************************************************/
+/*                                                                          */
+/*  Module:         HeciSim.c                                               */
+/*                                                                          */
+/*  Description:    Implements  a  HECI  transport  that   simulates   the  */
+/*                  Intel(R) Quiet System Technology (QST)  F/W  Subsystem  */
+/*                  in-process.   It   allows   the   communication    and  */
+/*                  instrumentation support (and  the  programs  built  on  */
+/*                  them) to be exercised and benchmarked on systems  that  */
+/*                  have no ME.                                             */
+/*                                                                          */
+/*  Notes:      1.  The  QST  2.x  command  set  is  supported:  subsystem  */
+/*                  information,  status  and  profile;  monitor  updates,  */
+/*                  configuration and thresholds for  each  sensor  class;  */
+/*                  fan controller updates, configuration and  duty  cycle  */
+/*                  overrides; and SST pass-through (answered with  zeroed  */
+/*                  data). Other commands are rejected as unsupported.      */
+/*                                                                          */
+/*              2.  Readings follow triangular waves around each  sensor's  */
+/*                  nominal value, each sensor at a different point in the  */
+/*                  cycle. Environment variable QST_SIM_PERIOD  holds  the  */
+/*                  period  in  milliseconds  (default  one  minute).  The  */
+/*                  sensors are scanned when a command arrives to find  no  */
+/*                  earlier response waiting to be  collected,  and  every  */
+/*                  update in that batch of commands is answered from  the  */
+/*                  same scan.  HeciSimReading()  gives  the  reading  any  */
+/*                  sensor has at a given time, so that a reader can check  */
+/*                  that what it was given came from a single scan. Health  */
+/*                  status is derived  from  the  current  thresholds,  so  */
+/*                  threshold changes take effect on the next update.       */
+/*                                                                          */
+/*              3.  Commands are answered in order by  a  model  subsystem  */
+/*                  that takes a configurable time  to  handle  each  one.  */
+/*                  Environment   variable   QST_SIM_LATENCY    holds    a  */
+/*                  comma-separated list of  microsecond  times;  a  plain  */
+/*                  value sets the time for all commands and a "code:time"  */
+/*                  pair (code in hex) sets  the  time  for  one  command.  */
+/*                  Example: "100,0D:400".                                  */
+/*                                                                          */
+/*              4.  Environment variable QST_SIM_SENSORS holds the  number  */
+/*                  of  temperature,  fan  speed,  voltage   and   current  */
+/*                  monitors  and  fan  controllers  to  simulate,  as   a  */
+/*                  comma-separated list. Example: "4,3,5,2,3". Each count  */
+/*                  is limited to the corresponding QST_ABS_* value.        */
+/*                                                                          */
+/*              5.  Like the driver's connection, the simulator provides a  */
+/*                  descriptor  that  is  readable  while  a  response  is  */
+/*                  available: a timerfd  set  for  the  time  the  oldest  */
+/*                  response becomes available. It is only kept  set  once  */
+/*                  the descriptor has been asked for.                      */
+/*                                                                          */
+/*              6.  Environment variable QST_SIM_RESET holds  a  count  of  */
+/*                  commands after which the subsystem behaves as  if  the  */
+/*                  ME had been reset: the connection  is  dropped  (along  */
+/*                  with responses awaiting receipt) and the command  that  */
+/*                  would have exceeded the count fails  with  EIO,  until  */
+/*                  the connection is formed again. Zero (the default)  or  */
+/*                  an absent value disables this.                          */
+/*                                                                          */
+/****************************************************************************/
+
+/****************************************************************************/
+/*                                                                          */
+/*     Copyright (c) 2005-2009, Intel Corporation. All Rights Reserved.     */
+/*                                                                          */
+/*  Redistribution and use in source and binary  forms,  with  or  without  */
+/*  modification, are permitted provided that the following conditions are  */
+/*  met:                                                                    */
+/*                                                                          */
+/*    - Redistributions of source code must  retain  the  above  copyright  */
+/*      notice, this list of conditions and the following disclaimer.       */
+/*                                                                          */
+/*    - Redistributions  in binary form must reproduce the above copyright  */
+/*      notice, this list of conditions and the  following  disclaimer  in  */
+/*      the   documentation  and/or  other  materials  provided  with  the  */
+/*      distribution.                                                       */
+/*                                                                          */
+/*    - Neither the name  of  Intel  Corporation  nor  the  names  of  its  */
+/*      contributors  may  be  used to endorse or promote products derived  */
+/*      from this software without specific prior written permission.       */
+/*                                                                          */
+/*  DISCLAIMER: THIS SOFTWARE IS PROVIDED BY  THE  COPYRIGHT  HOLDERS  AND  */
+/*  CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  */
+/*  BUT  NOT  LIMITED  TO,  THE  IMPLIED WARRANTIES OF MERCHANTABILITY AND  */
+/*  FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN  NO  EVENT  SHALL  */
+/*  INTEL  CORPORATION  OR  THE  CONTRIBUTORS  BE  LIABLE  FOR ANY DIRECT,  */
+/*  INDIRECT, INCIDENTAL, SPECIAL,  EXEMPLARY,  OR  CONSEQUENTIAL  DAMAGES  */
+/*  (INCLUDING,  BUT  NOT  LIMITED  TO, PROCUREMENT OF SUBSTITUTE GOODS OR  */
+/*  SERVICES; LOSS OF USE, DATA, OR  PROFITS;  OR  BUSINESS  INTERRUPTION)  */
+/*  HOWEVER  CAUSED  AND  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,  */
+/*  STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)  ARISING  */
+/*  IN  ANY  WAY  OUT  OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE  */
+/*  POSSIBILITY OF SUCH DAMAGE.                                             */
+/*                                                                          */
+/****************************************************************************/
+
+#ifndef __linux__
+#error This source module intended for use in Linux environments only
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+
+#include "QstCmd.h"
+#include "heci.h"
+
+/****************************************************************************/
+/* Configuration                                                            */
+/****************************************************************************/
+
+#define SIM_MAX_PACKET  512             // Maximum packet size
+#define SIM_QUEUE       32              // Maximum responses awaiting receipt
+#define SIM_LATENCY     100             // Default time per command (microseconds)
+#define SIM_PERIOD      60000           // Default period of reading waveforms (milliseconds)
+
+#define SIM_MAJOR       6               // Firmware version reported
+#define SIM_MINOR       0
+#define SIM_REVISION    0
+#define SIM_BUILD       1
+
+/****************************************************************************/
+/* Simulated sensor classes                                                 */
+/****************************************************************************/
+
+#define SIM_TEMP        0
+#define SIM_FAN         1
+#define SIM_VOLT        2
+#define SIM_CURR        3
+#define SIM_CTRL        4
+#define SIM_CLASSES     5
+
+static const int        aiSimDefault[SIM_CLASSES] = { 4, 3, 5, 2, 3 };
+static const int        aiSimMax[SIM_CLASSES]     = { QST_ABS_TEMP_MONITORS, QST_ABS_FAN_MONITORS,
+                                                      QST_ABS_VOLT_MONITORS, QST_ABS_CURR_MONITORS,
+                                                      QST_ABS_FAN_CONTROLLERS };
+
+/****************************************************************************/
+/* SIM_SENSOR - State of a simulated sensor (or controller). Readings and   */
+/* thresholds are kept in the fixed-point units used by the command set.    */
+/* Thresholds are indexed non-critical, critical, non-recoverable.          */
+/****************************************************************************/
+
+#define SIM_NONE_LOW    INT32_MIN       // No lower threshold
+#define SIM_NONE_HIGH   INT32_MAX       // No upper threshold
+
+typedef struct _SIM_SENSOR
+{
+    UINT8               byUsage;        // Usage code
+    INT32               iNominal;       // Nominal reading
+    INT32               iSwing;         // Amplitude of variation
+    INT32               aiLow[3];       // Lower thresholds
+    INT32               aiHigh[3];      // Upper thresholds
+    BOOL                bManual;        // Controller: duty cycle overridden
+    INT32               iManual;        // Controller: duty cycle override
+
+} SIM_SENSOR;
+
+/****************************************************************************/
+/* SIM_RESPONSE - A response packet awaiting receipt                        */
+/****************************************************************************/
+
+typedef struct _SIM_RESPONSE
+{
+    uint64_t            uReady;         // Time response becomes available (ns)
+    size_t              tLen;           // Length of response
+    UINT8               abyData[SIM_MAX_PACKET];
+
+} SIM_RESPONSE;
+
+/****************************************************************************/
+/* Persistent Variables                                                     */
+/****************************************************************************/
+
+static BOOL             bSimConnected;
+static int              aiSimCount[SIM_CLASSES];
+static SIM_SENSOR       astSim[SIM_CLASSES][32];
+static uint64_t         auSimLatency[QST_LAST_CMD_CODE + 1];
+static uint64_t         uSimFree;       // Time subsystem is next free (ns)
+static uint64_t         uSimStart;      // Time of connection (ns)
+static uint64_t         uSimPeriod;     // Period of reading waveforms (milliseconds)
+static uint64_t         uSimScan;       // Time of last scan of sensors (ms since connection)
+static BOOL             bSimConfigured;
+static unsigned long    ulSimReset;     // Commands between simulated resets
+static unsigned long    ulSimPosted;    // Commands posted since last reset
+
+static SIM_RESPONSE     astSimQueue[SIM_QUEUE];
+static int              iSimHead, iSimCount;
+
+static int              iSimTimer = -1; // Readable when response available
+static BOOL             bSimWatched;    // Descriptor has been asked for
+
+/****************************************************************************/
+/* SimNow() - Returns current (monotonic) time in nanoseconds               */
+/****************************************************************************/
+
+static uint64_t SimNow( void )
+{
+    struct timespec stTime;
+
+    clock_gettime( CLOCK_MONOTONIC, &stTime );
+    return( (uint64_t)stTime.tv_sec * 1000000000ULL + stTime.tv_nsec );
+}
+
+/****************************************************************************/
+/* SimConfigure() - Sets up simulated sensors and latencies, using values   */
+/* from the environment where supplied.                                     */
+/****************************************************************************/
+
+static void SimConfigure( void )
+{
+    static const INT32  aiVoltNominal[] = { 12000, 5000, 3300, 1500, 1200, 1800, 2500, 1050 };
+    static const UINT8  abyVoltUsage[]  = { QST_12_VOLTS, QST_5_VOLTS, QST_3P3_VOLTS, QST_1P5_VOLTS,
+                                            QST_CPU1_VCCP_VOLTS, QST_1P8_VOLTS, QST_2P5_VOLTS,
+                                            QST_CPU_VTT_VOLTAGE };
+
+    const char          *pszEnv;
+    char                *pszEnd;
+    SIM_SENSOR          *pstSensor;
+    uint64_t            uTime;
+    long                lValue, lCode;
+    int                 iClass, iIndex, iPct;
+
+    // Sensor counts
+
+    memcpy( aiSimCount, aiSimDefault, sizeof(aiSimCount) );
+
+    if( (pszEnv = getenv( "QST_SIM_SENSORS" )) != NULL )
+    {
+        for( iClass = 0; (iClass < SIM_CLASSES) && *pszEnv; iClass++ )
+        {
+            lValue = strtol( pszEnv, &pszEnd, 10 );
+
+            if( pszEnd != pszEnv )
+                aiSimCount[iClass] = (lValue < 0)? 0 : (lValue > aiSimMax[iClass])? aiSimMax[iClass] : (int)lValue;
+
+            pszEnv = (*pszEnd == ',')? pszEnd + 1 : pszEnd;
+        }
+    }
+
+    // Command latencies
+
+    for( iIndex = 0; iIndex <= QST_LAST_CMD_CODE; iIndex++ )
+        auSimLatency[iIndex] = SIM_LATENCY * 1000ULL;
+
+    if( (pszEnv = getenv( "QST_SIM_LATENCY" )) != NULL )
+    {
+        while( *pszEnv )
+        {
+            lValue = strtol( pszEnv, &pszEnd, 16 );
+            lCode  = -1;
+
+            if( (pszEnd != pszEnv) && (*pszEnd == ':') )
+            {
+                lCode  = lValue;
+                pszEnv = pszEnd + 1;
+            }
+
+            lValue = strtol( pszEnv, &pszEnd, 10 );
+
+            if( (pszEnd == pszEnv) || (lValue < 0) )
+                break;
+
+            uTime = (uint64_t)lValue * 1000ULL;
+
+            if( lCode == -1 )
+            {
+                for( iIndex = 0; iIndex <= QST_LAST_CMD_CODE; iIndex++ )
+                    auSimLatency[iIndex] = uTime;
+            }
+            else if( (lCode >= 0) && (lCode <= QST_LAST_CMD_CODE) )
+                auSimLatency[lCode] = uTime;
+
+            pszEnv = (*pszEnd == ',')? pszEnd + 1 : pszEnd;
+        }
+    }
+
+    // Period of reading waveforms
+
+    uSimPeriod = SIM_PERIOD;
+
+    if( (pszEnv = getenv( "QST_SIM_PERIOD" )) != NULL )
+    {
+        lValue = strtol( pszEnv, &pszEnd, 10 );
+
+        if( (pszEnd != pszEnv) && (lValue >= 2) )
+            uSimPeriod = (uint64_t)lValue;
+    }
+
+    // Simulated resets
+
+    ulSimReset = 0;
+
+    if( (pszEnv = getenv( "QST_SIM_RESET" )) != NULL )
+    {
+        lValue = strtol( pszEnv, &pszEnd, 10 );
+
+        if( (pszEnd != pszEnv) && (lValue > 0) )
+            ulSimReset = (unsigned long)lValue;
+    }
+
+    // Sensor characteristics
+
+    memset( astSim, 0, sizeof(astSim) );
+
+    for( iClass = 0; iClass < SIM_CLASSES; iClass++ )
+    {
+        for( iIndex = 0; iIndex < aiSimCount[iClass]; iIndex++ )
+        {
+            pstSensor = &astSim[iClass][iIndex];
+
+            pstSensor->aiLow[0]  = pstSensor->aiLow[1]  = pstSensor->aiLow[2]  = SIM_NONE_LOW;
+            pstSensor->aiHigh[0] = pstSensor->aiHigh[1] = pstSensor->aiHigh[2] = SIM_NONE_HIGH;
+
+            switch( iClass )
+            {
+            case SIM_TEMP:          // Degrees C * 100
+
+                pstSensor->byUsage   = (iIndex == 0)? QST_CPU_CORE_TEMP : (UINT8)(QST_ICH_TEMP + (iIndex - 1) % 8);
+                pstSensor->iNominal  = 4500 + 500 * (iIndex % 4);
+                pstSensor->iSwing    = 1000;
+                pstSensor->aiHigh[0] = 7500;
+                pstSensor->aiHigh[1] = 8500;
+                pstSensor->aiHigh[2] = 9500;
+                break;
+
+            case SIM_FAN:           // RPM
+
+                pstSensor->byUsage   = (UINT8)(QST_CPU_FAN + iIndex % QST_LAST_FAN_USAGE);
+                pstSensor->iNominal  = 1800 + 200 * (iIndex % 4);
+                pstSensor->iSwing    = 300;
+                pstSensor->aiLow[0]  = 800;
+                pstSensor->aiLow[1]  = 500;
+                pstSensor->aiLow[2]  = 200;
+                break;
+
+            case SIM_VOLT:          // Millivolts
+
+                iPct = sizeof(aiVoltNominal) / sizeof(aiVoltNominal[0]);
+
+                pstSensor->byUsage   = abyVoltUsage[iIndex % iPct];
+                pstSensor->iNominal  = aiVoltNominal[iIndex % iPct];
+                pstSensor->iSwing    = pstSensor->iNominal / 100;
+                pstSensor->aiLow[0]  = pstSensor->iNominal - pstSensor->iNominal * 5 / 100;
+                pstSensor->aiLow[1]  = pstSensor->iNominal - pstSensor->iNominal * 10 / 100;
+                pstSensor->aiLow[2]  = pstSensor->iNominal - pstSensor->iNominal * 15 / 100;
+                pstSensor->aiHigh[0] = pstSensor->iNominal + pstSensor->iNominal * 5 / 100;
+                pstSensor->aiHigh[1] = pstSensor->iNominal + pstSensor->iNominal * 10 / 100;
+                pstSensor->aiHigh[2] = pstSensor->iNominal + pstSensor->iNominal * 15 / 100;
+                break;
+
+            case SIM_CURR:          // Milliamps
+
+                pstSensor->byUsage   = (UINT8)(QST_12V_CURRENT + iIndex % QST_LAST_CURR_USAGE);
+                pstSensor->iNominal  = 4000 + 1000 * (iIndex % 4);
+                pstSensor->iSwing    = 1000;
+                pstSensor->aiHigh[0] = 10000;
+                pstSensor->aiHigh[1] = 12000;
+                pstSensor->aiHigh[2] = 14000;
+                break;
+
+            case SIM_CTRL:          // Duty cycle % * 100
+
+                pstSensor->byUsage   = (UINT8)(QST_CPU_FAN + iIndex % QST_LAST_FAN_USAGE);
+                pstSensor->iNominal  = 4000;
+                pstSensor->iSwing    = 1500;
+                break;
+            }
+        }
+    }
+
+    bSimConfigured = TRUE;
+}
+
+/****************************************************************************/
+/* SimClass() - Returns the class of sensor (or controller) a command       */
+/* targets, or -1 if it targets none                                        */
+/****************************************************************************/
+
+static int SimClass( UINT8 byCommand )
+{
+    switch( byCommand )
+    {
+    case QST_GET_TEMP_MON_UPDATE:
+    case QST_GET_TEMP_MON_CONFIG:
+    case QST_SET_TEMP_MON_THRESHOLDS:   return( SIM_TEMP );
+
+    case QST_GET_FAN_MON_UPDATE:
+    case QST_GET_FAN_MON_CONFIG:
+    case QST_SET_FAN_MON_THRESHOLDS:    return( SIM_FAN );
+
+    case QST_GET_VOLT_MON_UPDATE:
+    case QST_GET_VOLT_MON_CONFIG:
+    case QST_SET_VOLT_MON_THRESHOLDS:   return( SIM_VOLT );
+
+    case QST_GET_CURR_MON_UPDATE:
+    case QST_GET_CURR_MON_CONFIG:
+    case QST_SET_CURR_MON_THRESHOLDS:   return( SIM_CURR );
+
+    case QST_GET_FAN_CTRL_UPDATE:
+    case QST_GET_FAN_CTRL_CONFIG:
+    case QST_SET_FAN_CTRL_DUTY:
+    case QST_SET_FAN_CTRL_AUTO:         return( SIM_CTRL );
+
+    default:                            return( -1 );
+    }
+}
+
+/****************************************************************************/
+/* SimWave() - Returns the reading of a simulated sensor the specified      */
+/* number of milliseconds after the subsystem was first connected to. The   */
+/* reading follows a triangular wave, with each sensor at a different point */
+/* in the cycle.                                                            */
+/****************************************************************************/
+
+static INT32 SimWave( int iClass, int iIndex, uint64_t uElapsed )
+{
+    SIM_SENSOR          *pstSensor = &astSim[iClass][iIndex];
+    uint64_t            uPhase;
+    INT32               iOffset;
+
+    uPhase  = (uElapsed + (uint64_t)(iClass * 7 + iIndex) * 7919ULL) % uSimPeriod;
+    iOffset = (INT32)((uPhase < uSimPeriod / 2)? uPhase : uSimPeriod - uPhase);
+
+    return( pstSensor->iNominal - pstSensor->iSwing + (INT32)(((int64_t)2 * pstSensor->iSwing * iOffset) / (int64_t)(uSimPeriod / 2)) );
+}
+
+/****************************************************************************/
+/* SimReading() - Returns the reading for a simulated sensor the specified  */
+/* number of milliseconds after the subsystem was first connected to,       */
+/* allowing for a controller's duty cycle being overridden.                 */
+/****************************************************************************/
+
+static INT32 SimReading( int iClass, int iIndex, uint64_t uElapsed )
+{
+    SIM_SENSOR          *pstSensor = &astSim[iClass][iIndex];
+
+    if( (iClass == SIM_CTRL) && pstSensor->bManual )
+        return( pstSensor->iManual );
+
+    return( SimWave( iClass, iIndex, uElapsed ) );
+}
+
+/****************************************************************************/
+/* SimHealth() - Fills in the health status for a simulated sensor.         */
+/****************************************************************************/
+
+static void SimHealth( int iClass, int iIndex, INT32 iReading, QST_MON_HEALTH_STATUS *pstStatus )
+{
+    SIM_SENSOR          *pstSensor = &astSim[iClass][iIndex];
+    int                 iLevel, iStatus = QST_STATUS_NORMAL;
+
+    for( iLevel = 0; iLevel < 3; iLevel++ )
+    {
+        if( (iReading <= pstSensor->aiLow[iLevel]) || (iReading >= pstSensor->aiHigh[iLevel]) )
+            iStatus = QST_STATUS_NON_CRITICAL + iLevel;
+    }
+
+    memset( pstStatus, 0, sizeof(*pstStatus) );
+
+    pstStatus->bMonitorEnabled  = 1;
+    pstStatus->uMonitorStatus   = iStatus;
+    pstStatus->uThresholdStatus = iStatus;
+}
+
+/****************************************************************************/
+/* SimThreshold() - Converts a threshold for reporting (no threshold being  */
+/* reported as zero).                                                       */
+/****************************************************************************/
+
+static INT32 SimThreshold( INT32 iThreshold )
+{
+    return( ((iThreshold == SIM_NONE_LOW) || (iThreshold == SIM_NONE_HIGH))? 0 : iThreshold );
+}
+
+/****************************************************************************/
+/* SimSetLevels() - Stores thresholds supplied by a command. A value of     */
+/* zero removes the threshold.                                              */
+/****************************************************************************/
+
+static void SimSetLevels( INT32 *piLevels, INT32 iNone, INT32 iNonCritical, INT32 iCritical, INT32 iNonRecoverable )
+{
+    piLevels[0] = iNonCritical?    iNonCritical    : iNone;
+    piLevels[1] = iCritical?       iCritical       : iNone;
+    piLevels[2] = iNonRecoverable? iNonRecoverable : iNone;
+}
+
+/****************************************************************************/
+/* SimCommand() - Produces the response for a command. Returns the length   */
+/* of the response.                                                         */
+/****************************************************************************/
+
+static size_t SimCommand( P_QST_CMD_HEADER pstCmd, size_t tCmdSize, UINT8 *pbyRsp )
+{
+    int                 iClass = SimClass( pstCmd->byCommand ), iIndex = pstCmd->byEntity, iSensor;
+    size_t              tRspSize = pstCmd->wResponseLength;
+    INT32               iReading;
+    SIM_SENSOR          *pstSensor;
+
+    pstSensor = (iClass >= 0)? &astSim[iClass][iIndex] : NULL;
+
+    // Response must fit and must be large enough for at least the status
+
+    if( (tRspSize == 0) || (tRspSize > SIM_MAX_PACKET) || (tCmdSize != sizeof(QST_CMD_HEADER) + pstCmd->wCommandLength) )
+    {
+        pbyRsp[0] = QST_CMD_REJECTED_CMD_SIZE;
+        return( 1 );
+    }
+
+    memset( pbyRsp, 0, tRspSize );
+    pbyRsp[0] = QST_CMD_SUCCESSFUL;
+
+    switch( pstCmd->byCommand )
+    {
+    case QST_GET_SUBSYSTEM_INFO:
+        {
+            P_QST_GET_SUBSYSTEM_INFO_RSP pstRsp = (P_QST_GET_SUBSYSTEM_INFO_RSP)pbyRsp;
+
+            if( tRspSize != sizeof(*pstRsp) )
+                break;
+
+            pstRsp->uMajorVersionNumber = SIM_MAJOR;
+            pstRsp->uMinorVersionNumber = SIM_MINOR;
+            pstRsp->uRevisionNumber     = SIM_REVISION;
+            pstRsp->uBuildNumber        = SIM_BUILD;
+            pstRsp->uSuppTempMonitors   = QST_ABS_TEMP_MONITORS;
+            pstRsp->uSuppFanMonitors    = QST_ABS_FAN_MONITORS;
+            pstRsp->uSuppVoltMonitors   = QST_ABS_VOLT_MONITORS;
+            pstRsp->uSuppCurrMonitors   = QST_ABS_CURR_MONITORS;
+            pstRsp->uSuppTempResponses  = QST_ABS_TEMP_RESPONSES;
+            pstRsp->uSuppFanControllers = QST_ABS_FAN_CONTROLLERS;
+            pstRsp->uMaxCmdSize         = SIM_MAX_PACKET;
+            return( tRspSize );
+        }
+
+    case QST_GET_SUBSYSTEM_STATUS:
+        {
+            P_QST_GET_SUBSYSTEM_STATUS_RSP pstRsp = (P_QST_GET_SUBSYSTEM_STATUS_RSP)pbyRsp;
+
+            if( tRspSize != sizeof(*pstRsp) )
+                break;
+
+            pstRsp->stSubsystemStatus.bSubsystemConfigured = 1;
+            pstRsp->stConfigStatus.bConfigSuccessful       = 1;
+            pstRsp->stConfigStatus.uFailingEntityType      = QST_VALUE_NONE_UINT3;
+            return( tRspSize );
+        }
+
+    case QST_GET_SUBSYSTEM_CONFIG_PROFILE:
+        {
+            P_QST_GET_SUBSYSTEM_CONFIG_PROFILE_RSP pstRsp = (P_QST_GET_SUBSYSTEM_CONFIG_PROFILE_RSP)pbyRsp;
+
+            if( tRspSize != sizeof(*pstRsp) )
+                break;
+
+            pstRsp->dwTempMonsConfigured = (aiSimCount[SIM_TEMP] == 32)? 0xFFFFFFFF : (1U << aiSimCount[SIM_TEMP]) - 1;
+            pstRsp->dwFanMonsConfigured  = (aiSimCount[SIM_FAN]  == 32)? 0xFFFFFFFF : (1U << aiSimCount[SIM_FAN])  - 1;
+            pstRsp->dwVoltMonsConfigured = (aiSimCount[SIM_VOLT] == 32)? 0xFFFFFFFF : (1U << aiSimCount[SIM_VOLT]) - 1;
+            pstRsp->dwCurrMonsConfigured = (aiSimCount[SIM_CURR] == 32)? 0xFFFFFFFF : (1U << aiSimCount[SIM_CURR]) - 1;
+            pstRsp->dwFanCtrlsConfigured = (aiSimCount[SIM_CTRL] == 32)? 0xFFFFFFFF : (1U << aiSimCount[SIM_CTRL]) - 1;
+            return( tRspSize );
+        }
+
+    case QST_SST_PASS_THROUGH:
+
+        // No SST devices are simulated; reads return zeros
+
+        return( tRspSize );
+
+    case QST_GET_TEMP_MON_UPDATE:
+    case QST_GET_FAN_MON_UPDATE:
+    case QST_GET_VOLT_MON_UPDATE:
+    case QST_GET_CURR_MON_UPDATE:
+    case QST_GET_FAN_CTRL_UPDATE:
+        {
+            // All update entries have the same layout: a status byte followed
+            // by the reading (whose size depends upon the class)
+
+            size_t  tEntry = (iClass == SIM_TEMP)? sizeof(QST_TEMP_MON_UPDATE) :
+                             (iClass == SIM_FAN)?  sizeof(QST_FAN_MON_UPDATE)  :
+                             (iClass == SIM_VOLT)? sizeof(QST_VOLT_MON_UPDATE) :
+                             (iClass == SIM_CURR)? sizeof(QST_CURR_MON_UPDATE) :
+                                                   sizeof(QST_FAN_CTRL_UPDATE);
+            UINT8   *pbyEntry;
+
+            if( ((tRspSize - 1) % tEntry) || ((tRspSize - 1) / tEntry > aiSimMax[iClass]) )
+                break;
+
+            for( iSensor = 0; (iSensor < aiSimCount[iClass]) && (1 + (iSensor + 1) * tEntry <= tRspSize); iSensor++ )
+            {
+                pbyEntry = pbyRsp + 1 + iSensor * tEntry;
+                iReading = SimReading( iClass, iSensor, uSimScan );
+
+                if( iClass == SIM_CTRL )
+                {
+                    QST_FAN_CTRL_UPDATE *pstEntry = (QST_FAN_CTRL_UPDATE *)pbyEntry;
+
+                    pstEntry->stControllerStatus.bControllerEnabled = 1;
+                    pstEntry->stControllerStatus.bOverrideSoftware  = astSim[iClass][iSensor].bManual;
+                    pstEntry->uCurrentDutyCycle                     = (UINT16)iReading;
+                }
+                else
+                {
+                    SimHealth( iClass, iSensor, iReading, (QST_MON_HEALTH_STATUS *)pbyEntry );
+
+                    if( iClass == SIM_FAN )
+                        ((QST_FAN_MON_UPDATE *)pbyEntry)->uCurrentSpeed = (UINT16)iReading;
+                    else
+                        memcpy( pbyEntry + sizeof(QST_MON_HEALTH_STATUS), &iReading, sizeof(INT32) );
+                }
+            }
+
+            return( tRspSize );
+        }
+
+    case QST_GET_TEMP_MON_CONFIG:
+        {
+            P_QST_GET_TEMP_MON_CONFIG_RSP pstRsp = (P_QST_GET_TEMP_MON_CONFIG_RSP)pbyRsp;
+
+            if( (tRspSize != sizeof(*pstRsp)) || (iIndex >= aiSimCount[iClass]) )
+                break;
+
+            pstRsp->bMonitorEnabled      = TRUE;
+            pstRsp->byMonitorUsage       = pstSensor->byUsage;
+            pstRsp->lfTempNominal        = pstSensor->iNominal;
+            pstRsp->lfTempNonCritical    = SimThreshold( pstSensor->aiHigh[0] );
+            pstRsp->lfTempCritical       = SimThreshold( pstSensor->aiHigh[1] );
+            pstRsp->lfTempNonRecoverable = SimThreshold( pstSensor->aiHigh[2] );
+            return( tRspSize );
+        }
+
+    case QST_GET_FAN_MON_CONFIG:
+        {
+            P_QST_GET_FAN_MON_CONFIG_RSP pstRsp = (P_QST_GET_FAN_MON_CONFIG_RSP)pbyRsp;
+
+            if( (tRspSize != sizeof(*pstRsp)) || (iIndex >= aiSimCount[iClass]) )
+                break;
+
+            pstRsp->bMonitorEnabled      = TRUE;
+            pstRsp->byMonitorUsage       = pstSensor->byUsage;
+            pstRsp->uSpeedNominal        = (UINT16)pstSensor->iNominal;
+            pstRsp->uSpeedNonCritical    = (UINT16)SimThreshold( pstSensor->aiLow[0] );
+            pstRsp->uSpeedCritical       = (UINT16)SimThreshold( pstSensor->aiLow[1] );
+            pstRsp->uSpeedNonRecoverable = (UINT16)SimThreshold( pstSensor->aiLow[2] );
+            return( tRspSize );
+        }
+
+    case QST_GET_VOLT_MON_CONFIG:
+        {
+            P_QST_GET_VOLT_MON_CONFIG_RSP pstRsp = (P_QST_GET_VOLT_MON_CONFIG_RSP)pbyRsp;
+
+            if( (tRspSize != sizeof(*pstRsp)) || (iIndex >= aiSimCount[iClass]) )
+                break;
+
+            pstRsp->bMonitorEnabled             = TRUE;
+            pstRsp->byMonitorUsage              = pstSensor->byUsage;
+            pstRsp->iVoltageNominal             = pstSensor->iNominal;
+            pstRsp->iUnderVoltageNonCritical    = SimThreshold( pstSensor->aiLow[0] );
+            pstRsp->iOverVoltageNonCritical     = SimThreshold( pstSensor->aiHigh[0] );
+            pstRsp->iUnderVoltageCritical       = SimThreshold( pstSensor->aiLow[1] );
+            pstRsp->iOverVoltageCritical        = SimThreshold( pstSensor->aiHigh[1] );
+            pstRsp->iUnderVoltageNonRecoverable = SimThreshold( pstSensor->aiLow[2] );
+            pstRsp->iOverVoltageNonRecoverable  = SimThreshold( pstSensor->aiHigh[2] );
+            return( tRspSize );
+        }
+
+    case QST_GET_CURR_MON_CONFIG:
+        {
+            P_QST_GET_CURR_MON_CONFIG_RSP pstRsp = (P_QST_GET_CURR_MON_CONFIG_RSP)pbyRsp;
+
+            if( (tRspSize != sizeof(*pstRsp)) || (iIndex >= aiSimCount[iClass]) )
+                break;
+
+            pstRsp->bMonitorEnabled             = TRUE;
+            pstRsp->byMonitorUsage              = pstSensor->byUsage;
+            pstRsp->iCurrentNominal             = pstSensor->iNominal;
+            pstRsp->iUnderCurrentNonCritical    = SimThreshold( pstSensor->aiLow[0] );
+            pstRsp->iOverCurrentNonCritical     = SimThreshold( pstSensor->aiHigh[0] );
+            pstRsp->iUnderCurrentCritical       = SimThreshold( pstSensor->aiLow[1] );
+            pstRsp->iOverCurrentCritical        = SimThreshold( pstSensor->aiHigh[1] );
+            pstRsp->iUnderCurrentNonRecoverable = SimThreshold( pstSensor->aiLow[2] );
+            pstRsp->iOverCurrentNonRecoverable  = SimThreshold( pstSensor->aiHigh[2] );
+            return( tRspSize );
+        }
+
+    case QST_GET_FAN_CTRL_CONFIG:
+        {
+            P_QST_GET_FAN_CTRL_CONFIG_RSP pstRsp = (P_QST_GET_FAN_CTRL_CONFIG_RSP)pbyRsp;
+
+            if( (tRspSize != sizeof(*pstRsp)) || (iIndex >= aiSimCount[iClass]) )
+                break;
+
+            pstRsp->bControllerEnabled = TRUE;
+            pstRsp->byControllerUsage  = pstSensor->byUsage;
+            return( tRspSize );
+        }
+
+    case QST_SET_TEMP_MON_THRESHOLDS:
+        {
+            P_QST_SET_TEMP_MON_THRESHOLDS_CMD pstSet = (P_QST_SET_TEMP_MON_THRESHOLDS_CMD)pstCmd;
+
+            if( (tCmdSize != sizeof(*pstSet)) || (iIndex >= aiSimCount[iClass]) )
+                break;
+
+            SimSetLevels( pstSensor->aiHigh, SIM_NONE_HIGH, pstSet->lfTempNonCritical,
+                          pstSet->lfTempCritical, pstSet->lfTempNonRecoverable );
+            return( 1 );
+        }
+
+    case QST_SET_FAN_MON_THRESHOLDS:
+        {
+            P_QST_SET_FAN_MON_THRESHOLDS_CMD pstSet = (P_QST_SET_FAN_MON_THRESHOLDS_CMD)pstCmd;
+
+            if( (tCmdSize != sizeof(*pstSet)) || (iIndex >= aiSimCount[iClass]) )
+                break;
+
+            SimSetLevels( pstSensor->aiLow, SIM_NONE_LOW, pstSet->uSpeedNonCritical,
+                          pstSet->uSpeedCritical, pstSet->uSpeedNonRecoverable );
+            return( 1 );
+        }
+
+    case QST_SET_VOLT_MON_THRESHOLDS:
+        {
+            P_QST_SET_VOLT_MON_THRESHOLDS_CMD pstSet = (P_QST_SET_VOLT_MON_THRESHOLDS_CMD)pstCmd;
+
+            if( (tCmdSize != sizeof(*pstSet)) || (iIndex >= aiSimCount[iClass]) )
+                break;
+
+            SimSetLevels( pstSensor->aiLow, SIM_NONE_LOW, pstSet->iUnderVoltageNonCritical,
+                          pstSet->iUnderVoltageCritical, pstSet->iUnderVoltageNonRecoverable );
+            SimSetLevels( pstSensor->aiHigh, SIM_NONE_HIGH, pstSet->iOverVoltageNonCritical,
+                          pstSet->iOverVoltageCritical, pstSet->iOverVoltageNonRecoverable );
+            return( 1 );
+        }
+
+    case QST_SET_CURR_MON_THRESHOLDS:
+        {
+            P_QST_SET_CURR_MON_THRESHOLDS_CMD pstSet = (P_QST_SET_CURR_MON_THRESHOLDS_CMD)pstCmd;
+
+            if( (tCmdSize != sizeof(*pstSet)) || (iIndex >= aiSimCount[iClass]) )
+                break;
+
+            SimSetLevels( pstSensor->aiLow, SIM_NONE_LOW, pstSet->iUnderCurrentNonCritical,
+                          pstSet->iUnderCurrentCritical, pstSet->iUnderCurrentNonRecoverable );
+            SimSetLevels( pstSensor->aiHigh, SIM_NONE_HIGH, pstSet->iOverCurrentNonCritical,
+                          pstSet->iOverCurrentCritical, pstSet->iOverCurrentNonRecoverable );
+            return( 1 );
+        }
+
+    case QST_SET_FAN_CTRL_DUTY:
+        {
+            P_QST_SET_FAN_CTRL_DUTY_CMD pstSet = (P_QST_SET_FAN_CTRL_DUTY_CMD)pstCmd;
+
+            if( (tCmdSize != sizeof(*pstSet)) || (iIndex >= aiSimCount[iClass]) || (pstSet->uDutyCycle > 10000) )
+                break;
+
+            pstSensor->bManual = TRUE;
+            pstSensor->iManual = pstSet->uDutyCycle;
+            return( 1 );
+        }
+
+    case QST_SET_FAN_CTRL_AUTO:
+
+        if( iIndex >= aiSimCount[iClass] )
+            break;
+
+        pstSensor->bManual = FALSE;
+        return( 1 );
+
+    default:
+
+        pbyRsp[0] = QST_CMD_REJECTED_UNSUPPORTED;
+        return( 1 );
+    }
+
+    // Only get here if command's parameters were bad
+
+    pbyRsp[0] = QST_CMD_REJECTED_PARAMETER;
+    return( 1 );
+}
+
+/****************************************************************************/
+/* SimArm() - Sets the timer to expire when the oldest response becomes     */
+/* available (or clears it if there is none)                                */
+/****************************************************************************/
+
+static void SimArm( void )
+{
+    struct itimerspec   stTimer;
+
+    if( !bSimWatched )
+        return;
+
+    memset( &stTimer, 0, sizeof(stTimer) );
+
+    if( iSimCount )
+    {
+        stTimer.it_value.tv_sec  = (time_t)(astSimQueue[iSimHead].uReady / 1000000000ULL);
+        stTimer.it_value.tv_nsec = (long)(astSimQueue[iSimHead].uReady % 1000000000ULL);
+
+        if( !stTimer.it_value.tv_sec && !stTimer.it_value.tv_nsec )
+            stTimer.it_value.tv_nsec = 1;
+    }
+
+    timerfd_settime( iSimTimer, TFD_TIMER_ABSTIME, &stTimer, NULL );
+}
+
+/****************************************************************************/
+/* SimDisconnect() - Disconnects from the simulated subsystem               */
+/****************************************************************************/
+
+static void SimDisconnect( void )
+{
+    bSimConnected = FALSE;
+    iSimHead = iSimCount = 0;
+
+    SimArm();
+}
+
+/****************************************************************************/
+/* SimConnect() - Connects to the simulated subsystem                       */
+/****************************************************************************/
+
+static size_t SimConnect( const GUID *pSubsysGUID )
+{
+    SimDisconnect();
+
+    // Sensors are configured on first connection and then persist, so
+    // thresholds set survive the connection being reset
+
+    if( !uSimStart )
+    {
+        SimConfigure();
+        uSimStart = SimNow();
+    }
+
+    uSimFree      = 0;
+    bSimConnected = TRUE;
+
+    return( SIM_MAX_PACKET );
+}
+
+/****************************************************************************/
+/* SimPost() - Sends a packet to the simulated subsystem. The response is   */
+/* produced immediately but not made available until the model subsystem    */
+/* would have finished with the command.                                    */
+/****************************************************************************/
+
+static BOOL SimPost( void *pvBuff, size_t tBuffLen )
+{
+    P_QST_CMD_HEADER    pstCmd = (P_QST_CMD_HEADER)pvBuff;
+    SIM_RESPONSE        *pstRsp;
+    uint64_t            uNow;
+
+    if( !bSimConnected )
+    {
+        errno = EBADF;
+        return( FALSE );
+    }
+
+    if( (tBuffLen < sizeof(QST_CMD_HEADER)) || (tBuffLen > SIM_MAX_PACKET) )
+    {
+        errno = EINVAL;
+        return( FALSE );
+    }
+
+    if( iSimCount == SIM_QUEUE )
+    {
+        errno = EAGAIN;
+        return( FALSE );
+    }
+
+    if( ulSimReset && (++ulSimPosted > ulSimReset) )
+    {
+        ulSimPosted = 0;
+        SimDisconnect();
+
+        errno = EIO;
+        return( FALSE );
+    }
+
+    pstRsp = &astSimQueue[(iSimHead + iSimCount++) % SIM_QUEUE];
+
+    uNow     = SimNow();
+    uSimFree = ((uNow > uSimFree)? uNow : uSimFree) +
+               ((pstCmd->byCommand <= QST_LAST_CMD_CODE)? auSimLatency[pstCmd->byCommand] : SIM_LATENCY * 1000ULL);
+
+    // First of a batch scans the sensors (see note 2)
+
+    if( iSimCount == 1 )
+        uSimScan = (uNow - uSimStart) / 1000000ULL;
+
+    pstRsp->uReady = uSimFree;
+    pstRsp->tLen   = SimCommand( pstCmd, tBuffLen, pstRsp->abyData );
+
+    if( iSimCount == 1 )
+        SimArm();
+
+    return( TRUE );
+}
+
+/****************************************************************************/
+/* SimWait() - Waits (up to iTimeout milliseconds) for a response packet to */
+/* become available                                                         */
+/****************************************************************************/
+
+static BOOL SimWait( int iTimeout )
+{
+    struct timespec     stTime;
+    uint64_t            uUntil = SimNow() + (uint64_t)iTimeout * 1000000ULL;
+    BOOL                bReady = (iSimCount > 0) && (astSimQueue[iSimHead].uReady <= uUntil);
+
+    if( bReady && (astSimQueue[iSimHead].uReady < uUntil) )
+        uUntil = astSimQueue[iSimHead].uReady;
+
+    stTime.tv_sec  = (time_t)(uUntil / 1000000000ULL);
+    stTime.tv_nsec = (long)(uUntil % 1000000000ULL);
+
+    while( clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &stTime, NULL ) == EINTR );
+
+    if( !bReady )
+        errno = ETIMEDOUT;
+
+    return( bReady );
+}
+
+/****************************************************************************/
+/* SimReceive() - Receives a packet from the simulated subsystem            */
+/****************************************************************************/
+
+static int SimReceive( void *pvBuff, size_t tBuffMax )
+{
+    SIM_RESPONSE        *pstRsp = &astSimQueue[iSimHead];
+
+    if( !iSimCount )
+    {
+        errno = EIO;
+        return( -1 );
+    }
+
+    // Like the driver, block until response is available
+
+    if( pstRsp->uReady > SimNow() )
+        SimWait( (int)((pstRsp->uReady - SimNow()) / 1000000ULL) + 1 );
+
+    iSimHead = (iSimHead + 1) % SIM_QUEUE;
+    iSimCount--;
+
+    SimArm();
+
+    if( pstRsp->tLen > tBuffMax )
+    {
+        errno = ENOSPC;
+        return( -1 );
+    }
+
+    memcpy( pvBuff, pstRsp->abyData, pstRsp->tLen );
+    return( (int)pstRsp->tLen );
+}
+
+/****************************************************************************/
+/* SimGetFD() - Returns a descriptor that is readable when a response is    */
+/* available                                                                */
+/****************************************************************************/
+
+static int SimGetFD( void )
+{
+    if( !bSimConnected )
+        return( -1 );
+
+    if( !bSimWatched )
+    {
+        bSimWatched = TRUE;
+        SimArm();
+    }
+
+    return( iSimTimer );
+}
+
+/****************************************************************************/
+/* SimInitialize() - Initializes the transport                              */
+/****************************************************************************/
+
+static BOOL SimInitialize( void )
+{
+    bSimConnected = FALSE;
+    bSimWatched   = FALSE;
+    iSimHead = iSimCount = 0;
+
+    iSimTimer = timerfd_create( CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC );
+
+    return( iSimTimer != -1 );
+}
+
+/****************************************************************************/
+/* SimCleanup() - Cleans up after the transport                             */
+/****************************************************************************/
+
+static void SimCleanup( void )
+{
+    SimDisconnect();
+
+    if( iSimTimer != -1 )
+    {
+        close( iSimTimer );
+        iSimTimer = -1;
+    }
+}
+
+/****************************************************************************/
+/* HeciSimReading() - Returns the reading that the sensor (or controller)   */
+/* with the specified index reports, in the response to the specified       */
+/* update command, the specified number of milliseconds after the simulated */
+/* subsystem was first connected to (as if its duty cycle hadn't been       */
+/* overridden). Returns 0 for a sensor that isn't simulated. Sensors are    */
+/* configured from the environment if no connection has yet been made.      */
+/****************************************************************************/
+
+INT32 HeciSimReading( UINT8 byUpdate, int iIndex, unsigned long ulElapsed )
+{
+    int                 iClass = SimClass( byUpdate );
+
+    if( !bSimConfigured )
+        SimConfigure();
+
+    if( (iClass < 0) || (iIndex < 0) || (iIndex >= aiSimCount[iClass]) )
+        return( 0 );
+
+    return( SimWave( iClass, iIndex, (uint64_t)ulElapsed ) );
+}
+
+/****************************************************************************/
+/* stHeciSim - Transport that simulates the QST Subsystem                   */
+/****************************************************************************/
+
+const HECI_TRANSPORT stHeciSim =
+{
+    "sim",
+    SimInitialize,
+    SimCleanup,
+    SimConnect,
+    SimDisconnect,
+    SimPost,
+    SimWait,
+    SimReceive,
+    SimGetFD
+};
@@ -0,0 +1,2333 @@
+/****************************************************************************/
+/*                                                                          */
+/*  Module:         QstBench.c                                              */
+/*                                                                          */
+/*  Description:    Implements  program  QstBench,  which   measures   the  */
+/*                  performance of the Linux communication support modules  */
+/*                  without requiring an ME to be present.                  */
+/*                                                                          */
+/*  Notes:      1.  Benchmark "pipe" drives the  HECI  transaction  engine  */
+/*                  (HeciPipe.c) with a loopback transport, which models a  */
+/*                  subsystem that takes  a  fixed  time  to  handle  each  */
+/*                  command and a link that takes a fixed  time  to  carry  */
+/*                  each packet. It reports the throughput achieved by  1,  */
+/*                  4 and 16 concurrent callers with the engine limited to  */
+/*                  one outstanding transaction (the previous, serialized,  */
+/*                  behavior) and with the requested depth.                 */
+/*                                                                          */
+/*              2.  Benchmark "comm" loads libQstComm with  the  simulator  */
+/*                  transport  (HeciSim.c)  selected   and   reports   the  */
+/*                  throughput and latency of QstCommand2() for 1,  4  and  */
+/*                  16  concurrent  callers.   The   library   is   loaded  */
+/*                  dynamically so that  the  transport  can  be  selected  */
+/*                  before it initializes. Option  -b  makes  the  callers  */
+/*                  receive  into  buffers  borrowed  from   the   library  */
+/*                  (QstBorrowBuffer()).                                    */
+/*                                                                          */
+/*              3.  Benchmark "async" runs the same command from a  single  */
+/*                  thread's epoll loop using QstCommandAsync(),  with  1,  */
+/*                  4, 16 and 64 commands kept outstanding.                 */
+/*                                                                          */
+/*              4.  Benchmark "lock" compares the  cost  of  entering  and  */
+/*                  leaving  a  critical  section  using  the  futex-based  */
+/*                  implementation in  CritSect.c  against  the  System  V  */
+/*                  semaphore operations it replaced, both uncontended and  */
+/*                  with several threads contending.                        */
+/*                                                                          */
+/*              5.  Benchmark "modes" runs the callers of benchmark "comm"  */
+/*                  in  each  of  the  library's  concurrency  modes  (see  */
+/*                  QstSetConcurrency()). Each mode is measured in a child  */
+/*                  process, since a mode can only be selected before  the  */
+/*                  library sends its first command.                        */
+/*                                                                          */
+/*              6.  Benchmark "xlate" times the translation of  a  mix  of  */
+/*                  commands from the QST 2.x command set to the  1.x  set  */
+/*                  and back, with CommonCmdHandler() replaced by a stub.   */
+/*                                                                          */
+/*              7.  Benchmark  "update"   has   several   processes   take  */
+/*                  snapshots   of   every   reading    with    libQstInst  */
+/*                  (QstGetAllReadings()), against the simulator answering  */
+/*                  at once, while the readings are  refreshed  every  few  */
+/*                  milliseconds. It  checks  each  snapshot  against  the  */
+/*                  simulated waveforms (HeciSimReading()), then does  the  */
+/*                  same with the readings gathered one call at a time  as  */
+/*                  a control, and  fails  if  a  snapshot  tears  or  the  */
+/*                  control never does.                                     */
+/*                                                                          */
+/*              8.  Benchmark "globmem" times new  client  processes  that  */
+/*                  look up, map and first touch a global  memory  segment  */
+/*                  of each type (GlobMem.c): System V shared  memory  and  */
+/*                  files in /dev/shm, each with and without a  huge  page  */
+/*                  request.                                                */
+/*                                                                          */
+/*              9.  Benchmark  "hot"  has  several  processes   read   the  */
+/*                  temperature  readings   and   health   in   a   shared  */
+/*                  QST_DATA_SEGMENT  while  another  rewrites   the   fan  */
+/*                  controller update,  first  converting  them  from  the  */
+/*                  update responses (as the library  used  to)  and  then  */
+/*                  copying them from the hot blocks (QstDll.h).            */
+/*                                                                          */
+/*              10. Benchmark  "event"  has  several  processes  wait  for  */
+/*                  events  posted  to  the  event  stamps  of  a   shared  */
+/*                  QST_DATA_SEGMENT,  first  by  sleeping  for  a   fixed  */
+/*                  polling interval between checks (as the  service  loop  */
+/*                  of QstProtServ does) and  then  by  waiting  upon  the  */
+/*                  stamp count (WaitEvent() in QstDll.h), and reports how  */
+/*                  soon after each event was posted it was noticed.        */
+/*                                                                          */
+/*              11. Benchmark "timer" ticks every few  milliseconds  using  */
+/*                  the computed relative sleep WaitMTime() used  to  make  */
+/*                  (emulated here), the absolute sleep it makes now and a  */
+/*                  periodic MILLITIMER (timerfd),  and  reports  how  far  */
+/*                  from its scheduled time each tick was. It  also  times  */
+/*                  an expiry check  (CurrMTime()  and  PastMTime())  with  */
+/*                  wall clock and monotonic times.                         */
+/*                                                                          */
+/****************************************************************************/
+
+/****************************************************************************/
+/*                                                                          */
+/*     Copyright (c) 2005-2009, Intel Corporation. All Rights Reserved.     */
+/*                                                                          */
+/*  Redistribution and use in source and binary  forms,  with  or  without  */
+/*  modification, are permitted provided that the following conditions are  */
+/*  met:                                                                    */
+/*                                                                          */
+/*    - Redistributions of source code must  retain  the  above  copyright  */
+/*      notice, this list of conditions and the following disclaimer.       */
+/*                                                                          */
+/*    - Redistributions  in binary form must reproduce the above copyright  */
+/*      notice, this list of conditions and the  following  disclaimer  in  */
+/*      the   documentation  and/or  other  materials  provided  with  the  */
+/*      distribution.                                                       */
+/*                                                                          */
+/*    - Neither the name  of  Intel  Corporation  nor  the  names  of  its  */
+/*      contributors  may  be  used to endorse or promote products derived  */
+/*      from this software without specific prior written permission.       */
+/*                                                                          */
+/*  DISCLAIMER: THIS SOFTWARE IS PROVIDED BY  THE  COPYRIGHT  HOLDERS  AND  */
+/*  CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  */
+/*  BUT  NOT  LIMITED  TO,  THE  IMPLIED WARRANTIES OF MERCHANTABILITY AND  */
+/*  FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN  NO  EVENT  SHALL  */
+/*  INTEL  CORPORATION  OR  THE  CONTRIBUTORS  BE  LIABLE  FOR ANY DIRECT,  */
+/*  INDIRECT, INCIDENTAL, SPECIAL,  EXEMPLARY,  OR  CONSEQUENTIAL  DAMAGES  */
+/*  (INCLUDING,  BUT  NOT  LIMITED  TO, PROCUREMENT OF SUBSTITUTE GOODS OR  */
+/*  SERVICES; LOSS OF USE, DATA, OR  PROFITS;  OR  BUSINESS  INTERRUPTION)  */
+/*  HOWEVER  CAUSED  AND  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,  */
+/*  STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)  ARISING  */
+/*  IN  ANY  WAY  OUT  OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE  */
+/*  POSSIBILITY OF SUCH DAMAGE.                                             */
+/*                                                                          */
+/****************************************************************************/
+
+#ifndef __linux__
+#error This source module intended for use in Linux environments only
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <dlfcn.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/ipc.h>
+#include <sys/sem.h>
+#include <sys/shm.h>
+#include <sys/mman.h>
+#include <sys/epoll.h>
+#include <sys/time.h>
+#include <dirent.h>
+#include <limits.h>
+
+#include "QstCmd.h"
+#include "QstCmdLeg.h"
+#include "QstComm.h"
+#include "QstInst.h"
+#include "heci.h"
+#include "HeciPipe.h"
+#include "CritSect.h"
+#include "LegTranslationFuncs.h"
+#include "QstDll.h"
+#include "GlobMem.h"
+
+/****************************************************************************/
+/* Configuration                                                            */
+/****************************************************************************/
+
+#define BENCH_TIME      2000            // Default run time per measurement (milliseconds)
+
+#define LOOP_DEPTH      4               // Default transactions outstanding
+#define LOOP_LINK       200             // Default link time per packet (microseconds)
+#define LOOP_SERVICE    50              // Default subsystem time per command (microseconds)
+#define LOOP_MAX_PACKET 512             // Maximum packet size for loopback
+
+#define COMM_LIBRARY    "libQstComm.so.1"
+#define COMM_LATENCY    20              // Default simulated time per command (microseconds)
+
+#define LOCK_COUNT      1000000         // Default entries per measurement
+#define LOCK_THREADS    4               // Default contending threads
+
+#define XLATE_COUNT     1000000         // Default commands per measurement
+
+#define UPDATE_LIBRARY  "libQstInst.so.1"
+#define UPDATE_READERS  4               // Default reading processes
+#define UPDATE_MAX      64              // Maximum reading processes
+#define UPDATE_POLLING  "20"            // Polling interval of every class (milliseconds)
+#define UPDATE_PERIOD   200             // Period of simulated readings (milliseconds)
+
+#define GLOBMEM_SIZE    256             // Default segment size (KiB)
+#define GLOBMEM_CLIENTS 200             // Default clients per segment type
+
+#define HOT_READERS     4               // Default reading processes
+#define HOT_SENSORS     8               // Default temperature monitors read
+
+#define EVENT_WAITERS   4               // Default waiting processes
+#define EVENT_POLLING   100             // Default polling interval (milliseconds)
+#define EVENT_INTERVAL  10              // Default time between events (milliseconds)
+
+#define TIMER_INTERVAL  10              // Default time between ticks (milliseconds)
+#define TIMER_CHECKS    1000000         // Expiry checks timed
+
+/****************************************************************************/
+/* Common support                                                           */
+/****************************************************************************/
+
+static uint64_t NowNS( void )
+{
+    struct timespec stTime;
+
+    clock_gettime( CLOCK_MONOTONIC, &stTime );
+    return( (uint64_t)stTime.tv_sec * 1000000000ULL + stTime.tv_nsec );
+}
+
+static void SleepUntilNS( uint64_t uTime )
+{
+    struct timespec stTime;
+
+    stTime.tv_sec  = (time_t)(uTime / 1000000000ULL);
+    stTime.tv_nsec = (long)(uTime % 1000000000ULL);
+
+    while( clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &stTime, NULL ) == EINTR );
+}
+
+/****************************************************************************/
+/* Loopback transport. Commands posted are answered, in order, by a model   */
+/* subsystem that needs uLoopService ns per command and a link that needs   */
+/* uLoopLink ns to carry each packet. Each response carries a successful    */
+/* status byte followed by zeros, sized as the command header requests.     */
+/****************************************************************************/
+
+typedef struct _LOOP_PACKET
+{
+    uint64_t            uReady;         // Time response becomes available
+    size_t              tLen;           // Response length
+
+} LOOP_PACKET;
+
+static LOOP_PACKET      astLoop[HECI_PIPE_MAX_DEPTH];
+static int              iLoopHead, iLoopCount;
+static uint64_t         uLoopFree;      // Time subsystem is next free
+static uint64_t         uLoopLink;
+static uint64_t         uLoopService;
+
+static int LoopAttach( int iTimeout )
+{
+    iLoopHead = iLoopCount = 0;
+    uLoopFree = 0;
+
+    return( LOOP_MAX_PACKET );
+}
+
+static void LoopDetach( void )
+{
+    iLoopHead = iLoopCount = 0;
+}
+
+static BOOL LoopPost( void *pvBuff, size_t tBuffLen )
+{
+    P_QST_CMD_HEADER    pstHeader = (P_QST_CMD_HEADER)pvBuff;
+    LOOP_PACKET         *pstPkt;
+    uint64_t            uArrive;
+
+    if( (tBuffLen < sizeof(QST_CMD_HEADER)) || (iLoopCount == HECI_PIPE_MAX_DEPTH) )
+    {
+        errno = EIO;
+        return( FALSE );
+    }
+
+    // Command arrives after link time; subsystem handles one at a time
+
+    uArrive   = NowNS() + uLoopLink;
+    uLoopFree = ((uArrive > uLoopFree)? uArrive : uLoopFree) + uLoopService;
+
+    pstPkt         = &astLoop[(iLoopHead + iLoopCount++) % HECI_PIPE_MAX_DEPTH];
+    pstPkt->uReady = uLoopFree + uLoopLink;
+    pstPkt->tLen   = pstHeader->wResponseLength? pstHeader->wResponseLength : 1;
+
+    return( TRUE );
+}
+
+static BOOL LoopWait( int iTimeout )
+{
+    if( !iLoopCount )
+    {
+        errno = ETIMEDOUT;
+        return( FALSE );
+    }
+
+    SleepUntilNS( astLoop[iLoopHead].uReady );
+    return( TRUE );
+}
+
+static int LoopReceive( void *pvBuff, size_t tBuffMax )
+{
+    LOOP_PACKET         *pstPkt = &astLoop[iLoopHead];
+
+    if( !iLoopCount )
+    {
+        errno = EIO;
+        return( -1 );
+    }
+
+    iLoopHead = (iLoopHead + 1) % HECI_PIPE_MAX_DEPTH;
+    iLoopCount--;
+
+    if( pstPkt->tLen > tBuffMax )
+    {
+        errno = ENOSPC;
+        return( -1 );
+    }
+
+    memset( pvBuff, 0, pstPkt->tLen );
+    ((UINT8 *)pvBuff)[0] = QST_CMD_SUCCESSFUL;
+
+    return( (int)pstPkt->tLen );
+}
+
+static const HECI_PIPE_OPS stLoopOps =
+{
+    LoopAttach,
+    LoopDetach,
+    LoopPost,
+    LoopWait,
+    LoopReceive,
+    NULL,
+    NULL,
+    NULL
+};
+
+/****************************************************************************/
+/* Benchmark "pipe" - Measures the throughput of the transaction engine.    */
+/****************************************************************************/
+
+typedef struct _PIPE_CALLER
+{
+    pthread_t           hThread;
+    uint64_t            uEnd;           // Time to stop
+    unsigned long       ulCommands;     // Commands completed
+    unsigned long       ulFailures;     // Commands failed
+    uint64_t            uLatency;       // Total latency (ns)
+
+} PIPE_CALLER;
+
+static void *PipeCaller( void *pvArg )
+{
+    PIPE_CALLER                 *pstCaller = (PIPE_CALLER *)pvArg;
+    QST_GENERIC_CMD             stCmd;
+    QST_GET_TEMP_MON_UPDATE_RSP stRsp;
+    uint64_t                    uStart;
+    BOOL                        bGiveUp;
+
+    stCmd.stHeader.byCommand       = QST_GET_TEMP_MON_UPDATE;
+    stCmd.stHeader.byEntity        = 0;
+    stCmd.stHeader.wCommandLength  = 0;
+    stCmd.stHeader.wResponseLength = sizeof(stRsp);
+
+    while( (uStart = NowNS()) < pstCaller->uEnd )
+    {
+        if( HeciPipeTransact( &stCmd, sizeof(stCmd), &stRsp, sizeof(stRsp), &bGiveUp ) == sizeof(stRsp) )
+        {
+            pstCaller->ulCommands++;
+            pstCaller->uLatency += NowNS() - uStart;
+        }
+        else
+            pstCaller->ulFailures++;
+    }
+
+    return( NULL );
+}
+
+static double PipeRun( int iDepth, int iCallers, int iTime, double *pdLatency )
+{
+    PIPE_CALLER         astCaller[16];
+    unsigned long       ulCommands = 0, ulFailures = 0;
+    uint64_t            uLatency = 0, uStart, uEnd;
+    int                 iCaller;
+
+    HeciPipeInitialize( &stLoopOps, iDepth, 1000 );
+
+    memset( astCaller, 0, sizeof(astCaller) );
+
+    uStart = NowNS();
+    uEnd   = uStart + (uint64_t)iTime * 1000000ULL;
+
+    for( iCaller = 0; iCaller < iCallers; iCaller++ )
+    {
+        astCaller[iCaller].uEnd = uEnd;
+        pthread_create( &astCaller[iCaller].hThread, NULL, PipeCaller, &astCaller[iCaller] );
+    }
+
+    for( iCaller = 0; iCaller < iCallers; iCaller++ )
+    {
+        pthread_join( astCaller[iCaller].hThread, NULL );
+
+        ulCommands += astCaller[iCaller].ulCommands;
+        ulFailures += astCaller[iCaller].ulFailures;
+        uLatency   += astCaller[iCaller].uLatency;
+    }
+
+    uEnd = NowNS();
+
+    HeciPipeCleanup();
+
+    if( ulFailures )
+        printf( "   (%lu commands failed)\n", ulFailures );
+
+    *pdLatency = ulCommands? (double)uLatency / ulCommands / 1000.0 : 0.0;
+
+    return( (double)ulCommands * 1000000000.0 / (double)(uEnd - uStart) );
+}
+
+static int BenchPipe( int iArgs, char *pszArg[] )
+{
+    static const int    aiCallers[] = { 1, 4, 16 };
+
+    int                 iDepth = LOOP_DEPTH, iTime = BENCH_TIME;
+    int                 iLink = LOOP_LINK, iService = LOOP_SERVICE;
+    int                 iIndex, iOpt;
+    double              dSerial, dPiped, dSerialLat, dPipedLat;
+
+    for( iOpt = 0; iOpt + 1 < iArgs; iOpt += 2 )
+    {
+        if( !strcmp( pszArg[iOpt], "-d" ) )
+            iDepth = atoi( pszArg[iOpt + 1] );
+        else if( !strcmp( pszArg[iOpt], "-l" ) )
+            iLink = atoi( pszArg[iOpt + 1] );
+        else if( !strcmp( pszArg[iOpt], "-s" ) )
+            iService = atoi( pszArg[iOpt + 1] );
+        else if( !strcmp( pszArg[iOpt], "-t" ) )
+            iTime = atoi( pszArg[iOpt + 1] );
+        else
+            break;
+    }
+
+    if( (iOpt != iArgs) || (iDepth < 1) || (iDepth > HECI_PIPE_MAX_DEPTH) || (iTime < 1) )
+    {
+        puts( "Usage: QstBench pipe [-d depth] [-l link-us] [-s service-us] [-t time-ms]" );
+        return( 1 );
+    }
+
+    uLoopLink    = (uint64_t)iLink * 1000;
+    uLoopService = (uint64_t)iService * 1000;
+
+    printf( "Loopback: link %d us per packet, subsystem %d us per command\n\n", iLink, iService );
+    printf( "Callers     Depth 1 (cmds/s, avg us)     Depth %-2d (cmds/s, avg us)   Speedup\n", iDepth );
+    printf( "-------     ------------------------     -------------------------   -------\n" );
+
+    for( iIndex = 0; iIndex < sizeof(aiCallers) / sizeof(aiCallers[0]); iIndex++ )
+    {
+        dSerial = PipeRun( 1,      aiCallers[iIndex], iTime, &dSerialLat );
+        dPiped  = PipeRun( iDepth, aiCallers[iIndex], iTime, &dPipedLat );
+
+        printf( "%7d     %10.0f %10.1f        %10.0f %10.1f        %6.2fx\n",
+                aiCallers[iIndex], dSerial, dSerialLat, dPiped, dPipedLat,
+                dSerial? dPiped / dSerial : 0.0 );
+    }
+
+    return( 0 );
+}
+
+/****************************************************************************/
+/* Benchmark "comm" - Measures the throughput of libQstComm (QstCommand2()) */
+/* against the simulated subsystem.                                         */
+/****************************************************************************/
+
+typedef BOOL  (*COMM_FUNC)( void *, size_t, void *, size_t );
+typedef void *(*BORROW_FUNC)( void );
+typedef void  (*RETURN_FUNC)( void * );
+
+static COMM_FUNC        pfnCommand;
+static BORROW_FUNC      pfnBorrow;
+static RETURN_FUNC      pfnReturn;
+static BOOL             bCommBorrow;
+
+static void *CommCaller( void *pvArg )
+{
+    PIPE_CALLER                 *pstCaller = (PIPE_CALLER *)pvArg;
+    QST_GENERIC_CMD             stCmd;
+    QST_GET_TEMP_MON_UPDATE_RSP stRsp, *pstRsp = &stRsp;
+    uint64_t                    uStart;
+
+    if( bCommBorrow && ((pstRsp = (QST_GET_TEMP_MON_UPDATE_RSP *)pfnBorrow()) == NULL) )
+    {
+        pstCaller->ulFailures++;
+        return( NULL );
+    }
+
+    stCmd.stHeader.byCommand       = QST_GET_TEMP_MON_UPDATE;
+    stCmd.stHeader.byEntity        = 0;
+    stCmd.stHeader.wCommandLength  = 0;
+    stCmd.stHeader.wResponseLength = sizeof(stRsp);
+
+    while( (uStart = NowNS()) < pstCaller->uEnd )
+    {
+        if( pfnCommand( &stCmd, sizeof(stCmd), pstRsp, sizeof(stRsp) ) && (pstRsp->byStatus == QST_CMD_SUCCESSFUL) )
+        {
+            pstCaller->ulCommands++;
+            pstCaller->uLatency += NowNS() - uStart;
+        }
+        else
+            pstCaller->ulFailures++;
+    }
+
+    if( bCommBorrow )
+        pfnReturn( pstRsp );
+
+    return( NULL );
+}
+
+static void *CommLoad( int iLatency )
+{
+    char                szLatency[16];
+    void                *hLib;
+
+    // Select simulator before library initializes; an explicit latency
+    // setting in the environment takes precedence
+
+    sprintf( szLatency, "%d", iLatency );
+
+    setenv( "QST_HECI_TRANSPORT", "sim", 1 );
+    setenv( "QST_SIM_LATENCY", szLatency, 0 );
+
+    if(    ((hLib = dlopen( COMM_LIBRARY, RTLD_NOW )) == NULL)
+        || ((pfnCommand = (COMM_FUNC)dlsym( hLib, "QstCommand2" )) == NULL)
+        || ((pfnBorrow = (BORROW_FUNC)dlsym( hLib, "QstBorrowBuffer" )) == NULL)
+        || ((pfnReturn = (RETURN_FUNC)dlsym( hLib, "QstReturnBuffer" )) == NULL) )
+    {
+        printf( "Unable to load %s: %s\n", COMM_LIBRARY, dlerror() );
+
+        if( hLib )
+            dlclose( hLib );
+
+        return( NULL );
+    }
+
+    return( hLib );
+}
+
+static double CommRun( int iCallers, int iTime, double *pdLatency )
+{
+    PIPE_CALLER         astCaller[16];
+    unsigned long       ulCommands = 0, ulFailures = 0;
+    uint64_t            uLatency = 0, uStart, uEnd;
+    int                 iCaller;
+
+    memset( astCaller, 0, sizeof(astCaller) );
+
+    uStart = NowNS();
+    uEnd   = uStart + (uint64_t)iTime * 1000000ULL;
+
+    for( iCaller = 0; iCaller < iCallers; iCaller++ )
+    {
+        astCaller[iCaller].uEnd = uEnd;
+        pthread_create( &astCaller[iCaller].hThread, NULL, CommCaller, &astCaller[iCaller] );
+    }
+
+    for( iCaller = 0; iCaller < iCallers; iCaller++ )
+    {
+        pthread_join( astCaller[iCaller].hThread, NULL );
+
+        ulCommands += astCaller[iCaller].ulCommands;
+        ulFailures += astCaller[iCaller].ulFailures;
+        uLatency   += astCaller[iCaller].uLatency;
+    }
+
+    uEnd = NowNS();
+
+    if( ulFailures )
+        printf( "   (%lu commands failed)\n", ulFailures );
+
+    *pdLatency = ulCommands? (double)uLatency / ulCommands / 1000.0 : 0.0;
+
+    return( (double)ulCommands * 1000000000.0 / (double)(uEnd - uStart) );
+}
+
+static int BenchComm( int iArgs, char *pszArg[] )
+{
+    static const int    aiCallers[] = { 1, 4, 16 };
+
+    double              dRate, dLatency;
+    int                 iTime = BENCH_TIME, iLatency = COMM_LATENCY;
+    int                 iIndex, iOpt;
+    void                *hLib;
+
+    for( iOpt = 0; iOpt < iArgs; iOpt += 2 )
+    {
+        if( !strcmp( pszArg[iOpt], "-b" ) )
+        {
+            bCommBorrow = TRUE;
+            iOpt--;
+        }
+        else if( iOpt + 1 == iArgs )
+            break;
+        else if( !strcmp( pszArg[iOpt], "-s" ) )
+            iLatency = atoi( pszArg[iOpt + 1] );
+        else if( !strcmp( pszArg[iOpt], "-t" ) )
+            iTime = atoi( pszArg[iOpt + 1] );
+        else
+            break;
+    }
+
+    if( (iOpt != iArgs) || (iLatency < 0) || (iTime < 1) )
+    {
+        puts( "Usage: QstBench comm [-b] [-s service-us] [-t time-ms]" );
+        return( 1 );
+    }
+
+    if( (hLib = CommLoad( iLatency )) == NULL )
+        return( 1 );
+
+    printf( "Simulator: subsystem latency %s us per command, %s buffers\n\n",
+            getenv( "QST_SIM_LATENCY" ), bCommBorrow? "borrowed" : "caller's" );
+    printf( "Callers          cmds/s     avg us\n" );
+    printf( "-------     -----------   --------\n" );
+
+    for( iIndex = 0; iIndex < sizeof(aiCallers) / sizeof(aiCallers[0]); iIndex++ )
+    {
+        dRate = CommRun( aiCallers[iIndex], iTime, &dLatency );
+
+        printf( "%7d     %11.0f   %8.1f\n", aiCallers[iIndex], dRate, dLatency );
+    }
+
+    dlclose( hLib );
+    return( 0 );
+}
+
+/****************************************************************************/
+/* Benchmark "modes" - Measures libQstComm (as benchmark "comm" does) in    */
+/* each of its concurrency modes.                                           */
+/****************************************************************************/
+
+static int BenchModes( int iArgs, char *pszArg[] )
+{
+    static const char * const pszMode[] = { "exclusive", "process", "system" };
+    static const int    aiCallers[] = { 1, 4 };
+
+    double              dRate, dLatency;
+    int                 iTime = BENCH_TIME, iLatency = COMM_LATENCY;
+    int                 iMode, iIndex, iOpt, iStatus;
+    pid_t               hChild;
+    void                *hLib;
+
+    for( iOpt = 0; iOpt + 1 < iArgs; iOpt += 2 )
+    {
+        if( !strcmp( pszArg[iOpt], "-s" ) )
+            iLatency = atoi( pszArg[iOpt + 1] );
+        else if( !strcmp( pszArg[iOpt], "-t" ) )
+            iTime = atoi( pszArg[iOpt + 1] );
+        else
+            break;
+    }
+
+    if( (iOpt != iArgs) || (iLatency < 0) || (iTime < 1) )
+    {
+        puts( "Usage: QstBench modes [-s service-us] [-t time-ms]" );
+        return( 1 );
+    }
+
+    if( getenv( "QST_SIM_LATENCY" ) )
+        iLatency = atoi( getenv( "QST_SIM_LATENCY" ) );
+
+    printf( "Simulator: subsystem latency %d us per command\n\n", iLatency );
+    printf( "Mode         Callers          cmds/s     avg us\n" );
+    printf( "---------    -------     -----------   --------\n" );
+
+    for( iMode = 0; iMode < sizeof(pszMode) / sizeof(pszMode[0]); iMode++ )
+    {
+        fflush( stdout );
+
+        if( (hChild = fork()) == -1 )
+        {
+            printf( "Unable to create process: %s\n", strerror( errno ) );
+            return( 1 );
+        }
+
+        if( hChild == 0 )
+        {
+            setenv( "QST_CONCURRENCY", pszMode[iMode], 1 );
+
+            if( (hLib = CommLoad( iLatency )) == NULL )
+                exit( 1 );
+
+            // Exclusive mode is only for a single caller
+
+            for( iIndex = 0; iIndex < sizeof(aiCallers) / sizeof(aiCallers[0]); iIndex++ )
+            {
+                if( (iMode == 0) && (aiCallers[iIndex] > 1) )
+                    break;
+
+                dRate = CommRun( aiCallers[iIndex], iTime, &dLatency );
+
+                printf( "%-9s    %7d     %11.0f   %8.1f\n", pszMode[iMode], aiCallers[iIndex], dRate, dLatency );
+            }
+
+            fflush( stdout );
+            dlclose( hLib );
+            exit( 0 );
+        }
+
+        if( (waitpid( hChild, &iStatus, 0 ) == -1) || !WIFEXITED( iStatus ) || WEXITSTATUS( iStatus ) )
+            return( 1 );
+    }
+
+    return( 0 );
+}
+
+/****************************************************************************/
+/* Benchmark "async" - Measures the throughput of asynchronous commands     */
+/* (QstCommandAsync()) driven by an epoll loop, against the simulated       */
+/* subsystem.                                                               */
+/****************************************************************************/
+
+typedef BOOL  (*ASYNC_FUNC)( P_QST_ASYNC_CMD );
+typedef int   (*ASYNC_INT_FUNC)( void );
+
+typedef struct _ASYNC_SLOT
+{
+    QST_ASYNC_CMD               stAsync;
+    QST_GENERIC_CMD             stCmd;
+    QST_GET_TEMP_MON_UPDATE_RSP stRsp;
+    uint64_t                    uStart;
+
+} ASYNC_SLOT;
+
+static ASYNC_FUNC       pfnAsync;
+static ASYNC_INT_FUNC   pfnAsyncProcess;
+static unsigned long    ulAsyncCommands, ulAsyncFailures;
+static uint64_t         uAsyncLatency, uAsyncEnd;
+
+static void AsyncComplete( P_QST_ASYNC_CMD pstAsync )
+{
+    ASYNC_SLOT                  *pstSlot = (ASYNC_SLOT *)pstAsync->pvContext;
+    uint64_t                    uNow = NowNS();
+
+    if( pstAsync->bSucceeded && (pstSlot->stRsp.byStatus == QST_CMD_SUCCESSFUL) )
+    {
+        ulAsyncCommands++;
+        uAsyncLatency += uNow - pstSlot->uStart;
+    }
+    else
+        ulAsyncFailures++;
+
+    // Keep the slot busy until time runs out
+
+    if( uNow < uAsyncEnd )
+    {
+        pstSlot->uStart = uNow;
+
+        if( !pfnAsync( pstAsync ) )
+        {
+            pstAsync->bDone = TRUE;
+            ulAsyncFailures++;
+        }
+    }
+}
+
+static int BenchAsync( int iArgs, char *pszArg[] )
+{
+    static const int    aiDepth[] = { 1, 4, 16, QST_ASYNC_MAX_OUTSTANDING };
+
+    static ASYNC_SLOT   astSlot[QST_ASYNC_MAX_OUTSTANDING];
+    struct epoll_event  stEvent;
+    ASYNC_INT_FUNC      pfnGetFD;
+    uint64_t            uStart, uEnd;
+    unsigned long       ulWakes;
+    int                 iTime = BENCH_TIME, iLatency = COMM_LATENCY;
+    int                 iIndex, iSlot, iOpt, iPollFD, iLibFD;
+    char                szLatency[16];
+    void                *hLib;
+
+    for( iOpt = 0; iOpt + 1 < iArgs; iOpt += 2 )
+    {
+        if( !strcmp( pszArg[iOpt], "-s" ) )
+            iLatency = atoi( pszArg[iOpt + 1] );
+        else if( !strcmp( pszArg[iOpt], "-t" ) )
+            iTime = atoi( pszArg[iOpt + 1] );
+        else
+            break;
+    }
+
+    if( (iOpt != iArgs) || (iLatency < 0) || (iTime < 1) )
+    {
+        puts( "Usage: QstBench async [-s service-us] [-t time-ms]" );
+        return( 1 );
+    }
+
+    sprintf( szLatency, "%d", iLatency );
+
+    setenv( "QST_HECI_TRANSPORT", "sim", 1 );
+    setenv( "QST_SIM_LATENCY", szLatency, 0 );
+
+    if(    ((hLib = dlopen( COMM_LIBRARY, RTLD_NOW )) == NULL)
+        || ((pfnAsync = (ASYNC_FUNC)dlsym( hLib, "QstCommandAsync" )) == NULL)
+        || ((pfnGetFD = (ASYNC_INT_FUNC)dlsym( hLib, "QstAsyncGetFD" )) == NULL)
+        || ((pfnAsyncProcess = (ASYNC_INT_FUNC)dlsym( hLib, "QstAsyncProcess" )) == NULL) )
+    {
+        printf( "Unable to load %s: %s\n", COMM_LIBRARY, dlerror() );
+        return( 1 );
+    }
+
+    // Application's epoll set, holding the library's descriptor
+
+    iPollFD = epoll_create1( 0 );
+    iLibFD  = pfnGetFD();
+
+    memset( &stEvent, 0, sizeof(stEvent) );
+    stEvent.events = EPOLLIN;
+
+    if( (iPollFD == -1) || (iLibFD == -1) || epoll_ctl( iPollFD, EPOLL_CTL_ADD, iLibFD, &stEvent ) )
+    {
+        printf( "Unable to set up epoll set: %s\n", strerror( errno ) );
+        return( 1 );
+    }
+
+    printf( "Simulator: subsystem latency %s us per command, one thread\n\n", getenv( "QST_SIM_LATENCY" ) );
+    printf( "Outstanding      cmds/s     avg us   wakes/cmd\n" );
+    printf( "-----------  -----------   --------   ---------\n" );
+
+    for( iIndex = 0; iIndex < sizeof(aiDepth) / sizeof(aiDepth[0]); iIndex++ )
+    {
+        ulAsyncCommands = ulAsyncFailures = ulWakes = 0;
+        uAsyncLatency   = 0;
+        uStart          = NowNS();
+        uAsyncEnd       = uStart + (uint64_t)iTime * 1000000ULL;
+
+        for( iSlot = 0; iSlot < aiDepth[iIndex]; iSlot++ )
+        {
+            memset( &astSlot[iSlot], 0, sizeof(astSlot[iSlot]) );
+
+            astSlot[iSlot].stCmd.stHeader.byCommand       = QST_GET_TEMP_MON_UPDATE;
+            astSlot[iSlot].stCmd.stHeader.wResponseLength = sizeof(astSlot[iSlot].stRsp);
+
+            astSlot[iSlot].stAsync.pvCmdBuf  = &astSlot[iSlot].stCmd;
+            astSlot[iSlot].stAsync.tCmdSize  = sizeof(astSlot[iSlot].stCmd);
+            astSlot[iSlot].stAsync.pvRspBuf  = &astSlot[iSlot].stRsp;
+            astSlot[iSlot].stAsync.tRspSize  = sizeof(astSlot[iSlot].stRsp);
+            astSlot[iSlot].stAsync.pfnDone   = AsyncComplete;
+            astSlot[iSlot].stAsync.pvContext = &astSlot[iSlot];
+            astSlot[iSlot].uStart            = NowNS();
+
+            if( !pfnAsync( &astSlot[iSlot].stAsync ) )
+            {
+                astSlot[iSlot].stAsync.bDone = TRUE;
+                ulAsyncFailures++;
+            }
+        }
+
+        // Run loop until time is up and every command has completed
+
+        for( ;; )
+        {
+            for( iSlot = 0; iSlot < aiDepth[iIndex]; iSlot++ )
+            {
+                if( !astSlot[iSlot].stAsync.bDone || (NowNS() < uAsyncEnd) )
+                    break;
+            }
+
+            if( iSlot == aiDepth[iIndex] )
+                break;
+
+            if( epoll_wait( iPollFD, &stEvent, 1, 1000 ) > 0 )
+            {
+                ulWakes++;
+                pfnAsyncProcess();
+            }
+        }
+
+        uEnd = NowNS();
+
+        if( ulAsyncFailures )
+            printf( "   (%lu commands failed)\n", ulAsyncFailures );
+
+        printf( "%11d  %11.0f   %8.1f   %9.2f\n", aiDepth[iIndex],
+                (double)ulAsyncCommands * 1000000000.0 / (double)(uEnd - uStart),
+                ulAsyncCommands? (double)uAsyncLatency / ulAsyncCommands / 1000.0 : 0.0,
+                ulAsyncCommands? (double)ulWakes / ulAsyncCommands : 0.0 );
+    }
+
+    close( iPollFD );
+    dlclose( hLib );
+    return( 0 );
+}
+
+/****************************************************************************/
+/* Benchmark "lock" - Measures critical section entry/exit cost. The        */
+/* semaphore variant reproduces the operations the previous CritSect.c      */
+/* implementation made.                                                     */
+/****************************************************************************/
+
+#if defined(__GNU_LIBRARY__) && !defined(_SEM_SEMUN_UNDEFINED)
+#else
+union semun
+{
+    int                 val;
+    struct semid_ds     *buf;
+    unsigned short int  *array;
+    struct seminfo      *__buf;
+};
+#endif
+
+typedef struct _LOCK_CALLER
+{
+    pthread_t           hThread;
+    BOOL                bFutex;         // Use CritSect.c (else semaphore)
+    int                 iCount;         // Entries to make
+
+} LOCK_CALLER;
+
+static HCRITSECT        hLockSect;
+static int              iLockSem;
+static volatile long    lLockShared;
+
+static const struct sembuf stLockAdd = { 0,  1, SEM_UNDO };
+static const struct sembuf stLockRem = { 0, -1, SEM_UNDO };
+
+static void *LockCaller( void *pvArg )
+{
+    LOCK_CALLER         *pstCaller = (LOCK_CALLER *)pvArg;
+    int                 iCount;
+
+    for( iCount = 0; iCount < pstCaller->iCount; iCount++ )
+    {
+        if( pstCaller->bFutex )
+        {
+            EnterCritSect( hLockSect );
+            lLockShared++;
+            LeaveCritSect( hLockSect );
+        }
+        else
+        {
+            semop( iLockSem, (struct sembuf *)&stLockRem, 1 );
+            lLockShared++;
+            semop( iLockSem, (struct sembuf *)&stLockAdd, 1 );
+        }
+    }
+
+    return( NULL );
+}
+
+static double LockRun( BOOL bFutex, int iThreads, int iCount )
+{
+    LOCK_CALLER         astCaller[64];
+    uint64_t            uStart;
+    int                 iThread;
+
+    lLockShared = 0;
+    uStart      = NowNS();
+
+    for( iThread = 0; iThread < iThreads; iThread++ )
+    {
+        astCaller[iThread].bFutex = bFutex;
+        astCaller[iThread].iCount = iCount;
+
+        pthread_create( &astCaller[iThread].hThread, NULL, LockCaller, &astCaller[iThread] );
+    }
+
+    for( iThread = 0; iThread < iThreads; iThread++ )
+        pthread_join( astCaller[iThread].hThread, NULL );
+
+    if( lLockShared != (long)iThreads * iCount )
+        printf( "   (mutual exclusion failure: %ld of %ld increments)\n", lLockShared, (long)iThreads * iCount );
+
+    return( (double)(NowNS() - uStart) / ((double)iThreads * iCount) );
+}
+
+static int BenchLock( int iArgs, char *pszArg[] )
+{
+    int                 iCount = LOCK_COUNT, iThreads = LOCK_THREADS, iOpt;
+    U32                 uKey = 0x51B00000 | (U32)(getpid() & 0xFFFF);
+    union semun         uSemun;
+    double              dSem, dFutex;
+
+    for( iOpt = 0; iOpt + 1 < iArgs; iOpt += 2 )
+    {
+        if( !strcmp( pszArg[iOpt], "-n" ) )
+            iCount = atoi( pszArg[iOpt + 1] );
+        else if( !strcmp( pszArg[iOpt], "-c" ) )
+            iThreads = atoi( pszArg[iOpt + 1] );
+        else
+            break;
+    }
+
+    if( (iOpt != iArgs) || (iCount < 1) || (iThreads < 2) || (iThreads > 64) )
+    {
+        puts( "Usage: QstBench lock [-n entries] [-c threads]" );
+        return( 1 );
+    }
+
+    uSemun.val = 1;
+
+    if(    ((iLockSem = semget( IPC_PRIVATE, 1, 0600 )) == -1)
+        || (semctl( iLockSem, 0, SETVAL, uSemun ) == -1)
+        || ((hLockSect = CreateCritSect( uKey, TRUE )) == NULL) )
+    {
+        printf( "Unable to create locks: %s\n", strerror( errno ) );
+        return( 1 );
+    }
+
+    printf( "Critical section cost (ns per enter/leave pair):\n\n" );
+    printf( "Contention             semop()       futex     Speedup\n" );
+    printf( "------------------   ---------   ---------     -------\n" );
+
+    dSem   = LockRun( FALSE, 1, iCount );
+    dFutex = LockRun( TRUE,  1, iCount );
+
+    printf( "None (1 thread)      %9.1f   %9.1f     %6.2fx\n", dSem, dFutex, dSem / dFutex );
+
+    dSem   = LockRun( FALSE, iThreads, iCount / iThreads );
+    dFutex = LockRun( TRUE,  iThreads, iCount / iThreads );
+
+    printf( "%2d threads           %9.1f   %9.1f     %6.2fx\n", iThreads, dSem, dFutex, dSem / dFutex );
+
+    CloseCritSect( hLockSect );
+    shmctl( shmget( (key_t)uKey, 0, 0 ), IPC_RMID, NULL );
+    semctl( iLockSem, 0, IPC_RMID, 0 );
+
+    return( 0 );
+}
+
+/****************************************************************************/
+/* Benchmark "xlate" - Measures the cost of translating commands between    */
+/* the QST 2.x and 1.x command sets (LegTranslationFuncs.c). The module is  */
+/* linked in directly and its CommonCmdHandler() is replaced by one that    */
+/* returns a zero-filled response, so only the translation is timed.        */
+/****************************************************************************/
+
+typedef struct _XLATE_CMD
+{
+    const char          *pszName;
+    UINT8               byCommand;      // Command code (2.x or 1.x)
+    UINT8               byEntity;       // 2.x only
+    size_t              tCmdSize;
+    size_t              tRspSize;
+
+} XLATE_CMD;
+
+static const XLATE_CMD  astXlateNew[] =
+{
+    { "GET_SUBSYSTEM_STATUS", QST_GET_SUBSYSTEM_STATUS, 0, sizeof(QST_GENERIC_CMD), sizeof(QST_GET_SUBSYSTEM_STATUS_RSP) },
+    { "GET_TEMP_MON_UPDATE",  QST_GET_TEMP_MON_UPDATE,  0, sizeof(QST_GENERIC_CMD), QST_TEMP_MON_UPDATE_RSP_SIZE(QST_LEG_MAX_TEMP_MONITORS) },
+    { "GET_FAN_MON_UPDATE",   QST_GET_FAN_MON_UPDATE,   0, sizeof(QST_GENERIC_CMD), QST_FAN_MON_UPDATE_RSP_SIZE(QST_LEG_MAX_FAN_MONITORS) },
+    { "GET_FAN_CTRL_UPDATE",  QST_GET_FAN_CTRL_UPDATE,  0, sizeof(QST_GENERIC_CMD), QST_FAN_CTRL_UPDATE_RSP_SIZE(QST_LEG_MAX_FAN_CONTROLLERS) },
+    { "GET_TEMP_MON_CONFIG",  QST_GET_TEMP_MON_CONFIG,  3, sizeof(QST_GENERIC_CMD), sizeof(QST_GET_TEMP_MON_CONFIG_RSP) },
+    { "SET_FAN_CTRL_DUTY",    QST_SET_FAN_CTRL_DUTY,    1, sizeof(QST_SET_FAN_CTRL_DUTY_CMD), sizeof(QST_GENERIC_RSP) },
+    { "GET_CONFIG_PROFILE",   QST_GET_SUBSYSTEM_CONFIG_PROFILE, 0, sizeof(QST_GENERIC_CMD), sizeof(QST_GET_SUBSYSTEM_CONFIG_PROFILE_RSP) }
+};
+
+static const XLATE_CMD  astXlateLeg[] =
+{
+    { "GET_SUBSYSTEM_STATUS", QST_LEG_GET_SUBSYSTEM_STATUS,     0, sizeof(QST_LEG_GENERIC_CMD), sizeof(QST_LEG_GET_SUBSYSTEM_STATUS_RSP) },
+    { "GET_TEMP_MON_UPDATE",  QST_LEG_GET_TEMP_MON_UPDATE,      0, sizeof(QST_LEG_GENERIC_CMD), sizeof(QST_LEG_GET_TEMP_MON_UPDATE_RSP) },
+    { "GET_FAN_MON_UPDATE",   QST_LEG_GET_FAN_MON_UPDATE,       0, sizeof(QST_LEG_GENERIC_CMD), sizeof(QST_LEG_GET_FAN_MON_UPDATE_RSP) },
+    { "GET_FAN_CTRL_UPDATE",  QST_LEG_GET_FAN_CTRL_UPDATE,      0, sizeof(QST_LEG_GENERIC_CMD), sizeof(QST_LEG_GET_FAN_CTRL_UPDATE_RSP) },
+    { "GET_TEMP_MON_CONFIG",  QST_LEG_GET_TEMP_MON_4_CONFIG,    0, sizeof(QST_LEG_GENERIC_CMD), sizeof(QST_LEG_GET_TEMP_MON_CONFIG_RSP) },
+    { "SET_FAN_CTRL_DUTY",    QST_LEG_SET_FAN_CTRL_2_DUTY,      0, sizeof(QST_LEG_SET_FAN_CTRL_DUTY_CMD), sizeof(QST_LEG_GENERIC_RSP) },
+    { "GET_CONFIG_PROFILE",   QST_LEG_GET_SUBSYSTEM_CONFIG_PROFILE, 0, sizeof(QST_LEG_GENERIC_CMD), sizeof(QST_LEG_GET_SUBSYSTEM_CONFIG_PROFILE_RSP) }
+};
+
+#define XLATE_COMMANDS  (sizeof(astXlateNew) / sizeof(astXlateNew[0]))
+
+static unsigned long    ulXlateSent;
+
+/****************************************************************************/
+/* CommonCmdHandler() - Stands in for the one in QstComm.c, answering each  */
+/* (translated) command with a successful, zero-filled response.            */
+/****************************************************************************/
+
+BOOL CommonCmdHandler( void *pvCmdBuf, size_t tCmdSize, void *pvRspBuf, size_t tRspSize )
+{
+    memset( pvRspBuf, 0, tRspSize );
+    ulXlateSent++;
+
+    return( TRUE );
+}
+
+static void XlateBuild( const XLATE_CMD *pstCmd, BOOL bLegacy, void *pvCmdBuf )
+{
+    memset( pvCmdBuf, 0, pstCmd->tCmdSize );
+
+    if( bLegacy )
+    {
+        QST_LEG_CMD_HEADER *pstHeader = (QST_LEG_CMD_HEADER *)pvCmdBuf;
+
+        pstHeader->byCommand       = pstCmd->byCommand;
+        pstHeader->wCommandLength  = (UINT16)(pstCmd->tCmdSize - sizeof(QST_LEG_CMD_HEADER));
+        pstHeader->wResponseLength = (UINT16)pstCmd->tRspSize;
+    }
+    else
+    {
+        QST_CMD_HEADER  *pstHeader = (QST_CMD_HEADER *)pvCmdBuf;
+
+        pstHeader->byCommand       = pstCmd->byCommand;
+        pstHeader->byEntity        = pstCmd->byEntity;
+        pstHeader->wCommandLength  = (UINT16)(pstCmd->tCmdSize - sizeof(QST_CMD_HEADER));
+        pstHeader->wResponseLength = (UINT16)pstCmd->tRspSize;
+    }
+}
+
+// Returns ns per command; with bDirect, the handler is called without translation
+
+static double XlateRun( const XLATE_CMD *pstCmd, BOOL bLegacy, BOOL bDirect, int iCount )
+{
+    UINT8               abyCmd[LOOP_MAX_PACKET], abyRsp[LOOP_MAX_PACKET];
+    CMD_TRANSLATION_STATUS eStatus;
+    uint64_t            uStart;
+    int                 iIndex;
+
+    XlateBuild( pstCmd, bLegacy, abyCmd );
+
+    ulXlateSent = 0;
+    uStart      = NowNS();
+
+    for( iIndex = 0; iIndex < iCount; iIndex++ )
+    {
+        if( bDirect )
+            eStatus = CommonCmdHandler( abyCmd, pstCmd->tCmdSize, abyRsp, pstCmd->tRspSize )? TRANSLATE_CMD_SUCCESS : TRANSLATE_CMD_FAILED_WITH_ERROR_SET;
+        else if( bLegacy )
+            eStatus = TranslateToNewCommand( abyCmd, pstCmd->tCmdSize, abyRsp, pstCmd->tRspSize );
+        else
+            eStatus = TranslateToLegacyCommand( abyCmd, pstCmd->tCmdSize, abyRsp, pstCmd->tRspSize );
+
+        if( eStatus != TRANSLATE_CMD_SUCCESS )
+        {
+            printf( "   (%s failed: status %d)\n", pstCmd->pszName, (int)eStatus );
+            return( 0.0 );
+        }
+    }
+
+    if( ulXlateSent != (unsigned long)iCount )
+        printf( "   (%s: %lu of %d commands sent)\n", pstCmd->pszName, ulXlateSent, iCount );
+
+    return( (double)(NowNS() - uStart) / iCount );
+}
+
+static int BenchXlate( int iArgs, char *pszArg[] )
+{
+    int                 iCount = XLATE_COUNT, iOpt, iIndex;
+    double              dDirect, dToLeg, dToNew, dTotalLeg = 0.0, dTotalNew = 0.0;
+
+    for( iOpt = 0; iOpt + 1 < iArgs; iOpt += 2 )
+    {
+        if( !strcmp( pszArg[iOpt], "-n" ) )
+            iCount = atoi( pszArg[iOpt + 1] );
+        else
+            break;
+    }
+
+    if( (iOpt != iArgs) || (iCount < 1) )
+    {
+        puts( "Usage: QstBench xlate [-n commands]" );
+        return( 1 );
+    }
+
+    printf( "Translation overhead (ns per command, handler cost removed):\n\n" );
+    printf( "Command                  2.x -> 1.x   1.x -> 2.x\n" );
+    printf( "--------------------     ----------   ----------\n" );
+
+    for( iIndex = 0; iIndex < XLATE_COMMANDS; iIndex++ )
+    {
+        dDirect = XlateRun( &astXlateNew[iIndex], FALSE, TRUE, iCount );
+        dToLeg  = XlateRun( &astXlateNew[iIndex], FALSE, FALSE, iCount ) - dDirect;
+
+        dDirect = XlateRun( &astXlateLeg[iIndex], TRUE, TRUE, iCount );
+        dToNew  = XlateRun( &astXlateLeg[iIndex], TRUE, FALSE, iCount ) - dDirect;
+
+        printf( "%-20s     %10.1f   %10.1f\n", astXlateNew[iIndex].pszName, dToLeg, dToNew );
+
+        dTotalLeg += dToLeg;
+        dTotalNew += dToNew;
+    }
+
+    printf( "--------------------     ----------   ----------\n" );
+    printf( "%-20s     %10.1f   %10.1f\n", "Average", dTotalLeg / XLATE_COMMANDS, dTotalNew / XLATE_COMMANDS );
+
+    return( 0 );
+}
+
+/****************************************************************************/
+/* Benchmark "update" - Has several processes take snapshots of every       */
+/* reading with libQstInst, against the simulated subsystem answering at    */
+/* once, while the readings are refreshed every few milliseconds by         */
+/* whichever of them finds them due. Each snapshot is checked against the   */
+/* simulator's waveforms (HeciSimReading()): there must be an instant at    */
+/* which the simulator would have given every reading in it. Snapshots are  */
+/* taken with QstGetAllReadings() and then, as a control, gathered one      */
+/* reading at a time; the control has to be seen to tear, or the check      */
+/* proves nothing. The library runs in a directory of its own, holding its  */
+/* global memory and a QST.ini that sets the polling intervals.             */
+/****************************************************************************/
+
+#define UPDATE_SNAPSHOT 0               // QstGetAllReadings()
+#define UPDATE_SINGLE   1               // One reading at a time
+
+#define UPDATE_CLASSES  (QST_SENSOR_TYPES + 1)  // Sensor types, then controllers
+
+typedef BOOL  (*ALL_READINGS_FUNC)( QST_SNAPSHOT * );
+typedef BOOL  (*SENSOR_COUNT_FUNC)( QST_SENSOR_TYPE, int * );
+typedef BOOL  (*SENSOR_READING_FUNC)( QST_SENSOR_TYPE, int, float * );
+typedef BOOL  (*CTRL_COUNT_FUNC)( int * );
+typedef BOOL  (*CTRL_DUTY_FUNC)( int, float * );
+
+typedef struct _UPDATE_AREA
+{
+    int                 bStop;          // Set when readers are to finish
+    int                 iReady;         // Readers started
+    unsigned long       aulReads[UPDATE_MAX];
+    unsigned long       aulFailed[UPDATE_MAX];
+    unsigned long       aulTorn[UPDATE_MAX];
+
+} UPDATE_AREA;
+
+static UPDATE_AREA          *pstUpdate; // Shared with reading processes
+
+static ALL_READINGS_FUNC    pfnAllReadings;
+static SENSOR_COUNT_FUNC    pfnSensorCount;
+static SENSOR_READING_FUNC  pfnSensorReading;
+static CTRL_COUNT_FUNC      pfnCtrlCount;
+static CTRL_DUTY_FUNC       pfnCtrlDuty;
+
+// Readings the simulator gives, in its own units, at each instant of a period
+
+static INT32            aiUpdateWave[UPDATE_CLASSES][UPDATE_PERIOD][QST_MAX_SNAPSHOT_ENTRIES];
+
+static const UINT8      abyUpdateCmd[UPDATE_CLASSES]  = { QST_GET_TEMP_MON_UPDATE, QST_GET_VOLT_MON_UPDATE, QST_GET_FAN_MON_UPDATE,
+                                                          QST_GET_CURR_MON_UPDATE, QST_GET_FAN_CTRL_UPDATE };
+static const float      afUpdateScale[UPDATE_CLASSES] = { 100.0f, 1000.0f, 1.0f, 1000.0f, 100.0f };
+
+static const char       szUpdateINI[] = "[Instrumentation]\n"
+                                        "PollingInterval=1000\n"
+                                        "TempPollingInterval=" UPDATE_POLLING "\n"
+                                        "FanPollingInterval=" UPDATE_POLLING "\n"
+                                        "VoltPollingInterval=" UPDATE_POLLING "\n"
+                                        "CurrPollingInterval=" UPDATE_POLLING "\n"
+                                        "DutyPollingInterval=" UPDATE_POLLING "\n";
+
+static BOOL UpdateLoad( void )
+{
+    void                *hLib;
+
+    if(    ((hLib = dlopen( UPDATE_LIBRARY, RTLD_NOW )) == NULL)
+        || ((pfnAllReadings = (ALL_READINGS_FUNC)dlsym( hLib, "QstGetAllReadings" )) == NULL)
+        || ((pfnSensorCount = (SENSOR_COUNT_FUNC)dlsym( hLib, "QstGetSensorCount" )) == NULL)
+        || ((pfnSensorReading = (SENSOR_READING_FUNC)dlsym( hLib, "QstGetSensorReading" )) == NULL)
+        || ((pfnCtrlCount = (CTRL_COUNT_FUNC)dlsym( hLib, "QstGetControllerCount" )) == NULL)
+        || ((pfnCtrlDuty = (CTRL_DUTY_FUNC)dlsym( hLib, "QstGetControllerDutyCycle" )) == NULL) )
+    {
+        printf( "Unable to load %s: %s\n", UPDATE_LIBRARY, dlerror() );
+        return( FALSE );
+    }
+
+    return( TRUE );
+}
+
+static BOOL UpdateGather( QST_SNAPSHOT *pstSnap )
+{
+    QST_SNAPSHOT_SENSORS *pstSensors;
+    int                 iType, iIndex;
+
+    for( iType = 0; iType < QST_SENSOR_TYPES; iType++ )
+    {
+        pstSensors = &pstSnap->Sensor[iType];
+
+        if( !pfnSensorCount( (QST_SENSOR_TYPE)iType, &pstSensors->Count ) )
+            return( FALSE );
+
+        for( iIndex = 0; iIndex < pstSensors->Count; iIndex++ )
+        {
+            if( !pfnSensorReading( (QST_SENSOR_TYPE)iType, iIndex, &pstSensors->Reading[iIndex] ) )
+                return( FALSE );
+        }
+    }
+
+    if( !pfnCtrlCount( &pstSnap->ControllerCount ) )
+        return( FALSE );
+
+    for( iIndex = 0; iIndex < pstSnap->ControllerCount; iIndex++ )
+    {
+        if( !pfnCtrlDuty( iIndex, &pstSnap->ControllerDuty[iIndex] ) )
+            return( FALSE );
+    }
+
+    return( TRUE );
+}
+
+static BOOL UpdateTorn( const QST_SNAPSHOT *pstSnap )
+{
+    INT32               aiRaw[UPDATE_CLASSES][QST_MAX_SNAPSHOT_ENTRIES];
+    int                 aiCount[UPDATE_CLASSES];
+    const float         *pfReading;
+    int                 iClass, iIndex, iTime;
+
+    for( iClass = 0; iClass < UPDATE_CLASSES; iClass++ )
+    {
+        aiCount[iClass] = (iClass < QST_SENSOR_TYPES)? pstSnap->Sensor[iClass].Count   : pstSnap->ControllerCount;
+        pfReading       = (iClass < QST_SENSOR_TYPES)? pstSnap->Sensor[iClass].Reading : pstSnap->ControllerDuty;
+
+        for( iIndex = 0; iIndex < aiCount[iClass]; iIndex++ )
+            aiRaw[iClass][iIndex] = (INT32)(pfReading[iIndex] * afUpdateScale[iClass] + 0.5f);
+    }
+
+    // Look for an instant at which every reading is as given
+
+    for( iTime = 0; iTime < UPDATE_PERIOD; iTime++ )
+    {
+        for( iClass = 0; iClass < UPDATE_CLASSES; iClass++ )
+        {
+            if( memcmp( aiUpdateWave[iClass][iTime], aiRaw[iClass], aiCount[iClass] * sizeof(INT32) ) )
+                break;
+        }
+
+        if( iClass == UPDATE_CLASSES )
+            return( FALSE );
+    }
+
+    return( TRUE );
+}
+
+static void UpdateReader( int iReader, int iMode )
+{
+    QST_SNAPSHOT        stSnap;
+    unsigned long       ulReads = 0, ulFailed = 0, ulTorn = 0;
+    BOOL                bLoaded = UpdateLoad();
+
+    __atomic_fetch_add( &pstUpdate->iReady, 1, __ATOMIC_RELEASE );
+
+    if( !bLoaded )
+        exit( 1 );
+
+    while( !__atomic_load_n( &pstUpdate->bStop, __ATOMIC_ACQUIRE ) )
+    {
+        if( !((iMode == UPDATE_SNAPSHOT)? pfnAllReadings( &stSnap ) : UpdateGather( &stSnap )) )
+        {
+            ulFailed++;
+            continue;
+        }
+
+        ulReads++;
+
+        if( UpdateTorn( &stSnap ) )
+            ulTorn++;
+    }
+
+    pstUpdate->aulReads[iReader]  = ulReads;
+    pstUpdate->aulFailed[iReader] = ulFailed;
+    pstUpdate->aulTorn[iReader]   = ulTorn;
+}
+
+static BOOL UpdateRun( int iMode, int iReaders, int iTime )
+{
+    static const char * const pszMode[] = { "QstGetAllReadings", "One at a time" };
+
+    unsigned long       ulReads = 0, ulFailed = 0, ulTorn = 0;
+    uint64_t            uStart, uEnd;
+    pid_t               ahChild[UPDATE_MAX];
+    int                 iReader, iStatus;
+    BOOL                bLoaded = TRUE;
+
+    memset( pstUpdate, 0, sizeof(UPDATE_AREA) );
+    fflush( stdout );
+
+    for( iReader = 0; iReader < iReaders; iReader++ )
+    {
+        if( (ahChild[iReader] = fork()) == -1 )
+        {
+            printf( "Unable to create process: %s\n", strerror( errno ) );
+            __atomic_store_n( &pstUpdate->bStop, TRUE, __ATOMIC_RELEASE );
+            iReaders = iReader;
+            break;
+        }
+
+        if( ahChild[iReader] == 0 )
+        {
+            UpdateReader( iReader, iMode );
+            exit( 0 );
+        }
+    }
+
+    while( __atomic_load_n( &pstUpdate->iReady, __ATOMIC_ACQUIRE ) < iReaders )
+        sched_yield();
+
+    // Let the readers run until time is up
+
+    uStart = NowNS();
+    uEnd   = uStart + (uint64_t)iTime * 1000000ULL;
+
+    SleepUntilNS( uEnd );
+
+    __atomic_store_n( &pstUpdate->bStop, TRUE, __ATOMIC_RELEASE );
+
+    for( iReader = 0; iReader < iReaders; iReader++ )
+    {
+        waitpid( ahChild[iReader], &iStatus, 0 );
+
+        if( !WIFEXITED( iStatus ) || WEXITSTATUS( iStatus ) )
+            bLoaded = FALSE;
+
+        ulReads  += pstUpdate->aulReads[iReader];
+        ulFailed += pstUpdate->aulFailed[iReader];
+        ulTorn   += pstUpdate->aulTorn[iReader];
+    }
+
+    uEnd = NowNS();
+
+    printf( "%-17s   %11.0f   %10lu   %8lu\n", pszMode[iMode],
+            (double)ulReads * 1e9 / (double)(uEnd - uStart), ulFailed, ulTorn );
+
+    // Snapshots must never tear; the readings gathered one at a time must
+
+    if( !bLoaded || !ulReads )
+        return( FALSE );
+
+    return( (iMode == UPDATE_SNAPSHOT)? !ulTorn : (ulTorn != 0) );
+}
+
+static void UpdateCleanup( const char *pszDir )
+{
+    char                szPath[PATH_MAX];
+    struct dirent       *pstEntry;
+    DIR                 *pDir;
+
+    if( (pDir = opendir( pszDir )) != NULL )
+    {
+        while( (pstEntry = readdir( pDir )) != NULL )
+        {
+            if( strcmp( pstEntry->d_name, "." ) && strcmp( pstEntry->d_name, ".." ) )
+            {
+                snprintf( szPath, sizeof(szPath), "%s/%s", pszDir, pstEntry->d_name );
+                unlink( szPath );
+            }
+        }
+
+        closedir( pDir );
+    }
+
+    rmdir( pszDir );
+}
+
+static int BenchUpdate( int iArgs, char *pszArg[] )
+{
+    char                szDir[] = "/tmp/QstBench-XXXXXX";
+    char                szPeriod[16];
+    int                 iReaders = UPDATE_READERS, iTime = BENCH_TIME, iOpt, iClass, iWave, iIndex;
+    BOOL                bClean;
+    FILE                *pFile;
+
+    for( iOpt = 0; iOpt + 1 < iArgs; iOpt += 2 )
+    {
+        if( !strcmp( pszArg[iOpt], "-c" ) )
+            iReaders = atoi( pszArg[iOpt + 1] );
+        else if( !strcmp( pszArg[iOpt], "-t" ) )
+            iTime = atoi( pszArg[iOpt + 1] );
+        else
+            break;
+    }
+
+    if( (iOpt != iArgs) || (iReaders < 1) || (iReaders > UPDATE_MAX) || (iTime < 1) )
+    {
+        puts( "Usage: QstBench update [-c readers] [-t time-ms]" );
+        return( 1 );
+    }
+
+    // The library finds its QST.ini in the current directory, and its global
+    // memory where told; select the simulator before it initializes
+
+    if( !mkdtemp( szDir ) || chdir( szDir ) || ((pFile = fopen( "QST.ini", "w" )) == NULL) )
+    {
+        printf( "Unable to create %s: %s\n", szDir, strerror( errno ) );
+        return( 1 );
+    }
+
+    fputs( szUpdateINI, pFile );
+    fclose( pFile );
+
+    sprintf( szPeriod, "%d", UPDATE_PERIOD );
+
+    setenv( "QST_HECI_TRANSPORT", "sim", 1 );
+    setenv( "QST_SIM_LATENCY", "0", 1 );
+    setenv( "QST_SIM_PERIOD", szPeriod, 1 );
+    setenv( "QST_GLOBMEM_DIR", szDir, 1 );
+    setenv( "QST_ENUM_CACHE", "", 1 );
+    unsetenv( "QST_GLOBMEM_TYPE" );
+
+    for( iClass = 0; iClass < UPDATE_CLASSES; iClass++ )
+    {
+        for( iWave = 0; iWave < UPDATE_PERIOD; iWave++ )
+        {
+            for( iIndex = 0; iIndex < QST_MAX_SNAPSHOT_ENTRIES; iIndex++ )
+                aiUpdateWave[iClass][iWave][iIndex] = HeciSimReading( abyUpdateCmd[iClass], iIndex, (unsigned long)iWave );
+        }
+    }
+
+    pstUpdate = (UPDATE_AREA *)mmap( NULL, sizeof(UPDATE_AREA), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0 );
+
+    if( pstUpdate == MAP_FAILED )
+    {
+        printf( "Unable to create shared area: %s\n", strerror( errno ) );
+        UpdateCleanup( szDir );
+        return( 1 );
+    }
+
+    printf( "%d reading processes, classes polled every %s ms\n\n", iReaders, UPDATE_POLLING );
+    printf( "Readings taken        reads/s       failed       torn\n" );
+    printf( "-----------------   -----------   ----------   --------\n" );
+
+    bClean = UpdateRun( UPDATE_SNAPSHOT, iReaders, iTime ) &
+             UpdateRun( UPDATE_SINGLE, iReaders, iTime );
+
+    munmap( pstUpdate, sizeof(UPDATE_AREA) );
+    UpdateCleanup( szDir );
+
+    return( bClean? 0 : 1 );
+}
+
+/****************************************************************************/
+/* Benchmark "globmem" - Measures what a new client of a global memory      */
+/* segment pays to find it, map it and first touch each of its pages, with  */
+/* each of the GlobMem.c segment types. Each type is measured in a child    */
+/* process, since the type is only taken from the environment once; that    */
+/* process creates the segment and forks the clients.                       */
+/****************************************************************************/
+
+typedef struct _GLOBMEM_TIMES
+{
+    uint64_t            uAttach;        // Lookup and map (nanoseconds)
+    uint64_t            uTouch;         // First touch of each page (nanoseconds)
+
+} GLOBMEM_TIMES;
+
+static GLOBMEM_TIMES    *pstGlobTimes;  // Shared with client processes
+
+static void GlobMemClient( U32 uKey, size_t tSize, GLOBMEM_TIMES *pstTimes )
+{
+    volatile UINT8      *pbySeg;
+    HGLOBMEM            hSeg;
+    uint64_t            uStart, uMapped;
+    size_t              tOffset, tPage = (size_t)sysconf( _SC_PAGESIZE );
+    unsigned long       ulSum = 0;
+
+    uStart = NowNS();
+
+    if( ((hSeg = LookupGlobMem( uKey, tSize )) == NULL) || ((pbySeg = (volatile UINT8 *)MapGlobMem( hSeg )) == NULL) )
+        exit( 1 );
+
+    uMapped = NowNS();
+
+    for( tOffset = 0; tOffset < tSize; tOffset += tPage )
+        ulSum += pbySeg[tOffset];
+
+    pstTimes->uTouch  = NowNS() - uMapped + (ulSum & 0);
+    pstTimes->uAttach = uMapped - uStart;
+}
+
+static BOOL GlobMemRun( const char *pszType, BOOL bHuge, U32 uKey, size_t tSize, int iClients )
+{
+    uint64_t            uAttach = 0, uTouch = 0, uMax = 0;
+    HGLOBMEM            hSeg;
+    void                *pvSeg;
+    pid_t               hClient;
+    int                 iClient, iStatus;
+
+    setenv( "QST_GLOBMEM_TYPE", pszType, 1 );
+    setenv( "QST_GLOBMEM_HUGEPAGES", bHuge? "1" : "0", 1 );
+
+    if( ((hSeg = CreateGlobMem( uKey, tSize, TRUE )) == NULL) || ((pvSeg = MapGlobMem( hSeg )) == NULL) )
+    {
+        printf( "Unable to create %s segment: %s\n", pszType, strerror( errno ) );
+        return( FALSE );
+    }
+
+    memset( pvSeg, 0x5A, tSize );
+
+    for( iClient = 0; iClient < iClients; iClient++ )
+    {
+        if( (hClient = fork()) == -1 )
+        {
+            printf( "Unable to create process: %s\n", strerror( errno ) );
+            break;
+        }
+
+        if( hClient == 0 )
+        {
+            GlobMemClient( uKey, tSize, &pstGlobTimes[iClient] );
+            exit( 0 );
+        }
+
+        if( (waitpid( hClient, &iStatus, 0 ) == -1) || !WIFEXITED( iStatus ) || WEXITSTATUS( iStatus ) )
+            break;
+
+        uAttach += pstGlobTimes[iClient].uAttach;
+        uTouch  += pstGlobTimes[iClient].uTouch;
+
+        if( pstGlobTimes[iClient].uAttach + pstGlobTimes[iClient].uTouch > uMax )
+            uMax = pstGlobTimes[iClient].uAttach + pstGlobTimes[iClient].uTouch;
+    }
+
+    UnmapGlobMem( pvSeg );
+    CloseGlobMem( hSeg );
+
+    if( iClient < iClients )
+    {
+        printf( "Client unable to attach %s segment\n", pszType );
+        return( FALSE );
+    }
+
+    printf( "%-5s %-5s   %10.1f   %10.1f   %10.1f   %10.1f\n", pszType, bHuge? "huge" : "", (double)uAttach / iClients / 1e3,
+            (double)uTouch / iClients / 1e3, (double)(uAttach + uTouch) / iClients / 1e3, (double)uMax / 1e3 );
+
+    return( TRUE );
+}
+
+static int BenchGlobMem( int iArgs, char *pszArg[] )
+{
+    static const char * const pszType[] = { "sysv", "sysv", "posix", "posix" };
+
+    int                 iSize = GLOBMEM_SIZE, iClients = GLOBMEM_CLIENTS;
+    int                 iType, iOpt, iStatus;
+    U32                 uKey = 0x51B20000 | (U32)(getpid() & 0xFFFF);
+    pid_t               hChild;
+
+    for( iOpt = 0; iOpt + 1 < iArgs; iOpt += 2 )
+    {
+        if( !strcmp( pszArg[iOpt], "-k" ) )
+            iSize = atoi( pszArg[iOpt + 1] );
+        else if( !strcmp( pszArg[iOpt], "-n" ) )
+            iClients = atoi( pszArg[iOpt + 1] );
+        else
+            break;
+    }
+
+    if( (iOpt != iArgs) || (iSize < 1) || (iClients < 1) )
+    {
+        puts( "Usage: QstBench globmem [-k size-kb] [-n clients]" );
+        return( 1 );
+    }
+
+    pstGlobTimes = (GLOBMEM_TIMES *)mmap( NULL, iClients * sizeof(GLOBMEM_TIMES), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0 );
+
+    if( pstGlobTimes == MAP_FAILED )
+    {
+        printf( "Unable to create shared area: %s\n", strerror( errno ) );
+        return( 1 );
+    }
+
+    printf( "%d KiB segment, %d clients\n\n", iSize, iClients );
+    printf( "Segment         attach us     touch us     total us       max us\n" );
+    printf( "-----------   ----------   ----------   ----------   ----------\n" );
+
+    for( iType = 0; iType < sizeof(pszType) / sizeof(pszType[0]); iType++ )
+    {
+        fflush( stdout );
+
+        if( (hChild = fork()) == -1 )
+        {
+            printf( "Unable to create process: %s\n", strerror( errno ) );
+            return( 1 );
+        }
+
+        if( hChild == 0 )
+        {
+            iStatus = GlobMemRun( pszType[iType], iType & 1, uKey + iType, (size_t)iSize * 1024, iClients );
+            fflush( stdout );
+            exit( iStatus? 0 : 1 );
+        }
+
+        if( (waitpid( hChild, &iStatus, 0 ) == -1) || !WIFEXITED( iStatus ) || WEXITSTATUS( iStatus ) )
+            return( 1 );
+    }
+
+    munmap( pstGlobTimes, iClients * sizeof(GLOBMEM_TIMES) );
+    return( 0 );
+}
+
+/****************************************************************************/
+/* Benchmark "hot" - Has several processes read every temperature reading   */
+/* and health in a shared QST_DATA_SEGMENT while this one rewrites the fan  */
+/* controller update, which those processes never read. Each run is made    */
+/* with the readers converting entries of the update response under the     */
+/* update sequence count and then copying them from the temperature hot     */
+/* block under its own sequence count; the writer uses the matching count.  */
+/****************************************************************************/
+
+#define HOT_RAW         0               // Update responses, update sequence count
+#define HOT_BLOCK       1               // Hot blocks, their own sequence counts
+
+typedef struct _HOT_AREA
+{
+    QST_DATA_SEGMENT    stSeg;
+    int                 bStop;          // Set when readers are to finish
+    int                 iReady;         // Readers started
+    unsigned long       aulReads[UPDATE_MAX];
+    unsigned long       aulRetries[UPDATE_MAX];
+
+} HOT_AREA;
+
+static HOT_AREA         *pstHotArea;    // Shared with reading processes
+
+static void HotReader( int iReader, int iMode )
+{
+    QST_DATA_SEGMENT    *pstSeg = &pstHotArea->stSeg;
+    P_QST_HOT_BLOCK     pstHot  = &pstSeg->stHot[HOT_TEMP_MON];
+    QST_TEMP_MON_UPDATE *pstUpdate;
+    MILLITIME           stUpdateTime;
+    float               afReading[QST_HOT_ENTRIES];
+    UINT8               abyHealth[QST_HOT_ENTRIES];
+    unsigned long       ulReads = 0, ulRetries = 0;
+    UINT32              uSequence;
+    int                 iIndex;
+
+    __atomic_fetch_add( &pstHotArea->iReady, 1, __ATOMIC_RELEASE );
+
+    while( !__atomic_load_n( &pstHotArea->bStop, __ATOMIC_ACQUIRE ) )
+    {
+        for( ;; )
+        {
+            if( iMode == HOT_RAW )
+            {
+                uSequence = BeginUpdateRead( pstSeg );
+
+                for( iIndex = 0; iIndex < pstSeg->iTempMons; iIndex++ )
+                {
+                    pstUpdate = &pstSeg->stTempMonUpdateRsp.stMonitorUpdate[pstSeg->iTempMonIndex[iIndex]];
+
+                    afReading[iIndex] = QST_TEMP_TO_FLOAT( pstUpdate->lfCurrentReading );
+                    abyHealth[iIndex] = pstUpdate->stMonitorStatus.uMonitorStatus? pstUpdate->stMonitorStatus.uMonitorStatus
+                                                                                 : pstUpdate->stMonitorStatus.uThresholdStatus;
+                }
+
+                memcpy( &stUpdateTime, &pstSeg->stTempMonUpdateTime, sizeof(MILLITIME) );
+
+                if( EndUpdateRead( pstSeg, uSequence ) )
+                    break;
+            }
+            else
+            {
+                uSequence = BeginSeqRead( &pstHot->uSequence );
+
+                memcpy( afReading, pstHot->fReading, pstSeg->iTempMons * sizeof(float) );
+                memcpy( abyHealth, pstHot->byHealth, pstSeg->iTempMons );
+                memcpy( &stUpdateTime, &pstHot->stUpdateTime, sizeof(MILLITIME) );
+
+                if( EndSeqRead( &pstHot->uSequence, uSequence ) )
+                    break;
+            }
+
+            ulRetries++;
+        }
+
+        ulReads++;
+    }
+
+    pstHotArea->aulReads[iReader]   = ulReads;
+    pstHotArea->aulRetries[iReader] = ulRetries;
+}
+
+static void HotRun( int iMode, int iReaders, int iTime, int iInterval )
+{
+    static const char * const pszMode[] = { "Update responses", "Hot blocks" };
+
+    QST_DATA_SEGMENT    *pstSeg = &pstHotArea->stSeg;
+    P_QST_HOT_BLOCK     pstHot  = &pstSeg->stHot[HOT_FAN_CTRL];
+    unsigned long       ulReads = 0, ulRetries = 0, ulWrites = 0;
+    uint64_t            uStart, uEnd, uNext;
+    pid_t               ahChild[UPDATE_MAX];
+    int                 iReader, iStatus;
+
+    pstHotArea->bStop  = FALSE;
+    pstHotArea->iReady = 0;
+    fflush( stdout );
+
+    for( iReader = 0; iReader < iReaders; iReader++ )
+    {
+        if( (ahChild[iReader] = fork()) == -1 )
+        {
+            printf( "Unable to create process: %s\n", strerror( errno ) );
+            __atomic_store_n( &pstHotArea->bStop, TRUE, __ATOMIC_RELEASE );
+            iReaders = iReader;
+            break;
+        }
+
+        if( ahChild[iReader] == 0 )
+        {
+            HotReader( iReader, iMode );
+            exit( 0 );
+        }
+    }
+
+    while( __atomic_load_n( &pstHotArea->iReady, __ATOMIC_ACQUIRE ) < iReaders )
+        sched_yield();
+
+    // Rewrite the fan controller update until time is up
+
+    uStart = uNext = NowNS();
+    uEnd   = uStart + (uint64_t)iTime * 1000000ULL;
+
+    while( (uNext = NowNS()) < uEnd )
+    {
+        if( iMode == HOT_RAW )
+        {
+            BeginUpdateWrite( pstSeg );
+            pstSeg->stFanCtrlUpdateRsp.stControllerUpdate[0].uCurrentDutyCycle = (UINT16)ulWrites;
+            EndUpdateWrite( pstSeg );
+        }
+        else
+        {
+            BeginSeqWrite( &pstHot->uSequence );
+            pstHot->fReading[0] = (float)ulWrites;
+            EndSeqWrite( &pstHot->uSequence );
+        }
+
+        ulWrites++;
+
+        if( iInterval )
+            SleepUntilNS( uNext + (uint64_t)iInterval * 1000ULL );
+    }
+
+    __atomic_store_n( &pstHotArea->bStop, TRUE, __ATOMIC_RELEASE );
+
+    for( iReader = 0; iReader < iReaders; iReader++ )
+    {
+        waitpid( ahChild[iReader], &iStatus, 0 );
+
+        ulReads   += pstHotArea->aulReads[iReader];
+        ulRetries += pstHotArea->aulRetries[iReader];
+    }
+
+    uEnd = NowNS();
+
+    printf( "%-16s   %11.0f   %10.0f   %10lu\n", pszMode[iMode],
+            (double)ulReads * 1e9 / (double)(uEnd - uStart), (double)ulWrites * 1e9 / (double)(uEnd - uStart), ulRetries );
+}
+
+static int BenchHot( int iArgs, char *pszArg[] )
+{
+    int                 iReaders = HOT_READERS, iSensors = HOT_SENSORS, iTime = BENCH_TIME, iInterval = 0, iOpt, iIndex;
+
+    for( iOpt = 0; iOpt + 1 < iArgs; iOpt += 2 )
+    {
+        if( !strcmp( pszArg[iOpt], "-c" ) )
+            iReaders = atoi( pszArg[iOpt + 1] );
+        else if( !strcmp( pszArg[iOpt], "-n" ) )
+            iSensors = atoi( pszArg[iOpt + 1] );
+        else if( !strcmp( pszArg[iOpt], "-i" ) )
+            iInterval = atoi( pszArg[iOpt + 1] );
+        else if( !strcmp( pszArg[iOpt], "-t" ) )
+            iTime = atoi( pszArg[iOpt + 1] );
+        else
+            break;
+    }
+
+    if( (iOpt != iArgs) || (iReaders < 1) || (iReaders > UPDATE_MAX) || (iSensors < 1) ||
+        (iSensors > QST_ABS_TEMP_MONITORS) || (iInterval < 0) || (iTime < 1) )
+    {
+        puts( "Usage: QstBench hot [-c readers] [-n sensors] [-i interval-us] [-t time-ms]" );
+        return( 1 );
+    }
+
+    pstHotArea = (HOT_AREA *)mmap( NULL, sizeof(HOT_AREA), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0 );
+
+    if( pstHotArea == MAP_FAILED )
+    {
+        printf( "Unable to create shared area: %s\n", strerror( errno ) );
+        return( 1 );
+    }
+
+    // Spread the monitors across the update response, as a sparse profile would
+
+    memset( pstHotArea, 0, sizeof(HOT_AREA) );
+
+    pstHotArea->stSeg.iTempMons = iSensors;
+    pstHotArea->stSeg.iFanCtrls = 1;
+
+    for( iIndex = 0; iIndex < iSensors; iIndex++ )
+        pstHotArea->stSeg.iTempMonIndex[iIndex] = (iIndex * QST_ABS_TEMP_MONITORS) / iSensors;
+
+    printf( "%d reading processes, %d sensors, writer %s\n\n", iReaders, iSensors, iInterval? "paced" : "continuous" );
+    printf( "Readings from         reads/s     writes/s      retries\n" );
+    printf( "----------------   -----------   ----------   ----------\n" );
+
+    HotRun( HOT_RAW, iReaders, iTime, iInterval );
+    HotRun( HOT_BLOCK, iReaders, iTime, iInterval );
+
+    munmap( pstHotArea, sizeof(HOT_AREA) );
+    return( 0 );
+}
+
+/****************************************************************************/
+/* Benchmark "event" - Has several processes wait for the events this one   */
+/* posts to the event stamps of a shared QST_DATA_SEGMENT, and measures how */
+/* long after the first event they hadn't seen was posted they noticed it.  */
+/* Each run is made with the waiters sleeping for the polling interval      */
+/* between checks of the stamp count, and then with them waiting upon the   */
+/* count using WaitEvent().                                                 */
+/****************************************************************************/
+
+#define EVENT_TIMES     1024            // Posting times kept, by stamp
+
+typedef struct _EVENT_AREA
+{
+    QST_DATA_SEGMENT    stSeg;
+    int                 bStop;          // Set when waiters are to finish
+    int                 iReady;         // Waiters started
+    uint64_t            auPosted[EVENT_TIMES];  // Times events posted
+    unsigned long       aulSeen[UPDATE_MAX];
+    uint64_t            auTotal[UPDATE_MAX];
+    uint64_t            auWorst[UPDATE_MAX];
+
+} EVENT_AREA;
+
+static EVENT_AREA       *pstEventArea;  // Shared with waiting processes
+
+static void EventWaiter( int iWaiter, int iPolling )
+{
+    P_QST_EVENT_STAMPS  pstEvents = &pstEventArea->stSeg.stEvents;
+    unsigned long       ulSeen = 0;
+    uint64_t            uTotal = 0, uWorst = 0, uLatency;
+    UINT32              uLast, uCount;
+
+    uLast = __atomic_load_n( &pstEvents->uCount, __ATOMIC_ACQUIRE );
+    __atomic_fetch_add( &pstEventArea->iReady, 1, __ATOMIC_RELEASE );
+
+    while( !__atomic_load_n( &pstEventArea->bStop, __ATOMIC_ACQUIRE ) )
+    {
+        if( iPolling )
+        {
+            SleepUntilNS( NowNS() + (uint64_t)iPolling * 1000000ULL );
+            uCount = __atomic_load_n( &pstEvents->uCount, __ATOMIC_ACQUIRE );
+        }
+        else
+            uCount = WaitEvent( pstEvents, uLast, EVENT_POLLING );
+
+        if( uCount != uLast )
+        {
+            uLatency = NowNS() - pstEventArea->auPosted[(uLast + 1) % EVENT_TIMES];
+            uTotal  += uLatency;
+            uWorst   = (uLatency > uWorst)? uLatency : uWorst;
+            uLast    = uCount;
+            ulSeen++;
+        }
+    }
+
+    pstEventArea->aulSeen[iWaiter] = ulSeen;
+    pstEventArea->auTotal[iWaiter] = uTotal;
+    pstEventArea->auWorst[iWaiter] = uWorst;
+}
+
+static void EventRun( int iPolling, int iWaiters, int iTime, int iInterval )
+{
+    P_QST_EVENT_STAMPS  pstEvents = &pstEventArea->stSeg.stEvents;
+    unsigned long       ulSeen = 0, ulPosted = 0;
+    uint64_t            uTotal = 0, uWorst = 0, uEnd, uNext;
+    pid_t               ahChild[UPDATE_MAX];
+    char                szMode[32];
+    int                 iWaiter, iStatus;
+
+    pstEventArea->bStop  = FALSE;
+    pstEventArea->iReady = 0;
+    fflush( stdout );
+
+    for( iWaiter = 0; iWaiter < iWaiters; iWaiter++ )
+    {
+        if( (ahChild[iWaiter] = fork()) == -1 )
+        {
+            printf( "Unable to create process: %s\n", strerror( errno ) );
+            __atomic_store_n( &pstEventArea->bStop, TRUE, __ATOMIC_RELEASE );
+            iWaiters = iWaiter;
+            break;
+        }
+
+        if( ahChild[iWaiter] == 0 )
+        {
+            EventWaiter( iWaiter, iPolling );
+            exit( 0 );
+        }
+    }
+
+    while( __atomic_load_n( &pstEventArea->iReady, __ATOMIC_ACQUIRE ) < iWaiters )
+        sched_yield();
+
+    // Post an event each interval until time is up
+
+    uNext = NowNS();
+    uEnd  = uNext + (uint64_t)iTime * 1000000ULL;
+
+    while( (uNext += (uint64_t)iInterval * 1000000ULL) < uEnd )
+    {
+        SleepUntilNS( uNext );
+
+        pstEvents->uReadings = NextEventStamp( &pstEventArea->stSeg );
+        pstEventArea->auPosted[pstEvents->uReadings % EVENT_TIMES] = NowNS();
+        PostEvent( pstEvents, pstEvents->uReadings );
+        ulPosted++;
+    }
+
+    __atomic_store_n( &pstEventArea->bStop, TRUE, __ATOMIC_RELEASE );
+
+    for( iWaiter = 0; iWaiter < iWaiters; iWaiter++ )
+    {
+        waitpid( ahChild[iWaiter], &iStatus, 0 );
+
+        ulSeen += pstEventArea->aulSeen[iWaiter];
+        uTotal += pstEventArea->auTotal[iWaiter];
+        uWorst  = (pstEventArea->auWorst[iWaiter] > uWorst)? pstEventArea->auWorst[iWaiter] : uWorst;
+    }
+
+    if( iPolling )
+        sprintf( szMode, "Polling (%d ms)", iPolling );
+    else
+        strcpy( szMode, "Futex" );
+
+    printf( "%-16s   %8lu   %8lu   %12.1f   %12.1f\n", szMode, ulPosted, ulSeen,
+            ulSeen? (double)uTotal / (double)ulSeen / 1000.0 : 0.0, (double)uWorst / 1000.0 );
+}
+
+static int BenchEvent( int iArgs, char *pszArg[] )
+{
+    int                 iWaiters = EVENT_WAITERS, iPolling = EVENT_POLLING, iInterval = EVENT_INTERVAL, iTime = BENCH_TIME, iOpt;
+
+    for( iOpt = 0; iOpt + 1 < iArgs; iOpt += 2 )
+    {
+        if( !strcmp( pszArg[iOpt], "-c" ) )
+            iWaiters = atoi( pszArg[iOpt + 1] );
+        else if( !strcmp( pszArg[iOpt], "-p" ) )
+            iPolling = atoi( pszArg[iOpt + 1] );
+        else if( !strcmp( pszArg[iOpt], "-i" ) )
+            iInterval = atoi( pszArg[iOpt + 1] );
+        else if( !strcmp( pszArg[iOpt], "-t" ) )
+            iTime = atoi( pszArg[iOpt + 1] );
+        else
+            break;
+    }
+
+    if( (iOpt != iArgs) || (iWaiters < 1) || (iWaiters > UPDATE_MAX) || (iPolling < 1) || (iInterval < 1) || (iTime < 1) )
+    {
+        puts( "Usage: QstBench event [-c waiters] [-p polling-ms] [-i interval-ms] [-t time-ms]" );
+        return( 1 );
+    }
+
+    pstEventArea = (EVENT_AREA *)mmap( NULL, sizeof(EVENT_AREA), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0 );
+
+    if( pstEventArea == MAP_FAILED )
+    {
+        printf( "Unable to create shared area: %s\n", strerror( errno ) );
+        return( 1 );
+    }
+
+    memset( pstEventArea, 0, sizeof(EVENT_AREA) );
+
+    printf( "%d waiting processes, an event every %d ms\n\n", iWaiters, iInterval );
+    printf( "Waiting by            posted       seen   mean latency  worst latency\n" );
+    printf( "                                                  (us)           (us)\n" );
+    printf( "----------------   --------   --------   ------------   ------------\n" );
+
+    EventRun( iPolling, iWaiters, iTime, iInterval );
+    EventRun( 0, iWaiters, iTime, iInterval );
+
+    munmap( pstEventArea, sizeof(EVENT_AREA) );
+    return( 0 );
+}
+
+/****************************************************************************/
+/* Benchmark "timer" - Ticks every interval, scheduling the ticks the way   */
+/* WaitMTime() used to (wall clock times truncated to the millisecond, and  */
+/* a relative sleep computed from them), the way it does now (an absolute   */
+/* sleep on the monotonic clock) and with a periodic MILLITIMER, and        */
+/* measures how early or late each tick was against its scheduled time.     */
+/* Then times the expiry check made by the Get*UpdateQst() functions with   */
+/* each kind of time.                                                       */
+/****************************************************************************/
+
+#define TIMER_SCHEDULERS 3
+
+typedef struct _WALL_MTIME              // MILLITIME, as it used to be
+{
+    time_t              tTimeS;
+    unsigned long       uTimeMS;
+
+} WALL_MTIME;
+
+static void WallCurrMTime( WALL_MTIME *pMTime )
+{
+    struct timeval      stTV;
+
+    gettimeofday( &stTV, NULL );
+
+    pMTime->tTimeS  = stTV.tv_sec;
+    pMTime->uTimeMS = stTV.tv_usec / 1000;
+}
+
+static void WallAddMTime( WALL_MTIME *pMTime, unsigned long uMillisecs )
+{
+    unsigned long       uMS = pMTime->uTimeMS + uMillisecs;
+
+    pMTime->tTimeS  += uMS / 1000;
+    pMTime->uTimeMS  = uMS % 1000;
+}
+
+static BOOL WallPastMTime( WALL_MTIME *pMTime1, WALL_MTIME *pMTime2 )
+{
+    if( pMTime1->tTimeS != pMTime2->tTimeS )
+        return( pMTime1->tTimeS < pMTime2->tTimeS );
+
+    return( pMTime1->uTimeMS < pMTime2->uTimeMS );
+}
+
+static void WallWaitMTime( WALL_MTIME *pMTime )
+{
+    WALL_MTIME          stNow;
+    struct timespec     stTime;
+    long                iMS;
+
+    WallCurrMTime( &stNow );
+
+    iMS = (long)((((double)pMTime->tTimeS - (double)stNow.tTimeS) * 1000.0) + (double)pMTime->uTimeMS - (double)stNow.uTimeMS);
+
+    if( iMS > 0 )
+    {
+        stTime.tv_sec  = (time_t)(iMS / 1000);
+        stTime.tv_nsec = 1000000L * (iMS % 1000);
+
+        while( (nanosleep( &stTime, &stTime ) == -1) && (errno == EINTR) );
+    }
+}
+
+static uint64_t WallNowNS( void )
+{
+    struct timespec     stTime;
+
+    clock_gettime( CLOCK_REALTIME, &stTime );
+    return( (uint64_t)stTime.tv_sec * 1000000000ULL + stTime.tv_nsec );
+}
+
+static void TimerRun( int iScheduler, int iInterval, int iTime )
+{
+    static const char * const pszScheduler[TIMER_SCHEDULERS] = { "WaitMTime (old)", "WaitMTime", "MILLITIMER" };
+
+    WALL_MTIME          stWallDue;
+    MILLITIME           stDue;
+    MILLITIMER          stTimer;
+    uint64_t            uBase, uPeriod = (uint64_t)iInterval * 1000000ULL, uEnd, uScheduled, uNow;
+    uint64_t            uTotal = 0, uEarly = 0, uLate = 0;
+    unsigned long       ulTicks = 0, ulMissed = 0, ulTick, ulCount;
+    int64_t             iError;
+
+    // The old scheduler works in wall clock time, the others in monotonic
+
+    if( iScheduler == 0 )
+    {
+        WallCurrMTime( &stWallDue );
+        uBase = (uint64_t)stWallDue.tTimeS * 1000000000ULL + stWallDue.uTimeMS * 1000000ULL;
+    }
+    else
+    {
+        CurrMTime( &stDue );
+        uBase = stDue.uTimeNS;
+    }
+
+    if( iScheduler == 2 )
+    {
+        if( !OpenMTimer( &stTimer ) )
+        {
+            printf( "Unable to create timer: %s\n", strerror( errno ) );
+            return;
+        }
+
+        AddMTime( &stDue, 0, iInterval );
+        StartMTimer( &stTimer, &stDue, iInterval );
+    }
+
+    uEnd = uBase + (uint64_t)iTime * 1000000ULL;
+
+    for( ulTick = 1; (uScheduled = uBase + ulTick * uPeriod) <= uEnd; ulTick++ )
+    {
+        switch( iScheduler )
+        {
+        case 0:
+
+            WallAddMTime( &stWallDue, iInterval );
+            WallWaitMTime( &stWallDue );
+            uNow = WallNowNS();
+            break;
+
+        case 1:
+
+            AddMTime( &stDue, 0, iInterval );
+            WaitMTime( &stDue );
+            uNow = NowNS();
+            break;
+
+        default:
+
+            // Ticks missed are counted, but not measured
+
+            ulCount     = WaitMTimer( &stTimer );
+            uNow        = NowNS();
+            ulTick     += (ulCount > 1)? ulCount - 1 : 0;
+            ulMissed   += (ulCount > 1)? ulCount - 1 : 0;
+            uScheduled  = uBase + ulTick * uPeriod;
+            break;
+        }
+
+        iError  = (int64_t)(uNow - uScheduled);
+        uTotal += (iError < 0)? (uint64_t)-iError : (uint64_t)iError;
+        uEarly  = ((iError < 0) && ((uint64_t)-iError > uEarly))? (uint64_t)-iError : uEarly;
+        uLate   = ((iError > 0) && ((uint64_t)iError > uLate))? (uint64_t)iError : uLate;
+        ulTicks++;
+    }
+
+    if( iScheduler == 2 )
+        CloseMTimer( &stTimer );
+
+    printf( "%-16s   %8lu   %8lu   %12.1f   %12.1f   %12.1f\n", pszScheduler[iScheduler], ulTicks, ulMissed,
+            ulTicks? (double)uTotal / (double)ulTicks / 1000.0 : 0.0, (double)uEarly / 1000.0, (double)uLate / 1000.0 );
+}
+
+static void TimerChecks( void )
+{
+    WALL_MTIME          stWallNow, stWallDue;
+    MILLITIME           stNow, stDue;
+    unsigned long       ulDue = 0;
+    uint64_t            uStart, uWall, uMono;
+    int                 iCheck;
+
+    WallCurrMTime( &stWallDue );
+    WallAddMTime( &stWallDue, 60000 );
+    uStart = NowNS();
+
+    for( iCheck = 0; iCheck < TIMER_CHECKS; iCheck++ )
+    {
+        WallCurrMTime( &stWallNow );
+        ulDue += WallPastMTime( &stWallDue, &stWallNow );
+    }
+
+    uWall = NowNS() - uStart;
+
+    CurrMTime( &stDue );
+    AddMTime( &stDue, 60, 0 );
+    uStart = NowNS();
+
+    for( iCheck = 0; iCheck < TIMER_CHECKS; iCheck++ )
+    {
+        CurrMTime( &stNow );
+        ulDue += PastMTime( &stDue, &stNow );
+    }
+
+    uMono = NowNS() - uStart;
+
+    printf( "\nExpiry check: %.1f ns with wall clock times, %.1f ns with monotonic times%s\n",
+            (double)uWall / TIMER_CHECKS, (double)uMono / TIMER_CHECKS, ulDue? " (clock stepped)" : "" );
+}
+
+static int BenchTimer( int iArgs, char *pszArg[] )
+{
+    int                 iInterval = TIMER_INTERVAL, iTime = BENCH_TIME, iOpt, iScheduler;
+
+    for( iOpt = 0; iOpt + 1 < iArgs; iOpt += 2 )
+    {
+        if( !strcmp( pszArg[iOpt], "-i" ) )
+            iInterval = atoi( pszArg[iOpt + 1] );
+        else if( !strcmp( pszArg[iOpt], "-t" ) )
+            iTime = atoi( pszArg[iOpt + 1] );
+        else
+            break;
+    }
+
+    if( (iOpt != iArgs) || (iInterval < 1) || (iTime < iInterval) )
+    {
+        puts( "Usage: QstBench timer [-i interval-ms] [-t time-ms]" );
+        return( 1 );
+    }
+
+    printf( "A tick every %d ms\n\n", iInterval );
+    printf( "Scheduler             ticks     missed     mean error    worst early     worst late\n" );
+    printf( "                                               (us)           (us)           (us)\n" );
+    printf( "----------------   --------   --------   ------------   ------------   ------------\n" );
+
+    for( iScheduler = 0; iScheduler < TIMER_SCHEDULERS; iScheduler++ )
+        TimerRun( iScheduler, iInterval, iTime );
+
+    TimerChecks();
+    return( 0 );
+}
+
+/****************************************************************************/
+/* main() - Mainline for program                                            */
+/****************************************************************************/
+
+int main( int iArgs, char *pszArg[] )
+{
+    if( iArgs >= 2 )
+    {
+        if( !strcmp( pszArg[1], "pipe" ) )
+            return( BenchPipe( iArgs - 2, pszArg + 2 ) );
+
+        if( !strcmp( pszArg[1], "comm" ) )
+            return( BenchComm( iArgs - 2, pszArg + 2 ) );
+
+        if( !strcmp( pszArg[1], "modes" ) )
+            return( BenchModes( iArgs - 2, pszArg + 2 ) );
+
+        if( !strcmp( pszArg[1], "async" ) )
+            return( BenchAsync( iArgs - 2, pszArg + 2 ) );
+
+        if( !strcmp( pszArg[1], "lock" ) )
+            return( BenchLock( iArgs - 2, pszArg + 2 ) );
+
+        if( !strcmp( pszArg[1], "xlate" ) )
+            return( BenchXlate( iArgs - 2, pszArg + 2 ) );
+
+        if( !strcmp( pszArg[1], "update" ) )
+            return( BenchUpdate( iArgs - 2, pszArg + 2 ) );
+
+        if( !strcmp( pszArg[1], "globmem" ) )
+            return( BenchGlobMem( iArgs - 2, pszArg + 2 ) );
+
+        if( !strcmp( pszArg[1], "hot" ) )
+            return( BenchHot( iArgs - 2, pszArg + 2 ) );
+
+        if( !strcmp( pszArg[1], "event" ) )
+            return( BenchEvent( iArgs - 2, pszArg + 2 ) );
+
+        if( !strcmp( pszArg[1], "timer" ) )
+            return( BenchTimer( iArgs - 2, pszArg + 2 ) );
+    }
+
+    puts( "Usage: QstBench <benchmark> [options]\n" );
+    puts( "Benchmarks:" );
+    puts( "   pipe      HECI transaction engine against a loopback transport" );
+    puts( "   comm      libQstComm against the simulated subsystem" );
+    puts( "   modes     libQstComm in each of its concurrency modes" );
+    puts( "   async     Asynchronous libQstComm commands from an epoll loop" );
+    puts( "   lock      Critical section (futex) against semaphore operations" );
+    puts( "   xlate     Translation between the QST 2.x and 1.x command sets" );
+    puts( "   update    Multi-process libQstInst snapshots checked against the simulator" );
+    puts( "   globmem   New client attaching each type of global memory segment" );
+    puts( "   hot       Multi-process reads of readings, with and without hot blocks" );
+    puts( "   event     Processes waiting for events, by polling and on a futex" );
+    puts( "   timer     Tick scheduling jitter, and the cost of an expiry check" );
+
+    return( 1 );
+}
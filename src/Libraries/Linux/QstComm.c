@@ -1,7 +1,4 @@
 
-#define SINGLE_THREADED             // Define this to force module to do QST
-                                    // HECI transactions one at a time...
-
 /****************************************************************************/
 /*                                                                          */
 /*  Module:         QstComm.c                                               */
@@ -10,10 +7,127 @@
 /*                  with  the  Intel(R)  Quiet System Technology (QST) F/W  */
 /*                  Subsystem running on the Management Engine (ME).        */
 /*                                                                          */
-/*  Notes:      1.  This  module  is  designed  such that it can be linked  */
-/*                  directly  into  an  application  (along  with   module  */
-/*                  heci.c) or it can be used as the main module  for  the  */
-/*                  QstComm Shared Object (SO) File.                        */
+/*  Notes:      1.  This module is designed such that  it  can  be  linked  */
+/*                  directly  into  an  application  (along  with  modules  */
+/*                  heci.c and HeciPipe.c) or it can be used as  the  main  */
+/*                  module for the QstComm Shared Object (SO) File.         */
+/*                                                                          */
+/*              2.  QstCommandTimed() bounds the time taken by a  command.  */
+/*                  The deadline it sets is kept per thread and honored by  */
+/*                  CommonCmdHandler(), so every transaction made  on  the  */
+/*                  command's behalf (including those for determining  the  */
+/*                  firmware version and for translating commands)  shares  */
+/*                  it. Attach attempts, waits for  the  critical  section  */
+/*                  and responses, and retry delays are all cut  short  as  */
+/*                  it approaches. Retries made under a deadline back  off  */
+/*                  exponentially, with  jitter,  rather  than  waiting  a  */
+/*                  fixed RETRY_DELAY.                                      */
+/*                                                                          */
+/*              3.  Applications that poll the  subsystem  frequently  can  */
+/*                  borrow response buffers with QstBorrowBuffer().  These  */
+/*                  are registered with heci.c, so responses are read from  */
+/*                  the driver directly  into  them  (rather  than  via  a  */
+/*                  bounce  buffer),  and  the  application  can  use  the  */
+/*                  responses where they land.                              */
+/*                                                                          */
+/*              4.  Event-driven applications  can  submit  commands  with  */
+/*                  QstCommandAsync() and have them complete, without  any  */
+/*                  thread blocking, by calling QstAsyncProcess() whenever  */
+/*                  the descriptor from QstAsyncGetFD() is readable.  This  */
+/*                  is the Linux counterpart of the overlapped I/O used by  */
+/*                  the Windows DLL. Asynchronous commands are not retried  */
+/*                  and  are  only   supported   by   QST   2.x   firmware  */
+/*                  (translation  to  the  legacy  command  set   requires  */
+/*                  several  transactions  per  command).  Responses   are  */
+/*                  awaited  with  the  critical  section  held,  so   the  */
+/*                  application must call QstAsyncProcess()  promptly:  if  */
+/*                  it hasn't done so a second after a response  was  due,  */
+/*                  the commands outstanding fail with ETIMEDOUT  and  the  */
+/*                  critical section is released for other processes.       */
+/*                                                                          */
+/*              5.  QstCommandBatch() verifies a  set  of  commands  once,  */
+/*                  determines the firmware version once and hands them to  */
+/*                  the transaction engine together, so they are sent in a  */
+/*                  single hold of the critical section and kept in flight  */
+/*                  together. Commands that fail in transfer  are  retried  */
+/*                  together, as QstCommand2() would retry them and  after  */
+/*                  the same delays (see RetryDelay()).                     */
+/*                                                                          */
+/*              6.  Threads  of  the  same  process  that  make  the  same  */
+/*                  read-only request of QST 2.x firmware at the same time  */
+/*                  (typically when a polling interval has expired for all  */
+/*                  of them) share a single transaction: the  first  sends  */
+/*                  the command and the others wait  for,  and  are  given  */
+/*                  copies of, its response. Commands that may change  the  */
+/*                  subsystem's state stop reads already  in  flight  from  */
+/*                  being joined, so a thread never sees a response  older  */
+/*                  than its own last change. Commands with a deadline are  */
+/*                  never shared. Requests from  different  processes  are  */
+/*                  not  coalesced;  each  sends  its   own   transaction.  */
+/*                  QstGetCoalesceStats() reports how many  requests  were  */
+/*                  shared this way.                                        */
+/*                                                                          */
+/*              7.  Setting environment variable QST_COMM_STATS (to  other  */
+/*                  than 0),  or  calling  QstCommEnableStats(),  has  the  */
+/*                  module keep latency histograms for each  command,  and  */
+/*                  counts   of   retries,   connections,   timeouts   and  */
+/*                  translations, which QstCommGetStats() takes a snapshot  */
+/*                  of.  The  counters  are  updated  atomically,  without  */
+/*                  locking; when statistics aren't being kept,  the  cost  */
+/*                  is a test of  a  flag.  Asynchronous  commands  aren't  */
+/*                  included.                                               */
+/*                                                                          */
+/*              8.  The way in which the subsystem is shared  is  selected  */
+/*                  at  run  time,  by  QstSetConcurrency()  (before   any  */
+/*                  commands   are   sent)   or    environment    variable  */
+/*                  QST_CONCURRENCY. In the  default  (system)  mode,  the  */
+/*                  transaction  engine  holds  a  cross-process  critical  */
+/*                  section  while  it  has  transactions  in  flight.  In  */
+/*                  process mode, the application promises that  no  other  */
+/*                  process  will  use  the  subsystem,  so  the  critical  */
+/*                  section isn't created and the threads of  the  process  */
+/*                  are  coordinated  only  by  the  engine's  own  mutex.  */
+/*                  Exclusive mode further promises that only  one  thread  */
+/*                  will  send  commands,  so  reads  aren't  checked  for  */
+/*                  coalescing either. The engine's mutex is  still  taken  */
+/*                  in exclusive mode, since it also guards  state  shared  */
+/*                  with asynchronous completion and the engine's watchdog  */
+/*                  thread, but with a single thread sending  commands  it  */
+/*                  is normally uncontended.                                */
+/*                                                                          */
+/*              9.  The subsystem information  that  decides  whether  the  */
+/*                  legacy command set is in use  is  published,  under  a  */
+/*                  sequence count, in a global memory segment.  Only  the  */
+/*                  first process to send a command  asks  the  subsystem;  */
+/*                  later processes start with  no  probes.  A  connection  */
+/*                  re-formed after a failure (as when the ME resets)  may  */
+/*                  find different firmware, so it bumps an epoch  in  the  */
+/*                  segment, and each process asks again before  its  next  */
+/*                  command. So does any connection the driver refused  at  */
+/*                  first,  even  a  process's  first,  since  the  driver  */
+/*                  refuses connections while the  ME  is  resetting.  The  */
+/*                  segment is persistent (see GlobMem.c): it is kept when  */
+/*                  no process is using it, so programs that run  briefly,  */
+/*                  one after another,  don't  each  ask  again.  It  also  */
+/*                  records the kernel's boot id, and the first process to  */
+/*                  open it after the system restarts bumps the epoch,  in  */
+/*                  case the segment's  directory  outlived  the  restart.  */
+/*                  Each layout of the segment has its own segment id,  so  */
+/*                  a persistent segment left by an older library  doesn't  */
+/*                  get in the way. Without the segment,  the  information  */
+/*                  is kept for the process alone, and is still  refreshed  */
+/*                  this way.                                               */
+/*                                                                          */
+/*              10. The segment also holds the  configuration  stamp  that  */
+/*                  QstGetConfigStamp() returns. It starts from  the  time  */
+/*                  the segment was made and is bumped  before  and  after  */
+/*                  every  command  that  sets  a   sensor's   thresholds,  */
+/*                  whichever process sends it and  in  whichever  command  */
+/*                  set, and when the system is found to have restarted. A  */
+/*                  copy of  the  sensors'  configurations  (such  as  the  */
+/*                  Instrumentation  Library's  enumeration  cache)  taken  */
+/*                  after the stamp was read is current  as  long  as  the  */
+/*                  stamp still has that value.                             */
 /*                                                                          */
 /****************************************************************************/
 
@@ -62,6 +176,7 @@
 #include <string.h>
 #include <time.h>
 #include <errno.h>
+#include <pthread.h>
 
 #include <sys/ipc.h>
 #include <sys/types.h>
@@ -75,7 +190,9 @@
 #include "LegTranslationFuncs.h"
 #include "QstComm.h"
 #include "CritSect.h"
+#include "GlobMem.h"
 #include "heci.h"
+#include "HeciPipe.h"
 
 /****************************************************************************/
 /* Configuration                                                            */
@@ -86,16 +203,67 @@
 
 #define RETRY_COUNT     10              // Communication attempts before giving up
 #define RETRY_DELAY     1000            // Delay between retries
+#define BACKOFF_DELAY   10              // Initial delay between retries with a deadline
+
+#define PIPE_DEPTH      4               // Transactions outstanding with subsystem
+#define PIPE_TIMEOUT    1000            // Wait for each response (milliseconds)
+
+#define BORROW_COUNT    16              // Response buffers available for borrowing
+
+#if QST_ASYNC_MAX_OUTSTANDING > HECI_PIPE_MAX_ASYNC
+#error Engine cannot hold QST_ASYNC_MAX_OUTSTANDING asynchronous commands
+#endif
 
-#ifdef  SINGLE_THREADED
 /****************************************************************************/
-/* Definitions/Variables for single-threading                               */
+/* Definitions/Variables for sharing among processes                        */
 /****************************************************************************/
 
 #define CRITSECT_TYPE   0xAF5C010       // Critical Section type
-static  HCRITSECT       hCritSect;      // Critical Section handle
+static  HCRITSECT       hCritSect;      // Critical Section handle (system mode only)
 
-#endif
+static int              iConcurrency;   // Concurrency mode (QST_CONCURRENCY_XXX)
+static volatile BOOL    bStarted;       // Indicates if transactions have begun
+
+/****************************************************************************/
+/* Subsystem information published for other processes. The entry is        */
+/* rewritten with uSequence odd, so readers can detect (and ignore) one     */
+/* that is being changed underneath them. It only applies while uEpoch      */
+/* holds the value it was obtained under.                                   */
+/****************************************************************************/
+
+#define INFO_VERSION    3               // Layout of INFO_SEGMENT
+#define INFO_SEGMENT_ID (0xAF5C04F + INFO_VERSION)
+                                        // Global memory segment id (one per layout)
+#define INFO_BOOT_ID    "/proc/sys/kernel/random/boot_id"
+                                        // Identifies the current system start
+
+#define INFO_MODE_NONE      0           // No entry published
+#define INFO_MODE_NATIVE    1           // QST 2.x command set in use
+#define INFO_MODE_LEGACY    2           // Commands translated to QST 1.x command set
+
+typedef struct _INFO_SEGMENT
+{
+   U32                              uVersion;           // INFO_VERSION (0 before initialization)
+   U32                              uSize;              // Size of segment
+   U32                              uEpoch;             // Bumped when connection re-formed
+   U32                              uSequence;          // Odd while entry being written
+   U32                              uInfoEpoch;         // Value of uEpoch entry obtained under
+   U32                              uMode;              // Command set in use (INFO_MODE_XXX)
+   uint64_t                         uBootId;            // System start segment last opened in (0 if unknown)
+   uint64_t                         uConfigStamp;       // Bumped when thresholds set (see note 10)
+   char                             szTransport[16];    // Transport entry obtained through
+   QST_GET_SUBSYSTEM_INFO_RSP       stInfo;             // Subsystem information
+
+} INFO_SEGMENT;
+
+static INFO_SEGMENT     *pstInfoSeg;    // Shared segment (or stInfoLocal)
+static INFO_SEGMENT     stInfoLocal;    // Used when segment unavailable
+static pthread_mutex_t  stInfoLock = PTHREAD_MUTEX_INITIALIZER;
+static U32              uInfoEpoch;     // Value of uEpoch QstSubsystemInfo obtained under
+static U32              uInfoSeen;      // Sequence count of entry found unusable
+static BOOL             bEverAttached;  // Indicates if connection has been formed before
+static QST_GET_SUBSYSTEM_INFO_RSP stInfoDefault;
+                                        // QstSubsystemInfo before determination
 
 /****************************************************************************/
 /* Process-Specific Variables                                               */
@@ -108,6 +276,60 @@ static BOOL             bAttached;      // Indicates if attached to HECI driver
 static int              iMaxReceive;    // Maximum receive/send length
 static int              iInitErrno;     // Saved errno from initialization
 
+static void             *apvBorrow[BORROW_COUNT];
+                                        // Response buffers for borrowing
+static volatile UINT32  uBorrowed;      // Mask of buffers currently borrowed
+
+/****************************************************************************/
+/* Coalescing of identical reads. A thread sending a read-only command      */
+/* lists it in pstFlights while the transaction is made; threads wanting    */
+/* the same response attach themselves to its list of waiters instead of    */
+/* sending the command again.                                               */
+/****************************************************************************/
+
+typedef struct _COALESCE_WAITER
+{
+   struct _COALESCE_WAITER          *pstNext;           // Next waiter for same flight
+   void                             *pvRspBuf;          // Where to copy response
+   BOOL                             bDone;              // Set when flight complete
+   BOOL                             bSucceeded;         // Outcome of flight
+   int                              iErrno;             // errno value when failed
+
+} COALESCE_WAITER;
+
+typedef struct _COALESCE_FLIGHT
+{
+   struct _COALESCE_FLIGHT          *pstNext;           // Next flight in progress
+   void                             *pvCmdBuf;          // Command packet being sent
+   size_t                           tCmdSize;           // Size of command packet
+   size_t                           tRspSize;           // Expected size of response packet
+   UINT32                           uGeneration;        // Value of uGeneration when sent
+   COALESCE_WAITER                  *pstWaiters;        // Threads awaiting its response
+
+} COALESCE_FLIGHT;
+
+static pthread_mutex_t  stCoalesceLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   stCoalesceDone = PTHREAD_COND_INITIALIZER;
+static COALESCE_FLIGHT  *pstFlights;    // Reads in progress
+static volatile UINT32  uGeneration;    // Bumped by commands that change state
+static unsigned long    ulIssued;       // Reads sent to subsystem
+static unsigned long    ulCoalesced;    // Reads answered by another's response
+
+/****************************************************************************/
+/* Instrumentation                                                          */
+/****************************************************************************/
+
+static volatile BOOL    bStatsEnabled;  // Indicates if statistics are being kept
+static QST_COMM_STATS   stStats;        // Statistics for process
+
+/****************************************************************************/
+/* Thread-Specific Variables                                                */
+/****************************************************************************/
+
+static __thread uint64_t uCmdDeadline;  // Deadline for current command (0 if none)
+static __thread unsigned int uJitterSeed;
+                                        // Seed for retry delay jitter
+
 /****************************************************************************/
 /* Delay() - Implements an 'n' millisecond delay.                           */
 /****************************************************************************/
@@ -126,284 +348,611 @@ static void Delay( int iMilliseconds )
 }
 
 /****************************************************************************/
-/* AttachDriver() - Attaches HECI driver.                                   */
+/* StatsNow() - Returns a monotonic time in microseconds.                   */
 /****************************************************************************/
 
-static BOOL AttachDriver( void )
+static uint64_t StatsNow( void )
 {
-   int iRetries, iMax;
+   struct timespec stNow;
 
-   for( iRetries = 0, bAttached = FALSE; iRetries < ATTACH_RETRIES; iRetries++ )
-   {
-      iMaxReceive = HeciConnect( &QST_SUBSYSTEM_GUID );
+   clock_gettime( CLOCK_MONOTONIC, &stNow );
 
-      if( iMaxReceive > 0 )
-      {
-         bAttached = TRUE;
-         break;
-      }
+   return( (uint64_t)stNow.tv_sec * 1000000 + stNow.tv_nsec / 1000 );
+}
 
-      Delay( ATTACH_DELAY );
-   }
+/****************************************************************************/
+/* CountEvent() - Counts an event, if statistics are being kept.            */
+/****************************************************************************/
 
-   return( bAttached );
+static void CountEvent( unsigned long long *pullCounter )
+{
+   if( bStatsEnabled )
+      __atomic_fetch_add( pullCounter, 1, __ATOMIC_RELAXED );
 }
 
 /****************************************************************************/
-/* DetachDriver() - Detaches HECI driver                                    */
+/* StatsBucket() - Determines histogram bucket for a latency. See           */
+/* QST_STATS_BUCKET_FLOOR() in QstComm.h for the layout.                    */
 /****************************************************************************/
 
-static void DetachDriver( void )
+static int StatsBucket( uint64_t uMicroseconds )
 {
-   if( bAttached )
-   {
-      HeciDisconnect();
-      bAttached = FALSE;
-   }
+   int iExp, iBucket;
+
+   if( uMicroseconds < 8 )
+      return( (int)uMicroseconds );
+
+   iExp    = 63 - __builtin_clzll( uMicroseconds );
+   iBucket = 8 + (iExp - 3) * 4 + (int)((uMicroseconds >> (iExp - 2)) & 3);
+
+   return( (iBucket < QST_STATS_BUCKETS)? iBucket : QST_STATS_BUCKETS - 1 );
 }
 
+C_ASSERT(QST_STATS_COMMANDS == QST_LAST_CMD_CODE + 1);
+
 /****************************************************************************/
-/* CommonCmdHandler() - Common code used to pass commands and obtain any    */
-/* responses from the QST subsystem.  This code MUST be compatible with any */
-/* revision of the QST firmware.                                            */
+/* RecordCommand() - Records the latency and outcome of a command that was  */
+/* started at time uStart (see StatsNow()). errno is preserved.             */
 /****************************************************************************/
 
-BOOL CommonCmdHandler(
+static void RecordCommand( void *pvCmdBuf, uint64_t uStart, BOOL bSucceeded )
+{
+   P_QST_COMMAND_STATS              pstCmd;             // Statistics for command
+   uint64_t                         uTime;              // Latency of command
+   uint64_t                         uMax;               // Longest latency seen so far
+   UINT8                            byCommand;          // Command code
 
-   IN  void                         *pvCmdBuf,          // Address of buffer contaiing command packet
-   IN  size_t                       tCmdSize,           // Size of command packet
-   OUT void                         *pvRspBuf,          // Address of buffer for response packet
-   IN  size_t                       tRspSize            // Expected size of response packet
-){
-   DWORD                            tReceived;          // Response packet size
-   int                              iRetries;           // Retry counter
-   int                              iErrnoSave;         // For saving errno value
-   BOOL                             bSucceeded = FALSE; // Success indicator
+   if( !pvCmdBuf )
+      return;
 
-   // If we had problem during module initialization, we can't continue
+   if( (byCommand = ((P_QST_CMD_HEADER)pvCmdBuf)->byCommand) >= QST_STATS_COMMANDS )
+      return;
 
-   if( iInitErrno )
-   {
-      errno = iInitErrno;
-      return( FALSE );
-   }
+   pstCmd = &stStats.astCommand[byCommand];
+   uTime  = StatsNow() - uStart;
+   uMax   = __atomic_load_n( &pstCmd->ullMaxTime, __ATOMIC_RELAXED );
 
-#ifdef SINGLE_THREADED
+   __atomic_fetch_add( &pstCmd->ullCount, 1, __ATOMIC_RELAXED );
+   __atomic_fetch_add( &pstCmd->ullTotalTime, uTime, __ATOMIC_RELAXED );
+   __atomic_fetch_add( &pstCmd->aullHistogram[StatsBucket( uTime )], 1, __ATOMIC_RELAXED );
 
-   // Get exclusive access to driver (no overlapped operations)
+   while(    (uTime > uMax)
+          && !__atomic_compare_exchange_n( &pstCmd->ullMaxTime, &uMax, uTime, TRUE, __ATOMIC_RELAXED, __ATOMIC_RELAXED ) );
 
-   if( !EnterCritSect( hCritSect ) )
-      return( FALSE );
+   if( !bSucceeded )
+   {
+      __atomic_fetch_add( &pstCmd->ullFailed, 1, __ATOMIC_RELAXED );
 
-#endif
+      if( errno == ETIMEDOUT )
+         __atomic_fetch_add( &stStats.ullTimeouts, 1, __ATOMIC_RELAXED );
+   }
+}
+
+/****************************************************************************/
+/* AttachDriver() - Attaches HECI driver. Gives up after iTimeout ms unless */
+/* iTimeout is negative.                                                    */
+/****************************************************************************/
 
-   // Attach to HECI driver if we haven't already
+static BOOL AttachDriver( int iTimeout )
+{
+   uint64_t uUntil = (iTimeout >= 0)? HeciPipeNow() + iTimeout : 0;
+   uint64_t uNow;
+   int      iRetries;
 
-   if( bAttached || AttachDriver() )
+   for( iRetries = 0, bAttached = FALSE; iRetries < ATTACH_RETRIES; iRetries++ )
    {
-      // Attached; now have access to info needed to finish verifying command/response size...
+      iMaxReceive = HeciConnect( &QST_SUBSYSTEM_GUID );
 
-      if( (tCmdSize > iMaxReceive) || (tRspSize > iMaxReceive) )
+      if( iMaxReceive > 0 )
       {
-         // wants to send/receive more than can be supported...
+         bAttached = TRUE;
+         CountEvent( &stStats.ullAttaches );
+
+         // The subsystem may have been reset (and its firmware changed)
+         // since we were last connected, or while the driver was refusing
+         // the connection (as it does while the ME resets)
 
-         iErrnoSave = ERANGE;
+         if( bEverAttached || iRetries )
+            __atomic_fetch_add( &pstInfoSeg->uEpoch, 1, __ATOMIC_ACQ_REL );
+
+         bEverAttached = TRUE;
+         break;
       }
+
+      if( !uUntil )
+         Delay( ATTACH_DELAY );
+      else if( (uNow = HeciPipeNow()) + ATTACH_DELAY < uUntil )
+         Delay( ATTACH_DELAY );
       else
       {
-         // Sizes can be handled; we can attempt the transaction
-         // Support retries during attempt...
-
-         for( iRetries = 0; iRetries < RETRY_COUNT; iRetries++ )
-         {
-            // Send Command packet
+         Delay( (uNow < uUntil)? (int)(uUntil - uNow) : 0 );
+         errno = ETIMEDOUT;
+         break;
+      }
+   }
 
-            if( HeciSend( pvCmdBuf, tCmdSize ) )
-            {
-               // Successful!
-               // If no response is desired, we're done!
+   return( bAttached );
+}
 
-               if( tRspSize == 0 )
-               {
-                  bSucceeded = TRUE;
-                  break;
-               }
+/****************************************************************************/
+/* LoadInfo() - Takes the subsystem information published under epoch       */
+/* uEpoch, if there is a complete entry for the transport in use.           */
+/****************************************************************************/
 
-               // Receive and process Response Packet
+static BOOL LoadInfo( U32 uEpoch )
+{
+   QST_GET_SUBSYSTEM_INFO_RSP       stInfo;
+   char                             szTransport[sizeof(pstInfoSeg->szTransport)];
+   U32                              uSequence, uEntryEpoch, uMode;
 
-               tReceived = HeciReceive( pvRspBuf, tRspSize );
+   uSequence = __atomic_load_n( &pstInfoSeg->uSequence, __ATOMIC_ACQUIRE );
 
-               if( tReceived > 0 )
-               {
-                  // We have a response so we're done, only need to verify length
+   if( uSequence & 1 )
+   {
+      uInfoSeen = uSequence;
+      return( FALSE );
+   }
 
-                  // Since QST, if it's rejecting/failing command, always returns
-                  // just a single byte (the status byte), we can say there's a
-                  // problem if the length doesn't match what's requested and the
-                  // status byte says succeeded. Otherwise we're cool...
+   uEntryEpoch = pstInfoSeg->uInfoEpoch;
+   uMode       = pstInfoSeg->uMode;
+   memcpy( szTransport, pstInfoSeg->szTransport, sizeof(szTransport) );
+   memcpy( &stInfo, &pstInfoSeg->stInfo, sizeof(stInfo) );
 
-                  if( (tReceived != tRspSize) && (*((UINT8*)pvRspBuf) == QST_CMD_SUCCESSFUL) )
-                     iErrnoSave = ENOSPC;
-                  else
-                     bSucceeded = TRUE;
+   __atomic_thread_fence( __ATOMIC_ACQUIRE );
 
-                  break;
-               }
-            }
+   if( __atomic_load_n( &pstInfoSeg->uSequence, __ATOMIC_RELAXED ) != uSequence )
+      return( FALSE );
 
-            // Only get here if send/receive failed
-            // Want to remember ccode from first attempt, not after retry...
+   if( (uMode == INFO_MODE_NONE) || (uEntryEpoch != uEpoch) ||
+       strncmp( szTransport, HeciGetTransport()->pszName, sizeof(szTransport) ) )
+      return( FALSE );
 
-            if( iRetries == 0 )
-               iErrnoSave = errno;
+   memcpy( &QstSubsystemInfo, &stInfo, sizeof(stInfo) );
 
-            // Recreate attachment to driver (in case lost due to PM transition, HECI reset, etc.)
-            // Implement our retry delay in the middle of this to give driver a chance to recover
-            // (and others a chance to use driver)
+   // The entry has to agree with itself about the command set
 
-            DetachDriver();
+   if( uMode != (TranslationToLegacyRequired()? INFO_MODE_LEGACY : INFO_MODE_NATIVE) )
+   {
+      memcpy( &QstSubsystemInfo, &stInfoDefault, sizeof(stInfoDefault) );
+      return( FALSE );
+   }
 
-#ifdef SINGLE_THREADED
-            LeaveCritSect( hCritSect );
-#endif
+   return( TRUE );
+}
 
-            Delay( RETRY_DELAY );
+/****************************************************************************/
+/* PublishInfo() - Publishes the subsystem information obtained under epoch */
+/* uEpoch. Gives up if another process is publishing at the same time,      */
+/* unless that process seems to have died part way through (the sequence    */
+/* count hasn't moved since LoadInfo() found it odd).                       */
+/****************************************************************************/
 
-#ifdef SINGLE_THREADED
-            EnterCritSect( hCritSect );
-#endif
+static void PublishInfo( U32 uEpoch )
+{
+   U32 uSequence = __atomic_load_n( &pstInfoSeg->uSequence, __ATOMIC_RELAXED );
+   U32 uWriting  = (uSequence & 1)? uSequence + 2 : uSequence + 1;
 
-            if( !AttachDriver() )
-               break;      // Can't reattach, time to give up
-         }
-      }
-   }
+   if( (uSequence & 1) && (uSequence != uInfoSeen) )
+      return;
 
-#ifdef SINGLE_THREADED
-   LeaveCritSect( hCritSect );
-#endif
+   if( !__atomic_compare_exchange_n( &pstInfoSeg->uSequence, &uSequence, uWriting, FALSE,
+                                     __ATOMIC_ACQUIRE, __ATOMIC_RELAXED ) )
+      return;
 
-   // Set errno to reflect any errors detected
+   __atomic_thread_fence( __ATOMIC_RELEASE );
 
-   if( !bSucceeded )
-      errno = iErrnoSave;
+   pstInfoSeg->uInfoEpoch = uEpoch;
+   pstInfoSeg->uMode      = TranslationToLegacyRequired()? INFO_MODE_LEGACY : INFO_MODE_NATIVE;
+   strncpy( pstInfoSeg->szTransport, HeciGetTransport()->pszName, sizeof(pstInfoSeg->szTransport) );
+   memcpy( &pstInfoSeg->stInfo, &QstSubsystemInfo, sizeof(QstSubsystemInfo) );
 
-   return( bSucceeded );
+   __atomic_store_n( &pstInfoSeg->uSequence, uWriting + 1, __ATOMIC_RELEASE );
 }
 
 /****************************************************************************/
-/* QstCommand() - Sends command to the QST Subsystem and awaits response.   */
-/* Function returns TRUE/FALSE success indicator. Use errno to obtain       */
-/* details about failures.                                                  */
-/*                                                                          */
-/* If errors occur during the write/read operations, which will happen if   */
-/* the system goes through a low-power state transition and could happen if */
-/* the ME suffers a failure (reset), we try reforming the QST Subsystem     */
-/* connection. If successful, we then restart the transaction. We will try  */
-/* this RETRY_COUNT times before giving up.                                 */
+/* LockInfo() - Takes the lock serializing subsystem probes. If the calling */
+/* thread has a deadline, gives up (with errno ETIMEDOUT) when it passes.   */
+/* The deadline is on the monotonic clock and the mutex waits against the   */
+/* realtime clock, so the time remaining is carried over to the latter.     */
 /****************************************************************************/
 
-BOOL QstCommand(
+static BOOL LockInfo( void )
+{
+   struct timespec stTime;
+   uint64_t        uNow;
+   int             iError;
 
-   IN  void                         *pvCmdBuf,          // Address of buffer contaiing command packet
-   IN  size_t                       tCmdSize,           // Size of command packet
-   OUT void                         *pvRspBuf,          // Address of buffer for response packet
-   IN  size_t                       tRspSize            // Expected size of response packet
-){
-   P_QST_LEG_SST_PASS_THROUGH_CMD   pstQstCmd = (P_QST_LEG_SST_PASS_THROUGH_CMD)pvCmdBuf;
-                                                         // For structured access to command packet
-   BOOL                             bSucceeded = FALSE;  // Success indicator
+   if( !uCmdDeadline )
+      iError = pthread_mutex_lock( &stInfoLock );
+   else
+   {
+      if( (iError = pthread_mutex_trylock( &stInfoLock )) == EBUSY )
+      {
+         if( (uNow = HeciPipeNow()) >= uCmdDeadline )
+            iError = ETIMEDOUT;
+         else
+         {
+            clock_gettime( CLOCK_REALTIME, &stTime );
 
-   // Initialize Subsystem Information structure
+            stTime.tv_sec  += (uCmdDeadline - uNow) / 1000;
+            stTime.tv_nsec += ((uCmdDeadline - uNow) % 1000) * 1000000;
 
-   if (!GetSubsystemInformation())
-   {
-      errno = ENODEV;
-      return( FALSE );
-   }
+            if( stTime.tv_nsec >= 1000000000 )
+            {
+               stTime.tv_sec++;
+               stTime.tv_nsec -= 1000000000;
+            }
 
-   // Verify buffer validity
+            iError = pthread_mutex_timedlock( &stInfoLock, &stTime );
+         }
+      }
+   }
 
-   if( !pvCmdBuf || !pvRspBuf )
+   if( iError )
    {
-      errno = EFAULT;
+      errno = iError;
       return( FALSE );
    }
 
-   // Validate command buffer size
-
-   if( tCmdSize < sizeof(QST_LEG_CMD_HEADER) )
-   {
-      errno = EPERM;
-      return FALSE;
-   }
+   return( TRUE );
+}
 
-   // Verify Command Code
+/****************************************************************************/
+/* ProbeSubsystem() - Ensures that the subsystem information (and so the    */
+/* command set in use) is current, taking it from the global memory segment */
+/* where possible and asking the subsystem otherwise. Returns FALSE with    */
+/* errno ETIMEDOUT if the calling thread's deadline passes while another    */
+/* thread is probing, otherwise with errno ENODEV.                          */
+/****************************************************************************/
 
-   if( pstQstCmd->stHeader.byCommand > QST_LEG_LAST_CMD_CODE )
-   {
-      errno = EPERM;
-      return( FALSE );
-   }
+static BOOL ProbeSubsystem( void )
+{
+   U32  uEpoch = __atomic_load_n( &pstInfoSeg->uEpoch, __ATOMIC_ACQUIRE );
+   BOOL bFound;
 
-   // Verify Command/Response Lengths
+   if( QstSubsystemInfoFound && (uEpoch == uInfoEpoch) )
+      return( TRUE );
 
-   if(    (tCmdSize != (pstQstCmd->stHeader.wCommandLength + sizeof(QST_LEG_CMD_HEADER)))
-       || (tRspSize != (pstQstCmd->stHeader.wResponseLength)) )
-   {
-      errno = ERANGE;
+   if( !LockInfo() )
       return( FALSE );
-   }
 
-   // Verify Command/Response Lengths for SST Command if one's embedded in the packet
+   bFound = QstSubsystemInfoFound && (uEpoch == uInfoEpoch);
 
-   if( pstQstCmd->stHeader.byCommand == QST_LEG_SST_PASS_THROUGH )
+   if( !bFound )
    {
-      if(    (pstQstCmd->stHeader.wCommandLength  != (pstQstCmd->stSSTPacket.stSSTHeader.byWriteLength + sizeof(SST_CMD_HEADER)))
-          || (pstQstCmd->stHeader.wResponseLength != (pstQstCmd->stSSTPacket.stSSTHeader.byReadLength + 1)) )
+      QstSubsystemInfoFound = FALSE;
+
+      if( LoadInfo( uEpoch ) )
+         bFound = QstSubsystemInfoFound = TRUE;
+      else
       {
-         errno = ERANGE;
-         return( FALSE );
-      }
-   }
+         memcpy( &QstSubsystemInfo, &stInfoDefault, sizeof(stInfoDefault) );
+         CountEvent( &stStats.ullProbes );
 
-   // Determine if sending to a QST 2.x ME firmware...
+         if( (bFound = GetSubsystemInformation()) != FALSE )
+            PublishInfo( uEpoch );
+      }
 
-   if( TranslationToNewRequired() )
-   {
-      // Target is QST 2.x ME firmware so translate command to new command set.
+      if( bFound )
+         uInfoEpoch = uEpoch;
+   }
 
-      switch( TranslateToNewCommand( pvCmdBuf, tCmdSize, pvRspBuf, tRspSize ) )
-      {
-      case TRANSLATE_CMD_SUCCESS:
+   pthread_mutex_unlock( &stInfoLock );
 
-         return( TRUE );
+   if( !bFound )
+      errno = ENODEV;
 
-      case TRANSLATE_CMD_INVALID_PARAMETER:
-      case TRANSLATE_CMD_BAD_COMMAND:
+   return( bFound );
+}
 
-         errno = EINVAL;
-         return( FALSE );
+/****************************************************************************/
+/* DetachDriver() - Detaches HECI driver                                    */
+/****************************************************************************/
 
-      case TRANSLATE_CMD_NOT_ENOUGH_MEMORY:
+static void DetachDriver( void )
+{
+   if( bAttached )
+   {
+      HeciDisconnect();
+      bAttached = FALSE;
+      CountEvent( &stStats.ullDetaches );
+   }
+}
 
-         errno = ENOMEM;
-         return( FALSE );
+/****************************************************************************/
+/* Transaction engine operations. The engine drives the HECI driver through */
+/* these and, in system mode, uses the critical section to keep the         */
+/* transactions of other processes out of the way of its own.               */
+/****************************************************************************/
 
-      case TRANSLATE_CMD_FAILED_WITH_ERROR_SET:
-      default:
+static int PipeAttach( int iTimeout )
+{
+   bStarted = TRUE;
 
-         return( FALSE );
-      }
-   }
+   return( AttachDriver( iTimeout )? iMaxReceive : -1 );
+}
 
-   // Call common command handler (sets errno before exit if failed)
+static BOOL PipeEnter( int iTimeout )
+{
+   return( EnterCritSectTimed( hCritSect, iTimeout ) );
+}
 
-   return( CommonCmdHandler( pvCmdBuf, tCmdSize, pvRspBuf, tRspSize ) );
+static void PipeLeave( void )
+{
+   LeaveCritSect( hCritSect );
 }
 
+static const HECI_PIPE_OPS stPipeOps =          // For system mode
+{
+   PipeAttach,
+   DetachDriver,
+   HeciPost,
+   HeciWait,
+   HeciReceive,
+   PipeEnter,
+   PipeLeave,
+   HeciGetFD
+};
+
+static const HECI_PIPE_OPS stPipeOpsLocal =     // For exclusive and process modes
+{
+   PipeAttach,
+   DetachDriver,
+   HeciPost,
+   HeciWait,
+   HeciReceive,
+   NULL,
+   NULL,
+   HeciGetFD
+};
+
 /****************************************************************************/
-/* QstCommand2() - Sends command to the QST Subsystem and awaits response.  */
+/* Coalescable() - Indicates if a command (QST 2.x command set) only reads  */
+/* from the subsystem, so that a response to it can be given to any thread  */
+/* that sent the same command at the same time.                             */
+/****************************************************************************/
+
+static BOOL Coalescable( void *pvCmdBuf )
+{
+   switch( ((P_QST_CMD_HEADER)pvCmdBuf)->byCommand )
+   {
+   case QST_GET_SUBSYSTEM_INFO:
+   case QST_GET_SUBSYSTEM_STATUS:
+   case QST_GET_SUBSYSTEM_CONFIG:
+   case QST_GET_SUBSYSTEM_CONFIG_PROFILE:
+   case QST_GET_CPU_CONFIG_UPDATE:
+   case QST_GET_CPU_DTS_CONFIG_UPDATE:
+   case QST_GET_FAN_CONFIG_UPDATE:
+   case QST_GET_TEMP_MON_UPDATE:
+   case QST_GET_TEMP_MON_CONFIG:
+   case QST_GET_FAN_MON_UPDATE:
+   case QST_GET_FAN_MON_CONFIG:
+   case QST_GET_VOLT_MON_UPDATE:
+   case QST_GET_VOLT_MON_CONFIG:
+   case QST_GET_CURR_MON_UPDATE:
+   case QST_GET_CURR_MON_CONFIG:
+   case QST_GET_FAN_CTRL_UPDATE:
+   case QST_GET_FAN_CTRL_CONFIG:
+
+      return( TRUE );
+
+   default:
+
+      return( FALSE );
+   }
+}
+
+/****************************************************************************/
+/* NoteCommand() - Called before a command (QST 2.x command set) is sent.   */
+/* If the command may change the subsystem's state, reads already in flight */
+/* may return the state from before the change, so they're closed to new    */
+/* waiters.                                                                 */
+/****************************************************************************/
+
+static void NoteCommand( void *pvCmdBuf )
+{
+   if( !Coalescable( pvCmdBuf ) )
+      __atomic_add_fetch( &uGeneration, 1, __ATOMIC_RELEASE );
+}
+
+/****************************************************************************/
+/* NoteThresholds() - Called before a command (in the command set the       */
+/* subsystem is using) is sent and again once it is done with. If it sets   */
+/* a sensor's thresholds, the configuration stamp is bumped (see note 10).  */
+/****************************************************************************/
+
+static void NoteThresholds( void *pvCmdBuf )
+{
+   UINT8 byCommand = ((P_QST_CMD_HEADER)pvCmdBuf)->byCommand;
+   BOOL  bThresholds;
+
+   if( TranslationToLegacyRequired() )
+      bThresholds =    ((byCommand >= QST_LEG_SET_TEMP_MON_1_THRESHOLDS) && (byCommand <= QST_LEG_SET_TEMP_MON_12_THRESHOLDS))
+                    || ((byCommand >= QST_LEG_SET_FAN_MON_1_THRESHOLDS)  && (byCommand <= QST_LEG_SET_FAN_MON_8_THRESHOLDS))
+                    || ((byCommand >= QST_LEG_SET_VOLT_MON_1_THRESHOLDS) && (byCommand <= QST_LEG_SET_VOLT_MON_8_THRESHOLDS));
+   else
+      bThresholds =    (byCommand == QST_SET_TEMP_MON_THRESHOLDS) || (byCommand == QST_SET_FAN_MON_THRESHOLDS)
+                    || (byCommand == QST_SET_VOLT_MON_THRESHOLDS) || (byCommand == QST_SET_CURR_MON_THRESHOLDS);
+
+   if( bThresholds )
+      __atomic_add_fetch( &pstInfoSeg->uConfigStamp, 1, __ATOMIC_ACQ_REL );
+}
+
+/****************************************************************************/
+/* StampBase() - Returns the value a new configuration stamp starts from:   */
+/* the time (nanoseconds), so that it differs from any handed out before    */
+/****************************************************************************/
+
+static uint64_t StampBase( void )
+{
+   struct timespec stTime;
+
+   clock_gettime( CLOCK_REALTIME, &stTime );
+
+   return( (uint64_t)stTime.tv_sec * 1000000000ULL + (uint64_t)stTime.tv_nsec );
+}
+
+/****************************************************************************/
+/* RetryDelay() - Waits before retrying a transaction that failed on its    */
+/* attempt iRetries (0 for the first). Without a deadline, waits for        */
+/* RETRY_DELAY. With one, the delay doubles with each attempt (up to        */
+/* RETRY_DELAY) and is then reduced by a random amount (up to half), so     */
+/* that threads that failed together don't all retry together; returns      */
+/* FALSE, without waiting, if another attempt couldn't then be made before  */
+/* the deadline.                                                            */
+/****************************************************************************/
+
+static BOOL RetryDelay( int iRetries, uint64_t uDeadline )
+{
+   int iDelay;
+
+   if( !uDeadline )
+   {
+      Delay( RETRY_DELAY );
+      return( TRUE );
+   }
+
+   iDelay = (iRetries < 7)? BACKOFF_DELAY << iRetries : RETRY_DELAY;
+
+   if( iDelay > RETRY_DELAY )
+      iDelay = RETRY_DELAY;
+
+   if( !uJitterSeed )
+      uJitterSeed = (unsigned int)HeciPipeNow() ^ (unsigned int)(size_t)&iDelay;
+
+   iDelay -= rand_r( &uJitterSeed ) % (iDelay / 2 + 1);
+
+   if( HeciPipeNow() + iDelay >= uDeadline )
+      return( FALSE );
+
+   Delay( iDelay );
+   return( TRUE );
+}
+
+/****************************************************************************/
+/* CommonCmdHandler() - Common code used to pass commands and obtain any    */
+/* responses from the QST subsystem.  This code MUST be compatible with any */
+/* revision of the QST firmware.                                            */
+/*                                                                          */
+/* The transaction is handed to the transaction engine, which overlaps it   */
+/* with the transactions of other threads. If the engine reports a failure, */
+/* it has already dropped its attachment to the driver (which it will form  */
+/* again for the next attempt), so all we need to do here is wait a while   */
+/* before retrying.                                                         */
+/*                                                                          */
+/* If the calling thread has a deadline (see QstCommandTimed()), the engine */
+/* is told of it, retry delays follow a jittered exponential backoff and we */
+/* stop (failing with ETIMEDOUT) as soon as another attempt can't be made   */
+/* before the deadline.                                                     */
+/****************************************************************************/
+
+BOOL CommonCmdHandler(
+
+   IN  void                         *pvCmdBuf,          // Address of buffer contaiing command packet
+   IN  size_t                       tCmdSize,           // Size of command packet
+   OUT void                         *pvRspBuf,          // Address of buffer for response packet
+   IN  size_t                       tRspSize            // Expected size of response packet
+){
+   int                              iReceived;          // Response packet size
+   int                              iRetries;           // Retry counter
+   int                              iErrnoSave = 0;     // For saving errno value
+   uint64_t                         uDeadline = uCmdDeadline;
+                                                        // Time by which we must finish (0 if none)
+   BOOL                             bGiveUp;            // Indicates retries are pointless
+   BOOL                             bTimedOut = FALSE;  // Indicates deadline reached
+   BOOL                             bSucceeded = FALSE; // Success indicator
+
+   // If we had problem during module initialization, we can't continue
+
+   if( iInitErrno )
+   {
+      errno = iInitErrno;
+      return( FALSE );
+   }
+
+   if( !TranslationToLegacyRequired() )
+      NoteCommand( pvCmdBuf );
+
+   NoteThresholds( pvCmdBuf );
+
+   // Support retries during attempt...
+
+   for( iRetries = 0; iRetries < RETRY_COUNT; iRetries++ )
+   {
+      if( iRetries )
+         CountEvent( &stStats.ullRetries );
+
+      iReceived = HeciPipeTransactTimed( pvCmdBuf, tCmdSize, pvRspBuf, tRspSize, &bGiveUp, uDeadline );
+
+      // If no response is desired, we're done!
+
+      if( (iReceived == 0) && (tRspSize == 0) )
+      {
+         bSucceeded = TRUE;
+         break;
+      }
+
+      if( iReceived > 0 )
+      {
+         // We have a response so we're done, only need to verify length
+
+         // Since QST, if it's rejecting/failing command, always returns
+         // just a single byte (the status byte), we can say there's a
+         // problem if the length doesn't match what's requested and the
+         // status byte says succeeded. Otherwise we're cool...
+
+         if( (iReceived != tRspSize) && (*((UINT8*)pvRspBuf) == QST_CMD_SUCCESSFUL) )
+            iErrnoSave = ENOSPC;
+         else
+            bSucceeded = TRUE;
+
+         break;
+      }
+
+      // Only get here if send/receive failed
+      // Want to remember ccode from first attempt, not after retry...
+
+      if( iReceived == 0 )
+         errno = EIO;
+
+      if( iRetries == 0 )
+         iErrnoSave = errno;
+
+      // Out of time, can't go on
+
+      if( uDeadline && (HeciPipeNow() >= uDeadline) )
+      {
+         bTimedOut = TRUE;
+         break;
+      }
+
+      // Command too big or can't reattach, time to give up
+
+      if( bGiveUp )
+         break;
+
+      // Implement our retry delay to give driver a chance to recover (and others
+      // a chance to use driver)
+
+      if( !RetryDelay( iRetries, uDeadline ) )
+      {
+         bTimedOut = TRUE;
+         break;
+      }
+   }
+
+   // Set errno to reflect any errors detected
+
+   NoteThresholds( pvCmdBuf );
+
+   if( !bSucceeded )
+      errno = bTimedOut? ETIMEDOUT : iErrnoSave;
+
+   return( bSucceeded );
+}
+
+/****************************************************************************/
+/* QstCommand() - Sends command to the QST Subsystem and awaits response.   */
 /* Function returns TRUE/FALSE success indicator. Use errno to obtain       */
 /* details about failures.                                                  */
 /*                                                                          */
@@ -414,24 +963,21 @@ BOOL QstCommand(
 /* this RETRY_COUNT times before giving up.                                 */
 /****************************************************************************/
 
-BOOL QstCommand2(
+BOOL QstCommand(
 
-   IN  void                        *pvCmdBuf,          // Address of buffer contaiing command packet
-   IN  size_t                      tCmdSize,           // Size of command packet
-   OUT void                        *pvRspBuf,          // Address of buffer for response packet
-   IN  size_t                      tRspSize            // Expected size of response packet
+   IN  void                         *pvCmdBuf,          // Address of buffer contaiing command packet
+   IN  size_t                       tCmdSize,           // Size of command packet
+   OUT void                         *pvRspBuf,          // Address of buffer for response packet
+   IN  size_t                       tRspSize            // Expected size of response packet
 ){
-   P_QST_SST_PASS_THROUGH_CMD       pstQstCmd = (P_QST_SST_PASS_THROUGH_CMD)pvCmdBuf;
-                                                        // For structured access to command packet
-   BOOL                             bSucceeded = FALSE; // Success indicator
+   P_QST_LEG_SST_PASS_THROUGH_CMD   pstQstCmd = (P_QST_LEG_SST_PASS_THROUGH_CMD)pvCmdBuf;
+                                                         // For structured access to command packet
+   BOOL                             bSucceeded = FALSE;  // Success indicator
 
    // Initialize Subsystem Information structure
 
-   if (!GetSubsystemInformation())
-   {
-      errno = ENODEV;
+   if( !ProbeSubsystem() )
       return( FALSE );
-   }
 
    // Verify buffer validity
 
@@ -443,15 +989,15 @@ BOOL QstCommand2(
 
    // Validate command buffer size
 
-   if( tCmdSize < sizeof(QST_CMD_HEADER) )
+   if( tCmdSize < sizeof(QST_LEG_CMD_HEADER) )
    {
       errno = EPERM;
-      return( FALSE );
+      return FALSE;
    }
 
    // Verify Command Code
 
-   if( pstQstCmd->stHeader.byCommand > QST_LAST_CMD_CODE )
+   if( pstQstCmd->stHeader.byCommand > QST_LEG_LAST_CMD_CODE )
    {
       errno = EPERM;
       return( FALSE );
@@ -459,7 +1005,7 @@ BOOL QstCommand2(
 
    // Verify Command/Response Lengths
 
-   if(    (tCmdSize != (pstQstCmd->stHeader.wCommandLength + sizeof(QST_CMD_HEADER)))
+   if(    (tCmdSize != (pstQstCmd->stHeader.wCommandLength + sizeof(QST_LEG_CMD_HEADER)))
        || (tRspSize != (pstQstCmd->stHeader.wResponseLength)) )
    {
       errno = ERANGE;
@@ -468,7 +1014,7 @@ BOOL QstCommand2(
 
    // Verify Command/Response Lengths for SST Command if one's embedded in the packet
 
-   if( pstQstCmd->stHeader.byCommand == QST_SST_PASS_THROUGH )
+   if( pstQstCmd->stHeader.byCommand == QST_LEG_SST_PASS_THROUGH )
    {
       if(    (pstQstCmd->stHeader.wCommandLength  != (pstQstCmd->stSSTPacket.stSSTHeader.byWriteLength + sizeof(SST_CMD_HEADER)))
           || (pstQstCmd->stHeader.wResponseLength != (pstQstCmd->stSSTPacket.stSSTHeader.byReadLength + 1)) )
@@ -478,13 +1024,15 @@ BOOL QstCommand2(
       }
    }
 
-   // Determine if sending to a QST 1.x ME firmware...
+   // Determine if sending to a QST 2.x ME firmware...
 
-   if( TranslationToLegacyRequired() )
+   if( TranslationToNewRequired() )
    {
-      // Target is QST 1.x ME firmware so translate command to legacy command set.
+      // Target is QST 2.x ME firmware so translate command to new command set.
 
-      switch( TranslateToLegacyCommand( pvCmdBuf, tCmdSize, pvRspBuf, tRspSize ) )
+      CountEvent( &stStats.ullTranslations );
+
+      switch( TranslateToNewCommand( pvCmdBuf, tCmdSize, pvRspBuf, tRspSize ) )
       {
       case TRANSLATE_CMD_SUCCESS:
 
@@ -514,52 +1062,988 @@ BOOL QstCommand2(
 }
 
 /****************************************************************************/
-/* InitializeModule() - Initializes module. Runs when module loaded...      */
+/* CheckCommand2() - Verifies a command packet (QST 2.x command set) and    */
+/* its expected response size. Returns FALSE (with errno set) if they're    */
+/* not valid.                                                               */
 /****************************************************************************/
 
-static void InitializeModule( void )
-{
-   // Initialize variables
+static BOOL CheckCommand2(
 
-   bAttached    = FALSE;
-   iMaxReceive  = 0;
-   iInitErrno   = 0;
+   IN  void                        *pvCmdBuf,          // Address of buffer contaiing command packet
+   IN  size_t                      tCmdSize,           // Size of command packet
+   IN  void                        *pvRspBuf,          // Address of buffer for response packet
+   IN  size_t                      tRspSize            // Expected size of response packet
+){
+   P_QST_SST_PASS_THROUGH_CMD       pstQstCmd = (P_QST_SST_PASS_THROUGH_CMD)pvCmdBuf;
+                                                        // For structured access to command packet
 
-   // Initialize HECI support module
+   // Verify buffer validity
 
-   if( !HeciInitialize() )
+   if( !pvCmdBuf || !pvRspBuf )
    {
-      iInitErrno = errno; // Save errno for reporting later
-      return;
+      errno = EFAULT;
+      return( FALSE );
    }
 
-#ifdef SINGLE_THREADED
+   // Validate command buffer size
+
+   if( tCmdSize < sizeof(QST_CMD_HEADER) )
+   {
+      errno = EPERM;
+      return( FALSE );
+   }
 
-   hCritSect = CreateCritSect( CRITSECT_TYPE, FALSE );
+   // Verify Command Code
 
-   if( !hCritSect )
+   if( pstQstCmd->stHeader.byCommand > QST_LAST_CMD_CODE )
    {
-      iInitErrno = errno; // Save errno for reporting later
-      return;
+      errno = EPERM;
+      return( FALSE );
+   }
+
+   // Verify Command/Response Lengths
+
+   if(    (tCmdSize != (pstQstCmd->stHeader.wCommandLength + sizeof(QST_CMD_HEADER)))
+       || (tRspSize != (pstQstCmd->stHeader.wResponseLength)) )
+   {
+      errno = ERANGE;
+      return( FALSE );
    }
 
-#endif // def SINGLE_THREADED
+   // Verify Command/Response Lengths for SST Command if one's embedded in the packet
+
+   if( pstQstCmd->stHeader.byCommand == QST_SST_PASS_THROUGH )
+   {
+      if(    (pstQstCmd->stHeader.wCommandLength  != (pstQstCmd->stSSTPacket.stSSTHeader.byWriteLength + sizeof(SST_CMD_HEADER)))
+          || (pstQstCmd->stHeader.wResponseLength != (pstQstCmd->stSSTPacket.stSSTHeader.byReadLength + 1)) )
+      {
+         errno = ERANGE;
+         return( FALSE );
+      }
+   }
 
+   return( TRUE );
 }
 
 /****************************************************************************/
-/* CleanupModule() - Cleans up after module. Runs when module unloaded...   */
+/* CoalescedCmdHandler() - Passes a read-only command (QST 2.x command set) */
+/* to CommonCmdHandler() unless another thread of this process is already   */
+/* sending the same command, in which case we wait for, and take a copy of, */
+/* its response. Function returns TRUE/FALSE success indicator (with errno  */
+/* set).                                                                    */
 /****************************************************************************/
 
-static void CleanupModule( void )
-{
-   DetachDriver();
-   HeciCleanup();
+static BOOL CoalescedCmdHandler(
 
-#ifdef SINGLE_THREADED
-   CloseCritSect( hCritSect );
-#endif
+   IN  void                        *pvCmdBuf,          // Address of buffer contaiing command packet
+   IN  size_t                      tCmdSize,           // Size of command packet
+   OUT void                        *pvRspBuf,          // Address of buffer for response packet
+   IN  size_t                      tRspSize            // Expected size of response packet
+){
+   COALESCE_FLIGHT                  stFlight;           // Our flight, if we send the command
+   COALESCE_FLIGHT                  *pstFlight;         // Flight being examined
+   COALESCE_FLIGHT                  **ppstLink;         // For unlinking our flight
+   COALESCE_WAITER                  stWaiter;           // Our place, if we join another flight
+   COALESCE_WAITER                  *pstWaiter;         // Waiter being completed
+   BOOL                             bSucceeded;         // Success indicator
+   int                              iErrnoSave;         // For saving errno value
+
+   pthread_mutex_lock( &stCoalesceLock );
+
+   // Look for the same command already being sent (and not overtaken by a
+   // change of state)
+
+   for( pstFlight = pstFlights; pstFlight; pstFlight = pstFlight->pstNext )
+   {
+      if(    (pstFlight->uGeneration == __atomic_load_n( &uGeneration, __ATOMIC_ACQUIRE ))
+          && (pstFlight->tCmdSize == tCmdSize)
+          && (pstFlight->tRspSize == tRspSize)
+          && !memcmp( pstFlight->pvCmdBuf, pvCmdBuf, tCmdSize ) )
+         break;
+   }
+
+   if( pstFlight )
+   {
+      // Join it and wait for its response
+
+      stWaiter.pvRspBuf      = pvRspBuf;
+      stWaiter.bDone         = FALSE;
+      stWaiter.pstNext       = pstFlight->pstWaiters;
+      pstFlight->pstWaiters  = &stWaiter;
+      ulCoalesced++;
+
+      while( !stWaiter.bDone )
+         pthread_cond_wait( &stCoalesceDone, &stCoalesceLock );
+
+      pthread_mutex_unlock( &stCoalesceLock );
+
+      if( !stWaiter.bSucceeded )
+         errno = stWaiter.iErrno;
+
+      return( stWaiter.bSucceeded );
+   }
 
+   // Nobody's sending it, so we will
+
+   stFlight.pvCmdBuf    = pvCmdBuf;
+   stFlight.tCmdSize    = tCmdSize;
+   stFlight.tRspSize    = tRspSize;
+   stFlight.uGeneration = __atomic_load_n( &uGeneration, __ATOMIC_ACQUIRE );
+   stFlight.pstWaiters  = NULL;
+   stFlight.pstNext     = pstFlights;
+   pstFlights           = &stFlight;
+   ulIssued++;
+
+   pthread_mutex_unlock( &stCoalesceLock );
+
+   bSucceeded = CommonCmdHandler( pvCmdBuf, tCmdSize, pvRspBuf, tRspSize );
+   iErrnoSave = errno;
+
+   // Hand the outcome to those who joined us
+
+   pthread_mutex_lock( &stCoalesceLock );
+
+   for( ppstLink = &pstFlights; *ppstLink != &stFlight; ppstLink = &(*ppstLink)->pstNext );
+
+   *ppstLink = stFlight.pstNext;
+
+   for( pstWaiter = stFlight.pstWaiters; pstWaiter; pstWaiter = pstWaiter->pstNext )
+   {
+      if( bSucceeded && (pstWaiter->pvRspBuf != pvRspBuf) )
+         memcpy( pstWaiter->pvRspBuf, pvRspBuf, tRspSize );
+
+      pstWaiter->bSucceeded = bSucceeded;
+      pstWaiter->iErrno     = iErrnoSave;
+      pstWaiter->bDone      = TRUE;
+   }
+
+   if( stFlight.pstWaiters )
+      pthread_cond_broadcast( &stCoalesceDone );
+
+   pthread_mutex_unlock( &stCoalesceLock );
+
+   errno = iErrnoSave;
+   return( bSucceeded );
+}
+
+/****************************************************************************/
+/* SendCommand2() - Does the work of QstCommand2()                          */
+/****************************************************************************/
+
+static BOOL SendCommand2(
+
+   IN  void                        *pvCmdBuf,          // Address of buffer contaiing command packet
+   IN  size_t                      tCmdSize,           // Size of command packet
+   OUT void                        *pvRspBuf,          // Address of buffer for response packet
+   IN  size_t                      tRspSize            // Expected size of response packet
+){
+   // Initialize Subsystem Information structure
+
+   if( !ProbeSubsystem() )
+      return( FALSE );
+
+   // Verify command packet
+
+   if( !CheckCommand2( pvCmdBuf, tCmdSize, pvRspBuf, tRspSize ) )
+      return( FALSE );
+
+   // Determine if sending to a QST 1.x ME firmware...
+
+   if( TranslationToLegacyRequired() )
+   {
+      // Target is QST 1.x ME firmware so translate command to legacy command set.
+
+      CountEvent( &stStats.ullTranslations );
+
+      switch( TranslateToLegacyCommand( pvCmdBuf, tCmdSize, pvRspBuf, tRspSize ) )
+      {
+      case TRANSLATE_CMD_SUCCESS:
+
+         return( TRUE );
+
+      case TRANSLATE_CMD_INVALID_PARAMETER:
+      case TRANSLATE_CMD_BAD_COMMAND:
+
+         errno = EINVAL;
+         return( FALSE );
+
+      case TRANSLATE_CMD_NOT_ENOUGH_MEMORY:
+
+         errno = ENOMEM;
+         return( FALSE );
+
+      case TRANSLATE_CMD_FAILED_WITH_ERROR_SET:
+      default:
+
+         return( FALSE );
+      }
+   }
+
+   // Reads (without a deadline) may share another thread's transaction
+
+   if( !uCmdDeadline && (iConcurrency != QST_CONCURRENCY_EXCLUSIVE) && Coalescable( pvCmdBuf ) )
+      return( CoalescedCmdHandler( pvCmdBuf, tCmdSize, pvRspBuf, tRspSize ) );
+
+   // Call common command handler (sets errno before exit if failed)
+
+   return( CommonCmdHandler( pvCmdBuf, tCmdSize, pvRspBuf, tRspSize ) );
+}
+
+/****************************************************************************/
+/* QstCommand2() - Sends command to the QST Subsystem and awaits response.  */
+/* Function returns TRUE/FALSE success indicator. Use errno to obtain       */
+/* details about failures.                                                  */
+/*                                                                          */
+/* If errors occur during the write/read operations, which will happen if   */
+/* the system goes through a low-power state transition and could happen if */
+/* the ME suffers a failure (reset), we try reforming the QST Subsystem     */
+/* connection. If successful, we then restart the transaction. We will try  */
+/* this RETRY_COUNT times before giving up.                                 */
+/****************************************************************************/
+
+BOOL QstCommand2(
+
+   IN  void                        *pvCmdBuf,          // Address of buffer contaiing command packet
+   IN  size_t                      tCmdSize,           // Size of command packet
+   OUT void                        *pvRspBuf,          // Address of buffer for response packet
+   IN  size_t                      tRspSize            // Expected size of response packet
+){
+   uint64_t                         uStart;             // When command started
+   BOOL                             bSucceeded;         // Success indicator
+
+   if( !bStatsEnabled )
+      return( SendCommand2( pvCmdBuf, tCmdSize, pvRspBuf, tRspSize ) );
+
+   uStart     = StatsNow();
+   bSucceeded = SendCommand2( pvCmdBuf, tCmdSize, pvRspBuf, tRspSize );
+
+   RecordCommand( pvCmdBuf, uStart, bSucceeded );
+
+   return( bSucceeded );
+}
+
+/****************************************************************************/
+/* QstCommandTimed() - Sends command (QST 2.x command set) to the QST       */
+/* Subsystem and awaits response, like QstCommand2(), but gives up after    */
+/* iTimeout milliseconds. Function returns TRUE/FALSE success indicator.    */
+/* Use errno to obtain details about failures; ETIMEDOUT indicates that the */
+/* time ran out.                                                            */
+/****************************************************************************/
+
+BOOL QstCommandTimed(
+
+   IN  void                        *pvCmdBuf,          // Address of buffer contaiing command packet
+   IN  size_t                      tCmdSize,           // Size of command packet
+   OUT void                        *pvRspBuf,          // Address of buffer for response packet
+   IN  size_t                      tRspSize,           // Expected size of response packet
+   IN  int                         iTimeout            // Time allowed (milliseconds)
+){
+   BOOL                             bSucceeded;         // Success indicator
+   int                              iErrnoSave;         // For saving errno value
+
+   if( iTimeout < 0 )
+   {
+      errno = EINVAL;
+      return( FALSE );
+   }
+
+   uCmdDeadline = HeciPipeNow() + iTimeout;
+
+   bSucceeded = QstCommand2( pvCmdBuf, tCmdSize, pvRspBuf, tRspSize );
+   iErrnoSave = errno;
+
+   // Failures reported on the way (e.g. version determination) mean
+   // nothing to the caller once time has run out
+
+   if( !bSucceeded && (HeciPipeNow() >= uCmdDeadline) )
+      iErrnoSave = ETIMEDOUT;
+
+   uCmdDeadline = 0;
+   errno        = iErrnoSave;
+
+   return( bSucceeded );
+}
+
+/****************************************************************************/
+/* ResponseErrno() - Checks the outcome of a transaction the way            */
+/* CommonCmdHandler() does. Returns 0 if the command succeeded, otherwise   */
+/* the errno value to report.                                               */
+/****************************************************************************/
+
+static int ResponseErrno( int iReceived, int iErrno, void *pvRspBuf, size_t tRspSize )
+{
+   if( (iReceived == 0) && (tRspSize == 0) )
+      return( 0 );
+
+   if( iReceived > 0 )
+      return( ((iReceived != tRspSize) && (*((UINT8*)pvRspBuf) == QST_CMD_SUCCESSFUL))? ENOSPC : 0 );
+
+   return( (iReceived == 0)? EIO : iErrno );
+}
+
+/****************************************************************************/
+/* QstCommandBatch() - Sends a set of commands (QST 2.x command set) to the */
+/* QST Subsystem and awaits all of their responses. Each entry's bSucceeded */
+/* and iErrno fields report its outcome; entries that aren't valid are not  */
+/* sent. Function returns TRUE if every command succeeded, otherwise FALSE  */
+/* with errno set from the first that failed.                               */
+/****************************************************************************/
+
+BOOL QstCommandBatch(
+
+   IN OUT P_QST_BATCH_ENTRY        pstEntries,         // Commands to send
+   IN  int                         iCount              // Number of commands
+){
+   HECI_PIPE_ENTRY                  astPipe[HECI_PIPE_MAX_BATCH];
+                                                        // Engine's view of commands being sent
+   int                              aiPending[HECI_PIPE_MAX_BATCH];
+                                                        // Commands of chunk still to be sent
+   P_QST_BATCH_ENTRY                pstEntry;           // Entry being handled
+   uint64_t                         uStart = 0;         // When chunk started (if keeping statistics)
+   uint64_t                         uDeadline = uCmdDeadline;
+                                                        // Time by which we must finish (0 if none)
+   int                              iFirst, iChunk;     // Chunk of entries being handled
+   int                              iPending, iKeep;    // Counts of commands to send
+   int                              iIndex, iRetries, iErrno;
+
+   if( iInitErrno )
+   {
+      errno = iInitErrno;
+      return( FALSE );
+   }
+
+   if( !pstEntries || (iCount < 0) )
+   {
+      errno = pstEntries? EINVAL : EFAULT;
+      return( FALSE );
+   }
+
+   // Initialize Subsystem Information structure
+
+   if( !ProbeSubsystem() )
+      return( FALSE );
+
+   // Verify all of the command packets up front
+
+   for( iIndex = 0; iIndex < iCount; iIndex++ )
+   {
+      pstEntry = &pstEntries[iIndex];
+
+      pstEntry->bSucceeded = FALSE;
+      pstEntry->iErrno     = CheckCommand2( pstEntry->pvCmdBuf, pstEntry->tCmdSize, pstEntry->pvRspBuf, pstEntry->tRspSize )? 0 : errno;
+   }
+
+   // Determine if sending to a QST 1.x ME firmware, in which case the
+   // commands have to be translated one at a time
+
+   if( TranslationToLegacyRequired() )
+   {
+      for( iIndex = 0; iIndex < iCount; iIndex++ )
+      {
+         pstEntry = &pstEntries[iIndex];
+
+         if( !pstEntry->iErrno )
+         {
+            pstEntry->bSucceeded = QstCommand2( pstEntry->pvCmdBuf, pstEntry->tCmdSize, pstEntry->pvRspBuf, pstEntry->tRspSize );
+            pstEntry->iErrno     = pstEntry->bSucceeded? 0 : errno;
+         }
+      }
+   }
+   else
+   {
+      // Hand commands to the engine as many at a time as it will take
+
+      for( iFirst = 0; iFirst < iCount; iFirst += iChunk )
+      {
+         iChunk = (iCount - iFirst < HECI_PIPE_MAX_BATCH)? iCount - iFirst : HECI_PIPE_MAX_BATCH;
+
+         for( iIndex = iPending = 0; iIndex < iChunk; iIndex++ )
+         {
+            if( !pstEntries[iFirst + iIndex].iErrno )
+               aiPending[iPending++] = iFirst + iIndex;
+         }
+
+         if( bStatsEnabled )
+            uStart = StatsNow();
+
+         // Support retries of those that fail in transfer...
+
+         for( iRetries = 0; iPending && (iRetries < RETRY_COUNT); iRetries++ )
+         {
+            if( iRetries && !RetryDelay( iRetries - 1, uDeadline ) )
+               break;
+
+            for( iIndex = 0; iIndex < iPending; iIndex++ )
+            {
+               pstEntry = &pstEntries[aiPending[iIndex]];
+
+               if( iRetries )
+                  CountEvent( &stStats.ullRetries );
+
+               NoteCommand( pstEntry->pvCmdBuf );
+               NoteThresholds( pstEntry->pvCmdBuf );
+
+               astPipe[iIndex].pvCmdBuf = pstEntry->pvCmdBuf;
+               astPipe[iIndex].tCmdSize = pstEntry->tCmdSize;
+               astPipe[iIndex].pvRspBuf = pstEntry->pvRspBuf;
+               astPipe[iIndex].tRspSize = pstEntry->tRspSize;
+            }
+
+            HeciPipeTransactBatch( astPipe, iPending );
+
+            for( iIndex = iKeep = 0; iIndex < iPending; iIndex++ )
+            {
+               pstEntry = &pstEntries[aiPending[iIndex]];
+               iErrno   = ResponseErrno( astPipe[iIndex].iResult, astPipe[iIndex].iErrno, pstEntry->pvRspBuf, pstEntry->tRspSize );
+
+               NoteThresholds( pstEntry->pvCmdBuf );
+
+               pstEntry->bSucceeded = !iErrno;
+
+               // Want to remember ccode from first attempt, not after retry...
+
+               if( !iErrno || !iRetries )
+                  pstEntry->iErrno = iErrno;
+
+               if( iErrno && (astPipe[iIndex].iResult <= 0) && !astPipe[iIndex].bGiveUp && (iRetries < RETRY_COUNT - 1) )
+                  aiPending[iKeep++] = aiPending[iIndex];
+               else if( bStatsEnabled )
+               {
+                  // Commands sent together are timed from the start of the chunk
+
+                  errno = pstEntry->iErrno;
+                  RecordCommand( pstEntry->pvCmdBuf, uStart, pstEntry->bSucceeded );
+               }
+            }
+
+            iPending = iKeep;
+         }
+
+         // Any left over are those there wasn't time to retry
+
+         for( iIndex = 0; iIndex < iPending; iIndex++ )
+         {
+            pstEntry = &pstEntries[aiPending[iIndex]];
+            pstEntry->iErrno = ETIMEDOUT;
+
+            if( bStatsEnabled )
+            {
+               errno = ETIMEDOUT;
+               RecordCommand( pstEntry->pvCmdBuf, uStart, FALSE );
+            }
+         }
+      }
+   }
+
+   // Set errno to reflect first failure
+
+   for( iIndex = 0; iIndex < iCount; iIndex++ )
+   {
+      if( !pstEntries[iIndex].bSucceeded )
+      {
+         errno = pstEntries[iIndex].iErrno;
+         return( FALSE );
+      }
+   }
+
+   return( TRUE );
+}
+
+/****************************************************************************/
+/* AsyncDone() - Completes an asynchronous command, checking its response   */
+/* the way CommonCmdHandler() does                                          */
+/****************************************************************************/
+
+static void AsyncDone( void *pvTag, int iResult, int iErrno )
+{
+   P_QST_ASYNC_CMD                  pstCmd = (P_QST_ASYNC_CMD)pvTag;
+
+   iErrno = ResponseErrno( iResult, iErrno, pstCmd->pvRspBuf, pstCmd->tRspSize );
+
+   NoteThresholds( pstCmd->pvCmdBuf );
+
+   pstCmd->bSucceeded = (iErrno == 0);
+   pstCmd->iErrno     = iErrno;
+   pstCmd->bDone      = TRUE;
+
+   if( pstCmd->pfnDone )
+      pstCmd->pfnDone( pstCmd );
+}
+
+/****************************************************************************/
+/* QstCommandAsync() - Submits a command (QST 2.x command set) to the QST   */
+/* Subsystem without waiting for its response. The command completes during */
+/* a later call to QstAsyncProcess(), which sets its bDone, bSucceeded and  */
+/* iErrno fields and calls its pfnDone function (if any); its buffers must  */
+/* remain valid until then. Function returns TRUE/FALSE success indicator   */
+/* for the submission; EAGAIN indicates that QST_ASYNC_MAX_OUTSTANDING      */
+/* commands are already outstanding.                                        */
+/****************************************************************************/
+
+BOOL QstCommandAsync(
+
+   IN  P_QST_ASYNC_CMD             pstCmd              // Command to submit
+){
+   if( !pstCmd )
+   {
+      errno = EFAULT;
+      return( FALSE );
+   }
+
+   pstCmd->bDone      = FALSE;
+   pstCmd->bSucceeded = FALSE;
+   pstCmd->iErrno     = 0;
+
+   if( iInitErrno )
+   {
+      errno = iInitErrno;
+      return( FALSE );
+   }
+
+   // Initialize Subsystem Information structure (only blocks first time)
+
+   if( !ProbeSubsystem() )
+      return( FALSE );
+
+   // Verify command packet
+
+   if( !CheckCommand2( pstCmd->pvCmdBuf, pstCmd->tCmdSize, pstCmd->pvRspBuf, pstCmd->tRspSize ) )
+      return( FALSE );
+
+   // Translated commands take several transactions; can't do them this way
+
+   if( TranslationToLegacyRequired() )
+   {
+      errno = ENOTSUP;
+      return( FALSE );
+   }
+
+   NoteCommand( pstCmd->pvCmdBuf );
+   NoteThresholds( pstCmd->pvCmdBuf );
+
+   return( HeciPipeSubmit( pstCmd->pvCmdBuf, pstCmd->tCmdSize, pstCmd->pvRspBuf, pstCmd->tRspSize, AsyncDone, pstCmd ) );
+}
+
+/****************************************************************************/
+/* QstAsyncGetFD() - Returns a descriptor, for adding to an application's   */
+/* poll/epoll set, that is readable whenever QstAsyncProcess() should be    */
+/* called. Returns -1 (with errno set) on failure.                          */
+/****************************************************************************/
+
+int QstAsyncGetFD( void )
+{
+   if( iInitErrno )
+   {
+      errno = iInitErrno;
+      return( -1 );
+   }
+
+   return( HeciPipeGetFD() );
+}
+
+/****************************************************************************/
+/* QstAsyncProcess() - Progresses outstanding asynchronous commands without */
+/* blocking and completes those whose responses have arrived. Returns the   */
+/* number of commands completed. Must be called promptly whenever the       */
+/* descriptor from QstAsyncGetFD() is readable; commands left outstanding a */
+/* second after their responses were due fail with ETIMEDOUT (see note 4).  */
+/****************************************************************************/
+
+int QstAsyncProcess( void )
+{
+   return( iInitErrno? 0 : HeciPipeProcess() );
+}
+
+/****************************************************************************/
+/* QstGetCoalesceStats() - Reports how many reads have been sent to the     */
+/* subsystem and how many were answered with the response to another        */
+/* thread's identical read, since the module was loaded.                    */
+/****************************************************************************/
+
+BOOL QstGetCoalesceStats(
+
+   OUT P_QST_COALESCE_STATS        pstStats            // Where to report counts
+){
+   if( !pstStats )
+   {
+      errno = EFAULT;
+      return( FALSE );
+   }
+
+   pthread_mutex_lock( &stCoalesceLock );
+
+   pstStats->ulIssued    = ulIssued;
+   pstStats->ulCoalesced = ulCoalesced;
+
+   pthread_mutex_unlock( &stCoalesceLock );
+
+   return( TRUE );
+}
+
+/****************************************************************************/
+/* QstGetConfigStamp() - Returns the configuration stamp (see note 10).     */
+/* Sensor configurations read after it was obtained are still current if    */
+/* it returns the same value later on.                                      */
+/****************************************************************************/
+
+unsigned long long QstGetConfigStamp( void )
+{
+   return( __atomic_load_n( &pstInfoSeg->uConfigStamp, __ATOMIC_ACQUIRE ) );
+}
+
+/****************************************************************************/
+/* QstSetConcurrency() - Selects the way in which the subsystem is shared   */
+/* (QST_CONCURRENCY_XXX). Must be called before any commands are sent, as   */
+/* the application starts up; fails with EBUSY thereafter. Function returns */
+/* TRUE/FALSE success indicator.                                            */
+/****************************************************************************/
+
+BOOL QstSetConcurrency(
+
+   IN  int                         iMode               // Mode to select
+){
+   if( iInitErrno )
+   {
+      errno = iInitErrno;
+      return( FALSE );
+   }
+
+   if( (iMode < QST_CONCURRENCY_EXCLUSIVE) || (iMode > QST_CONCURRENCY_SYSTEM) )
+   {
+      errno = EINVAL;
+      return( FALSE );
+   }
+
+   if( bStarted )
+   {
+      errno = EBUSY;
+      return( FALSE );
+   }
+
+   if( iMode == iConcurrency )
+      return( TRUE );
+
+   // Cross-process critical section is only needed in system mode
+
+   if( iMode == QST_CONCURRENCY_SYSTEM )
+   {
+      if( (hCritSect = CreateCritSect( CRITSECT_TYPE, FALSE )) == NULL )
+         return( FALSE );
+   }
+
+   if( !HeciPipeInitialize( (iMode == QST_CONCURRENCY_SYSTEM)? &stPipeOps : &stPipeOpsLocal, PIPE_DEPTH, PIPE_TIMEOUT ) )
+      return( FALSE );
+
+   if( hCritSect && (iMode != QST_CONCURRENCY_SYSTEM) )
+   {
+      CloseCritSect( hCritSect );
+      hCritSect = NULL;
+   }
+
+   iConcurrency = iMode;
+   return( TRUE );
+}
+
+/****************************************************************************/
+/* QstGetConcurrency() - Returns the concurrency mode in use                */
+/****************************************************************************/
+
+int QstGetConcurrency( void )
+{
+   return( iConcurrency );
+}
+
+/****************************************************************************/
+/* QstCommEnableStats() - Starts (or stops) the keeping of statistics.      */
+/* Returns the previous setting.                                            */
+/****************************************************************************/
+
+BOOL QstCommEnableStats(
+
+   IN  BOOL                        bEnable             // Indicates if statistics are to be kept
+){
+   return( __atomic_exchange_n( &bStatsEnabled, bEnable? TRUE : FALSE, __ATOMIC_RELAXED ) );
+}
+
+/****************************************************************************/
+/* QstCommGetStats() - Takes a snapshot of the statistics kept since the    */
+/* module was loaded. Function returns TRUE/FALSE success indicator.        */
+/****************************************************************************/
+
+BOOL QstCommGetStats(
+
+   OUT P_QST_COMM_STATS            pstStats            // Where to copy statistics
+){
+   unsigned long long               *pullFrom = (unsigned long long *)&stStats;
+   unsigned long long               *pullTo   = (unsigned long long *)pstStats;
+   size_t                           tIndex;
+
+   if( !pstStats )
+   {
+      errno = EFAULT;
+      return( FALSE );
+   }
+
+   // Structure consists only of counters, each of which is copied atomically
+
+   for( tIndex = 0; tIndex < sizeof(QST_COMM_STATS) / sizeof(unsigned long long); tIndex++ )
+      pullTo[tIndex] = __atomic_load_n( &pullFrom[tIndex], __ATOMIC_RELAXED );
+
+   return( TRUE );
+}
+
+/****************************************************************************/
+/* QstBorrowBuffer() - Lends the caller a response buffer of (at least)     */
+/* QST_BORROW_BUFFER_SIZE bytes, which remains theirs until they return it  */
+/* using QstReturnBuffer(). Responses received into a borrowed buffer are   */
+/* not copied. Returns NULL (with errno set to ENOBUFS) if all buffers are  */
+/* already on loan.                                                         */
+/****************************************************************************/
+
+void *QstBorrowBuffer( void )
+{
+   UINT32   uMask;
+   int      iIndex;
+
+   for( iIndex = 0; iIndex < BORROW_COUNT; iIndex++ )
+   {
+      uMask = __atomic_fetch_or( &uBorrowed, 1U << iIndex, __ATOMIC_ACQUIRE );
+
+      if( !(uMask & (1U << iIndex)) )
+         break;
+   }
+
+   if( iIndex == BORROW_COUNT )
+   {
+      errno = ENOBUFS;
+      return( NULL );
+   }
+
+   // Buffers are created on first use and kept (registered) thereafter
+
+   if( !apvBorrow[iIndex] )
+   {
+      if( posix_memalign( &apvBorrow[iIndex], QST_BORROW_BUFFER_SIZE, QST_BORROW_BUFFER_SIZE ) )
+         apvBorrow[iIndex] = NULL;
+      else if( !HeciRegisterBuffer( apvBorrow[iIndex], QST_BORROW_BUFFER_SIZE ) )
+      {
+         free( apvBorrow[iIndex] );
+         apvBorrow[iIndex] = NULL;
+      }
+
+      if( !apvBorrow[iIndex] )
+      {
+         __atomic_fetch_and( &uBorrowed, ~(1U << iIndex), __ATOMIC_RELEASE );
+         errno = ENOMEM;
+         return( NULL );
+      }
+   }
+
+   return( apvBorrow[iIndex] );
+}
+
+/****************************************************************************/
+/* QstReturnBuffer() - Returns a buffer obtained using QstBorrowBuffer()    */
+/****************************************************************************/
+
+void QstReturnBuffer( void *pvBuff )
+{
+   int      iIndex;
+
+   for( iIndex = 0; iIndex < BORROW_COUNT; iIndex++ )
+   {
+      if( pvBuff && (apvBorrow[iIndex] == pvBuff) )
+      {
+         __atomic_fetch_and( &uBorrowed, ~(1U << iIndex), __ATOMIC_RELEASE );
+         break;
+      }
+   }
+}
+
+/****************************************************************************/
+/* BootId() - Returns a hash of the kernel's boot id, which changes every   */
+/* time the system starts (0 if it can't be read)                           */
+/****************************************************************************/
+
+static uint64_t BootId( void )
+{
+   FILE     *pFile;
+   char     szId[64];
+   char     *pszId;
+   uint64_t uHash = 0;
+
+   if( (pFile = fopen( INFO_BOOT_ID, "r" )) == NULL )
+      return( 0 );
+
+   if( fgets( szId, sizeof(szId), pFile ) )
+   {
+      uHash = 14695981039346656037ULL;
+
+      for( pszId = szId; *pszId && (*pszId != '\n'); pszId++ )
+         uHash = (uHash ^ (UINT8)*pszId) * 1099511628211ULL;
+   }
+
+   fclose( pFile );
+   return( uHash );
+}
+
+/****************************************************************************/
+/* OpenInfoSegment() - Maps the global memory segment that subsystem        */
+/* information is published in, initializing it if first to do so. Leaves   */
+/* the information process-local if the segment can't be used. Bumps the    */
+/* epoch and configuration stamp if the segment was last opened before the  */
+/* system restarted.                                                        */
+/****************************************************************************/
+
+static void OpenInfoSegment( void )
+{
+   HGLOBMEM     hInfoSeg;
+   INFO_SEGMENT *pstSeg;
+   U32          uVersion = 0;
+   uint64_t     uStamp   = 0;
+   uint64_t     uBootId  = BootId();
+
+   if( (hInfoSeg = CreateGlobMem( INFO_SEGMENT_ID | GLOBMEM_PERSISTENT, sizeof(INFO_SEGMENT), FALSE )) == NULL )
+      return;
+
+   if( (pstSeg = (INFO_SEGMENT *)MapGlobMem( hInfoSeg )) == NULL )
+      return;
+
+   // A new segment is zero-filled; whoever claims it sets the layout
+
+   if( !__atomic_load_n( &pstSeg->uVersion, __ATOMIC_ACQUIRE ) )
+   {
+      pstSeg->uSize = sizeof(INFO_SEGMENT);
+      __atomic_compare_exchange_n( &pstSeg->uConfigStamp, &uStamp, StampBase(), FALSE,
+                                   __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE );
+      __atomic_compare_exchange_n( &pstSeg->uVersion, &uVersion, INFO_VERSION, FALSE,
+                                   __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE );
+   }
+
+   if( (__atomic_load_n( &pstSeg->uVersion, __ATOMIC_ACQUIRE ) != INFO_VERSION) ||
+       (pstSeg->uSize != sizeof(INFO_SEGMENT)) )
+   {
+      UnmapGlobMem( pstSeg );
+      return;
+   }
+
+   // Epoch and stamp go first, so nobody sees our boot id with the old ones
+
+   if( uBootId && (__atomic_load_n( &pstSeg->uBootId, __ATOMIC_ACQUIRE ) != uBootId) )
+   {
+      __atomic_fetch_add( &pstSeg->uEpoch, 1, __ATOMIC_ACQ_REL );
+      __atomic_fetch_add( &pstSeg->uConfigStamp, 1, __ATOMIC_ACQ_REL );
+      __atomic_store_n( &pstSeg->uBootId, uBootId, __ATOMIC_RELEASE );
+   }
+
+   pstInfoSeg = pstSeg;
+}
+
+/****************************************************************************/
+/* InitializeModule() - Initializes module. Runs when module loaded...      */
+/****************************************************************************/
+
+static void InitializeModule( void )
+{
+   const char *pszStats;
+   const char *pszMode;
+
+   // Initialize variables
+
+   bAttached    = FALSE;
+   iMaxReceive  = 0;
+   iInitErrno   = 0;
+   bStarted     = FALSE;
+   hCritSect    = NULL;
+   pstInfoSeg   = &stInfoLocal;
+
+   stInfoLocal.uConfigStamp = StampBase();
+
+   memcpy( &stInfoDefault, &QstSubsystemInfo, sizeof(stInfoDefault) );
+
+   // Determine concurrency mode (system unless told otherwise)
+
+   pszMode = getenv( "QST_CONCURRENCY" );
+
+   if( pszMode && !strcmp( pszMode, "exclusive" ) )
+      iConcurrency = QST_CONCURRENCY_EXCLUSIVE;
+   else if( pszMode && !strcmp( pszMode, "process" ) )
+      iConcurrency = QST_CONCURRENCY_PROCESS;
+   else
+      iConcurrency = QST_CONCURRENCY_SYSTEM;
+
+   // Keep statistics if asked to
+
+   pszStats      = getenv( "QST_COMM_STATS" );
+   bStatsEnabled = pszStats && *pszStats && strcmp( pszStats, "0" );
+
+   // Initialize HECI support module
+
+   if( !HeciInitialize() )
+   {
+      iInitErrno = errno; // Save errno for reporting later
+      return;
+   }
+
+   if( iConcurrency == QST_CONCURRENCY_SYSTEM )
+   {
+      hCritSect = CreateCritSect( CRITSECT_TYPE, FALSE );
+
+      if( !hCritSect )
+      {
+         iInitErrno = errno; // Save errno for reporting later
+         return;
+      }
+   }
+
+   // Share subsystem information with other processes if possible
+
+   OpenInfoSegment();
+
+   // Initialize the transaction engine
+
+   if( !HeciPipeInitialize( (iConcurrency == QST_CONCURRENCY_SYSTEM)? &stPipeOps : &stPipeOpsLocal, PIPE_DEPTH, PIPE_TIMEOUT ) )
+   {
+      iInitErrno = errno; // Save errno for reporting later
+      return;
+   }
+}
+
+/****************************************************************************/
+/* CleanupModule() - Cleans up after module. Runs when module unloaded...   */
+/****************************************************************************/
+
+static void CleanupModule( void )
+{
+   int iIndex;
+
+   HeciPipeCleanup();
+   DetachDriver();
+   HeciCleanup();
+
+   for( iIndex = 0; iIndex < BORROW_COUNT; iIndex++ )
+   {
+      if( apvBorrow[iIndex] )
+      {
+         HeciUnregisterBuffer( apvBorrow[iIndex] );
+         free( apvBorrow[iIndex] );
+         apvBorrow[iIndex] = NULL;
+      }
+   }
+
+   if( hCritSect )
+   {
+      CloseCritSect( hCritSect );
+      hCritSect = NULL;
+   }
+
+   // The segment is left in place for the processes that follow
+
+   if( pstInfoSeg != &stInfoLocal )
+   {
+      UnmapGlobMem( pstInfoSeg );
+      pstInfoSeg = &stInfoLocal;
+   }
 }
 
 /****************************************************************************/
@@ -8,6 +8,24 @@
 /*                  Host  to  Embedded  Controller Interface (HECI) driver  */
 /*                  are used to perform this communication.                 */
 /*                                                                          */
+/*  Notes:      1.  The functions  exported  by  this  module  are  routed  */
+/*                  through a transport  (HECI_TRANSPORT).  The  transport  */
+/*                  that talks to the HECI driver is implemented here; the  */
+/*                  QST  firmware  simulator  is  implemented  by   module  */
+/*                  HeciSim.c.  Environment  variable   QST_HECI_TRANSPORT  */
+/*                  selects the transport ("mei" or "sim") when the module  */
+/*                  is initialized;  function  HeciSetTransport()  can  be  */
+/*                  used to select one explicitly.                          */
+/*                                                                          */
+/*              2.  Response packets are read directly into  the  caller's  */
+/*                  buffer when it can hold the largest packet the  driver  */
+/*                  may return; otherwise they  are  read  into  a  bounce  */
+/*                  buffer  (so  overflows  can  still  be  detected)  and  */
+/*                  copied. Buffers registered  with  HeciRegisterBuffer()  */
+/*                  are  known  to  extend  beyond  the  size  the  caller  */
+/*                  expects, so even responses smaller  than  the  maximum  */
+/*                  packet size are read into them directly.                */
+/*                                                                          */
 /****************************************************************************/
 
 /****************************************************************************/
@@ -59,6 +77,7 @@
 #include <unistd.h>
 #include <stdint.h>
 #include <aio.h>
+#include <pthread.h>
 
 #include "heci.h"
 
@@ -67,6 +86,7 @@
 /****************************************************************************/
 
 #define SEND_TIMEOUT    1000                // One second
+#define MAX_REGISTERED  32                  // Maximum buffers registered
 
 /****************************************************************************/
 /* Definitions for delivering IOCTLs to the HECI driver                     */
@@ -110,10 +130,117 @@ static void *           pvReceiveBuff;          // Pointer to receive buffer
 static size_t           tMaxReceive;            // Size of receive buffer
 
 /****************************************************************************/
-/* HeciDisconnect() - Disconnects from the ME Subsystem                     */
+/* Registered buffers                                                       */
 /****************************************************************************/
 
-void HeciDisconnect( void )
+typedef struct _HECI_REGISTERED
+{
+    UINT8               *pbyBuff;               // Start of buffer
+    size_t              tSize;                  // Size of buffer
+
+} HECI_REGISTERED;
+
+static HECI_REGISTERED  astRegistered[MAX_REGISTERED];
+static int              iRegistered;            // Number registered
+static pthread_mutex_t  stRegLock = PTHREAD_MUTEX_INITIALIZER;
+
+/****************************************************************************/
+/* HeciRegisterBuffer() - Registers a buffer that may be used to receive    */
+/* response packets. Returns FALSE (with errno set to ENOBUFS) if too many  */
+/* buffers are registered.                                                  */
+/****************************************************************************/
+
+BOOL HeciRegisterBuffer( void *pvBuff, size_t tBuffSize )
+{
+    int iIndex;
+
+    pthread_mutex_lock( &stRegLock );
+
+    for( iIndex = 0; iIndex < MAX_REGISTERED; iIndex++ )
+    {
+        if( !astRegistered[iIndex].pbyBuff )
+        {
+            astRegistered[iIndex].pbyBuff = (UINT8 *)pvBuff;
+            astRegistered[iIndex].tSize   = tBuffSize;
+            iRegistered++;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock( &stRegLock );
+
+    if( iIndex == MAX_REGISTERED )
+    {
+        errno = ENOBUFS;
+        return( FALSE );
+    }
+
+    return( TRUE );
+}
+
+/****************************************************************************/
+/* HeciUnregisterBuffer() - Removes a buffer's registration                 */
+/****************************************************************************/
+
+void HeciUnregisterBuffer( void *pvBuff )
+{
+    int iIndex;
+
+    pthread_mutex_lock( &stRegLock );
+
+    for( iIndex = 0; iIndex < MAX_REGISTERED; iIndex++ )
+    {
+        if( astRegistered[iIndex].pbyBuff == (UINT8 *)pvBuff )
+        {
+            astRegistered[iIndex].pbyBuff = NULL;
+            astRegistered[iIndex].tSize   = 0;
+            iRegistered--;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock( &stRegLock );
+}
+
+/****************************************************************************/
+/* HeciBufferCapacity() - Returns the number of bytes that may be written   */
+/* at pvBuff, which the caller says holds at least tBuffMax bytes. This is  */
+/* larger than tBuffMax if pvBuff lies within a registered buffer.          */
+/****************************************************************************/
+
+size_t HeciBufferCapacity( void *pvBuff, size_t tBuffMax )
+{
+    UINT8   *pbyBuff = (UINT8 *)pvBuff;
+    size_t  tCapacity = tBuffMax;
+    int     iIndex;
+
+    if( !iRegistered )
+        return( tCapacity );
+
+    pthread_mutex_lock( &stRegLock );
+
+    for( iIndex = 0; iIndex < MAX_REGISTERED; iIndex++ )
+    {
+        if(    (pbyBuff >= astRegistered[iIndex].pbyBuff)
+            && (pbyBuff <  astRegistered[iIndex].pbyBuff + astRegistered[iIndex].tSize) )
+        {
+            if( (size_t)(astRegistered[iIndex].pbyBuff + astRegistered[iIndex].tSize - pbyBuff) > tCapacity )
+                tCapacity = (size_t)(astRegistered[iIndex].pbyBuff + astRegistered[iIndex].tSize - pbyBuff);
+
+            break;
+        }
+    }
+
+    pthread_mutex_unlock( &stRegLock );
+
+    return( tCapacity );
+}
+
+/****************************************************************************/
+/* MeiDisconnect() - Disconnects from the ME Subsystem                      */
+/****************************************************************************/
+
+static void MeiDisconnect( void )
 {
     if( pvReceiveBuff )
     {
@@ -130,14 +257,14 @@ void HeciDisconnect( void )
 }
 
 /****************************************************************************/
-/* HeciConnect() - Connects to a ME Subsystem                               */
+/* MeiConnect() - Connects to a ME Subsystem                                */
 /****************************************************************************/
 
-size_t HeciConnect( const GUID *pSubsysGUID )
+static size_t MeiConnect( const GUID *pSubsysGUID )
 {
     HECI_IOCTL_DATA     stIOCTL;
 
-    HeciDisconnect();
+    MeiDisconnect();
 
     // Open a connection to the driver
 
@@ -152,7 +279,7 @@ size_t HeciConnect( const GUID *pSubsysGUID )
 
     if( ioctl( hDriver, IOCTL_HECI_CONNECT_CLIENT, &stIOCTL ) )
     {
-        HeciDisconnect();
+        MeiDisconnect();
         return( -1 );
     }
 
@@ -164,7 +291,7 @@ size_t HeciConnect( const GUID *pSubsysGUID )
 
     if( !pvReceiveBuff )
     {
-        HeciDisconnect();
+        MeiDisconnect();
         return( -1 );
     }
 
@@ -174,14 +301,18 @@ size_t HeciConnect( const GUID *pSubsysGUID )
 }
 
 /****************************************************************************/
-/* HeciReceive() - Receive a packet from the ME Subsystem                   */
+/* MeiReceive() - Receive a packet from the ME Subsystem                    */
 /****************************************************************************/
 
-int HeciReceive( void *pvBuff, size_t tBuffMax )
+static int MeiReceive( void *pvBuff, size_t tBuffMax )
 {
-    // Get the next response packet
+    BOOL bDirect = (HeciBufferCapacity( pvBuff, tBuffMax ) >= tMaxReceive);
+    int  iLen;
+
+    // Get the next response packet; straight into user's buffer if any
+    // packet the driver could return will fit
 
-    int iLen = read( hDriver, pvReceiveBuff, tMaxReceive );
+    iLen = read( hDriver, bDirect? pvBuff : pvReceiveBuff, tMaxReceive );
 
     if( iLen < 0 )
         return( -1 );
@@ -194,49 +325,67 @@ int HeciReceive( void *pvBuff, size_t tBuffMax )
         return( -1 );
     }
 
-    // Fits; copy into user's buffer and tell them its size
+    // Fits; copy into user's buffer (if not already there) and tell them
+    // its size
+
+    if( !bDirect )
+        memcpy( pvBuff, pvReceiveBuff, iLen );
 
-    memcpy( pvBuff, pvReceiveBuff, iLen );
     return( iLen );
 }
 
 /****************************************************************************/
-/* HeciSend() - Sends a packet to the ME Subsystem                          */
+/* MeiPost() - Sends a packet to the ME Subsystem without waiting for the   */
+/* response to become available                                             */
 /****************************************************************************/
 
-BOOL HeciSend( void *pvBuff, size_t tBuffLen )
+static BOOL MeiPost( void *pvBuff, size_t tBuffLen )
 {
     // Send the packet to the driver for transmission
 
-    int iLen = write( hDriver, pvBuff, (int)tBuffLen );
+    return( write( hDriver, pvBuff, (int)tBuffLen ) >= 0 );
+}
 
-    if( iLen < 0 )
-        return( FALSE );
-    else
-    {
-        // Driver accepted packet; wait for transmission to actually complete
+/****************************************************************************/
+/* MeiWait() - Waits (up to iTimeout milliseconds) for a response packet    */
+/* to become available                                                      */
+/****************************************************************************/
 
-        fd_set          stFDSet;
-        struct timeval  stTime;
-        int             iNumFD;
+static BOOL MeiWait( int iTimeout )
+{
+    fd_set          stFDSet;
+    struct timeval  stTime;
+    int             iNumFD;
 
-        stTime.tv_sec  = SEND_TIMEOUT / 1000;
-        stTime.tv_usec = (SEND_TIMEOUT % 1000) * 1000000;
+    stTime.tv_sec  = iTimeout / 1000;
+    stTime.tv_usec = (iTimeout % 1000) * 1000;
 
-        FD_ZERO( &stFDSet );
-        FD_SET( hDriver, &stFDSet );
+    FD_ZERO( &stFDSet );
+    FD_SET( hDriver, &stFDSet );
 
-        iNumFD = select( hDriver + 1, &stFDSet, NULL, NULL, &stTime );
+    iNumFD = select( hDriver + 1, &stFDSet, NULL, NULL, &stTime );
 
-        return( (iNumFD > 0) && FD_ISSET( hDriver, &stFDSet ) );
-    }
+    if( iNumFD == 0 )
+        errno = ETIMEDOUT;
+
+    return( (iNumFD > 0) && FD_ISSET( hDriver, &stFDSet ) );
 }
 
 /****************************************************************************/
-/* HeciInitialize() - Initializes the module                                */
+/* MeiGetFD() - Returns the driver connection's descriptor, which is        */
+/* readable when a response packet is available                             */
 /****************************************************************************/
 
-BOOL HeciInitialize( void )
+static int MeiGetFD( void )
+{
+    return( hDriver );
+}
+
+/****************************************************************************/
+/* MeiInitialize() - Initializes the transport                              */
+/****************************************************************************/
+
+static BOOL MeiInitialize( void )
 {
     hDriver       = -1;
     pvReceiveBuff = NULL;
@@ -245,12 +394,171 @@ BOOL HeciInitialize( void )
     return( TRUE );
 }
 
+/****************************************************************************/
+/* MeiCleanup() - Cleans up after the transport                             */
+/****************************************************************************/
+
+static void MeiCleanup( void )
+{
+    MeiDisconnect();
+}
+
+/****************************************************************************/
+/* stHeciMei - Transport that uses the HECI driver                          */
+/****************************************************************************/
+
+const HECI_TRANSPORT stHeciMei =
+{
+    "mei",
+    MeiInitialize,
+    MeiCleanup,
+    MeiConnect,
+    MeiDisconnect,
+    MeiPost,
+    MeiWait,
+    MeiReceive,
+    MeiGetFD
+};
+
+/****************************************************************************/
+/* Transport Selection                                                      */
+/****************************************************************************/
+
+static const HECI_TRANSPORT *apstTransports[] = { &stHeciMei, &stHeciSim };
+
+static const HECI_TRANSPORT *pstTransport = &stHeciMei;
+
+/****************************************************************************/
+/* HeciSetTransport() - Selects the transport used by the functions below.  */
+/* Must be called before HeciInitialize() or after HeciCleanup().           */
+/****************************************************************************/
+
+BOOL HeciSetTransport( const HECI_TRANSPORT *pstNew )
+{
+    if( !pstNew )
+    {
+        errno = EINVAL;
+        return( FALSE );
+    }
+
+    pstTransport = pstNew;
+    return( TRUE );
+}
+
+/****************************************************************************/
+/* HeciGetTransport() - Returns the transport currently selected            */
+/****************************************************************************/
+
+const HECI_TRANSPORT *HeciGetTransport( void )
+{
+    return( pstTransport );
+}
+
+/****************************************************************************/
+/* HeciDisconnect() - Disconnects from the ME Subsystem                     */
+/****************************************************************************/
+
+void HeciDisconnect( void )
+{
+    pstTransport->pfnDisconnect();
+}
+
+/****************************************************************************/
+/* HeciConnect() - Connects to a ME Subsystem                               */
+/****************************************************************************/
+
+size_t HeciConnect( const GUID *pSubsysGUID )
+{
+    return( pstTransport->pfnConnect( pSubsysGUID ) );
+}
+
+/****************************************************************************/
+/* HeciReceive() - Receive a packet from the ME Subsystem                   */
+/****************************************************************************/
+
+int HeciReceive( void *pvBuff, size_t tBuffMax )
+{
+    return( pstTransport->pfnReceive( pvBuff, tBuffMax ) );
+}
+
+/****************************************************************************/
+/* HeciPost() - Sends a packet to the ME Subsystem without waiting for the  */
+/* response to become available                                             */
+/****************************************************************************/
+
+BOOL HeciPost( void *pvBuff, size_t tBuffLen )
+{
+    return( pstTransport->pfnPost( pvBuff, tBuffLen ) );
+}
+
+/****************************************************************************/
+/* HeciWait() - Waits (up to iTimeout milliseconds) for a response packet   */
+/* to become available                                                      */
+/****************************************************************************/
+
+BOOL HeciWait( int iTimeout )
+{
+    return( pstTransport->pfnWait( iTimeout ) );
+}
+
+/****************************************************************************/
+/* HeciGetFD() - Returns a descriptor that is readable when a response      */
+/* packet is available, or -1 if there is none                              */
+/****************************************************************************/
+
+int HeciGetFD( void )
+{
+    return( pstTransport->pfnGetFD? pstTransport->pfnGetFD() : -1 );
+}
+
+/****************************************************************************/
+/* HeciSend() - Sends a packet to the ME Subsystem                          */
+/****************************************************************************/
+
+BOOL HeciSend( void *pvBuff, size_t tBuffLen )
+{
+    // Send the packet; wait for transmission to actually complete
+
+    return( HeciPost( pvBuff, tBuffLen ) && HeciWait( SEND_TIMEOUT ) );
+}
+
+/****************************************************************************/
+/* HeciInitialize() - Initializes the module                                */
+/****************************************************************************/
+
+BOOL HeciInitialize( void )
+{
+    const char  *pszName = getenv( "QST_HECI_TRANSPORT" );
+    int         iIndex;
+
+    // Select transport requested by environment (if any)
+
+    if( pszName && *pszName )
+    {
+        for( iIndex = 0; iIndex < sizeof(apstTransports) / sizeof(apstTransports[0]); iIndex++ )
+        {
+            if( !strcmp( pszName, apstTransports[iIndex]->pszName ) )
+                break;
+        }
+
+        if( iIndex == sizeof(apstTransports) / sizeof(apstTransports[0]) )
+        {
+            errno = ENODEV;
+            return( FALSE );
+        }
+
+        pstTransport = apstTransports[iIndex];
+    }
+
+    return( pstTransport->pfnInitialize() );
+}
+
 /****************************************************************************/
 /* HeciCleanup() - Cleans up after the module                               */
 /****************************************************************************/
 
 void HeciCleanup( void )
 {
-    HeciDisconnect();
+    pstTransport->pfnCleanup();
 }
 
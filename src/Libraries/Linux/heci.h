@@ -49,6 +49,36 @@
 
 #include <typedef.h>
 
+/****************************************************************************/
+/* HECI_TRANSPORT - Operations implementing a transport. The functions      */
+/* below are routed through the transport that is currently selected.       */
+/****************************************************************************/
+
+typedef struct _HECI_TRANSPORT
+{
+    const char  *pszName;                                       // Name used for selection
+
+    BOOL        (*pfnInitialize)( void );
+    void        (*pfnCleanup)( void );
+
+    size_t      (*pfnConnect)( const GUID *pSubsysGUID );
+    void        (*pfnDisconnect)( void );
+
+    BOOL        (*pfnPost)( void *pvBuff, size_t tBuffLen );
+    BOOL        (*pfnWait)( int iTimeout );
+    int         (*pfnReceive)( void *pvBuff, size_t tBuffMax );
+    int         (*pfnGetFD)( void );                            // Readable when response available
+
+} HECI_TRANSPORT;
+
+extern const HECI_TRANSPORT stHeciMei;                          // HECI driver (heci.c)
+extern const HECI_TRANSPORT stHeciSim;                          // QST firmware simulator (HeciSim.c)
+
+INT32  HeciSimReading( UINT8 byUpdate, int iIndex, unsigned long ulElapsed );
+
+BOOL   HeciSetTransport( const HECI_TRANSPORT *pstTransport );
+const HECI_TRANSPORT *HeciGetTransport( void );
+
 BOOL   HeciInitialize( void );
 void   HeciCleanup( void );
 
@@ -56,7 +86,14 @@ size_t HeciConnect( const GUID *pSubsysGUID );
 void   HeciDisconnect( void );
 
 BOOL   HeciSend( void *pvBuff, size_t tBuffLen );
+BOOL   HeciPost( void *pvBuff, size_t tBuffLen );
+BOOL   HeciWait( int iTimeout );
 int    HeciReceive( void *pvBuff, size_t tBuffMax );
+int    HeciGetFD( void );
+
+BOOL   HeciRegisterBuffer( void *pvBuff, size_t tBuffSize );
+void   HeciUnregisterBuffer( void *pvBuff );
+size_t HeciBufferCapacity( void *pvBuff, size_t tBuffMax );
 
 #endif // ndef _HECI_H
 
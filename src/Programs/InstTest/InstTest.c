@@ -25,6 +25,12 @@
 /*                  memory, modify the  project  to  include  source  file  */
 /*                  ..\Support\QstInst.c and symbol DYNAMIC_DLL_LOADING.    */
 /*                                                                          */
+/*              3.  On Linux, each pass takes every  reading  and  setting  */
+/*                  with a single call  to  QstGetAllReadings(),  so  that  */
+/*                  those displayed together all come from the same update  */
+/*                  of the QST Subsystem,  rather  than  asking  for  each  */
+/*                  Sensor and Controller in turn.                          */
+/*                                                                          */
 /****************************************************************************/
 
 /****************************************************************************/
@@ -128,6 +134,10 @@ static float                fTempReading,
                             fDutySettingMin[QST_MAX_FAN_SPEED_CONTROLLERS],
                             fDutySettingTotal[QST_MAX_FAN_SPEED_CONTROLLERS];
 
+#if defined(__LINUX__)
+static QST_SNAPSHOT         stSnapshot;
+#endif
+
 static DWORD                dwCount;
 
 static time_t               tStart;
@@ -327,6 +337,30 @@ static float GetValue( int iType, int iIndex )
 {
    float fValue = 0;
 
+#if defined(__LINUX__)
+
+   // Taken from the snapshot made for this pass
+
+   switch( iType )
+   {
+   case TEMP_READING:
+
+      fValue = stSnapshot.Sensor[TEMPERATURE_SENSOR].Reading[iIndex];
+      break;
+
+   case FAN_READING:
+
+      fValue = stSnapshot.Sensor[FAN_SPEED_SENSOR].Reading[iIndex];
+      break;
+
+   case DUTY_SETTING:
+
+      fValue = stSnapshot.ControllerDuty[iIndex];
+      break;
+   }
+
+#else
+
    switch( iType )
    {
    case TEMP_READING:
@@ -351,6 +385,8 @@ static float GetValue( int iType, int iIndex )
       break;
    }
 
+#endif
+
    if( fValue == -1 )
    {
       sprintf( szMessage, "Unable to obtain reading from %s %d", szDevice[iType], iIndex );
@@ -453,6 +489,19 @@ int main( int iArgs, char *pszArg[] )
       ++dwCount;
       fputs( "\rCurrent ", stdout );
 
+#if defined(__LINUX__)
+
+      // Sample every Sensor and Controller at once
+
+      if( !QstGetAllReadings( &stSnapshot ) )
+      {
+         DisplayError( "Unable to obtain readings", FALSE );
+         Cleanup();
+         exit( 1 );
+      }
+
+#endif
+
       // Display Temperatures
 
       for( iIndex = 0; iIndex < iTempReadings; iIndex++ )
@@ -0,0 +1,382 @@
+/****************************************************************************/
+/*                                                                          */
+/*  Module:         QstRec.c                                                */
+/*                                                                          */
+/*  Description:    Implements program QstRec, which records the  readings  */
+/*                  of the sensors and the settings of the fan controllers  */
+/*                  of  the  Intel(R)  Quiet   System   Technology   (QST)  */
+/*                  Subsystem at a fixed interval,  appending  them  to  a  */
+/*                  compressed recording that program  RecQuery  can  read  */
+/*                  back.                                                   */
+/*                                                                          */
+/****************************************************************************/
+/*                                                                          */
+/*     Copyright (c) 2005-2009, Intel Corporation. All Rights Reserved.     */
+/*                                                                          */
+/*  Redistribution and use in source and binary  forms,  with  or  without  */
+/*  modification, are permitted provided that the following conditions are  */
+/*  met:                                                                    */
+/*                                                                          */
+/*    - Redistributions of source code must  retain  the  above  copyright  */
+/*      notice, this list of conditions and the following disclaimer.       */
+/*                                                                          */
+/*    - Redistributions  in binary form must reproduce the above copyright  */
+/*      notice, this list of conditions and the  following  disclaimer  in  */
+/*      the   documentation  and/or  other  materials  provided  with  the  */
+/*      distribution.                                                       */
+/*                                                                          */
+/*    - Neither the name  of  Intel  Corporation  nor  the  names  of  its  */
+/*      contributors  may  be  used to endorse or promote products derived  */
+/*      from this software without specific prior written permission.       */
+/*                                                                          */
+/*  DISCLAIMER: THIS SOFTWARE IS PROVIDED BY  THE  COPYRIGHT  HOLDERS  AND  */
+/*  CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  */
+/*  BUT  NOT  LIMITED  TO,  THE  IMPLIED WARRANTIES OF MERCHANTABILITY AND  */
+/*  FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN  NO  EVENT  SHALL  */
+/*  INTEL  CORPORATION  OR  THE  CONTRIBUTORS  BE  LIABLE  FOR ANY DIRECT,  */
+/*  INDIRECT, INCIDENTAL, SPECIAL,  EXEMPLARY,  OR  CONSEQUENTIAL  DAMAGES  */
+/*  (INCLUDING,  BUT  NOT  LIMITED  TO, PROCUREMENT OF SUBSTITUTE GOODS OR  */
+/*  SERVICES; LOSS OF USE, DATA, OR  PROFITS;  OR  BUSINESS  INTERRUPTION)  */
+/*  HOWEVER  CAUSED  AND  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,  */
+/*  STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)  ARISING  */
+/*  IN  ANY  WAY  OUT  OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE  */
+/*  POSSIBILITY OF SUCH DAMAGE.                                             */
+/*                                                                          */
+/****************************************************************************/
+
+#ifndef __linux__
+#error This source module intended for use in Linux environments only
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "QstCmd.h"
+#include "QstComm.h"
+#include "AccessQst.h"
+#include "RecFile.h"
+
+/****************************************************************************/
+/* Definitions                                                              */
+/****************************************************************************/
+
+#define DEFAULT_INTERVAL    1000        // Time between samples (milliseconds)
+#define DEFAULT_FLUSH       60          // Time between flushes to disk (seconds)
+
+/****************************************************************************/
+/* Commands fetching the readings of each class of column                   */
+/****************************************************************************/
+
+static QST_GET_TEMP_MON_UPDATE_RSP      stTempRsp;
+static QST_GET_FAN_MON_UPDATE_RSP       stFanRsp;
+static QST_GET_VOLT_MON_UPDATE_RSP      stVoltRsp;
+static QST_GET_CURR_MON_UPDATE_RSP      stCurrRsp;
+static QST_GET_FAN_CTRL_UPDATE_RSP      stDutyRsp;
+
+static const struct
+{
+   UINT8    byCommand;                  // Command code
+   void     *pvRspBuf;                  // Buffer for response
+   size_t   tRspSize;                   // Size of response
+   int      (*pfnCount)( void );        // Returns number of sensors
+   int      (*pfnIndex)( int );         // Returns Subsystem's index of sensor
+   int      (*pfnUsage)( int );         // Returns usage of sensor
+
+} stClass[REC_CLASSES] =
+{
+   { QST_GET_TEMP_MON_UPDATE, &stTempRsp, sizeof(stTempRsp), GetTempCountQst, GetTempIndexQst, GetTempUsageQst },
+   { QST_GET_FAN_MON_UPDATE,  &stFanRsp,  sizeof(stFanRsp),  GetFanCountQst,  GetFanIndexQst,  GetFanUsageQst  },
+   { QST_GET_VOLT_MON_UPDATE, &stVoltRsp, sizeof(stVoltRsp), GetVoltCountQst, GetVoltIndexQst, GetVoltUsageQst },
+   { QST_GET_CURR_MON_UPDATE, &stCurrRsp, sizeof(stCurrRsp), GetCurrCountQst, GetCurrIndexQst, GetCurrUsageQst },
+   { QST_GET_FAN_CTRL_UPDATE, &stDutyRsp, sizeof(stDutyRsp), GetDutyCountQst, GetDutyIndexQst, GetDutyUsageQst }
+};
+
+static QST_GENERIC_CMD                  stCmd[REC_CLASSES];
+static QST_BATCH_ENTRY                  stBatch[REC_CLASSES];
+static int                              iBatch = 0;
+
+static volatile sig_atomic_t            iStop = 0;
+
+/****************************************************************************/
+/* Stop() - Handles the signals that end the recording                      */
+/****************************************************************************/
+
+static void Stop( int iSignal )
+{
+   iStop = iSignal;
+}
+
+/****************************************************************************/
+/* BuildColumns() - Fills in the columns of the header of the recording,    */
+/* one per enabled sensor or controller, and the batch of commands needed   */
+/* to fetch their values.                                                   */
+/****************************************************************************/
+
+static void BuildColumns( P_REC_FILE_HEADER pstHeader )
+{
+   P_REC_COLUMN pstColumn;
+   int          iClass, iIndex, iCount;
+
+   memset( pstHeader, 0, sizeof(REC_FILE_HEADER) );
+
+   for( iClass = 0; iClass < REC_CLASSES; iClass++ )
+   {
+      if( (iCount = stClass[iClass].pfnCount()) <= 0 )
+         continue;
+
+      for( iIndex = 0; iIndex < iCount; iIndex++ )
+      {
+         pstColumn = &pstHeader->stColumn[pstHeader->wColumns++];
+
+         pstColumn->byClass = (UINT8)iClass;
+         pstColumn->byIndex = (UINT8)stClass[iClass].pfnIndex( iIndex );
+         pstColumn->byUsage = (UINT8)stClass[iClass].pfnUsage( iIndex );
+      }
+
+      stCmd[iBatch].stHeader.byCommand       = stClass[iClass].byCommand;
+      stCmd[iBatch].stHeader.byEntity        = 0;
+      stCmd[iBatch].stHeader.wCommandLength  = QST_CMD_DATA_SIZE(QST_GENERIC_CMD);
+      stCmd[iBatch].stHeader.wResponseLength = (UINT16)stClass[iClass].tRspSize;
+
+      stBatch[iBatch].pvCmdBuf = &stCmd[iBatch];
+      stBatch[iBatch].tCmdSize = sizeof(QST_GENERIC_CMD);
+      stBatch[iBatch].pvRspBuf = stClass[iClass].pvRspBuf;
+      stBatch[iBatch].tRspSize = stClass[iClass].tRspSize;
+      iBatch++;
+   }
+}
+
+/****************************************************************************/
+/* TakeSample() - Fetches the values of the columns, as the Subsystem's own */
+/* fixed-point integers.                                                    */
+/****************************************************************************/
+
+static BOOL TakeSample( const REC_FILE_HEADER *pstHeader, long long *pllValues )
+{
+   const REC_COLUMN *pstColumn;
+   int              iIndex;
+
+   if( !QstCommandBatch( stBatch, iBatch ) )
+      return( FALSE );
+
+   for( iIndex = 0; iIndex < iBatch; iIndex++ )
+   {
+      if( !stBatch[iIndex].bSucceeded || ((UINT8 *)stBatch[iIndex].pvRspBuf)[0] )
+         return( FALSE );
+   }
+
+   for( iIndex = 0; iIndex < pstHeader->wColumns; iIndex++ )
+   {
+      pstColumn = &pstHeader->stColumn[iIndex];
+
+      switch( pstColumn->byClass )
+      {
+      case REC_TEMP:
+
+         pllValues[iIndex] = stTempRsp.stMonitorUpdate[pstColumn->byIndex].lfCurrentReading;
+         break;
+
+      case REC_FAN:
+
+         pllValues[iIndex] = stFanRsp.stMonitorUpdate[pstColumn->byIndex].uCurrentSpeed;
+         break;
+
+      case REC_VOLT:
+
+         pllValues[iIndex] = stVoltRsp.stMonitorUpdate[pstColumn->byIndex].iCurrentVoltage;
+         break;
+
+      case REC_CURR:
+
+         pllValues[iIndex] = stCurrRsp.stMonitorUpdate[pstColumn->byIndex].iCurrentCurrent;
+         break;
+
+      default:
+
+         pllValues[iIndex] = stDutyRsp.stControllerUpdate[pstColumn->byIndex].uCurrentDutyCycle;
+         break;
+      }
+   }
+
+   return( TRUE );
+}
+
+/****************************************************************************/
+/* AddTime() - Advances a time by 'n' milliseconds                          */
+/****************************************************************************/
+
+static void AddTime( struct timespec *pstTime, int iMilliseconds )
+{
+   pstTime->tv_sec  += iMilliseconds / 1000;
+   pstTime->tv_nsec += 1000000L * (iMilliseconds % 1000);
+
+   if( pstTime->tv_nsec >= 1000000000L )
+   {
+      pstTime->tv_sec++;
+      pstTime->tv_nsec -= 1000000000L;
+   }
+}
+
+/****************************************************************************/
+/* Usage() - Displays program usage                                         */
+/****************************************************************************/
+
+static void Usage( void )
+{
+   puts( "Usage: QstRec [-i interval] [-f flush] [-n samples] file\n" );
+   puts( "   -i interval  Time between samples, in milliseconds (default 1000)" );
+   puts( "   -f flush     Time between flushes to disk, in seconds (default 60)" );
+   puts( "   -n samples   Samples to record (default: until interrupted)" );
+}
+
+/****************************************************************************/
+/* main() - Mainline for program                                            */
+/****************************************************************************/
+
+int main( int iArgs, char *pszArg[] )
+{
+   REC_FILE_HEADER      stHeader;       // Columns recorded
+   P_REC_WRITER         pstWriter;      // Recording
+   long long            llValue[REC_MAX_COLUMNS];
+   struct timespec      stStart, stNext, stNow;
+   struct sigaction     stAction;
+   struct stat          stStat;
+   long long            llStart, llTick = 0, llFlushTicks;
+   long                 lSamples  = 0;
+   long                 lRecorded = 0, lMissed = 0;
+   int                  iInterval = DEFAULT_INTERVAL;
+   int                  iFlush    = DEFAULT_FLUSH;
+   int                  iOption;
+
+   puts( "\nIntel(R) Quiet System Technology Sensor Recorder" );
+   puts( "Copyright (C) 2007-2009, Intel Corporation. All Rights Reserved.\n" );
+
+   while( (iOption = getopt( iArgs, pszArg, "i:f:n:" )) != -1 )
+   {
+      switch( iOption )
+      {
+      case 'i':
+
+         iInterval = atoi( optarg );
+         break;
+
+      case 'f':
+
+         iFlush = atoi( optarg );
+         break;
+
+      case 'n':
+
+         lSamples = atol( optarg );
+         break;
+
+      default:
+
+         Usage();
+         return( 1 );
+      }
+   }
+
+   if( (optind != iArgs - 1) || (iInterval <= 0) || (iFlush <= 0) || (lSamples < 0) )
+   {
+      Usage();
+      return( 1 );
+   }
+
+   if( !InitializeQst() )
+   {
+      printf( "\n*** Unable to communicate with QST Subsystem!!\n   ERRNO = %d (%s)\n\n", errno, strerror( errno ) );
+      return( errno );
+   }
+
+   BuildColumns( &stHeader );
+   stHeader.dwInterval = (UINT32)iInterval;
+
+   if( !stHeader.wColumns )
+   {
+      puts( "The QST Subsystem has no sensors enabled!" );
+      return( 1 );
+   }
+
+   if( !RecOpenWrite( pszArg[optind], &stHeader, &pstWriter ) )
+   {
+      printf( "\n*** Unable to open recording %s!!\n   ERRNO = %d (%s)\n\n", pszArg[optind], errno, strerror( errno ) );
+      return( errno );
+   }
+
+   // Stop cleanly when interrupted, waking up the wait for the next sample
+
+   memset( &stAction, 0, sizeof(stAction) );
+   stAction.sa_handler = Stop;
+   sigaction( SIGINT,  &stAction, NULL );
+   sigaction( SIGTERM, &stAction, NULL );
+
+   printf( "Recording %d columns every %d ms to %s\n", stHeader.wColumns, iInterval, pszArg[optind] );
+
+   // Samples are timed on the monotonic clock, so that their times (offsets
+   // from the start on the wall clock) step evenly, coding to runs of zero
+
+   clock_gettime( CLOCK_REALTIME,  &stStart );
+   clock_gettime( CLOCK_MONOTONIC, &stNext );
+
+   llStart      = ((long long)stStart.tv_sec * 1000) + (stStart.tv_nsec / 1000000L);
+   llFlushTicks = ((long long)iFlush * 1000 + iInterval - 1) / iInterval;
+
+   while( !iStop && (!lSamples || (lRecorded + lMissed < lSamples)) )
+   {
+      while( (clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &stNext, NULL ) == EINTR) && !iStop );
+
+      if( iStop )
+         break;
+
+      if( TakeSample( &stHeader, llValue ) )
+      {
+         if( !RecAppend( pstWriter, llStart + (llTick * iInterval), llValue ) )
+         {
+            printf( "\n*** Unable to write recording!!\n   ERRNO = %d (%s)\n\n", errno, strerror( errno ) );
+            break;
+         }
+
+         lRecorded++;
+      }
+      else
+         lMissed++;
+
+      if( !(++llTick % llFlushTicks) && !RecFlush( pstWriter ) )
+      {
+         printf( "\n*** Unable to flush recording!!\n   ERRNO = %d (%s)\n\n", errno, strerror( errno ) );
+         break;
+      }
+
+      // Skip the samples that there was no time to take
+
+      AddTime( &stNext, iInterval );
+      clock_gettime( CLOCK_MONOTONIC, &stNow );
+
+      while(    (stNext.tv_sec < stNow.tv_sec)
+             || ((stNext.tv_sec == stNow.tv_sec) && (stNext.tv_nsec < stNow.tv_nsec)) )
+      {
+         AddTime( &stNext, iInterval );
+         llTick++;
+         lMissed++;
+      }
+   }
+
+   if( !RecCloseWrite( pstWriter ) )
+      printf( "\n*** Unable to close recording!!\n   ERRNO = %d (%s)\n\n", errno, strerror( errno ) );
+
+   printf( "%ld samples recorded (%ld missed)\n", lRecorded, lMissed );
+
+   if( !stat( pszArg[optind], &stStat ) )
+      printf( "Recording is %lld bytes\n", (long long)stStat.st_size );
+
+   puts( "\nEnd of Recording\n" );
+
+   return( 0 );
+}
@@ -0,0 +1,797 @@
+/****************************************************************************/
+/*                                                                          */
+/*  Module:         RecFile.c                                               */
+/*                                                                          */
+/*  Description:    Implements the reading and writing of the  files  kept  */
+/*                  by the QstRec sensor history recorder, as described in  */
+/*                  RecFile.h.                                              */
+/*                                                                          */
+/*  Functions:      RecOpenWrite()  - Opens  a  recording  for   appending  */
+/*                                    samples, creating it if need be.      */
+/*                                                                          */
+/*                  RecAppend()     - Appends a  sample  to  a  recording,  */
+/*                                    writing out the block  being  filled  */
+/*                                    once it is full.                      */
+/*                                                                          */
+/*                  RecFlush()      - Writes out the block  being  filled,  */
+/*                                    as far as it has  been  filled,  and  */
+/*                                    waits for it to reach the disk.       */
+/*                                                                          */
+/*                  RecCloseWrite() - Flushes  and  closes   a   recording  */
+/*                                    opened for appending.                 */
+/*                                                                          */
+/*                  RecOpenRead()   - Maps a  recording  into  memory  for  */
+/*                                    reading.                              */
+/*                                                                          */
+/*                  RecCloseRead()  - Unmaps  a   recording   opened   for  */
+/*                                    reading.                              */
+/*                                                                          */
+/*                  RecGetBlock()   - Returns the address of  a  block  of  */
+/*                                    samples, if it is intact.             */
+/*                                                                          */
+/*                  RecFindBlock()  - Returns the number of the  block  at  */
+/*                                    which to start reading  the  samples  */
+/*                                    taken from a given time on.           */
+/*                                                                          */
+/*                  RecDecode()     - Decodes the values of one column  of  */
+/*                                    a block of samples.                   */
+/*                                                                          */
+/****************************************************************************/
+/*                                                                          */
+/*     Copyright (c) 2005-2009, Intel Corporation. All Rights Reserved.     */
+/*                                                                          */
+/*  Redistribution and use in source and binary  forms,  with  or  without  */
+/*  modification, are permitted provided that the following conditions are  */
+/*  met:                                                                    */
+/*                                                                          */
+/*    - Redistributions of source code must  retain  the  above  copyright  */
+/*      notice, this list of conditions and the following disclaimer.       */
+/*                                                                          */
+/*    - Redistributions  in binary form must reproduce the above copyright  */
+/*      notice, this list of conditions and the  following  disclaimer  in  */
+/*      the   documentation  and/or  other  materials  provided  with  the  */
+/*      distribution.                                                       */
+/*                                                                          */
+/*    - Neither the name  of  Intel  Corporation  nor  the  names  of  its  */
+/*      contributors  may  be  used to endorse or promote products derived  */
+/*      from this software without specific prior written permission.       */
+/*                                                                          */
+/*  DISCLAIMER: THIS SOFTWARE IS PROVIDED BY  THE  COPYRIGHT  HOLDERS  AND  */
+/*  CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  */
+/*  BUT  NOT  LIMITED  TO,  THE  IMPLIED WARRANTIES OF MERCHANTABILITY AND  */
+/*  FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN  NO  EVENT  SHALL  */
+/*  INTEL  CORPORATION  OR  THE  CONTRIBUTORS  BE  LIABLE  FOR ANY DIRECT,  */
+/*  INDIRECT, INCIDENTAL, SPECIAL,  EXEMPLARY,  OR  CONSEQUENTIAL  DAMAGES  */
+/*  (INCLUDING,  BUT  NOT  LIMITED  TO, PROCUREMENT OF SUBSTITUTE GOODS OR  */
+/*  SERVICES; LOSS OF USE, DATA, OR  PROFITS;  OR  BUSINESS  INTERRUPTION)  */
+/*  HOWEVER  CAUSED  AND  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,  */
+/*  STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)  ARISING  */
+/*  IN  ANY  WAY  OUT  OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE  */
+/*  POSSIBILITY OF SUCH DAMAGE.                                             */
+/*                                                                          */
+/****************************************************************************/
+
+#ifndef __linux__
+#error This source module intended for use in Linux environments only
+#endif
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/file.h>
+
+#include "RecFile.h"
+
+/****************************************************************************/
+/* Definitions                                                              */
+/****************************************************************************/
+
+#define ZIGZAG(ll)          (((unsigned long long)(ll) << 1) ^ (unsigned long long)((ll) >> 63))
+#define UNZIGZAG(ull)       ((long long)((ull) >> 1) ^ -(long long)((ull) & 1))
+
+#define VALUE_TOKEN(ll)     (ZIGZAG( ll ) << 1)
+#define RUN_TOKEN(u)        (((unsigned long long)(u) << 1) | 1)
+
+#define BLOCK_OFFSET(lBlock) ((off_t)((lBlock) + 1) * REC_BLOCK_SIZE)
+
+/****************************************************************************/
+/* CloseFailed() - Closes a file after a failure, keeping the errno of the  */
+/* failure, and returns FALSE.                                              */
+/****************************************************************************/
+
+static BOOL CloseFailed( int iFile )
+{
+   int iErrno = errno;
+
+   close( iFile );
+   errno = iErrno;
+   return( FALSE );
+}
+
+/****************************************************************************/
+/* PutToken() - Writes a number 7 bits a byte, returning the bytes written  */
+/****************************************************************************/
+
+static int PutToken( UINT8 *pbyData, unsigned long long ullToken )
+{
+   int iLength = 0;
+
+   while( ullToken >= 0x80 )
+   {
+      pbyData[iLength++] = (UINT8)(ullToken | 0x80);
+      ullToken >>= 7;
+   }
+
+   pbyData[iLength++] = (UINT8)ullToken;
+   return( iLength );
+}
+
+/****************************************************************************/
+/* TokenSize() - Returns the number of bytes PutToken() would write         */
+/****************************************************************************/
+
+static int TokenSize( unsigned long long ullToken )
+{
+   int iLength = 1;
+
+   while( ullToken >= 0x80 )
+   {
+      ullToken >>= 7;
+      iLength++;
+   }
+
+   return( iLength );
+}
+
+/****************************************************************************/
+/* GetToken() - Reads a number written by PutToken(). Returns FALSE if the  */
+/* number runs past the end of the data.                                    */
+/****************************************************************************/
+
+static BOOL GetToken( const UINT8 **ppbyData, const UINT8 *pbyEnd, unsigned long long *pullToken )
+{
+   unsigned long long ullToken = 0;
+   UINT8              byData;
+   int                iShift;
+
+   for( iShift = 0; (*ppbyData < pbyEnd) && (iShift < 64); iShift += 7 )
+   {
+      byData    = *(*ppbyData)++;
+      ullToken |= (unsigned long long)(byData & 0x7F) << iShift;
+
+      if( !(byData & 0x80) )
+      {
+         *pullToken = ullToken;
+         return( TRUE );
+      }
+   }
+
+   return( FALSE );
+}
+
+/****************************************************************************/
+/* Checksum() - Returns the FNV-1a hash of a block, from just after its     */
+/* checksum to its end.                                                     */
+/****************************************************************************/
+
+static UINT32 Checksum( const UINT8 *pbyBlock )
+{
+   UINT32 dwHash = 2166136261U;
+   size_t tIndex;
+
+   for( tIndex = offsetof(REC_BLOCK_HEADER, llFirstTime); tIndex < REC_BLOCK_SIZE; tIndex++ )
+      dwHash = (dwHash ^ pbyBlock[tIndex]) * 16777619U;
+
+   return( dwHash );
+}
+
+/****************************************************************************/
+/* Encode() - Adds a column's value for the iSample'th sample of a block to */
+/* the column's data. A zero delta of delta only lengthens the current run, */
+/* which is written once a non-zero one ends it.                            */
+/****************************************************************************/
+
+static void Encode( P_REC_CODER pstCoder, UINT8 *pbyData, long long llValue, int iSample )
+{
+   long long llDelta = llValue - pstCoder->llLast;
+
+   if( iSample == 0 )
+   {
+      pstCoder->wLength += PutToken( pbyData + pstCoder->wLength, VALUE_TOKEN( llValue ) );
+      llDelta = 0;
+   }
+   else if( iSample == 1 )
+      pstCoder->wLength += PutToken( pbyData + pstCoder->wLength, VALUE_TOKEN( llDelta ) );
+   else if( llDelta == pstCoder->llDelta )
+      pstCoder->uRun++;
+   else
+   {
+      if( pstCoder->uRun )
+      {
+         pstCoder->wLength += PutToken( pbyData + pstCoder->wLength, RUN_TOKEN( pstCoder->uRun ) );
+         pstCoder->uRun     = 0;
+      }
+
+      pstCoder->wLength += PutToken( pbyData + pstCoder->wLength, VALUE_TOKEN( llDelta - pstCoder->llDelta ) );
+   }
+
+   pstCoder->llLast  = llValue;
+   pstCoder->llDelta = llDelta;
+}
+
+/****************************************************************************/
+/* EncodeSample() - Adds a sample to the block being filled                 */
+/****************************************************************************/
+
+static void EncodeSample( P_REC_WRITER pstWriter, long long llTime, const long long *pllValues )
+{
+   int iColumn, iSample = pstWriter->wSamples;
+
+   Encode( &pstWriter->stCoder[0], pstWriter->pbyData, llTime, iSample );
+
+   for( iColumn = 1; iColumn < pstWriter->iColumns; iColumn++ )
+      Encode( &pstWriter->stCoder[iColumn], pstWriter->pbyData + (iColumn * REC_CODER_SPACE), pllValues[iColumn - 1], iSample );
+
+   if( !iSample )
+      pstWriter->llFirstTime = llTime;
+
+   pstWriter->llLastTime = llTime;
+   pstWriter->wSamples++;
+}
+
+/****************************************************************************/
+/* BlockUsed() - Returns the size the block being filled would be written   */
+/* at, unused space aside.                                                  */
+/****************************************************************************/
+
+static size_t BlockUsed( P_REC_WRITER pstWriter )
+{
+   size_t tUsed = REC_BLOCK_HEADER_SIZE( pstWriter->iColumns );
+   int    iColumn;
+
+   for( iColumn = 0; iColumn < pstWriter->iColumns; iColumn++ )
+   {
+      tUsed += pstWriter->stCoder[iColumn].wLength;
+
+      if( pstWriter->stCoder[iColumn].uRun )
+         tUsed += TokenSize( RUN_TOKEN( pstWriter->stCoder[iColumn].uRun ) );
+   }
+
+   return( tUsed );
+}
+
+/****************************************************************************/
+/* WriteBlock() - Writes out the block being filled, as far as it has been  */
+/* filled, as block lBlock of the file. Runs not yet written are ended in   */
+/* the copy written, but are left to grow in the block being filled.        */
+/****************************************************************************/
+
+static BOOL WriteBlock( P_REC_WRITER pstWriter, long lBlock )
+{
+   UINT8              abyBlock[REC_BLOCK_SIZE];
+   P_REC_BLOCK_HEADER pstBlock = (P_REC_BLOCK_HEADER)abyBlock;
+   UINT16             *pwEnd   = pstBlock->wEnd;
+   P_REC_CODER        pstCoder;
+   size_t             tOffset  = REC_BLOCK_HEADER_SIZE( pstWriter->iColumns );
+   ssize_t            tWritten;
+   int                iColumn;
+
+   memset( abyBlock, 0, sizeof(abyBlock) );
+
+   pstBlock->dwSignature = REC_BLOCK_SIGNATURE;
+   pstBlock->llFirstTime = pstWriter->llFirstTime;
+   pstBlock->llLastTime  = pstWriter->llLastTime;
+   pstBlock->wSamples    = pstWriter->wSamples;
+   pstBlock->wColumns    = (UINT16)pstWriter->iColumns;
+
+   for( iColumn = 0; iColumn < pstWriter->iColumns; iColumn++ )
+   {
+      pstCoder = &pstWriter->stCoder[iColumn];
+
+      memcpy( abyBlock + tOffset, pstWriter->pbyData + (iColumn * REC_CODER_SPACE), pstCoder->wLength );
+      tOffset += pstCoder->wLength;
+
+      if( pstCoder->uRun )
+         tOffset += PutToken( abyBlock + tOffset, RUN_TOKEN( pstCoder->uRun ) );
+
+      pwEnd[iColumn] = (UINT16)tOffset;
+   }
+
+   pstBlock->dwChecksum = Checksum( abyBlock );
+
+   tWritten = pwrite( pstWriter->iFile, abyBlock, REC_BLOCK_SIZE, BLOCK_OFFSET( lBlock ) );
+
+   if( tWritten != REC_BLOCK_SIZE )
+   {
+      if( tWritten >= 0 )
+         errno = ENOSPC;
+
+      return( FALSE );
+   }
+
+   return( TRUE );
+}
+
+/****************************************************************************/
+/* NextBlock() - Writes out the block being filled and starts another. If   */
+/* copies of the block have been flushed (see RecFlush()), the whole block  */
+/* goes to the first of its two places, and reaches the disk before the     */
+/* next block can overwrite the copy left in the second. Should the latest  */
+/* copy be in the first place, the whole block is put in the second (and    */
+/* synced) before the first is overwritten.                                 */
+/****************************************************************************/
+
+static BOOL NextBlock( P_REC_WRITER pstWriter )
+{
+   if( !pstWriter->wSamples )
+      return( TRUE );
+
+   if( !pstWriter->wWritten )
+   {
+      if( !WriteBlock( pstWriter, pstWriter->lBlock ) )
+         return( FALSE );
+   }
+   else
+   {
+      if(    !pstWriter->iCopy
+          && (!WriteBlock( pstWriter, pstWriter->lBlock + 1 ) || fdatasync( pstWriter->iFile )) )
+      {
+         return( FALSE );
+      }
+
+      if( !WriteBlock( pstWriter, pstWriter->lBlock ) || fdatasync( pstWriter->iFile ) )
+         return( FALSE );
+   }
+
+   pstWriter->lBlock++;
+   pstWriter->wSamples = 0;
+   pstWriter->wWritten = 0;
+
+   memset( pstWriter->stCoder, 0, sizeof(pstWriter->stCoder) );
+   return( TRUE );
+}
+
+/****************************************************************************/
+/* RecOpenWrite() - Opens a recording for appending samples, creating it if */
+/* need be. The header given supplies the interval and the columns; those   */
+/* of an existing recording must match them. Only one writer may have a     */
+/* recording open at a time.                                                */
+/****************************************************************************/
+
+BOOL RecOpenWrite( const char *pszFile, const REC_FILE_HEADER *pstHeader, P_REC_WRITER *ppstWriter )
+{
+   UINT8              abyBlock[REC_BLOCK_SIZE];
+   P_REC_FILE_HEADER  pstFound = (P_REC_FILE_HEADER)abyBlock;
+   P_REC_WRITER       pstWriter;
+   struct stat        stStat;
+   ssize_t            tWritten;
+   long               lBlock;
+   int                iFile;
+
+   if( !pstHeader->wColumns || (pstHeader->wColumns > REC_MAX_COLUMNS) )
+   {
+      errno = EINVAL;
+      return( FALSE );
+   }
+
+   if( (iFile = open( pszFile, O_RDWR | O_CREAT | O_CLOEXEC, 0644 )) < 0 )
+      return( FALSE );
+
+   if( flock( iFile, LOCK_EX | LOCK_NB ) || fstat( iFile, &stStat ) )
+      return( CloseFailed( iFile ) );
+
+   if( stStat.st_size < REC_BLOCK_SIZE )
+   {
+      // A new recording (or one whose header never got written)
+
+      memset( abyBlock, 0, sizeof(abyBlock) );
+      memcpy( abyBlock, pstHeader, sizeof(REC_FILE_HEADER) );
+
+      pstFound->dwSignature = REC_SIGNATURE;
+      pstFound->wVersion    = REC_VERSION;
+      pstFound->wBlockSize  = REC_BLOCK_SIZE;
+
+      if( (tWritten = pwrite( iFile, abyBlock, REC_BLOCK_SIZE, 0 )) != REC_BLOCK_SIZE )
+      {
+         if( tWritten >= 0 )
+            errno = ENOSPC;
+
+         return( CloseFailed( iFile ) );
+      }
+
+      lBlock = 0;
+   }
+   else
+   {
+      // An existing recording, which must have the same interval and
+      // columns
+
+      if( pread( iFile, abyBlock, REC_BLOCK_SIZE, 0 ) != REC_BLOCK_SIZE )
+         return( CloseFailed( iFile ) );
+
+      if(    (pstFound->dwSignature != REC_SIGNATURE)
+          || (pstFound->wVersion    != REC_VERSION)
+          || (pstFound->wBlockSize  != REC_BLOCK_SIZE)
+          || (pstFound->dwInterval  != pstHeader->dwInterval)
+          || (pstFound->wColumns    != pstHeader->wColumns)
+          || memcmp( pstFound->stColumn, pstHeader->stColumn, pstHeader->wColumns * sizeof(REC_COLUMN) ) )
+      {
+         errno = EINVAL;
+         return( CloseFailed( iFile ) );
+      }
+
+      // New samples start a block of their own, after any whole blocks
+
+      lBlock = (long)(stStat.st_size / REC_BLOCK_SIZE) - 1;
+   }
+
+   if( (pstWriter = (P_REC_WRITER)calloc( 1, sizeof(REC_WRITER) )) == NULL )
+      return( CloseFailed( iFile ) );
+
+   if( (pstWriter->pbyData = (UINT8 *)malloc( (pstHeader->wColumns + 1) * REC_CODER_SPACE )) == NULL )
+   {
+      free( pstWriter );
+      return( CloseFailed( iFile ) );
+   }
+
+   pstWriter->iFile    = iFile;
+   pstWriter->iColumns = pstHeader->wColumns + 1;
+   pstWriter->lBlock   = lBlock;
+
+   *ppstWriter = pstWriter;
+   return( TRUE );
+}
+
+/****************************************************************************/
+/* RecAppend() - Appends a sample to a recording. The values are given in   */
+/* the order of the columns, and they and the time must lie within +/-      */
+/* REC_MAX_VALUE. A sample that does not fit in the block being filled is   */
+/* put at the start of the next, once the block is written out.             */
+/****************************************************************************/
+
+BOOL RecAppend( P_REC_WRITER pstWriter, long long llTime, const long long *pllValues )
+{
+   REC_CODER stSaved[REC_MAX_COLUMNS + 1];
+   long long llLastTime;
+   int       iColumn;
+
+   if( (llTime < -REC_MAX_VALUE) || (llTime >= REC_MAX_VALUE) )
+   {
+      errno = EINVAL;
+      return( FALSE );
+   }
+
+   for( iColumn = 0; iColumn < pstWriter->iColumns - 1; iColumn++ )
+   {
+      if( (pllValues[iColumn] < -REC_MAX_VALUE) || (pllValues[iColumn] >= REC_MAX_VALUE) )
+      {
+         errno = EINVAL;
+         return( FALSE );
+      }
+   }
+
+   if( (pstWriter->wSamples == REC_BLOCK_SAMPLES) && !NextBlock( pstWriter ) )
+      return( FALSE );
+
+   memcpy( stSaved, pstWriter->stCoder, pstWriter->iColumns * sizeof(REC_CODER) );
+   llLastTime = pstWriter->llLastTime;
+
+   EncodeSample( pstWriter, llTime, pllValues );
+
+   if( BlockUsed( pstWriter ) > REC_BLOCK_SIZE )
+   {
+      memcpy( pstWriter->stCoder, stSaved, pstWriter->iColumns * sizeof(REC_CODER) );
+      pstWriter->llLastTime = llLastTime;
+      pstWriter->wSamples--;
+
+      if( !NextBlock( pstWriter ) )
+         return( FALSE );
+
+      EncodeSample( pstWriter, llTime, pllValues );
+   }
+
+   return( TRUE );
+}
+
+/****************************************************************************/
+/* RecFlush() - Writes out the block being filled, as far as it has been    */
+/* filled, and waits for it to reach the disk. Samples appended after this  */
+/* go on filling the same block. So that a write torn part way through can  */
+/* only lose samples that had not reached the disk, copies of the block are */
+/* written alternately to two places, the block's own and the one after it: */
+/* each overwrites the older copy, never the latest. Readers use whichever  */
+/* intact copy holds the most samples (see RecGetBlock()).                  */
+/****************************************************************************/
+
+BOOL RecFlush( P_REC_WRITER pstWriter )
+{
+   int iCopy = pstWriter->wWritten ? !pstWriter->iCopy : 0;
+
+   if( pstWriter->wSamples != pstWriter->wWritten )
+   {
+      if( !WriteBlock( pstWriter, pstWriter->lBlock + iCopy ) )
+         return( FALSE );
+
+      pstWriter->iCopy    = iCopy;
+      pstWriter->wWritten = pstWriter->wSamples;
+   }
+
+   return( fdatasync( pstWriter->iFile ) == 0 );
+}
+
+/****************************************************************************/
+/* RecCloseWrite() - Flushes and closes a recording opened for appending    */
+/****************************************************************************/
+
+BOOL RecCloseWrite( P_REC_WRITER pstWriter )
+{
+   BOOL bSuccess = RecFlush( pstWriter );
+   int  iErrno   = errno;
+
+   close( pstWriter->iFile );
+   free( pstWriter->pbyData );
+   free( pstWriter );
+
+   errno = iErrno;
+   return( bSuccess );
+}
+
+/****************************************************************************/
+/* RecOpenRead() - Maps a recording into memory for reading. Samples added  */
+/* to the recording after this are not seen.                                */
+/****************************************************************************/
+
+BOOL RecOpenRead( const char *pszFile, P_REC_READER pstReader )
+{
+   const REC_FILE_HEADER *pstHeader;
+   struct stat           stStat;
+   void                  *pvMap;
+
+   memset( pstReader, 0, sizeof(REC_READER) );
+
+   if( (pstReader->iFile = open( pszFile, O_RDONLY | O_CLOEXEC )) < 0 )
+      return( FALSE );
+
+   if( fstat( pstReader->iFile, &stStat ) )
+      return( CloseFailed( pstReader->iFile ) );
+
+   if( stStat.st_size < REC_BLOCK_SIZE )
+   {
+      errno = EINVAL;
+      return( CloseFailed( pstReader->iFile ) );
+   }
+
+   pvMap = mmap( NULL, (size_t)stStat.st_size, PROT_READ, MAP_SHARED, pstReader->iFile, 0 );
+
+   if( pvMap == MAP_FAILED )
+      return( CloseFailed( pstReader->iFile ) );
+
+   pstHeader = (const REC_FILE_HEADER *)pvMap;
+
+   if(    (pstHeader->dwSignature != REC_SIGNATURE)
+       || (pstHeader->wVersion    != REC_VERSION)
+       || (pstHeader->wBlockSize  != REC_BLOCK_SIZE)
+       || !pstHeader->wColumns
+       || (pstHeader->wColumns    >  REC_MAX_COLUMNS) )
+   {
+      munmap( pvMap, (size_t)stStat.st_size );
+      errno = EINVAL;
+      return( CloseFailed( pstReader->iFile ) );
+   }
+
+   pstReader->tSize     = (size_t)stStat.st_size;
+   pstReader->pbyMap    = (const UINT8 *)pvMap;
+   pstReader->pstHeader = pstHeader;
+   pstReader->lBlocks   = (long)(pstReader->tSize / REC_BLOCK_SIZE) - 1;
+
+   return( TRUE );
+}
+
+/****************************************************************************/
+/* RecCloseRead() - Unmaps a recording opened for reading                   */
+/****************************************************************************/
+
+void RecCloseRead( P_REC_READER pstReader )
+{
+   munmap( (void *)pstReader->pbyMap, pstReader->tSize );
+   close( pstReader->iFile );
+   memset( pstReader, 0, sizeof(REC_READER) );
+}
+
+/****************************************************************************/
+/* CheckBlock() - Returns the address of a block of samples, or NULL (and   */
+/* errno EBADMSG) if it fails its checks, as a copy of the block being      */
+/* filled will if it was caught part way through being written.             */
+/****************************************************************************/
+
+static const REC_BLOCK_HEADER *CheckBlock( P_REC_READER pstReader, long lBlock )
+{
+   const REC_BLOCK_HEADER *pstBlock;
+   const UINT16           *pwEnd;
+   const UINT8            *pbyBlock;
+   size_t                 tStart;
+   int                    iColumn;
+
+   pbyBlock = pstReader->pbyMap + BLOCK_OFFSET( lBlock );
+   pstBlock = (const REC_BLOCK_HEADER *)pbyBlock;
+   pwEnd    = pstBlock->wEnd;
+
+   if(    (pstBlock->dwSignature != REC_BLOCK_SIGNATURE)
+       || (pstBlock->wColumns    != pstReader->pstHeader->wColumns + 1)
+       || !pstBlock->wSamples
+       || (pstBlock->wSamples    >  REC_BLOCK_SAMPLES)
+       || (pstBlock->dwChecksum  != Checksum( pbyBlock )) )
+   {
+      errno = EBADMSG;
+      return( NULL );
+   }
+
+   // Each column's data must follow the last's, within the block
+
+   tStart = REC_BLOCK_HEADER_SIZE( pstBlock->wColumns );
+
+   for( iColumn = 0; iColumn < pstBlock->wColumns; iColumn++ )
+   {
+      if( (pwEnd[iColumn] < tStart) || (pwEnd[iColumn] > REC_BLOCK_SIZE) )
+      {
+         errno = EBADMSG;
+         return( NULL );
+      }
+
+      tStart = pwEnd[iColumn];
+   }
+
+   return( pstBlock );
+}
+
+/****************************************************************************/
+/* RecGetBlock() - Returns the address of a block of samples, or NULL if it */
+/* fails its checks (errno EBADMSG) or is a copy of the block that was      */
+/* being filled that another copy next to it supersedes (errno ESTALE, see  */
+/* RecFlush()). Of two intact copies, the one holding more samples, or the  */
+/* first if they hold the same, is used.                                    */
+/****************************************************************************/
+
+const REC_BLOCK_HEADER *RecGetBlock( P_REC_READER pstReader, long lBlock )
+{
+   const REC_BLOCK_HEADER *pstBlock, *pstOther;
+   long                   lOther;
+
+   if( (lBlock < 0) || (lBlock >= pstReader->lBlocks) )
+   {
+      errno = EINVAL;
+      return( NULL );
+   }
+
+   if( (pstBlock = CheckBlock( pstReader, lBlock )) == NULL )
+      return( NULL );
+
+   for( lOther = lBlock - 1; lOther <= lBlock + 1; lOther += 2 )
+   {
+      if( (lOther < 0) || (lOther >= pstReader->lBlocks) )
+         continue;
+
+      pstOther = (const REC_BLOCK_HEADER *)(pstReader->pbyMap + BLOCK_OFFSET( lOther ));
+
+      if(    (pstOther->llFirstTime == pstBlock->llFirstTime)
+          && (   (pstOther->wSamples > pstBlock->wSamples)
+              || ((pstOther->wSamples == pstBlock->wSamples) && (lOther < lBlock)))
+          && CheckBlock( pstReader, lOther ) )
+      {
+         errno = ESTALE;
+         return( NULL );
+      }
+   }
+
+   return( pstBlock );
+}
+
+/****************************************************************************/
+/* RecFindBlock() - Returns the number of the block at which to start       */
+/* reading the samples taken from a given time on: the last block to start  */
+/* no later than the time (or the first of its copies), or the first block  */
+/* if none does. Blocks are searched by their first times, which only go    */
+/* back if the clock is set back, and without being checked, which          */
+/* RecGetBlock() is left to do.                                             */
+/****************************************************************************/
+
+long RecFindBlock( P_REC_READER pstReader, long long llTime )
+{
+   const REC_BLOCK_HEADER *pstBlock, *pstPrior;
+   long                   lLow = 0, lHigh = pstReader->lBlocks, lMiddle;
+
+   while( lLow < lHigh )
+   {
+      lMiddle  = lLow + ((lHigh - lLow) / 2);
+      pstBlock = (const REC_BLOCK_HEADER *)(pstReader->pbyMap + BLOCK_OFFSET( lMiddle ));
+
+      if( pstBlock->llFirstTime <= llTime )
+         lLow  = lMiddle + 1;
+      else
+         lHigh = lMiddle;
+   }
+
+   if( !lLow-- )
+      return( 0 );
+
+   // The two copies of a block share its first time; start at the first
+
+   if( lLow )
+   {
+      pstBlock = (const REC_BLOCK_HEADER *)(pstReader->pbyMap + BLOCK_OFFSET( lLow ));
+      pstPrior = (const REC_BLOCK_HEADER *)(pstReader->pbyMap + BLOCK_OFFSET( lLow - 1 ));
+
+      if( pstPrior->llFirstTime == pstBlock->llFirstTime )
+         lLow--;
+   }
+
+   return( lLow );
+}
+
+/****************************************************************************/
+/* RecDecode() - Decodes the values of one column (0 for the times) of a    */
+/* block returned by RecGetBlock(), which pllValues must have room for.     */
+/* Returns the number of samples decoded, or -1 (and errno EBADMSG) if the  */
+/* column's data does not decode.                                           */
+/****************************************************************************/
+
+int RecDecode( const REC_BLOCK_HEADER *pstBlock, int iColumn, long long *pllValues )
+{
+   const UINT16       *pwEnd   = pstBlock->wEnd;
+   const UINT8        *pbyData = (const UINT8 *)pstBlock;
+   const UINT8        *pbyEnd  = (const UINT8 *)pstBlock + pwEnd[iColumn];
+   unsigned long long ullToken;
+   long long          llValue  = 0, llDelta = 0;
+   unsigned long long ullRun   = 0;
+   int                iSample;
+
+   pbyData += iColumn ? pwEnd[iColumn - 1] : REC_BLOCK_HEADER_SIZE( pstBlock->wColumns );
+
+   for( iSample = 0; iSample < pstBlock->wSamples; iSample++ )
+   {
+      if( ullRun )
+         ullRun--;
+      else
+      {
+         if( !GetToken( &pbyData, pbyEnd, &ullToken ) )
+         {
+            errno = EBADMSG;
+            return( -1 );
+         }
+
+         if( ullToken & 1 )
+         {
+            // A run of zero deltas of deltas, this sample's the first
+
+            if( (iSample < 2) || !(ullToken >> 1) )
+            {
+               errno = EBADMSG;
+               return( -1 );
+            }
+
+            ullRun = (ullToken >> 1) - 1;
+         }
+         else if( iSample == 0 )
+            llValue  = UNZIGZAG( ullToken >> 1 );
+         else if( iSample == 1 )
+            llDelta  = UNZIGZAG( ullToken >> 1 );
+         else
+            llDelta += UNZIGZAG( ullToken >> 1 );
+      }
+
+      if( iSample )
+         llValue += llDelta;
+
+      pllValues[iSample] = llValue;
+   }
+
+   return( pstBlock->wSamples );
+}
+
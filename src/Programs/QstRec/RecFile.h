@@ -0,0 +1,234 @@
+/****************************************************************************/
+/*                                                                          */
+/*  Module:         RecFile.h                                               */
+/*                                                                          */
+/*  Description:    Provides definitions and prototypes  for  reading  and  */
+/*                  writing the files kept by the  QstRec  sensor  history  */
+/*                  recorder:  append-only,  block-structured   files   of  */
+/*                  samples,  each  column  compressed  by  delta-of-delta  */
+/*                  coding of the fixed-point readings reported by the QST  */
+/*                  Subsystem.                                              */
+/*                                                                          */
+/*  Functions:      RecOpenWrite()  - Opens  a  recording  for   appending  */
+/*                                    samples, creating it if need be.      */
+/*                                                                          */
+/*                  RecAppend()     - Appends a  sample  to  a  recording,  */
+/*                                    writing out the block  being  filled  */
+/*                                    once it is full.                      */
+/*                                                                          */
+/*                  RecFlush()      - Writes out the block  being  filled,  */
+/*                                    as far as it has  been  filled,  and  */
+/*                                    waits for it to reach the disk.       */
+/*                                                                          */
+/*                  RecCloseWrite() - Flushes  and  closes   a   recording  */
+/*                                    opened for appending.                 */
+/*                                                                          */
+/*                  RecOpenRead()   - Maps a  recording  into  memory  for  */
+/*                                    reading.                              */
+/*                                                                          */
+/*                  RecCloseRead()  - Unmaps  a   recording   opened   for  */
+/*                                    reading.                              */
+/*                                                                          */
+/*                  RecGetBlock()   - Returns the address of  a  block  of  */
+/*                                    samples, if it is intact.             */
+/*                                                                          */
+/*                  RecFindBlock()  - Returns the number of the  block  at  */
+/*                                    which to start reading  the  samples  */
+/*                                    taken from a given time on.           */
+/*                                                                          */
+/*                  RecDecode()     - Decodes the values of one column  of  */
+/*                                    a block of samples.                   */
+/*                                                                          */
+/****************************************************************************/
+
+/****************************************************************************/
+/*                                                                          */
+/*     Copyright (c) 2005-2009, Intel Corporation. All Rights Reserved.     */
+/*                                                                          */
+/*  Redistribution and use in source and binary  forms,  with  or  without  */
+/*  modification, are permitted provided that the following conditions are  */
+/*  met:                                                                    */
+/*                                                                          */
+/*    - Redistributions of source code must  retain  the  above  copyright  */
+/*      notice, this list of conditions and the following disclaimer.       */
+/*                                                                          */
+/*    - Redistributions  in binary form must reproduce the above copyright  */
+/*      notice, this list of conditions and the  following  disclaimer  in  */
+/*      the   documentation  and/or  other  materials  provided  with  the  */
+/*      distribution.                                                       */
+/*                                                                          */
+/*    - Neither the name  of  Intel  Corporation  nor  the  names  of  its  */
+/*      contributors  may  be  used to endorse or promote products derived  */
+/*      from this software without specific prior written permission.       */
+/*                                                                          */
+/*  DISCLAIMER: THIS SOFTWARE IS PROVIDED BY  THE  COPYRIGHT  HOLDERS  AND  */
+/*  CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  */
+/*  BUT  NOT  LIMITED  TO,  THE  IMPLIED WARRANTIES OF MERCHANTABILITY AND  */
+/*  FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN  NO  EVENT  SHALL  */
+/*  INTEL  CORPORATION  OR  THE  CONTRIBUTORS  BE  LIABLE  FOR ANY DIRECT,  */
+/*  INDIRECT, INCIDENTAL, SPECIAL,  EXEMPLARY,  OR  CONSEQUENTIAL  DAMAGES  */
+/*  (INCLUDING,  BUT  NOT  LIMITED  TO, PROCUREMENT OF SUBSTITUTE GOODS OR  */
+/*  SERVICES; LOSS OF USE, DATA, OR  PROFITS;  OR  BUSINESS  INTERRUPTION)  */
+/*  HOWEVER  CAUSED  AND  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,  */
+/*  STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)  ARISING  */
+/*  IN  ANY  WAY  OUT  OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE  */
+/*  POSSIBILITY OF SUCH DAMAGE.                                             */
+/*                                                                          */
+/****************************************************************************/
+
+#ifndef _RECFILE_H
+#define _RECFILE_H
+
+#include <stddef.h>
+#include "QstCmd.h"
+#include "typedef.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#pragma pack(1)
+
+/****************************************************************************/
+/* File layout. A recording is a file of REC_BLOCK_SIZE blocks, so that it  */
+/* can be mapped into memory and any block found from its number. The first */
+/* block holds the REC_FILE_HEADER, which lists the columns: each sample    */
+/* holds a time and one value per column. Every later block holds a run of  */
+/* samples. It begins with a REC_BLOCK_HEADER, whose times let a block be   */
+/* found by a binary search, followed by the offset at which each column's  */
+/* data ends (times first) and then by the data itself, column by column.   */
+/* Blocks are only ever added at the end of the file. While the last block  */
+/* fills, copies of it are flushed alternately to its own place and the     */
+/* next, so a torn write can only lose samples not yet flushed. The whole   */
+/* block then goes in its own place and the next block overwrites the other */
+/* copy, but a block left unfinished keeps both; readers take the one       */
+/* holding more samples. A copy caught part way through being written fails */
+/* its checksum and is skipped.                                             */
+/****************************************************************************/
+
+#define REC_SIGNATURE           0x52545351  // "QSTR"
+#define REC_BLOCK_SIGNATURE     0x42545351  // "QSTB"
+#define REC_VERSION             1
+
+#define REC_BLOCK_SIZE          4096        // Size of every block
+#define REC_BLOCK_SAMPLES       4096        // Most samples held by a block
+
+#define REC_MAX_COLUMNS         (QST_ABS_TEMP_MONITORS + QST_ABS_FAN_MONITORS + QST_ABS_VOLT_MONITORS + QST_ABS_CURR_MONITORS + QST_ABS_FAN_CONTROLLERS)
+
+// Classes of column, with the units of their values
+
+#define REC_TEMP                0           // Temperature (hundredths of a degree C)
+#define REC_FAN                 1           // Fan speed (RPM)
+#define REC_VOLT                2           // Voltage (mV)
+#define REC_CURR                3           // Current (mA)
+#define REC_DUTY                4           // Fan controller duty cycle (hundredths of a percent)
+#define REC_CLASSES             5
+
+typedef struct _REC_COLUMN
+{
+   UINT8                        byClass;    // REC_TEMP etc.
+   UINT8                        byIndex;    // Subsystem's index of the sensor or controller
+   UINT8                        byUsage;    // Its usage, as reported in its configuration
+
+}  REC_COLUMN, *P_REC_COLUMN;
+
+typedef struct _REC_FILE_HEADER
+{
+   UINT32                       dwSignature;
+   UINT16                       wVersion;
+   UINT16                       wBlockSize;
+   UINT32                       dwInterval; // Time between samples (ms)
+   UINT16                       wColumns;   // Columns of values
+   REC_COLUMN                   stColumn[REC_MAX_COLUMNS];
+
+}  REC_FILE_HEADER, *P_REC_FILE_HEADER;
+
+typedef struct _REC_BLOCK_HEADER
+{
+   UINT32                       dwSignature;
+   UINT32                       dwChecksum; // Of the rest of the block
+   long long                    llFirstTime;// Time of first sample (ms since the Epoch)
+   long long                    llLastTime; // Time of last sample
+   UINT16                       wSamples;
+   UINT16                       wColumns;   // Columns, times included
+   UINT16                       wEnd[1];    // Offset of the end of each column's data
+
+}  REC_BLOCK_HEADER, *P_REC_BLOCK_HEADER;
+
+#define REC_BLOCK_HEADER_SIZE(Columns)  (offsetof(REC_BLOCK_HEADER, wEnd) + ((Columns) * sizeof(UINT16)))
+
+C_ASSERT(sizeof(REC_FILE_HEADER) <= REC_BLOCK_SIZE);
+
+/****************************************************************************/
+/* Column encoding. Values are the QST Subsystem's own fixed-point integers */
+/* (hundredths of a degree C, RPM, mV, mA and hundredths of a percent), so  */
+/* they are kept exactly. Within a block, a column holds its first value,   */
+/* then the change from that to the second, then, for each later sample,    */
+/* the change in the change (the delta of delta). The delta of delta is     */
+/* zero while a reading holds steady or changes steadily. Each number is    */
+/* zigzag coded (0, -1, 1, -2 .. becoming 0, 1, 2, 3 ..) and shifted left   */
+/* one bit. It is then written 7 bits a byte, low bits first, with the top  */
+/* bit set in every byte but the last. A run of zero deltas of deltas is    */
+/* written instead as one count, shifted left with the low bit set.         */
+/****************************************************************************/
+
+#define REC_MAX_VALUE           (1LL << 60) // Values and times lie within +/- this
+#define REC_MAX_TOKEN           10          // Longest number written (bytes)
+#define REC_CODER_SPACE         (REC_BLOCK_SIZE + (2 * REC_MAX_TOKEN))
+
+typedef struct _REC_CODER
+{
+   long long                    llLast;     // Previous value
+   long long                    llDelta;    // Previous change
+   UINT32                       uRun;       // Zero deltas of deltas not yet written
+   UINT16                       wLength;    // Bytes written
+
+}  REC_CODER, *P_REC_CODER;
+
+typedef struct _REC_WRITER
+{
+   int                          iFile;
+   int                          iColumns;   // Columns, times included
+   long                         lBlock;     // Block being filled (0 is the first after the header)
+   UINT16                       wSamples;   // Samples in it
+   UINT16                       wWritten;   // Samples in the latest copy of it written (0 if none)
+   int                          iCopy;      // Place that copy went to (see RecFlush())
+   long long                    llFirstTime;
+   long long                    llLastTime;
+   REC_CODER                    stCoder[REC_MAX_COLUMNS + 1];
+   UINT8                        *pbyData;   // REC_CODER_SPACE bytes of data per column
+
+}  REC_WRITER, *P_REC_WRITER;
+
+typedef struct _REC_READER
+{
+   int                          iFile;
+   size_t                       tSize;
+   const UINT8                  *pbyMap;
+   const REC_FILE_HEADER        *pstHeader;
+   long                         lBlocks;    // Blocks of samples
+
+}  REC_READER, *P_REC_READER;
+
+#pragma pack()
+
+/****************************************************************************/
+/* Function Prototypes                                                      */
+/****************************************************************************/
+
+BOOL RecOpenWrite( const char *pszFile, const REC_FILE_HEADER *pstHeader, P_REC_WRITER *ppstWriter );
+BOOL RecAppend( P_REC_WRITER pstWriter, long long llTime, const long long *pllValues );
+BOOL RecFlush( P_REC_WRITER pstWriter );
+BOOL RecCloseWrite( P_REC_WRITER pstWriter );
+
+BOOL RecOpenRead( const char *pszFile, P_REC_READER pstReader );
+void RecCloseRead( P_REC_READER pstReader );
+const REC_BLOCK_HEADER *RecGetBlock( P_REC_READER pstReader, long lBlock );
+long RecFindBlock( P_REC_READER pstReader, long long llTime );
+int  RecDecode( const REC_BLOCK_HEADER *pstBlock, int iColumn, long long *pllValues );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ndef _RECFILE_H
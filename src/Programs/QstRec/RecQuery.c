@@ -0,0 +1,584 @@
+/****************************************************************************/
+/*                                                                          */
+/*  Module:         RecQuery.c                                              */
+/*                                                                          */
+/*  Description:    Implements program  RecQuery,  which  reads  back  the  */
+/*                  recordings  made  by  program  QstRec:  listing  their  */
+/*                  columns and extent, or displaying  the  samples  taken  */
+/*                  over  a  range  of  time,  either   as   recorded   or  */
+/*                  downsampled to the mean, minimum or  maximum  of  each  */
+/*                  period.                                                 */
+/*                                                                          */
+/****************************************************************************/
+/*                                                                          */
+/*     Copyright (c) 2005-2009, Intel Corporation. All Rights Reserved.     */
+/*                                                                          */
+/*  Redistribution and use in source and binary  forms,  with  or  without  */
+/*  modification, are permitted provided that the following conditions are  */
+/*  met:                                                                    */
+/*                                                                          */
+/*    - Redistributions of source code must  retain  the  above  copyright  */
+/*      notice, this list of conditions and the following disclaimer.       */
+/*                                                                          */
+/*    - Redistributions  in binary form must reproduce the above copyright  */
+/*      notice, this list of conditions and the  following  disclaimer  in  */
+/*      the   documentation  and/or  other  materials  provided  with  the  */
+/*      distribution.                                                       */
+/*                                                                          */
+/*    - Neither the name  of  Intel  Corporation  nor  the  names  of  its  */
+/*      contributors  may  be  used to endorse or promote products derived  */
+/*      from this software without specific prior written permission.       */
+/*                                                                          */
+/*  DISCLAIMER: THIS SOFTWARE IS PROVIDED BY  THE  COPYRIGHT  HOLDERS  AND  */
+/*  CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  */
+/*  BUT  NOT  LIMITED  TO,  THE  IMPLIED WARRANTIES OF MERCHANTABILITY AND  */
+/*  FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN  NO  EVENT  SHALL  */
+/*  INTEL  CORPORATION  OR  THE  CONTRIBUTORS  BE  LIABLE  FOR ANY DIRECT,  */
+/*  INDIRECT, INCIDENTAL, SPECIAL,  EXEMPLARY,  OR  CONSEQUENTIAL  DAMAGES  */
+/*  (INCLUDING,  BUT  NOT  LIMITED  TO, PROCUREMENT OF SUBSTITUTE GOODS OR  */
+/*  SERVICES; LOSS OF USE, DATA, OR  PROFITS;  OR  BUSINESS  INTERRUPTION)  */
+/*  HOWEVER  CAUSED  AND  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,  */
+/*  STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)  ARISING  */
+/*  IN  ANY  WAY  OUT  OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE  */
+/*  POSSIBILITY OF SUCH DAMAGE.                                             */
+/*                                                                          */
+/****************************************************************************/
+
+#ifndef __linux__
+#error This source module intended for use in Linux environments only
+#endif
+
+#define _GNU_SOURCE                     // For strptime()
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "QstCmd.h"
+#include "UsageStr.h"
+#include "RecFile.h"
+
+/****************************************************************************/
+/* Definitions                                                              */
+/****************************************************************************/
+
+#define SHOW_MEAN           0           // Functions forming downsampled rows
+#define SHOW_MIN            1
+#define SHOW_MAX            2
+
+static const struct
+{
+   char     cName;                      // Letter naming columns of the class
+   double   dScale;                     // Subsystem's fixed-point units per unit
+   int      iDecimals;                  // Decimal places displayed
+   const char *pszUnits;                // Units displayed
+   char     *(*pfnUsage)( int );        // Returns description of usage
+
+} stClass[REC_CLASSES] =
+{
+   { 'T', 100,  2, "C",   GetTempUsageStr },
+   { 'F', 1,    0, "RPM", GetFanUsageStr  },
+   { 'V', 1000, 3, "V",   GetVoltUsageStr },
+   { 'C', 1000, 3, "A",   GetCurrUsageStr },
+   { 'D', 100,  2, "%",   GetCtrlUsageStr }
+};
+
+static const char * const pszFunction[] = { "mean", "min", "max" };
+
+/****************************************************************************/
+/* Variables                                                                */
+/****************************************************************************/
+
+static REC_READER           stReader;                               // Recording
+static char                 szName[REC_MAX_COLUMNS][8];             // Names of its columns
+static int                  aiColumn[REC_MAX_COLUMNS];              // Columns displayed
+static int                  iColumns = 0;
+static long long            allTime[REC_BLOCK_SAMPLES];             // Decoded block
+static long long            allValue[REC_MAX_COLUMNS][REC_BLOCK_SAMPLES];
+static double               adTotal[REC_MAX_COLUMNS];               // Period being downsampled
+static long long            allMin[REC_MAX_COLUMNS];
+static long long            allMax[REC_MAX_COLUMNS];
+
+/****************************************************************************/
+/* NameColumns() - Names the columns of the recording by class and position */
+/* within the class: T0, T1 .. F0 .. V0 .. C0 .. D0 ..                      */
+/****************************************************************************/
+
+static void NameColumns( void )
+{
+   const REC_FILE_HEADER *pstHeader = stReader.pstHeader;
+   int                   iCount[REC_CLASSES];
+   int                   iColumn, iClass;
+
+   memset( iCount, 0, sizeof(iCount) );
+
+   for( iColumn = 0; iColumn < pstHeader->wColumns; iColumn++ )
+   {
+      iClass = pstHeader->stColumn[iColumn].byClass % REC_CLASSES;
+      sprintf( szName[iColumn], "%c%d", stClass[iClass].cName, iCount[iClass]++ );
+   }
+}
+
+/****************************************************************************/
+/* SelectColumns() - Selects the columns named in a comma-separated list    */
+/****************************************************************************/
+
+static BOOL SelectColumns( char *pszList )
+{
+   const REC_FILE_HEADER *pstHeader = stReader.pstHeader;
+   char                  *pszName, *pszSave;
+   int                   iColumn;
+
+   for( pszName = strtok_r( pszList, ",", &pszSave ); pszName; pszName = strtok_r( NULL, ",", &pszSave ) )
+   {
+      for( iColumn = 0; iColumn < pstHeader->wColumns; iColumn++ )
+      {
+         if( !strcasecmp( pszName, szName[iColumn] ) )
+            break;
+      }
+
+      if( (iColumn == pstHeader->wColumns) || (iColumns == REC_MAX_COLUMNS) )
+      {
+         printf( "\n*** No column %s in recording!!\n\n", pszName );
+         return( FALSE );
+      }
+
+      aiColumn[iColumns++] = iColumn;
+   }
+
+   return( iColumns != 0 );
+}
+
+/****************************************************************************/
+/* ParseTime() - Converts a time, given as seconds since the Epoch or as a  */
+/* local time (YYYY-MM-DD, with HH:MM or HH:MM:SS optionally following) to  */
+/* milliseconds since the Epoch.                                            */
+/****************************************************************************/
+
+static BOOL ParseTime( const char *pszTime, long long *pllTime )
+{
+   static const char * const pszFormat[] = { "%Y-%m-%d %H:%M:%S", "%Y-%m-%d %H:%M", "%Y-%m-%d" };
+   struct tm                 stTime;
+   const char                *pszEnd;
+   char                      *pszNumberEnd;
+   size_t                    tFormat;
+   time_t                    tTime;
+
+   *pllTime = strtoll( pszTime, &pszNumberEnd, 10 );
+
+   if( (pszNumberEnd != pszTime) && !*pszNumberEnd )
+   {
+      *pllTime *= 1000;
+      return( TRUE );
+   }
+
+   for( tFormat = 0; tFormat < sizeof(pszFormat) / sizeof(pszFormat[0]); tFormat++ )
+   {
+      memset( &stTime, 0, sizeof(stTime) );
+      pszEnd = strptime( pszTime, pszFormat[tFormat], &stTime );
+
+      if( pszEnd && !*pszEnd )
+      {
+         stTime.tm_isdst = -1;
+
+         if( (tTime = mktime( &stTime )) == (time_t)-1 )
+            break;
+
+         *pllTime = (long long)tTime * 1000;
+         return( TRUE );
+      }
+   }
+
+   printf( "\n*** Invalid time %s!!\n\n", pszTime );
+   return( FALSE );
+}
+
+/****************************************************************************/
+/* FormatTime() - Formats a time as a local time, to the millisecond if so  */
+/* requested.                                                               */
+/****************************************************************************/
+
+static char *FormatTime( long long llTime, BOOL bMilliseconds, char *pszTime, size_t tSize )
+{
+   time_t    tTime = (time_t)(llTime / 1000);
+   struct tm stTime;
+   size_t    tLength;
+
+   localtime_r( &tTime, &stTime );
+   tLength = strftime( pszTime, tSize, "%Y-%m-%d %H:%M:%S", &stTime );
+
+   if( bMilliseconds )
+      snprintf( pszTime + tLength, tSize - tLength, ".%03d", (int)(llTime % 1000) );
+
+   return( pszTime );
+}
+
+/****************************************************************************/
+/* ShowHeading() - Displays the heading of the columns displayed            */
+/****************************************************************************/
+
+static void ShowHeading( BOOL bMilliseconds )
+{
+   int iIndex;
+
+   printf( bMilliseconds ? "%-23s" : "%-19s", "Time" );
+
+   for( iIndex = 0; iIndex < iColumns; iIndex++ )
+      printf( " %10s", szName[aiColumn[iIndex]] );
+
+   putchar( '\n' );
+}
+
+/****************************************************************************/
+/* ShowValue() - Displays a value of one of the columns displayed, given in */
+/* the Subsystem's fixed-point units.                                       */
+/****************************************************************************/
+
+static void ShowValue( int iIndex, double dValue )
+{
+   int iClass = stReader.pstHeader->stColumn[aiColumn[iIndex]].byClass % REC_CLASSES;
+
+   printf( " %10.*f", stClass[iClass].iDecimals, dValue / stClass[iClass].dScale );
+}
+
+/****************************************************************************/
+/* ShowPeriod() - Displays the row formed from the samples of a period      */
+/****************************************************************************/
+
+static void ShowPeriod( long long llPeriod, long lSamples, int iFunction )
+{
+   char szTime[32];
+   int  iIndex;
+
+   printf( "%-19s", FormatTime( llPeriod, FALSE, szTime, sizeof(szTime) ) );
+
+   for( iIndex = 0; iIndex < iColumns; iIndex++ )
+   {
+      switch( iFunction )
+      {
+      case SHOW_MIN:
+
+         ShowValue( iIndex, (double)allMin[iIndex] );
+         break;
+
+      case SHOW_MAX:
+
+         ShowValue( iIndex, (double)allMax[iIndex] );
+         break;
+
+      default:
+
+         ShowValue( iIndex, adTotal[iIndex] / lSamples );
+         break;
+      }
+   }
+
+   putchar( '\n' );
+}
+
+/****************************************************************************/
+/* ListRecording() - Displays the columns and extent of the recording       */
+/****************************************************************************/
+
+static void ListRecording( void )
+{
+   const REC_FILE_HEADER  *pstHeader = stReader.pstHeader;
+   const REC_BLOCK_HEADER *pstBlock;
+   const REC_COLUMN       *pstColumn;
+   long long              llFirst = 0, llLast = 0, llSamples = 0;
+   long                   lBlock, lDamaged = 0;
+   char                   szTime[32];
+   int                    iColumn, iClass;
+
+   for( lBlock = 0; lBlock < stReader.lBlocks; lBlock++ )
+   {
+      if( (pstBlock = RecGetBlock( &stReader, lBlock )) == NULL )
+      {
+         if( errno != ESTALE )
+            lDamaged++;
+
+         continue;
+      }
+
+      if( !llSamples )
+         llFirst = pstBlock->llFirstTime;
+
+      llLast     = pstBlock->llLastTime;
+      llSamples += pstBlock->wSamples;
+   }
+
+   printf( "Interval:     %u ms\n", (unsigned)pstHeader->dwInterval );
+   printf( "Blocks:       %ld (%ld damaged)\n", stReader.lBlocks, lDamaged );
+   printf( "Samples:      %lld\n", llSamples );
+
+   if( llSamples )
+   {
+      printf( "First:        %s\n", FormatTime( llFirst, TRUE, szTime, sizeof(szTime) ) );
+      printf( "Last:         %s\n", FormatTime( llLast,  TRUE, szTime, sizeof(szTime) ) );
+      printf( "Size:         %lu bytes (%.2f per sample, %.2f per value)\n", (unsigned long)stReader.tSize,
+              (double)stReader.tSize / llSamples, (double)stReader.tSize / (llSamples * (pstHeader->wColumns + 1)) );
+   }
+
+   puts( "\nColumn  Sensor  Units  Usage" );
+   puts( "------  ------  -----  -----" );
+
+   for( iColumn = 0; iColumn < pstHeader->wColumns; iColumn++ )
+   {
+      pstColumn = &pstHeader->stColumn[iColumn];
+      iClass    = pstColumn->byClass % REC_CLASSES;
+
+      printf( "%-6s  %6d  %-5s  %s\n", szName[iColumn], pstColumn->byIndex, stClass[iClass].pszUnits,
+              stClass[iClass].pfnUsage( pstColumn->byUsage ) );
+   }
+}
+
+/****************************************************************************/
+/* ShowSamples() - Displays the samples taken between two times, inclusive, */
+/* or, given a period, one row per period formed by a function from the     */
+/* samples taken within it. Damaged blocks are reported and skipped.        */
+/****************************************************************************/
+
+static long ShowSamples( long long llStart, long long llEnd, long long llPeriod, int iFunction )
+{
+   const REC_BLOCK_HEADER *pstBlock;
+   long long              llTime, llValue, llFirst = 0;
+   long                   lBlock, lRows = 0, lSamples = 0;
+   char                   szTime[32];
+   int                    iSample, iSamples, iIndex;
+
+   ShowHeading( !llPeriod );
+
+   for( lBlock = RecFindBlock( &stReader, llStart ); lBlock < stReader.lBlocks; lBlock++ )
+   {
+      if( (pstBlock = RecGetBlock( &stReader, lBlock )) == NULL )
+      {
+         if( errno != ESTALE )
+            fprintf( stderr, "Block %ld skipped: %s\n", lBlock, strerror( errno ) );
+
+         continue;
+      }
+
+      if( pstBlock->llFirstTime > llEnd )
+         break;
+
+      if( pstBlock->llLastTime < llStart )
+         continue;
+
+      iSamples = RecDecode( pstBlock, 0, allTime );
+
+      for( iIndex = 0; (iIndex < iColumns) && (iSamples > 0); iIndex++ )
+      {
+         if( RecDecode( pstBlock, aiColumn[iIndex] + 1, allValue[iIndex] ) < 0 )
+            iSamples = -1;
+      }
+
+      if( iSamples < 0 )
+      {
+         fprintf( stderr, "Block %ld skipped: %s\n", lBlock, strerror( errno ) );
+         continue;
+      }
+
+      for( iSample = 0; iSample < iSamples; iSample++ )
+      {
+         llTime = allTime[iSample];
+
+         if( (llTime < llStart) || (llTime > llEnd) )
+            continue;
+
+         if( !llPeriod )
+         {
+            printf( "%-23s", FormatTime( llTime, TRUE, szTime, sizeof(szTime) ) );
+
+            for( iIndex = 0; iIndex < iColumns; iIndex++ )
+               ShowValue( iIndex, (double)allValue[iIndex][iSample] );
+
+            putchar( '\n' );
+            lRows++;
+            continue;
+         }
+
+         // Display the last period once a sample falls beyond it
+
+         if( lSamples && (llTime - llFirst >= llPeriod) )
+         {
+            ShowPeriod( llFirst, lSamples, iFunction );
+            lSamples = 0;
+            lRows++;
+         }
+
+         if( !lSamples )
+         {
+            llFirst = llTime - (((llTime % llPeriod) + llPeriod) % llPeriod);
+
+            for( iIndex = 0; iIndex < iColumns; iIndex++ )
+            {
+               adTotal[iIndex] = 0;
+               allMin[iIndex]  = LLONG_MAX;
+               allMax[iIndex]  = LLONG_MIN;
+            }
+         }
+
+         for( iIndex = 0; iIndex < iColumns; iIndex++ )
+         {
+            llValue = allValue[iIndex][iSample];
+
+            adTotal[iIndex] += (double)llValue;
+
+            if( llValue < allMin[iIndex] )
+               allMin[iIndex] = llValue;
+
+            if( llValue > allMax[iIndex] )
+               allMax[iIndex] = llValue;
+         }
+
+         lSamples++;
+      }
+   }
+
+   if( lSamples )
+   {
+      ShowPeriod( llFirst, lSamples, iFunction );
+      lRows++;
+   }
+
+   return( lRows );
+}
+
+/****************************************************************************/
+/* Usage() - Displays program usage                                         */
+/****************************************************************************/
+
+static void Usage( void )
+{
+   puts( "Usage: RecQuery [-l] [-s start] [-e end] [-d seconds] [-a function] [-c columns] file\n" );
+   puts( "   -l           List the recording's columns and extent" );
+   puts( "   -s start     Time of earliest sample displayed (default: first recorded)" );
+   puts( "   -e end       Time of latest sample displayed (default: last recorded)" );
+   puts( "   -d seconds   Display one row per period of this length" );
+   puts( "   -a function  Forms each period's row: mean, min or max (default mean)" );
+   puts( "   -c columns   Columns displayed, such as T0,F1,D0 (default: all)\n" );
+   puts( "Times are seconds since the Epoch, or local times as YYYY-MM-DD [HH:MM[:SS]]" );
+}
+
+/****************************************************************************/
+/* main() - Mainline for program                                            */
+/****************************************************************************/
+
+int main( int iArgs, char *pszArg[] )
+{
+   long long            llStart   = LLONG_MIN;
+   long long            llEnd     = LLONG_MAX;
+   long long            llPeriod  = 0;
+   char                 *pszStart = NULL, *pszEnd = NULL, *pszColumns = NULL;
+   BOOL                 bList     = FALSE;
+   int                  iFunction = SHOW_MEAN;
+   int                  iOption, iColumn;
+   long                 lRows;
+
+   while( (iOption = getopt( iArgs, pszArg, "ls:e:d:a:c:" )) != -1 )
+   {
+      switch( iOption )
+      {
+      case 'l':
+
+         bList = TRUE;
+         break;
+
+      case 's':
+
+         pszStart = optarg;
+         break;
+
+      case 'e':
+
+         pszEnd = optarg;
+         break;
+
+      case 'd':
+
+         if( (llPeriod = atoll( optarg ) * 1000) <= 0 )
+         {
+            Usage();
+            return( 1 );
+         }
+
+         break;
+
+      case 'a':
+
+         for( iFunction = 0; iFunction < (int)(sizeof(pszFunction) / sizeof(pszFunction[0])); iFunction++ )
+         {
+            if( !strcmp( optarg, pszFunction[iFunction] ) )
+               break;
+         }
+
+         if( iFunction == (int)(sizeof(pszFunction) / sizeof(pszFunction[0])) )
+         {
+            Usage();
+            return( 1 );
+         }
+
+         break;
+
+      case 'c':
+
+         pszColumns = optarg;
+         break;
+
+      default:
+
+         Usage();
+         return( 1 );
+      }
+   }
+
+   if( optind != iArgs - 1 )
+   {
+      Usage();
+      return( 1 );
+   }
+
+   if( (pszStart && !ParseTime( pszStart, &llStart )) || (pszEnd && !ParseTime( pszEnd, &llEnd )) )
+      return( 1 );
+
+   if( !RecOpenRead( pszArg[optind], &stReader ) )
+   {
+      printf( "\n*** Unable to open recording %s!!\n   ERRNO = %d (%s)\n\n", pszArg[optind], errno, strerror( errno ) );
+      return( errno );
+   }
+
+   NameColumns();
+
+   if( bList )
+      ListRecording();
+   else
+   {
+      if( pszColumns )
+      {
+         if( !SelectColumns( pszColumns ) )
+         {
+            RecCloseRead( &stReader );
+            return( 1 );
+         }
+      }
+      else
+      {
+         for( iColumn = 0; iColumn < stReader.pstHeader->wColumns; iColumn++ )
+            aiColumn[iColumns++] = iColumn;
+      }
+
+      lRows = ShowSamples( llStart, llEnd, llPeriod, iFunction );
+
+      if( !lRows )
+         puts( "No samples recorded in that time" );
+   }
+
+   RecCloseRead( &stReader );
+
+   return( 0 );
+}
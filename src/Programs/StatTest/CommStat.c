@@ -0,0 +1,320 @@
+/****************************************************************************/
+/*                                                                          */
+/*  Module:         CommStat.c                                              */
+/*                                                                          */
+/*  Description:    Implements program CommStat, which polls the  Intel(R)  */
+/*                  Quiet System Technology  (QST)  Subsystem  the  way  a  */
+/*                  monitoring  application   would   and   displays   the  */
+/*                  statistics  kept  by  the  QstComm  library:   latency  */
+/*                  histograms for each command  and  counts  of  retries,  */
+/*                  connections,  timeouts,  translations  and   coalesced  */
+/*                  reads.                                                  */
+/*                                                                          */
+/****************************************************************************/
+
+/****************************************************************************/
+/*                                                                          */
+/*     Copyright (c) 2005-2009, Intel Corporation. All Rights Reserved.     */
+/*                                                                          */
+/*  Redistribution and use in source and binary  forms,  with  or  without  */
+/*  modification, are permitted provided that the following conditions are  */
+/*  met:                                                                    */
+/*                                                                          */
+/*    - Redistributions of source code must  retain  the  above  copyright  */
+/*      notice, this list of conditions and the following disclaimer.       */
+/*                                                                          */
+/*    - Redistributions  in binary form must reproduce the above copyright  */
+/*      notice, this list of conditions and the  following  disclaimer  in  */
+/*      the   documentation  and/or  other  materials  provided  with  the  */
+/*      distribution.                                                       */
+/*                                                                          */
+/*    - Neither the name  of  Intel  Corporation  nor  the  names  of  its  */
+/*      contributors  may  be  used to endorse or promote products derived  */
+/*      from this software without specific prior written permission.       */
+/*                                                                          */
+/*  DISCLAIMER: THIS SOFTWARE IS PROVIDED BY  THE  COPYRIGHT  HOLDERS  AND  */
+/*  CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  */
+/*  BUT  NOT  LIMITED  TO,  THE  IMPLIED WARRANTIES OF MERCHANTABILITY AND  */
+/*  FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN  NO  EVENT  SHALL  */
+/*  INTEL  CORPORATION  OR  THE  CONTRIBUTORS  BE  LIABLE  FOR ANY DIRECT,  */
+/*  INDIRECT, INCIDENTAL, SPECIAL,  EXEMPLARY,  OR  CONSEQUENTIAL  DAMAGES  */
+/*  (INCLUDING,  BUT  NOT  LIMITED  TO, PROCUREMENT OF SUBSTITUTE GOODS OR  */
+/*  SERVICES; LOSS OF USE, DATA, OR  PROFITS;  OR  BUSINESS  INTERRUPTION)  */
+/*  HOWEVER  CAUSED  AND  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,  */
+/*  STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)  ARISING  */
+/*  IN  ANY  WAY  OUT  OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE  */
+/*  POSSIBILITY OF SUCH DAMAGE.                                             */
+/*                                                                          */
+/****************************************************************************/
+
+#ifndef __linux__
+#error This source module intended for use in Linux environments only
+#endif
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "QstCmd.h"
+#include "QstComm.h"
+
+/****************************************************************************/
+/* Definitions                                                              */
+/****************************************************************************/
+
+#define DEFAULT_PASSES      100         // Polling passes made by default
+#define DEFAULT_INTERVAL    0           // Delay between passes (milliseconds)
+
+static const char * const pszCommand[QST_STATS_COMMANDS] =
+{
+   "GET_SUBSYSTEM_INFO",
+   "GET_SUBSYSTEM_STATUS",
+   "GET_SUBSYSTEM_CONFIG",
+   "GET_SUBSYSTEM_CONFIG_PROFILE",
+   "SET_SUBSYSTEM_CONFIG",
+   "LOCK_SUBSYSTEM",
+   "UPDATE_CPU_CONFIG",
+   "GET_CPU_CONFIG_UPDATE",
+   "UPDATE_CPU_DTS_CONFIG",
+   "GET_CPU_DTS_CONFIG_UPDATE",
+   "UPDATE_FAN_CONFIG",
+   "GET_FAN_CONFIG_UPDATE",
+   "SST_PASS_THROUGH",
+   "GET_TEMP_MON_UPDATE",
+   "GET_TEMP_MON_CONFIG",
+   "SET_TEMP_MON_THRESHOLDS",
+   "SET_TEMP_MON_READING",
+   "NO_TEMP_MON_READINGS",
+   "GET_FAN_MON_UPDATE",
+   "GET_FAN_MON_CONFIG",
+   "SET_FAN_MON_THRESHOLDS",
+   "ENABLE_FAN_MON",
+   "DISABLE_FAN_MON",
+   "REDETECT_FAN_PRESENCE",
+   "GET_VOLT_MON_UPDATE",
+   "GET_VOLT_MON_CONFIG",
+   "SET_VOLT_MON_THRESHOLDS",
+   "GET_CURR_MON_UPDATE",
+   "GET_CURR_MON_CONFIG",
+   "SET_CURR_MON_THRESHOLDS",
+   "GET_FAN_CTRL_UPDATE",
+   "GET_FAN_CTRL_CONFIG",
+   "SET_FAN_CTRL_DUTY",
+   "SET_FAN_CTRL_AUTO",
+   "RESET_FAN_CTRL_MIN_DUTY"
+};
+
+/****************************************************************************/
+/* Commands making up a polling pass                                        */
+/****************************************************************************/
+
+static QST_GET_SUBSYSTEM_STATUS_RSP     stStatusRsp;
+static QST_GET_TEMP_MON_UPDATE_RSP      stTempRsp;
+static QST_GET_FAN_MON_UPDATE_RSP       stFanRsp;
+static QST_GET_VOLT_MON_UPDATE_RSP      stVoltRsp;
+static QST_GET_CURR_MON_UPDATE_RSP      stCurrRsp;
+static QST_GET_FAN_CTRL_UPDATE_RSP      stDutyRsp;
+
+static const struct
+{
+   UINT8    byCommand;                  // Command code
+   void     *pvRspBuf;                  // Buffer for response
+   size_t   tRspSize;                   // Size of response
+
+} stPass[] =
+{
+   { QST_GET_SUBSYSTEM_STATUS,  &stStatusRsp,   sizeof(stStatusRsp) },
+   { QST_GET_TEMP_MON_UPDATE,   &stTempRsp,     sizeof(stTempRsp)   },
+   { QST_GET_FAN_MON_UPDATE,    &stFanRsp,      sizeof(stFanRsp)    },
+   { QST_GET_VOLT_MON_UPDATE,   &stVoltRsp,     sizeof(stVoltRsp)   },
+   { QST_GET_CURR_MON_UPDATE,   &stCurrRsp,     sizeof(stCurrRsp)   },
+   { QST_GET_FAN_CTRL_UPDATE,   &stDutyRsp,     sizeof(stDutyRsp)   }
+};
+
+#define PASS_COMMANDS   (sizeof(stPass) / sizeof(stPass[0]))
+
+/****************************************************************************/
+/* Delay() - Implements an 'n' millisecond delay.                           */
+/****************************************************************************/
+
+static void Delay( int iMilliseconds )
+{
+   struct timespec stTime;
+
+   stTime.tv_sec  = (time_t)(iMilliseconds / 1000);
+   stTime.tv_nsec = 1000000L * (iMilliseconds % 1000);
+
+   while( (nanosleep( &stTime, &stTime ) == -1) && (errno == EINTR) );
+}
+
+/****************************************************************************/
+/* Percentile() - Returns the latency (microseconds) below which the given  */
+/* percentage of a command's latencies fall, to the precision of the        */
+/* histogram (but never more than the longest latency).                     */
+/****************************************************************************/
+
+static unsigned long long Percentile( P_QST_COMMAND_STATS pstCmd, int iPercent )
+{
+   unsigned long long ullWanted = (pstCmd->ullCount * iPercent + 99) / 100;
+   unsigned long long ullSeen   = 0;
+   int                iBucket;
+
+   for( iBucket = 0; iBucket < QST_STATS_BUCKETS - 1; iBucket++ )
+   {
+      ullSeen += pstCmd->aullHistogram[iBucket];
+
+      if( ullSeen >= ullWanted )
+         break;
+   }
+
+   if( (iBucket < QST_STATS_BUCKETS - 1) && (QST_STATS_BUCKET_FLOOR( iBucket + 1 ) < pstCmd->ullMaxTime) )
+      return( QST_STATS_BUCKET_FLOOR( iBucket + 1 ) );
+
+   return( pstCmd->ullMaxTime );
+}
+
+/****************************************************************************/
+/* DisplayStats() - Displays the statistics kept by the library             */
+/****************************************************************************/
+
+static void DisplayStats( P_QST_COMM_STATS pstStats, BOOL bHistograms )
+{
+   QST_COALESCE_STATS stCoalesce;
+   P_QST_COMMAND_STATS pstCmd;
+   int                iCommand, iBucket;
+
+   puts( "Command                         Count  Failed   Avg(us)   p50(us)   p99(us)   Max(us)" );
+   puts( "----------------------------- ------- ------- --------- --------- --------- ---------" );
+
+   for( iCommand = 0; iCommand < QST_STATS_COMMANDS; iCommand++ )
+   {
+      pstCmd = &pstStats->astCommand[iCommand];
+
+      if( !pstCmd->ullCount )
+         continue;
+
+      printf( "%-29s %7llu %7llu %9llu %9llu %9llu %9llu\n", pszCommand[iCommand],
+              pstCmd->ullCount, pstCmd->ullFailed, pstCmd->ullTotalTime / pstCmd->ullCount,
+              Percentile( pstCmd, 50 ), Percentile( pstCmd, 99 ), pstCmd->ullMaxTime );
+
+      if( bHistograms )
+      {
+         for( iBucket = 0; iBucket < QST_STATS_BUCKETS; iBucket++ )
+         {
+            if( pstCmd->aullHistogram[iBucket] )
+               printf( "   >= %9llu us: %llu\n", QST_STATS_BUCKET_FLOOR( iBucket ), pstCmd->aullHistogram[iBucket] );
+         }
+      }
+   }
+
+   printf( "\nRetries:      %llu\n", pstStats->ullRetries );
+   printf( "Attaches:     %llu\n",   pstStats->ullAttaches );
+   printf( "Detaches:     %llu\n",   pstStats->ullDetaches );
+   printf( "Timeouts:     %llu\n",   pstStats->ullTimeouts );
+   printf( "Translations: %llu\n",   pstStats->ullTranslations );
+   printf( "Probes:       %llu\n",   pstStats->ullProbes );
+
+   if( QstGetCoalesceStats( &stCoalesce ) )
+      printf( "Coalesced:    %lu of %lu reads\n", stCoalesce.ulCoalesced, stCoalesce.ulCoalesced + stCoalesce.ulIssued );
+}
+
+/****************************************************************************/
+/* Usage() - Displays program usage                                         */
+/****************************************************************************/
+
+static void Usage( void )
+{
+   puts( "Usage: CommStat [-n passes] [-i interval] [-h]\n" );
+   puts( "   -n passes    Polling passes to make (default 100)" );
+   puts( "   -i interval  Delay between passes, in milliseconds (default 0)" );
+   puts( "   -h           Display histograms" );
+}
+
+/****************************************************************************/
+/* main() - Mainline for program                                            */
+/****************************************************************************/
+
+int main( int iArgs, char *pszArg[] )
+{
+   QST_GENERIC_CMD      stCmd;          // Command packet
+   QST_COMM_STATS       stStats;        // Snapshot of statistics
+   int                  iPasses   = DEFAULT_PASSES;
+   int                  iInterval = DEFAULT_INTERVAL;
+   BOOL                 bHistograms = FALSE;
+   int                  iOption, iPass, iFailed = 0;
+   size_t               tIndex;
+
+   puts( "\nIntel(R) Quiet System Technology Communications Statistics" );
+   puts( "Copyright (C) 2007-2009, Intel Corporation. All Rights Reserved.\n" );
+
+   while( (iOption = getopt( iArgs, pszArg, "n:i:h" )) != -1 )
+   {
+      switch( iOption )
+      {
+      case 'n':
+
+         iPasses = atoi( optarg );
+         break;
+
+      case 'i':
+
+         iInterval = atoi( optarg );
+         break;
+
+      case 'h':
+
+         bHistograms = TRUE;
+         break;
+
+      default:
+
+         Usage();
+         return( 1 );
+      }
+   }
+
+   if( (iPasses <= 0) || (iInterval < 0) )
+   {
+      Usage();
+      return( 1 );
+   }
+
+   QstCommEnableStats( TRUE );
+
+   // Poll the subsystem the way a monitoring application would
+
+   for( iPass = 0; iPass < iPasses; iPass++ )
+   {
+      if( iPass && iInterval )
+         Delay( iInterval );
+
+      for( tIndex = 0; tIndex < PASS_COMMANDS; tIndex++ )
+      {
+         stCmd.stHeader.byCommand       = stPass[tIndex].byCommand;
+         stCmd.stHeader.byEntity        = 0;
+         stCmd.stHeader.wCommandLength  = 0;
+         stCmd.stHeader.wResponseLength = (UINT16)stPass[tIndex].tRspSize;
+
+         if( !QstCommand2( &stCmd, sizeof(QST_CMD_HEADER), stPass[tIndex].pvRspBuf, stPass[tIndex].tRspSize ) )
+            iFailed++;
+      }
+   }
+
+   if( !QstCommGetStats( &stStats ) )
+   {
+      printf( "\n*** Unable to obtain statistics!!\n   ERRNO = %d (%s)\n\n", errno, strerror( errno ) );
+      return( errno );
+   }
+
+   printf( "%d passes of %d commands (%d failed)\n\n", iPasses, (int)PASS_COMMANDS, iFailed );
+
+   DisplayStats( &stStats, bHistograms );
+
+   puts( "\nEnd of Report\n" );
+
+   return( 0 );
+}
@@ -18,6 +18,11 @@
 /*                  remove  module  ..\Support\QstInst.c  and  also remove  */
 /*                  definition DYNAMIC_DLL_LOADING.                         */
 /*                                                                          */
+/*              2.  When run with option -t, the program reports how long   */
+/*                  it took to enumerate the sensors and  controllers  (in  */
+/*                  InitializeQst()), for gauging the effect  of  batching  */
+/*                  and caching the enumeration.                            */
+/*                                                                          */
 /****************************************************************************/
 
 /****************************************************************************/
@@ -61,6 +66,7 @@
 #include <string.h>
 #include <errno.h>
 #include <ctype.h>
+#include <time.h>
 
 #if defined(__WIN32__) || defined(_WIN32) || defined(_WIN64) || defined(__WINDOWS__)
 #include <windows.h>
@@ -759,17 +765,58 @@ static BOOL DisplaySubsystemStatus( void )
    return( TRUE );
 }
 
+/****************************************************************************/
+/* MilliTime() - Returns a timestamp, in milliseconds, for timing intervals */
+/****************************************************************************/
+
+static double MilliTime( void )
+{
+#if defined(__WIN32__)
+
+   return( (double)GetTickCount() );
+
+#elif defined(__MSDOS__)
+
+   return( (double)clock() * 1000.0 / CLOCKS_PER_SEC );
+
+#else
+
+   struct timespec stNow;
+
+   clock_gettime( CLOCK_MONOTONIC, &stNow );
+   return( (double)stNow.tv_sec * 1000.0 + (double)stNow.tv_nsec / 1000000.0 );
+
+#endif
+}
+
 /****************************************************************************/
 /* main() - Mainline for program                                            */
 /****************************************************************************/
 
 int main( int iArgs, char *pszArg[] )
 {
+   BOOL     bTiming = FALSE;
+   double   dStart;
+
    puts( "\nIntel(R) Quiet System Technology Status Display Demo" );
    puts( "Copyright (C) 2007-2008, Intel Corporation. All Rights Reserved.\n" );
 
+   if( iArgs > 1 )
+   {
+      if( (iArgs > 2) || strcmp( pszArg[1], "-t" ) )
+      {
+         puts( "Usage: StatTest [-t]\n" );
+         puts( "   -t  Report the time taken to enumerate sensors and controllers" );
+         return( 1 );
+      }
+
+      bTiming = TRUE;
+   }
+
    // Initialize Sensor/Controller access
 
+   dStart = MilliTime();
+
    if( !InitializeQst() )
    {
 
@@ -812,6 +859,9 @@ int main( int iArgs, char *pszArg[] )
       }
    }
 
+   if( bTiming )
+      printf( "Enumeration took %.3f milliseconds\n\n", MilliTime() - dStart );
+
    // Display Subsystem Status Summary
 
    if( !DisplaySubsystemStatus() )      // Note: sets bConfig
@@ -850,10 +900,4 @@ int main( int iArgs, char *pszArg[] )
       CleanupQst();
 
    return( 0 );
-
-#if _MSC_VER > 1000
-   UNREFERENCED_PARAMETER( iArgs );
-   UNREFERENCED_PARAMETER( pszArg );
-#endif
-
 }